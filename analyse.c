@@ -0,0 +1,353 @@
+// analyse.c - Headless batch FEN analyser
+//
+// Streams FENs (one per line; blank lines and '#' comments are skipped)
+// from a file or stdin, analyses them on a pool of worker threads and
+// writes one JSON object per line, in input order:
+//
+//   {"line": 1, "fen": "...", "bestmove": "e2e4", "score": 31,
+//    "pv": "e2e4 e7e5", "depth": 6, "nodes": 48210, "time_ms": 180}
+//
+// Work flows through a fixed window of slots: the reader fills a slot,
+// any idle worker analyses it, and the writer emits slots strictly in
+// sequence.  The reader blocks when the window is full, so memory stays
+// bounded however long the input is and results never reorder.
+//
+//   ./analyse [--threads N] [--engine search|nn] [--depth D] [--movetime MS]
+//             [--nodes N] [--hash MB] [--value FILE] [--order-plies N]
+//             [--out FILE] [FILE | -]
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "chess.h"
+#include "nn.h"
+#include "search.h"
+#include "stats.h"
+#include "value.h"
+
+// Globals required by other modules
+struct Piece board[8][8];
+int depth = 4;
+
+#define ANALYSE_FEN_MAX      256
+#define ANALYSE_SLOTS_PER_THREAD 4
+
+enum SlotState { SLOT_FREE, SLOT_PENDING, SLOT_DONE };
+
+typedef struct {
+    enum SlotState state;
+    long long      line;
+    char           fen[ANALYSE_FEN_MAX];
+    int            ok;           // 0 = FEN rejected
+    SearchResult   result;
+    char           best[8];
+    char           pv[SEARCH_MAX_PLY * 6 + 1];
+} AnalyseSlot;
+
+typedef struct {
+    int  threads;
+    int  use_nn;
+    SearchLimits limits;
+    int  hash_mb;
+    const char *in_path;
+    const char *out_path;
+    const char *value_path;
+} AnalyseConfig;
+
+static AnalyseConfig cfg;
+static ValueNet value_net;
+static AnalyseSlot *slots;
+static int window;
+
+static pthread_mutex_t window_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  work_ready = PTHREAD_COND_INITIALIZER;    // reader -> workers
+static pthread_cond_t  result_ready = PTHREAD_COND_INITIALIZER;  // workers -> writer
+static pthread_cond_t  slot_freed = PTHREAD_COND_INITIALIZER;    // writer -> reader
+static long long next_read = 0;    // next sequence number the reader assigns
+static long long next_take = 0;    // next sequence number a worker picks up
+static long long next_write = 0;   // next sequence number the writer emits
+static int input_done = 0;
+
+static void analyse_slot(AnalyseSlot *s)
+{
+    SearchPosition pos;
+    s->ok = search_position_from_fen(&pos, s->fen);
+    memset(&s->result, 0, sizeof(s->result));
+    s->pv[0] = '\0';
+    if (!s->ok)
+        return;
+
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
+    if (cfg.use_nn) {
+        struct Piece scratch[8][8];
+        memcpy(scratch, pos.board, sizeof(scratch));
+        s->result.best = nn_pick_move_from(&g_net, scratch, pos.side, &pos.lastMove);
+        s->result.ponder = (struct Move){-1, -1, -1, -1};
+        s->result.pv[0] = s->result.best;
+        s->result.pv_len = (s->result.best.fromX >= 0);
+    } else {
+        s->result = search_position(&pos, &cfg.limits, NULL);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    s->result.time_ms = (int)((t1.tv_sec - t0.tv_sec) * 1000 + (t1.tv_nsec - t0.tv_nsec) / 1000000);
+
+    search_move_to_uci(&pos, s->result.best, s->best);
+    size_t used = 0;
+    for (int i = 0; i < s->result.pv_len && used < sizeof(s->pv); i++) {
+        char mv[8];
+        search_move_to_uci(&pos, s->result.pv[i], mv);
+        used += (size_t)snprintf(s->pv + used, sizeof(s->pv) - used, "%s%s", i ? " " : "", mv);
+        search_position_play(&pos, s->result.pv[i], -1);
+    }
+}
+
+static void *worker_main(void *arg)
+{
+    (void)arg;
+    for (;;) {
+        pthread_mutex_lock(&window_mutex);
+        while (next_take == next_read && !input_done)
+            pthread_cond_wait(&work_ready, &window_mutex);
+        if (next_take == next_read) {
+            pthread_mutex_unlock(&window_mutex);
+            break;
+        }
+        AnalyseSlot *s = &slots[next_take % window];
+        next_take++;
+        pthread_mutex_unlock(&window_mutex);
+
+        analyse_slot(s);
+
+        pthread_mutex_lock(&window_mutex);
+        s->state = SLOT_DONE;
+        pthread_cond_signal(&result_ready);
+        pthread_mutex_unlock(&window_mutex);
+    }
+    return NULL;
+}
+
+static void write_slot(FILE *out, const AnalyseSlot *s)
+{
+    fprintf(out, "{\"line\": %lld, \"fen\": \"", s->line);
+    for (const char *c = s->fen; *c; c++) {
+        if (*c == '"' || *c == '\\')
+            fputc('\\', out);
+        fputc(*c, out);
+    }
+    if (!s->ok) {
+        fprintf(out, "\", \"error\": \"invalid fen\"}\n");
+        return;
+    }
+
+    fprintf(out, "\", \"bestmove\": \"%s\", ", s->best);
+    if (cfg.use_nn)
+        fprintf(out, "\"score\": null, ");
+    else if (s->result.score > SEARCH_MATE_BOUND)
+        fprintf(out, "\"mate\": %d, ", (SEARCH_MATE - s->result.score + 1) / 2);
+    else if (s->result.score < -SEARCH_MATE_BOUND)
+        fprintf(out, "\"mate\": %d, ", -(SEARCH_MATE + s->result.score) / 2);
+    else
+        fprintf(out, "\"score\": %d, ", s->result.score);
+    fprintf(out, "\"pv\": \"%s\", \"depth\": %d, \"nodes\": %lld, \"time_ms\": %d}\n",
+            s->pv, s->result.depth, s->result.nodes, s->result.time_ms);
+}
+
+typedef struct {
+    FILE *out;
+    long long written;
+} WriterArgs;
+
+static void *writer_main(void *arg)
+{
+    WriterArgs *w = arg;
+    for (;;) {
+        pthread_mutex_lock(&window_mutex);
+        AnalyseSlot *s = &slots[next_write % window];
+        while (!(next_write < next_read && s->state == SLOT_DONE) &&
+               !(input_done && next_write == next_read))
+            pthread_cond_wait(&result_ready, &window_mutex);
+        if (next_write == next_read) {   // input_done and everything written
+            pthread_mutex_unlock(&window_mutex);
+            break;
+        }
+        pthread_mutex_unlock(&window_mutex);
+
+        write_slot(w->out, s);   // slot is ours until marked free
+        w->written++;
+
+        pthread_mutex_lock(&window_mutex);
+        s->state = SLOT_FREE;
+        next_write++;
+        pthread_cond_signal(&slot_freed);
+        pthread_mutex_unlock(&window_mutex);
+    }
+    fflush(w->out);
+    return NULL;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s [--threads N] [--engine search|nn] [--depth D] [--movetime MS]\n"
+            "          [--nodes N] [--hash MB] [--value FILE] [--order-plies N]\n"
+            "          [--out FILE] [FILE | -]\n"
+            "Reads one FEN per line (stdin when FILE is - or omitted) and writes\n"
+            "one JSON result per line in input order.  Default: search to depth 6.\n"
+            "--value makes the search evaluate leaves with that value network;\n"
+            "--order-plies lets nn_weights.bin order the quiet moves of the first N plies.\n",
+            prog);
+}
+
+int main(int argc, char *argv[])
+{
+    cfg.threads = 1;
+    cfg.hash_mb = 64;
+
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        const char *v = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (strcmp(a, "--threads") == 0 && v) {
+            cfg.threads = atoi(v); i++;
+        } else if (strcmp(a, "--engine") == 0 && v) {
+            if (strcmp(v, "nn") == 0) cfg.use_nn = 1;
+            else if (strcmp(v, "search") != 0) { usage(argv[0]); return 1; }
+            i++;
+        } else if (strcmp(a, "--depth") == 0 && v) {
+            cfg.limits.depth = atoi(v); i++;
+        } else if (strcmp(a, "--movetime") == 0 && v) {
+            cfg.limits.movetime_ms = atoi(v); i++;
+        } else if (strcmp(a, "--nodes") == 0 && v) {
+            cfg.limits.nodes = atoll(v); i++;
+        } else if (strcmp(a, "--hash") == 0 && v) {
+            cfg.hash_mb = atoi(v); i++;
+        } else if (strcmp(a, "--value") == 0 && v) {
+            cfg.value_path = v; i++;
+        } else if (strcmp(a, "--order-plies") == 0 && v) {
+            cfg.limits.order_plies = atoi(v); i++;
+        } else if (strcmp(a, "--out") == 0 && v) {
+            cfg.out_path = v; i++;
+        } else if (a[0] != '-' || strcmp(a, "-") == 0) {
+            cfg.in_path = a;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (cfg.threads < 1) cfg.threads = 1;
+    if (cfg.threads > SEARCH_MAX_THREADS) cfg.threads = SEARCH_MAX_THREADS;
+    if (!cfg.limits.depth && !cfg.limits.movetime_ms && !cfg.limits.nodes)
+        cfg.limits.depth = 6;
+    if (cfg.value_path) {
+        if (!value_load(&value_net, cfg.value_path))
+            return 1;
+        cfg.limits.value_net = &value_net;
+    }
+
+    FILE *in = stdin;
+    if (cfg.in_path && strcmp(cfg.in_path, "-") != 0) {
+        in = fopen(cfg.in_path, "r");
+        if (!in) {
+            fprintf(stderr, "analyse: cannot open %s\n", cfg.in_path);
+            return 1;
+        }
+    }
+    FILE *out = stdout;
+    if (cfg.out_path) {
+        out = fopen(cfg.out_path, "w");
+        if (!out) {
+            fprintf(stderr, "analyse: cannot open %s for writing\n", cfg.out_path);
+            return 1;
+        }
+    }
+
+    suppress_engine_output = 1;
+    if (cfg.use_nn || cfg.limits.order_plies > 0) {
+        if (!nn_load(&g_net, "nn_weights.bin"))
+            nn_init(&g_net);
+    }
+    if (!cfg.use_nn) {
+        if (cfg.limits.order_plies > 0)
+            cfg.limits.order_net = &g_net;
+        search_init(1, cfg.hash_mb);   // workers search synchronously on the shared TT
+    }
+
+    window = cfg.threads * ANALYSE_SLOTS_PER_THREAD;
+    slots = calloc((size_t)window, sizeof(AnalyseSlot));
+    if (!slots) {
+        fprintf(stderr, "analyse: out of memory\n");
+        return 1;
+    }
+
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
+    pthread_t workers[SEARCH_MAX_THREADS], writer;
+    WriterArgs wargs = {out, 0};
+    for (int i = 0; i < cfg.threads; i++)
+        pthread_create(&workers[i], NULL, worker_main, NULL);
+    pthread_create(&writer, NULL, writer_main, &wargs);
+
+    char line[1024];
+    long long line_no = 0;
+    while (fgets(line, sizeof(line), in)) {
+        line_no++;
+        char *fen = line;
+        while (*fen == ' ' || *fen == '\t')
+            fen++;
+        fen[strcspn(fen, "\r\n")] = '\0';
+        if (*fen == '\0' || *fen == '#')
+            continue;
+
+        pthread_mutex_lock(&window_mutex);
+        while (next_read - next_write >= window)
+            pthread_cond_wait(&slot_freed, &window_mutex);
+        AnalyseSlot *s = &slots[next_read % window];
+        pthread_mutex_unlock(&window_mutex);
+
+        // Slot is free and invisible to workers until next_read advances
+        s->line = line_no;
+        size_t len = strlen(fen);
+        if (len >= sizeof(s->fen))
+            len = sizeof(s->fen) - 1;   // overlong lines are reported as invalid FENs
+        memcpy(s->fen, fen, len);
+        s->fen[len] = '\0';
+
+        pthread_mutex_lock(&window_mutex);
+        s->state = SLOT_PENDING;
+        next_read++;
+        pthread_cond_signal(&work_ready);
+        pthread_mutex_unlock(&window_mutex);
+    }
+
+    pthread_mutex_lock(&window_mutex);
+    input_done = 1;
+    pthread_cond_broadcast(&work_ready);
+    pthread_cond_broadcast(&result_ready);
+    pthread_mutex_unlock(&window_mutex);
+
+    for (int i = 0; i < cfg.threads; i++)
+        pthread_join(workers[i], NULL);
+    pthread_join(writer, NULL);
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double secs = (double)(t1.tv_sec - t0.tv_sec) + (double)(t1.tv_nsec - t0.tv_nsec) / 1e9;
+    fprintf(stderr, "analyse: %lld positions in %.2f s (%.1f pos/s, %d threads)\n",
+            wargs.written, secs, secs > 0 ? (double)wargs.written / secs : 0.0, cfg.threads);
+
+    if (in != stdin)
+        fclose(in);
+    if (out != stdout)
+        fclose(out);
+    free(slots);
+    if (!cfg.use_nn)
+        search_shutdown();
+    if (cfg.use_nn || cfg.limits.order_net)
+        nn_free(&g_net);
+    return 0;
+}
@@ -0,0 +1,899 @@
+// bench.c - Headless benchmark runner with machine-readable output
+//
+// Runs a fixed set of suites (perft, FEN parsing, leaf evaluators and eval
+// primitives, NN forward single and batched, nn_pick_move, mate solver vs
+// generic picker, multi-threaded puzzle run, training epoch, move ordering,
+// MCTS playouts) with pinned CPUs and fixed seeds, and prints one JSON document with per-case
+// median/p95 timings and throughput.  Progress goes to stderr so stdout can
+// be redirected straight into a results file.
+//
+//   ./bench [--quick] [--suite NAME]... [--reps N] [--depth D]
+//           [--puzzles N] [--threads N] [--seed S] [--out FILE]
+//           [--trace FILE]
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include "chess.h"
+#include "mate.h"
+#include "mcts.h"
+#include "nn.h"
+#include "search.h"
+#include "stats.h"
+#include "trace.h"
+#include "value.h"
+
+// Globals required by other modules
+struct Piece board[8][8];
+int depth = 4;
+
+#define BENCH_MAX_REPS      64
+#define BENCH_MAX_RESULTS   32
+#define BENCH_POSITIONS     64
+
+typedef struct {
+    const char *suite;
+    const char *name;
+    const char *unit;          // what `items` counts: nodes, positions, puzzles, samples
+    long long items;           // work done per repetition
+    int reps;
+    double samples_ms[BENCH_MAX_REPS];
+    long long extra;           // suite-specific value (perft nodes check, puzzles passed)
+    const char *extra_name;
+} BenchResult;
+
+typedef struct {
+    int reps;
+    int depth;
+    int puzzles;
+    int threads;
+    unsigned long long seed;
+    int quick;
+    const char *suites[16];
+    int suite_count;
+    const char *out_path;
+    const char *trace_path;
+} BenchConfig;
+
+static BenchResult results[BENCH_MAX_RESULTS];
+static int result_count = 0;
+static int pinned_ok = 0;
+
+// ── Timing / statistics ──────────────────────────────────────────────────────
+
+static double now_ms(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double)t.tv_sec * 1e3 + (double)t.tv_nsec / 1e6;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Nearest-rank percentile over the repetition samples
+static double percentile(const BenchResult *r, double pct)
+{
+    double sorted[BENCH_MAX_REPS];
+    memcpy(sorted, r->samples_ms, (size_t)r->reps * sizeof(double));
+    qsort(sorted, (size_t)r->reps, sizeof(double), cmp_double);
+    int rank = (int)(pct / 100.0 * r->reps + 0.999999);
+    if (rank < 1) rank = 1;
+    if (rank > r->reps) rank = r->reps;
+    return sorted[rank - 1];
+}
+
+static BenchResult *new_result(const char *suite, const char *name, const char *unit, long long items)
+{
+    if (result_count >= BENCH_MAX_RESULTS)
+        return NULL;
+    BenchResult *r = &results[result_count++];
+    memset(r, 0, sizeof(*r));
+    r->suite = suite;
+    r->name = name;
+    r->unit = unit;
+    r->items = items;
+    return r;
+}
+
+static void record(BenchResult *r, double ms)
+{
+    if (r && r->reps < BENCH_MAX_REPS)
+        r->samples_ms[r->reps++] = ms;
+}
+
+// ── Pinning / seeding ────────────────────────────────────────────────────────
+
+// Restrict the calling thread to CPUs [0, n).  Threads created afterwards
+// inherit the mask, so puzzle workers stay on the same cores run to run.
+static int pin_to_cpus(int n)
+{
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    if (online < 1) online = 1;
+    if (n > online) n = (int)online;
+    if (n < 1) n = 1;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int i = 0; i < n; i++)
+        CPU_SET(i, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+static unsigned long long rng_state;
+
+static unsigned long long rng_next(void)
+{
+    // xorshift64* — independent of rand(), which nn_init reseeds from the clock
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return rng_state * 2685821657736338717ULL;
+}
+
+// ── Board helpers ────────────────────────────────────────────────────────────
+
+// Play m on b in place and update the global lastMove (validMoves reads it
+// for en passant).  Promotions go to a queen, matching validMoves.
+static void bench_make_move(struct Piece b[8][8], struct Move m)
+{
+    struct Piece moving = b[m.fromX][m.fromY];
+
+    if (moving.type == PAWN && m.fromX != m.toX && b[m.toX][m.toY].type == (enum PieceType)-1) {
+        b[m.toX][m.fromY].type = -1;
+        b[m.toX][m.fromY].colour = -1;
+    }
+
+    b[m.toX][m.toY] = moving;
+    b[m.toX][m.toY].hasMoved = 1;
+    b[m.fromX][m.fromY].type = -1;
+    b[m.fromX][m.fromY].colour = -1;
+
+    if (moving.type == PAWN && (m.toY == 7 || m.toY == 0))
+        b[m.toX][m.toY].type = QUEEN;
+
+    if (moving.type == KING && m.fromX == 4 && (m.toX == 6 || m.toX == 2)) {
+        int rf = (m.toX == 6) ? 7 : 0, rt = (m.toX == 6) ? 5 : 3;
+        b[rt][m.toY] = b[rf][m.toY];
+        b[rt][m.toY].hasMoved = 1;
+        b[rf][m.toY].type = -1;
+        b[rf][m.toY].colour = -1;
+    }
+
+    lastMove = m;
+}
+
+static long long perft(struct Piece b[8][8], enum Colour side, int d)
+{
+    struct MoveList moves = validMoves(b, side);
+    if (d <= 1)
+        return moves.count;
+
+    struct Move saved = lastMove;
+    long long nodes = 0;
+    for (int i = 0; i < moves.count; i++) {
+        struct Piece child[8][8];
+        memcpy(child, b, sizeof(child));
+        bench_make_move(child, moves.moves[i]);
+        nodes += perft(child, side == WHITE ? BLACK : WHITE, d - 1);
+        lastMove = saved;
+    }
+    return nodes;
+}
+
+// Seeded random playouts from the start position: a reproducible mix of
+// opening and middlegame positions for the per-position suites.
+typedef struct {
+    struct Piece board[8][8];
+    struct Piece next[8][8];   // board after one more random legal move
+    enum Colour side;
+    struct Move last;
+} BenchPosition;
+
+static BenchPosition positions[BENCH_POSITIONS];
+static int position_count = 0;
+
+static void build_positions(unsigned long long seed)
+{
+    rng_state = seed ? seed : 1;
+    struct Move saved = lastMove;
+    position_count = 0;
+
+    while (position_count < BENCH_POSITIONS) {
+        boardSetup();
+        struct Piece b[8][8];
+        memcpy(b, board, sizeof(b));
+        enum Colour side = WHITE;
+        lastMove = (struct Move){-1, -1, -1, -1};
+
+        int plies = 4 + (int)(rng_next() % 40);
+        int ok = 1;
+        for (int p = 0; p < plies; p++) {
+            struct MoveList ml = validMoves(b, side);
+            if (ml.count == 0) { ok = 0; break; }
+            bench_make_move(b, ml.moves[rng_next() % (unsigned)ml.count]);
+            side = (side == WHITE) ? BLACK : WHITE;
+        }
+        if (!ok)
+            continue;
+
+        struct MoveList ml = validMoves(b, side);
+        if (ml.count == 0)
+            continue;
+
+        BenchPosition *pos = &positions[position_count++];
+        memcpy(pos->board, b, sizeof(b));
+        pos->side = side;
+        pos->last = lastMove;
+        memcpy(pos->next, b, sizeof(b));
+        bench_make_move(pos->next, ml.moves[rng_next() % (unsigned)ml.count]);
+    }
+
+    lastMove = saved;
+}
+
+// ── Suites ───────────────────────────────────────────────────────────────────
+
+static void bench_perft(const BenchConfig *cfg)
+{
+    static const struct {
+        const char *name;
+        const char *fen;   // NULL = standard start position
+        int depth;
+    } cases[] = {
+        {"startpos", NULL, 3},
+        {"kiwipete", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 2},
+    };
+
+    struct Move saved = lastMove;
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        struct Piece b[8][8];
+        if (cases[c].fen) {
+            loadBoardFromFEN(cases[c].fen, b);
+        } else {
+            boardSetup();
+            memcpy(b, board, sizeof(b));
+        }
+
+        lastMove = (struct Move){-1, -1, -1, -1};
+        long long nodes = perft(b, WHITE, cases[c].depth);
+        BenchResult *r = new_result("perft", cases[c].name, "nodes", nodes);
+        if (!r) break;
+        r->extra = cases[c].depth;
+        r->extra_name = "depth";
+
+        for (int i = 0; i < cfg->reps; i++) {
+            double t0 = now_ms();
+            perft(b, WHITE, cases[c].depth);
+            record(r, now_ms() - t0);
+        }
+    }
+    lastMove = saved;
+}
+
+// The leaf evaluators of the alpha-beta search (hand-crafted and value
+// network) next to the primitives the engine spends its per-position work on.
+static ValueNet bench_value_net;
+
+static void bench_eval(const BenchConfig *cfg)
+{
+    struct Move saved = lastMove;
+    BenchResult *hand = new_result("eval", "search_evaluate", "positions", position_count);
+    BenchResult *value = new_result("eval", "value_evaluate", "positions", position_count);
+    BenchResult *enc = new_result("eval", "nn_encode_board", "positions", position_count);
+    BenchResult *chk = new_result("eval", "isInCheck", "positions", position_count);
+    BenchResult *gen = new_result("eval", "validMoves", "positions", position_count);
+    BenchResult *mate = new_result("eval", "isCheckmate", "positions", position_count);
+    BenchResult *count = new_result("eval", "countLegalMoves", "positions", position_count);
+    BenchResult *stale = new_result("eval", "isStalemate", "positions", position_count);
+    BenchResult *checks = new_result("eval", "checkingMoves", "positions", position_count);
+    float vec[NN_INPUT_SIZE];
+    volatile long long sink = 0;
+    static SearchPosition sp[BENCH_POSITIONS];
+    for (int p = 0; p < position_count; p++)
+        search_position_from_board(&sp[p], positions[p].board, positions[p].side, &positions[p].last);
+    if (!value_load(&bench_value_net, VALUE_DEFAULT_PATH))
+        value_init(&bench_value_net);
+
+    for (int i = 0; i < cfg->reps; i++) {
+        double t0 = now_ms();
+        for (int k = 0; k < 16; k++)
+            for (int p = 0; p < position_count; p++)
+                sink += search_evaluate(&sp[p]);
+        record(hand, (now_ms() - t0) / 16.0);
+
+        t0 = now_ms();
+        for (int k = 0; k < 16; k++)
+            for (int p = 0; p < position_count; p++)
+                sink += value_evaluate(&bench_value_net, (const struct Piece (*)[8])positions[p].board,
+                                       positions[p].side);
+        record(value, (now_ms() - t0) / 16.0);
+
+        t0 = now_ms();
+        for (int k = 0; k < 16; k++)
+            for (int p = 0; p < position_count; p++) {
+                nn_encode_board(positions[p].board, vec);
+                sink += (long long)vec[p];
+            }
+        record(enc, (now_ms() - t0) / 16.0);
+
+        t0 = now_ms();
+        for (int p = 0; p < position_count; p++)
+            sink += isInCheck(positions[p].board, positions[p].side);
+        record(chk, now_ms() - t0);
+
+        t0 = now_ms();
+        for (int p = 0; p < position_count; p++) {
+            lastMove = positions[p].last;
+            sink += validMoves(positions[p].board, positions[p].side).count;
+        }
+        record(gen, now_ms() - t0);
+
+        t0 = now_ms();
+        for (int p = 0; p < position_count; p++) {
+            lastMove = positions[p].last;
+            sink += isCheckmate(positions[p].board, positions[p].side);
+        }
+        record(mate, now_ms() - t0);
+
+        t0 = now_ms();
+        for (int p = 0; p < position_count; p++)
+            sink += countLegalMoves(positions[p].board, positions[p].side, &positions[p].last);
+        record(count, now_ms() - t0);
+
+        t0 = now_ms();
+        for (int p = 0; p < position_count; p++) {
+            lastMove = positions[p].last;
+            sink += isStalemate(positions[p].board, positions[p].side);
+        }
+        record(stale, now_ms() - t0);
+
+        t0 = now_ms();
+        for (int p = 0; p < position_count; p++)
+            sink += checkingMoves(positions[p].board, positions[p].side, &positions[p].last).count;
+        record(checks, now_ms() - t0);
+    }
+    (void)sink;
+    lastMove = saved;
+}
+
+static void bench_nn_forward(const BenchConfig *cfg)
+{
+    float *in = malloc((size_t)position_count * NN_INPUT_SIZE * sizeof(float));
+    float *out = malloc((size_t)position_count * g_net.output_size * sizeof(float));
+    if (!in || !out) {
+        fprintf(stderr, "bench: out of memory for nn_forward suite\n");
+        free(in);
+        free(out);
+        return;
+    }
+    for (int p = 0; p < position_count; p++)
+        nn_encode_board(positions[p].board, in + (size_t)p * NN_INPUT_SIZE);
+
+    BenchResult *single = new_result("nn_forward", "single", "positions", position_count);
+    for (int i = 0; i < cfg->reps; i++) {
+        double t0 = now_ms();
+        for (int p = 0; p < position_count; p++)
+            nn_forward(&g_net, in + (size_t)p * NN_INPUT_SIZE, out + (size_t)p * g_net.output_size);
+        record(single, now_ms() - t0);
+    }
+
+    static const int batch_sizes[] = {8, 64};
+    static const char *batch_names[] = {"batch8", "batch64"};
+    for (size_t k = 0; k < sizeof(batch_sizes) / sizeof(batch_sizes[0]); k++) {
+        int bs = batch_sizes[k];
+        if (bs > position_count) bs = position_count;
+        BenchResult *r = new_result("nn_forward", batch_names[k], "positions", position_count);
+        for (int i = 0; i < cfg->reps; i++) {
+            double t0 = now_ms();
+            for (int p = 0; p < position_count; p += bs) {
+                int n = (position_count - p < bs) ? position_count - p : bs;
+                nn_forward_batch(&g_net, in + (size_t)p * NN_INPUT_SIZE,
+                                 out + (size_t)p * g_net.output_size, n);
+            }
+            record(r, now_ms() - t0);
+        }
+    }
+
+    free(in);
+    free(out);
+}
+
+static void bench_nn_pick_move(const BenchConfig *cfg)
+{
+    struct Move saved = lastMove;
+    BenchResult *r = new_result("nn_pick_move", "positions", "positions", position_count);
+    for (int i = 0; i < cfg->reps; i++) {
+        double t0 = now_ms();
+        for (int p = 0; p < position_count; p++) {
+            lastMove = positions[p].last;
+            nn_pick_move(&g_net, positions[p].board, positions[p].side);
+        }
+        record(r, now_ms() - t0);
+    }
+    lastMove = saved;
+}
+
+static void bench_puzzles(const BenchConfig *cfg)
+{
+    const char *csv = "lichess_db_puzzle.csv";
+    FILE *f = fopen(csv, "r");
+    if (!f) {
+        fprintf(stderr, "bench: %s not found, skipping puzzle suite\n", csv);
+        return;
+    }
+    fclose(f);
+
+    BenchResult *r = new_result("puzzles", "multithreaded", "puzzles", cfg->puzzles);
+    if (!r) return;
+    r->extra_name = "passed";
+
+    pin_to_cpus(cfg->threads);
+    for (int i = 0; i < cfg->reps; i++) {
+        double t0 = now_ms();
+        r->extra = playPuzzlesMultiThreaded(csv, cfg->depth, cfg->puzzles, cfg->threads, NULL);
+        record(r, now_ms() - t0);
+    }
+    pin_to_cpus(1);
+}
+
+// FEN parse / serialise throughput over every FEN in the puzzle DB.  The
+// DB is read into memory first so only parseFEN/writeFEN are timed; small
+// DBs are looped until each rep covers at least FEN_BENCH_MIN parses.
+#define FEN_BENCH_MIN 200000
+
+static void bench_fen(const BenchConfig *cfg)
+{
+    const char *csv = "lichess_db_puzzle.csv";
+    FILE *f = fopen(csv, "r");
+    if (!f) {
+        fprintf(stderr, "bench: %s not found, skipping fen suite\n", csv);
+        return;
+    }
+
+    char (*fens)[96] = NULL;
+    int count = 0, capacity = 0;
+    char line[2048];
+    while (fgets(line, sizeof(line), f)) {
+        // PuzzleId,FEN,...; the header row has no valid FEN and is dropped below
+        char *start = strchr(line, ',');
+        char *end = start ? strchr(start + 1, ',') : NULL;
+        if (!end || end - start - 1 >= 96)
+            continue;
+        if (count == capacity) {
+            capacity = capacity ? capacity * 2 : 1024;
+            char (*grown)[96] = realloc(fens, (size_t)capacity * sizeof(*fens));
+            if (!grown) break;
+            fens = grown;
+        }
+        memcpy(fens[count], start + 1, (size_t)(end - start - 1));
+        fens[count][end - start - 1] = '\0';
+        struct Position check;
+        if (parseFEN(fens[count], &check))
+            count++;
+    }
+    fclose(f);
+    if (count == 0) {
+        free(fens);
+        return;
+    }
+
+    int passes = (FEN_BENCH_MIN + count - 1) / count;
+    if (cfg->quick && passes > 1) passes = (passes + 3) / 4;
+    long long items = (long long)passes * count;
+
+    BenchResult *parse = new_result("fen", "parse", "fens", items);
+    BenchResult *roundtrip = new_result("fen", "roundtrip", "fens", items);
+    if (!parse || !roundtrip) {
+        free(fens);
+        return;
+    }
+
+    struct Position pos;
+    char out[128];
+    volatile int sink = 0;   // keep the work observable to the optimiser
+    for (int i = 0; i < cfg->reps; i++) {
+        double t0 = now_ms();
+        for (int p = 0; p < passes; p++)
+            for (int k = 0; k < count; k++)
+                sink += parseFEN(fens[k], &pos);
+        record(parse, now_ms() - t0);
+
+        long long mismatches = 0;
+        t0 = now_ms();
+        for (int p = 0; p < passes; p++)
+            for (int k = 0; k < count; k++) {
+                parseFEN(fens[k], &pos);
+                writeFEN(&pos, out, sizeof(out));
+                mismatches += (strcmp(out, fens[k]) != 0);
+            }
+        record(roundtrip, now_ms() - t0);
+        roundtrip->extra = mismatches / passes;
+    }
+    roundtrip->extra_name = "mismatches";
+    parse->extra = count;
+    parse->extra_name = "db_fens";
+    (void)sink;
+    free(fens);
+}
+
+// Mate-themed puzzles from the DB, solved by the proof-number solver and by
+// the generic NN picker the puzzle runner used before routing.  A puzzle
+// counts as solved when the first engine move is the expected one or mates
+// at once, the same rule the puzzle runner applies.
+#define MATE_BENCH_MAX 256
+
+typedef struct {
+    struct Piece board[8][8];
+    enum Colour side;
+    struct Move last;
+    struct Move expected;
+    int mate_moves;
+} MatePuzzle;
+
+static struct Move bench_parse_uci(const char *uci)
+{
+    return (struct Move){uci[0] - 'a', uci[1] - '1', uci[2] - 'a', uci[3] - '1'};
+}
+
+static int mate_puzzle_solved(const MatePuzzle *p, struct Move m)
+{
+    if (m.fromX < 0)
+        return 0;
+    if (memcmp(&m, &p->expected, sizeof(m)) == 0)
+        return 1;
+    struct Piece b[8][8];
+    memcpy(b, p->board, sizeof(b));
+    playMoveOnBoard(b, m);
+    return isCheckmate(b, p->side == WHITE ? BLACK : WHITE);
+}
+
+static void bench_mate(const BenchConfig *cfg)
+{
+    const char *csv = "lichess_db_puzzle.csv";
+    FILE *f = fopen(csv, "r");
+    if (!f) {
+        fprintf(stderr, "bench: %s not found, skipping mate suite\n", csv);
+        return;
+    }
+
+    static MatePuzzle puzzles[MATE_BENCH_MAX];
+    int count = 0;
+    char line[2048];
+    while (count < MATE_BENCH_MAX && fgets(line, sizeof(line), f)) {
+        // PuzzleId,FEN,Moves,Rating,RatingDeviation,Popularity,NbPlays,Themes,...
+        char *field[8];
+        int n = 0;
+        for (char *save = NULL, *tok = strtok_r(line, ",", &save); tok && n < 8; tok = strtok_r(NULL, ",", &save))
+            field[n++] = tok;
+        if (n < 8)
+            continue;
+        int mate_moves = mate_theme_length(field[7]);
+        struct Position pos;
+        if (mate_moves == 0 || !parseFEN(field[1], &pos) || strlen(field[2]) < 9)
+            continue;
+
+        // The first solution move is the opponent's setup move
+        MatePuzzle *p = &puzzles[count++];
+        struct Move setup = bench_parse_uci(field[2]);
+        memcpy(p->board, pos.board, sizeof(p->board));
+        playMoveOnBoard(p->board, setup);
+        p->side = pos.sideToMove == WHITE ? BLACK : WHITE;
+        p->last = setup;
+        p->expected = bench_parse_uci(field[2] + 5);
+        p->mate_moves = mate_moves;
+    }
+    fclose(f);
+    if (count == 0)
+        return;
+
+    BenchResult *solver = new_result("mate", "pn_solver", "puzzles", count);
+    BenchResult *generic = new_result("mate", "generic", "puzzles", count);
+    MateSolver *mate = mate_solver_new(MATE_TT_BITS_DEFAULT);
+    if (!solver || !generic || !mate) {
+        mate_solver_free(mate);
+        return;
+    }
+    solver->extra_name = generic->extra_name = "solved";
+
+    struct Move saved = lastMove;
+    for (int i = 0; i < cfg->reps; i++) {
+        // Fresh table each rep so every rep does the same work
+        mate_solver_clear(mate);
+        long long solved = 0;
+        double t0 = now_ms();
+        for (int k = 0; k < count; k++) {
+            struct Move m;
+            mate_solve(mate, puzzles[k].board, puzzles[k].side, &puzzles[k].last,
+                       puzzles[k].mate_moves, MATE_NODES_DEFAULT, &m);
+            solved += mate_puzzle_solved(&puzzles[k], m);
+        }
+        record(solver, now_ms() - t0);
+        solver->extra = solved;
+
+        solved = 0;
+        t0 = now_ms();
+        for (int k = 0; k < count; k++) {
+            struct Piece b[8][8];
+            memcpy(b, puzzles[k].board, sizeof(b));
+            lastMove = puzzles[k].last;
+            solved += mate_puzzle_solved(&puzzles[k], nn_pick_move(&g_net, b, puzzles[k].side));
+        }
+        record(generic, now_ms() - t0);
+        generic->extra = solved;
+    }
+    lastMove = saved;
+    mate_solver_free(mate);
+}
+
+// One epoch of teacher-forced SGD over the seeded positions.  Trains a
+// private copy of the weights so nn_weights.bin and g_net are left untouched.
+static void bench_training(const BenchConfig *cfg)
+{
+    NeuralNet net = {0};
+    if (!nn_load(&net, "nn_weights.bin"))
+        nn_init(&net);
+
+    int samples = cfg->quick ? 16 : position_count;
+    BenchResult *r = new_result("training", "epoch", "samples", samples);
+    int reps = cfg->reps < 3 ? cfg->reps : 3;   // an epoch is seconds long on CPU
+    for (int i = 0; i < reps; i++) {
+        double t0 = now_ms();
+        for (int p = 0; p < samples; p++)
+            nn_train_step(&net, positions[p].board, positions[p].next, 0.001f);
+        record(r, now_ms() - t0);
+    }
+
+    nn_free(&net);
+}
+
+// Fixed-depth alpha-beta over the seeded positions with heuristic move
+// ordering, then with the network ranking the first two plies.  items counts
+// nodes and extra the beta cutoffs, so the ordering gain reads off directly.
+static void bench_ordering(const BenchConfig *cfg)
+{
+    static const char *names[] = {"heuristic", "nn_ordered"};
+    int count = cfg->quick ? 8 : 16;
+    search_init(1, 16);
+    for (int k = 0; k < 2; k++) {
+        SearchLimits limits = {0};
+        limits.depth = cfg->depth;
+        if (k == 1) {
+            limits.order_net = &g_net;
+            limits.order_plies = 2;
+        }
+        BenchResult *r = new_result("ordering", names[k], "nodes", 0);
+        if (!r) break;
+        r->extra_name = "cutoffs";
+        int reps = cfg->reps < 3 ? cfg->reps : 3;
+        for (int i = 0; i < reps; i++) {
+            StatsSnapshot before, after;
+            long long nodes = 0;
+            search_clear();   // every rep starts from an empty TT
+            stats_snapshot(&before);
+            double t0 = now_ms();
+            for (int p = 0; p < count; p++) {
+                SearchPosition pos;
+                search_position_from_board(&pos, positions[p].board, positions[p].side, &positions[p].last);
+                nodes += search_position(&pos, &limits, NULL).nodes;
+            }
+            record(r, now_ms() - t0);
+            stats_snapshot(&after);
+            r->items = nodes;
+            r->extra = (long long)(after.counters[STAT_CUTOFFS] - before.counters[STAT_CUTOFFS]);
+        }
+    }
+    search_shutdown();
+}
+
+// MCTS playouts per second over the seeded positions, one thread and then
+// --threads threads on the same budget; extra is the deepest playout.
+static void bench_mcts(const BenchConfig *cfg)
+{
+    int count = cfg->quick ? 4 : 8;
+    long long visits = cfg->quick ? 200 : 800;
+    int threads[2] = {1, cfg->threads};
+    for (int k = 0; k < (cfg->threads > 1 ? 2 : 1); k++) {
+        MCTSLimits limits = {0};
+        limits.visits = visits;
+        limits.threads = threads[k];
+        limits.policy = &g_net;
+        BenchResult *r = new_result("mcts", k ? "threads_n" : "threads1", "playouts", 0);
+        if (!r) break;
+        r->extra_name = "seldepth";
+        int reps = cfg->reps < 3 ? cfg->reps : 3;
+        for (int i = 0; i < reps; i++) {
+            long long playouts = 0;
+            int seldepth = 0;
+            double t0 = now_ms();
+            for (int p = 0; p < count; p++) {
+                SearchPosition pos;
+                search_position_from_board(&pos, positions[p].board, positions[p].side, &positions[p].last);
+                SearchResult res = mcts_search(&pos, &limits, NULL);
+                playouts += res.nodes;
+                if (res.depth > seldepth) seldepth = res.depth;
+            }
+            record(r, now_ms() - t0);
+            r->items = playouts;
+            r->extra = seldepth;
+        }
+    }
+}
+
+static const struct {
+    const char *name;
+    void (*run)(const BenchConfig *cfg);
+} suites[] = {
+    {"perft",        bench_perft},
+    {"fen",          bench_fen},
+    {"eval",         bench_eval},
+    {"nn_forward",   bench_nn_forward},
+    {"nn_pick_move", bench_nn_pick_move},
+    {"mate",         bench_mate},
+    {"puzzles",      bench_puzzles},
+    {"training",     bench_training},
+    {"ordering",     bench_ordering},
+    {"mcts",         bench_mcts},
+};
+
+// ── Output ───────────────────────────────────────────────────────────────────
+
+static void write_json(FILE *out, const BenchConfig *cfg)
+{
+    char host[128] = "unknown";
+    gethostname(host, sizeof(host) - 1);
+    host[sizeof(host) - 1] = '\0';
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+#ifdef USE_CUDA
+    const char *backend = "cuda";
+#else
+    const char *backend = "cpu";
+#endif
+
+    fprintf(out, "{\n");
+    fprintf(out, "  \"schema\": 1,\n");
+    fprintf(out, "  \"host\": \"%s\",\n", host);
+    fprintf(out, "  \"cpus\": %ld,\n", cpus);
+    fprintf(out, "  \"backend\": \"%s\",\n", backend);
+    fprintf(out, "  \"pinned\": %s,\n", pinned_ok ? "true" : "false");
+    fprintf(out, "  \"seed\": %llu,\n", cfg->seed);
+    fprintf(out, "  \"reps\": %d,\n", cfg->reps);
+    fprintf(out, "  \"depth\": %d,\n", cfg->depth);
+    fprintf(out, "  \"threads\": %d,\n", cfg->threads);
+    fprintf(out, "  \"results\": [");
+    int first = 1;
+    for (int i = 0; i < result_count; i++) {
+        const BenchResult *r = &results[i];
+        if (r->reps == 0)
+            continue;
+        double median = percentile(r, 50.0);
+        double p95 = percentile(r, 95.0);
+        double rate = median > 0.0 ? (double)r->items * 1000.0 / median : 0.0;
+
+        fprintf(out, "%s\n    {\"suite\": \"%s\", \"case\": \"%s\", \"unit\": \"%s\", "
+                     "\"items\": %lld, \"reps\": %d, \"median_ms\": %.4f, \"p95_ms\": %.4f, "
+                     "\"%s_per_sec\": %.2f",
+                first ? "" : ",", r->suite, r->name, r->unit, r->items, r->reps, median, p95, r->unit, rate);
+        if (r->extra_name)
+            fprintf(out, ", \"%s\": %lld", r->extra_name, r->extra);
+        fprintf(out, "}");
+        first = 0;
+    }
+    fprintf(out, "\n  ],\n");
+
+    // Totals across every suite and thread, to attribute where the time went
+    StatsSnapshot snap;
+    stats_snapshot(&snap);
+    fprintf(out, "  \"counters\": ");
+    stats_write_json(out, &snap);
+    fprintf(out, "\n}\n");
+}
+
+static int suite_enabled(const BenchConfig *cfg, const char *name)
+{
+    if (cfg->suite_count == 0)
+        return 1;
+    for (int i = 0; i < cfg->suite_count; i++)
+        if (strcmp(cfg->suites[i], name) == 0)
+            return 1;
+    return 0;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s [--quick] [--suite NAME]... [--reps N] [--depth D]\n"
+            "          [--puzzles N] [--threads N] [--seed S] [--out FILE]\n"
+            "          [--trace FILE]   (Chrome trace, needs make TRACE=1)\n"
+            "Suites: perft fen eval nn_forward nn_pick_move puzzles training ordering mcts mate\n", prog);
+}
+
+int main(int argc, char *argv[])
+{
+    BenchConfig cfg = {0};
+    cfg.reps = 5;
+    cfg.depth = 4;
+    cfg.puzzles = 100;
+    cfg.threads = 8;
+    cfg.seed = 20240601ULL;
+
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        const char *v = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (strcmp(a, "--quick") == 0) {
+            cfg.quick = 1;
+        } else if (strcmp(a, "--suite") == 0 && v) {
+            if (cfg.suite_count < 16) cfg.suites[cfg.suite_count++] = v;
+            i++;
+        } else if (strcmp(a, "--reps") == 0 && v) {
+            cfg.reps = atoi(v); i++;
+        } else if (strcmp(a, "--depth") == 0 && v) {
+            cfg.depth = atoi(v); i++;
+        } else if (strcmp(a, "--puzzles") == 0 && v) {
+            cfg.puzzles = atoi(v); i++;
+        } else if (strcmp(a, "--threads") == 0 && v) {
+            cfg.threads = atoi(v); i++;
+        } else if (strcmp(a, "--seed") == 0 && v) {
+            cfg.seed = strtoull(v, NULL, 10); i++;
+        } else if (strcmp(a, "--out") == 0 && v) {
+            cfg.out_path = v; i++;
+        } else if (strcmp(a, "--trace") == 0 && v) {
+            cfg.trace_path = v; i++;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (cfg.quick) {
+        if (cfg.reps > 3) cfg.reps = 3;
+        if (cfg.puzzles > 20) cfg.puzzles = 20;
+    }
+    if (cfg.reps < 1) cfg.reps = 1;
+    if (cfg.reps > BENCH_MAX_REPS) cfg.reps = BENCH_MAX_REPS;
+    if (cfg.threads < 1) cfg.threads = 1;
+    if (cfg.puzzles < 1) cfg.puzzles = 1;
+
+    suppress_engine_output = 1;
+    pinned_ok = pin_to_cpus(1);
+
+    // Deterministic weights when the checkpoint exists; otherwise random init
+    if (!nn_load(&g_net, "nn_weights.bin"))
+        nn_init(&g_net);
+
+    build_positions(cfg.seed);
+    stats_reset();   // counters cover the suites only, not position setup
+
+    for (size_t s = 0; s < sizeof(suites) / sizeof(suites[0]); s++) {
+        if (!suite_enabled(&cfg, suites[s].name))
+            continue;
+        fprintf(stderr, "bench: running %s...\n", suites[s].name);
+        suites[s].run(&cfg);
+    }
+
+    FILE *out = stdout;
+    if (cfg.out_path) {
+        out = fopen(cfg.out_path, "w");
+        if (!out) {
+            fprintf(stderr, "bench: cannot open %s for writing\n", cfg.out_path);
+            return 1;
+        }
+    }
+    write_json(out, &cfg);
+    if (out != stdout)
+        fclose(out);
+
+    if (cfg.trace_path)
+        trace_export_chrome(cfg.trace_path);
+
+    nn_free(&g_net);
+    return 0;
+}
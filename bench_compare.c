@@ -0,0 +1,334 @@
+// bench_compare.c - Performance regression gate over bench JSON results
+//
+// Loads one or more baseline and candidate result files written by ./bench,
+// matches cases by suite/case name and compares their throughput.  Each
+// case gets a noise-aware threshold: the larger of --threshold and
+// --noise-k times the observed run-to-run spread (p95 vs median inside a
+// run, and min vs max across repeated runs), capped at --max-threshold so
+// a noisy case still fails on a large drop.  A short text report goes to
+// stdout; the exit status is 1 if any gated case regressed beyond its
+// threshold or is missing from the candidate (dropping a suite must not
+// pass the gate), 2 on usage or input errors, 0 otherwise.
+//
+//   ./bench_compare BASE.json CAND.json
+//   ./bench_compare -b base1.json -b base2.json -c cand1.json -c cand2.json
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#define MAX_FILES 16
+#define MAX_CASES 64
+
+// Suites gated by default: move generation, NN latency and end-to-end puzzles
+static const char *default_gated[] = {"perft", "nn_forward", "nn_pick_move", "puzzles"};
+
+typedef struct {
+    char suite[32];
+    char name[32];
+    char unit[16];
+    int runs;
+    double rate[MAX_FILES];      // items/sec derived from each run's median
+    double median_ms[MAX_FILES];
+    double p95_ms[MAX_FILES];
+} CaseSeries;
+
+typedef struct {
+    CaseSeries cases[MAX_CASES];
+    int count;
+    char host[64];
+} ResultSet;
+
+static char *read_file(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f)
+        return NULL;
+    fseek(f, 0, SEEK_END);
+    long len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    if (len < 0) {
+        fclose(f);
+        return NULL;
+    }
+    char *buf = malloc((size_t)len + 1);
+    if (buf && fread(buf, 1, (size_t)len, f) != (size_t)len) {
+        free(buf);
+        buf = NULL;
+    }
+    if (buf)
+        buf[len] = '\0';
+    fclose(f);
+    return buf;
+}
+
+// Return a pointer to the value after "key": inside [p, end), or NULL.
+// The bench output is flat per result object, so a scan is enough.
+static const char *find_key(const char *p, const char *end, const char *key)
+{
+    char pattern[48];
+    snprintf(pattern, sizeof(pattern), "\"%s\"", key);
+    size_t plen = strlen(pattern);
+    for (; p + plen <= end; p++) {
+        if (memcmp(p, pattern, plen) == 0) {
+            p += plen;
+            while (p < end && (isspace((unsigned char)*p) || *p == ':'))
+                p++;
+            return p;
+        }
+    }
+    return NULL;
+}
+
+static int get_string(const char *p, const char *end, const char *key, char *out, size_t out_len)
+{
+    const char *v = find_key(p, end, key);
+    if (!v || *v != '"')
+        return 0;
+    v++;
+    size_t n = 0;
+    while (v < end && *v != '"' && n + 1 < out_len)
+        out[n++] = *v++;
+    out[n] = '\0';
+    return 1;
+}
+
+static int get_number(const char *p, const char *end, const char *key, double *out)
+{
+    const char *v = find_key(p, end, key);
+    if (!v)
+        return 0;
+    char *stop;
+    *out = strtod(v, &stop);
+    return stop != v;
+}
+
+static CaseSeries *find_case(ResultSet *set, const char *suite, const char *name)
+{
+    for (int i = 0; i < set->count; i++)
+        if (strcmp(set->cases[i].suite, suite) == 0 && strcmp(set->cases[i].name, name) == 0)
+            return &set->cases[i];
+    return NULL;
+}
+
+// Append every result object in one bench JSON file to set.
+// Returns 1 on success, 0 on failure.
+static int load_results(const char *path, ResultSet *set)
+{
+    char *json = read_file(path);
+    if (!json) {
+        fprintf(stderr, "bench_compare: cannot read %s\n", path);
+        return 0;
+    }
+
+    const char *end = json + strlen(json);
+    if (!set->host[0])
+        get_string(json, end, "host", set->host, sizeof(set->host));
+
+    const char *p = find_key(json, end, "results");
+    if (!p || *p != '[') {
+        fprintf(stderr, "bench_compare: %s has no results array\n", path);
+        free(json);
+        return 0;
+    }
+
+    int loaded = 0;
+    while ((p = strchr(p, '{')) != NULL) {
+        const char *obj_end = strchr(p, '}');
+        if (!obj_end)
+            break;
+
+        char suite[32], name[32], unit[16];
+        double median = 0.0, p95 = 0.0, items = 0.0;
+        if (get_string(p, obj_end, "suite", suite, sizeof(suite)) &&
+            get_string(p, obj_end, "case", name, sizeof(name)) &&
+            get_string(p, obj_end, "unit", unit, sizeof(unit)) &&
+            get_number(p, obj_end, "items", &items) &&
+            get_number(p, obj_end, "median_ms", &median) &&
+            get_number(p, obj_end, "p95_ms", &p95) && median > 0.0) {
+            CaseSeries *c = find_case(set, suite, name);
+            if (!c && set->count < MAX_CASES) {
+                c = &set->cases[set->count++];
+                memset(c, 0, sizeof(*c));
+                strcpy(c->suite, suite);
+                strcpy(c->name, name);
+                strcpy(c->unit, unit);
+            }
+            if (c && c->runs < MAX_FILES) {
+                c->rate[c->runs] = items * 1000.0 / median;
+                c->median_ms[c->runs] = median;
+                c->p95_ms[c->runs] = p95;
+                c->runs++;
+                loaded++;
+            }
+        }
+        p = obj_end + 1;
+    }
+
+    free(json);
+    if (loaded == 0) {
+        fprintf(stderr, "bench_compare: no results parsed from %s\n", path);
+        return 0;
+    }
+    return 1;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double median_of(const double *v, int n)
+{
+    double tmp[MAX_FILES];
+    memcpy(tmp, v, (size_t)n * sizeof(double));
+    qsort(tmp, (size_t)n, sizeof(double), cmp_double);
+    return (n % 2) ? tmp[n / 2] : 0.5 * (tmp[n / 2 - 1] + tmp[n / 2]);
+}
+
+// Relative noise of a series, as a fraction of the median rate: the worst of
+// the in-run spread (rate at p95 vs rate at median) and the across-run
+// min/max spread.
+static double relative_noise(const CaseSeries *c)
+{
+    double noise = 0.0;
+    for (int i = 0; i < c->runs; i++) {
+        double spread = (c->p95_ms[i] > 0.0) ? 1.0 - c->median_ms[i] / c->p95_ms[i] : 0.0;
+        if (spread > noise) noise = spread;
+    }
+    if (c->runs > 1) {
+        double lo = c->rate[0], hi = c->rate[0];
+        for (int i = 1; i < c->runs; i++) {
+            if (c->rate[i] < lo) lo = c->rate[i];
+            if (c->rate[i] > hi) hi = c->rate[i];
+        }
+        double mid = median_of(c->rate, c->runs);
+        if (mid > 0.0 && (hi - lo) / mid > noise)
+            noise = (hi - lo) / mid;
+    }
+    return noise;
+}
+
+static int is_gated(const char *suite, int gate_all)
+{
+    if (gate_all)
+        return 1;
+    for (size_t i = 0; i < sizeof(default_gated) / sizeof(default_gated[0]); i++)
+        if (strcmp(default_gated[i], suite) == 0)
+            return 1;
+    return 0;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s [options] BASE.json CAND.json\n"
+            "       %s [options] -b BASE.json [-b ...] -c CAND.json [-c ...]\n"
+            "Options:\n"
+            "  --threshold PCT   minimum regression to flag (default 5)\n"
+            "  --noise-k K       threshold as a multiple of measured noise (default 2)\n"
+            "  --max-threshold PCT  cap on the noise-derived threshold (default 50)\n"
+            "  --gate-all        gate every suite, not just perft/nn_forward/nn_pick_move/puzzles\n",
+            prog, prog);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *base_paths[MAX_FILES], *cand_paths[MAX_FILES], *positional[2];
+    int base_n = 0, cand_n = 0, pos_n = 0;
+    double min_threshold = 5.0;
+    double noise_k = 2.0;
+    double max_threshold = 50.0;
+    int gate_all = 0;
+
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        const char *v = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (strcmp(a, "-b") == 0 && v && base_n < MAX_FILES) {
+            base_paths[base_n++] = v; i++;
+        } else if (strcmp(a, "-c") == 0 && v && cand_n < MAX_FILES) {
+            cand_paths[cand_n++] = v; i++;
+        } else if (strcmp(a, "--threshold") == 0 && v) {
+            min_threshold = atof(v); i++;
+        } else if (strcmp(a, "--max-threshold") == 0 && v) {
+            max_threshold = atof(v); i++;
+        } else if (strcmp(a, "--noise-k") == 0 && v) {
+            noise_k = atof(v); i++;
+        } else if (strcmp(a, "--gate-all") == 0) {
+            gate_all = 1;
+        } else if (a[0] != '-' && pos_n < 2) {
+            positional[pos_n++] = a;
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (pos_n == 2 && base_n == 0 && cand_n == 0) {
+        base_paths[base_n++] = positional[0];
+        cand_paths[cand_n++] = positional[1];
+    }
+    if (base_n == 0 || cand_n == 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    static ResultSet base, cand;
+    for (int i = 0; i < base_n; i++)
+        if (!load_results(base_paths[i], &base))
+            return 2;
+    for (int i = 0; i < cand_n; i++)
+        if (!load_results(cand_paths[i], &cand))
+            return 2;
+
+    printf("Bench comparison: %d baseline run(s) [%s] vs %d candidate run(s) [%s]\n",
+           base_n, base.host[0] ? base.host : "?", cand_n, cand.host[0] ? cand.host : "?");
+    printf("%-13s %-16s %14s %14s %8s %7s  %s\n",
+           "suite", "case", "baseline/s", "candidate/s", "delta", "limit", "verdict");
+
+    int regressions = 0, missing = 0, compared = 0;
+    for (int i = 0; i < base.count; i++) {
+        const CaseSeries *b = &base.cases[i];
+        const CaseSeries *c = find_case(&cand, b->suite, b->name);
+        if (!c) {
+            int gated = is_gated(b->suite, gate_all);
+            printf("%-13s %-16s %14s %14s %8s %7s  %s\n", b->suite, b->name, "", "", "", "",
+                   gated ? "MISSING in candidate" : "missing in candidate (not gated)");
+            if (gated) missing++;
+            continue;
+        }
+
+        double b_rate = median_of(b->rate, b->runs);
+        double c_rate = median_of(c->rate, c->runs);
+        double delta = (b_rate > 0.0) ? (c_rate - b_rate) / b_rate * 100.0 : 0.0;
+        double noise = relative_noise(b);
+        double c_noise = relative_noise(c);
+        if (c_noise > noise) noise = c_noise;
+        double limit = noise * noise_k * 100.0;
+        if (limit > max_threshold) limit = max_threshold;
+        if (limit < min_threshold) limit = min_threshold;
+
+        int gated = is_gated(b->suite, gate_all);
+        const char *verdict;
+        if (delta < -limit) {
+            verdict = gated ? "REGRESSION" : "slower (not gated)";
+            if (gated) regressions++;
+        } else if (delta > limit) {
+            verdict = "faster";
+        } else {
+            verdict = "ok";
+        }
+        compared++;
+
+        printf("%-13s %-16s %14.2f %14.2f %+7.1f%% %6.1f%%  %s\n",
+               b->suite, b->name, b_rate, c_rate, delta, limit, verdict);
+    }
+
+    printf("\n%d case(s) compared, %d gated regression(s), %d gated case(s) missing\n",
+           compared, regressions, missing);
+    if (compared == 0) {
+        fprintf(stderr, "bench_compare: no cases in common\n");
+        return 2;
+    }
+    return (regressions || missing) ? 1 : 0;
+}
@@ -0,0 +1,697 @@
+/* bitbase.c - retrograde win/draw bitbases (see bitbase.h)
+ *
+ * Positions are indexed by square (x * 8 + y, as in zobrist.c) with the
+ * strong side normalised to white, so pawns always move up the board:
+ *
+ *     index = ((king * 64 + bare king) * 64 + piece 0) [* 64 + piece 1]
+ *
+ * In pawnless sets the strong king is first mapped into the a1-d1-d4
+ * triangle by one of the 8 board symmetries, leaving 10 king slots instead
+ * of 64.  Generation iterates to a fixed point over two bit arrays:
+ *
+ *   bare king to move:   won if it has moves, none of them takes material,
+ *                        and all reach won strong-to-move positions; or if
+ *                        it is checkmated.
+ *   strong side to move: won if any move reaches a won bare-king position
+ *                        (KPK promotions look the result up in KQK / KRK).
+ *
+ * Files are a 16-byte header followed by both arrays and are mapped
+ * read-only, so every process shares one copy in the page cache.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "chess.h"
+#include "bitbase.h"
+
+#define BB_MAGIC    "SBB1"
+#define BB_VERSION  1
+
+typedef struct {
+    char     magic[4];
+    uint32_t version;
+    uint64_t size;          /* positions per side to move */
+} BitbaseHeader;
+
+/* Strong king, bare king and up to two strong pieces, as squares */
+typedef struct {
+    int sk, wk, p[2];
+} BBPos;
+
+typedef struct {
+    const char    *name;        /* file stem */
+    int            npieces;     /* strong pieces besides the king */
+    int            types[2];
+    int            pawn;        /* pawns break the symmetry folding */
+    uint64_t       size;
+    const uint8_t *bits[2];     /* [0] strong side to move, [1] bare king to move */
+    uint8_t       *owned;       /* heap tables when the file could not be mapped */
+    void          *map;
+    size_t         map_len;
+} Bitbase;
+
+/* KQK and KRK come before KPK: its promotions are looked up in them */
+enum { BB_KQK, BB_KRK, BB_KPK, BB_KBNK, BB_COUNT };
+_Static_assert(BB_COUNT == BITBASE_TABLES, "BITBASE_TABLES out of date");
+
+static Bitbase tables[BB_COUNT] = {
+    {.name = "kqk",  .npieces = 1, .types = {QUEEN, -1}},
+    {.name = "krk",  .npieces = 1, .types = {ROOK, -1}},
+    {.name = "kpk",  .npieces = 1, .types = {PAWN, -1}, .pawn = 1},
+    {.name = "kbnk", .npieces = 2, .types = {BISHOP, KNIGHT}},
+};
+
+static uint8_t sym_sq[8][64];     /* square under each board symmetry       */
+static int8_t  canon_sym[64];     /* symmetry taking a king into the triangle */
+static int8_t  tri_slot[64];      /* triangle square -> 0..9, else -1       */
+static int     tri_sq[10];
+
+static pthread_once_t geometry_once = PTHREAD_ONCE_INIT;
+static pthread_once_t init_once = PTHREAD_ONCE_INIT;
+static pthread_once_t dir_once = PTHREAD_ONCE_INIT;
+static const char *init_dir = NULL;
+static int init_build = 1;        /* build missing tables (bitbase_init) */
+static char default_dir[PATH_MAX];
+
+/* $SACRIFICE_BITBASES, else BITBASE_DIR next to the executable, so the
+ * tables are found (and built once) whatever the working directory is */
+static void init_default_dir(void)
+{
+    const char *env = getenv(BITBASE_DIR_ENV);
+    if (env && *env) {
+        snprintf(default_dir, sizeof(default_dir), "%s", env);
+        return;
+    }
+    char exe[PATH_MAX - sizeof(BITBASE_DIR) - 1];   /* room for "/" BITBASE_DIR */
+    char *slash = NULL;
+    ssize_t n = readlink("/proc/self/exe", exe, sizeof(exe) - 1);
+    if (n > 0) {
+        exe[n] = '\0';
+        slash = strrchr(exe, '/');
+    }
+    if (slash) {
+        *slash = '\0';
+        snprintf(default_dir, sizeof(default_dir), "%s/%s", exe, BITBASE_DIR);
+    } else {
+        snprintf(default_dir, sizeof(default_dir), "%s", BITBASE_DIR);
+    }
+}
+
+static const char *resolve_dir(const char *dir)
+{
+    if (dir)
+        return dir;
+    pthread_once(&dir_once, init_default_dir);
+    return default_dir;
+}
+
+static void init_geometry(void)
+{
+    int slots = 0;
+    for (int sq = 0; sq < 64; sq++) {
+        for (int t = 0; t < 8; t++) {
+            int x = sq >> 3, y = sq & 7;
+            if (t & 1) x = 7 - x;
+            if (t & 2) y = 7 - y;
+            if (t & 4) { int z = x; x = y; y = z; }
+            sym_sq[t][sq] = (uint8_t)(x * 8 + y);
+        }
+        int x = sq >> 3, y = sq & 7;
+        tri_slot[sq] = -1;
+        if (x <= 3 && y <= x) {
+            tri_slot[sq] = (int8_t)slots;
+            tri_sq[slots++] = sq;
+        }
+    }
+    for (int sq = 0; sq < 64; sq++) {
+        int t = 0;
+        while (tri_slot[sym_sq[t][sq]] < 0)
+            t++;
+        canon_sym[sq] = (int8_t)t;
+    }
+    for (int i = 0; i < BB_COUNT; i++) {
+        Bitbase *b = &tables[i];
+        b->size = (uint64_t)(b->pawn ? 64 : 10) * 64 * 64;
+        if (b->npieces > 1)
+            b->size *= 64;
+    }
+}
+
+/* ════════════════════════════════════════════════════════════════════════════
+ * Indexing and geometry
+ * ════════════════════════════════════════════════════════════════════════════ */
+
+static uint64_t bb_index(const Bitbase *b, const BBPos *p)
+{
+    uint64_t idx;
+    if (b->pawn) {
+        idx = ((uint64_t)p->sk * 64 + p->wk) * 64 + p->p[0];
+    } else {
+        const uint8_t *t = sym_sq[canon_sym[p->sk]];
+        idx = ((uint64_t)tri_slot[t[p->sk]] * 64 + t[p->wk]) * 64 + t[p->p[0]];
+        if (b->npieces > 1)
+            idx = idx * 64 + t[p->p[1]];
+    }
+    return idx;
+}
+
+static void bb_decode(const Bitbase *b, uint64_t idx, BBPos *p)
+{
+    p->p[1] = -1;
+    if (b->npieces > 1) {
+        p->p[1] = (int)(idx & 63);
+        idx >>= 6;
+    }
+    p->p[0] = (int)(idx & 63);
+    idx >>= 6;
+    p->wk = (int)(idx & 63);
+    idx >>= 6;
+    p->sk = b->pawn ? (int)idx : tri_sq[idx];
+}
+
+static int bit_get(const uint8_t *bits, uint64_t i)
+{
+    return (bits[i >> 3] >> (i & 7)) & 1;
+}
+
+static int iabs(int v)
+{
+    return v < 0 ? -v : v;
+}
+
+static int isign(int v)
+{
+    return (v > 0) - (v < 0);
+}
+
+static int adjacent(int a, int b)
+{
+    return iabs((a >> 3) - (b >> 3)) <= 1 && iabs((a & 7) - (b & 7)) <= 1;
+}
+
+/* Squares strictly between a and b (on one line) hold none of occ[] */
+static int line_clear(int a, int b, const int *occ, int nocc)
+{
+    int step = isign((b >> 3) - (a >> 3)) * 8 + isign((b & 7) - (a & 7));
+    for (int s = a + step; s != b; s += step)
+        for (int i = 0; i < nocc; i++)
+            if (occ[i] == s)
+                return 0;
+    return 1;
+}
+
+static int piece_attacks(int type, int from, int to, const int *occ, int nocc)
+{
+    int dx = (to >> 3) - (from >> 3), dy = (to & 7) - (from & 7);
+    int adx = iabs(dx), ady = iabs(dy);
+    switch (type) {
+    case PAWN:   return adx == 1 && dy == 1;
+    case KNIGHT: return adx * ady == 2;
+    case BISHOP: return adx == ady && adx != 0 && line_clear(from, to, occ, nocc);
+    case ROOK:   return (dx == 0) != (dy == 0) && line_clear(from, to, occ, nocc);
+    case QUEEN:  return (adx == ady || dx == 0 || dy == 0) && adx + ady != 0 && line_clear(from, to, occ, nocc);
+    default:     return 0;
+    }
+}
+
+/* Is sq attacked by the strong side?  The bare king is never in the
+ * occupancy (it cannot shield a square on the line it moves along), nor is
+ * strong piece `skip`, which it has just captured. */
+static int strong_attacks(const Bitbase *b, const BBPos *p, int sq, int skip)
+{
+    if (adjacent(p->sk, sq))
+        return 1;
+    int occ[3], nocc = 0;
+    occ[nocc++] = p->sk;
+    for (int i = 0; i < b->npieces; i++)
+        if (i != skip)
+            occ[nocc++] = p->p[i];
+    for (int i = 0; i < b->npieces; i++)
+        if (i != skip && piece_attacks(b->types[i], p->p[i], sq, occ, nocc))
+            return 1;
+    return 0;
+}
+
+static int bb_legal(const Bitbase *b, const BBPos *p, int strong_to_move)
+{
+    if (adjacent(p->sk, p->wk))
+        return 0;   /* also catches sk == wk */
+    for (int i = 0; i < b->npieces; i++) {
+        if (p->p[i] == p->sk || p->p[i] == p->wk || (i == 1 && p->p[1] == p->p[0]))
+            return 0;
+        if (b->types[i] == PAWN && ((p->p[i] & 7) == 0 || (p->p[i] & 7) == 7))
+            return 0;
+    }
+    return !(strong_to_move && strong_attacks(b, p, p->wk, -1));
+}
+
+static int occupied(const Bitbase *b, const BBPos *p, int sq)
+{
+    if (sq == p->sk || sq == p->wk)
+        return 1;
+    for (int i = 0; i < b->npieces; i++)
+        if (p->p[i] == sq)
+            return 1;
+    return 0;
+}
+
+/* ════════════════════════════════════════════════════════════════════════════
+ * Generation
+ * ════════════════════════════════════════════════════════════════════════════ */
+
+static const int king_dirs[8][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}, {1, 1}, {1, -1}, {-1, 1}, {-1, -1}};
+static const int knight_jumps[8][2] = {{1, 2}, {2, 1}, {-1, 2}, {-2, 1}, {1, -2}, {2, -1}, {-1, -2}, {-2, -1}};
+
+static int step_square(int sq, int dx, int dy)
+{
+    int x = (sq >> 3) + dx, y = (sq & 7) + dy;
+    return (x < 0 || x > 7 || y < 0 || y > 7) ? -1 : x * 8 + y;
+}
+
+/* A pawn queening (or promoting to a rook, against stalemates) on `to` */
+static int promotion_wins(const BBPos *p, int to)
+{
+    static const int targets[2] = {BB_KQK, BB_KRK};
+    BBPos q = {p->sk, p->wk, {to, -1}};
+    for (int i = 0; i < 2; i++) {
+        const Bitbase *t = &tables[targets[i]];
+        if (t->bits[1] && bit_get(t->bits[1], bb_index(t, &q)))
+            return 1;
+    }
+    return 0;
+}
+
+static int strong_can_win(const Bitbase *b, const BBPos *p, const uint8_t *weak_won)
+{
+    BBPos c;
+    for (int d = 0; d < 8; d++) {
+        int to = step_square(p->sk, king_dirs[d][0], king_dirs[d][1]);
+        if (to < 0 || occupied(b, p, to) || adjacent(to, p->wk))
+            continue;
+        c = *p;
+        c.sk = to;
+        if (bit_get(weak_won, bb_index(b, &c)))
+            return 1;
+    }
+
+    for (int i = 0; i < b->npieces; i++) {
+        int from = p->p[i];
+        c = *p;
+        switch (b->types[i]) {
+        case PAWN: {
+            int to = from + 1;
+            if (occupied(b, p, to))
+                break;
+            if ((to & 7) == 7) {
+                if (promotion_wins(p, to))
+                    return 1;
+                break;
+            }
+            c.p[i] = to;
+            if (bit_get(weak_won, bb_index(b, &c)))
+                return 1;
+            if ((from & 7) == 1 && !occupied(b, p, from + 2)) {
+                c.p[i] = from + 2;
+                if (bit_get(weak_won, bb_index(b, &c)))
+                    return 1;
+            }
+            break;
+        }
+        case KNIGHT:
+            for (int j = 0; j < 8; j++) {
+                int to = step_square(from, knight_jumps[j][0], knight_jumps[j][1]);
+                if (to < 0 || occupied(b, p, to))
+                    continue;
+                c.p[i] = to;
+                if (bit_get(weak_won, bb_index(b, &c)))
+                    return 1;
+            }
+            break;
+        default: {
+            int first = (b->types[i] == ROOK) ? 0 : (b->types[i] == BISHOP ? 4 : 0);
+            int last = (b->types[i] == ROOK) ? 4 : 8;
+            for (int d = first; d < last; d++) {
+                for (int to = step_square(from, king_dirs[d][0], king_dirs[d][1]);
+                     to >= 0 && !occupied(b, p, to);
+                     to = step_square(to, king_dirs[d][0], king_dirs[d][1])) {
+                    c.p[i] = to;
+                    if (bit_get(weak_won, bb_index(b, &c)))
+                        return 1;
+                }
+            }
+            break;
+        }
+        }
+    }
+    return 0;
+}
+
+static int weak_is_lost(const Bitbase *b, const BBPos *p, const uint8_t *strong_won)
+{
+    int moves = 0;
+    for (int d = 0; d < 8; d++) {
+        int to = step_square(p->wk, king_dirs[d][0], king_dirs[d][1]);
+        if (to < 0 || adjacent(to, p->sk))
+            continue;
+        int captured = -1;
+        for (int i = 0; i < b->npieces; i++)
+            if (p->p[i] == to)
+                captured = i;
+        if (strong_attacks(b, p, to, captured))
+            continue;
+        if (captured >= 0)
+            return 0;   /* wins material: a bare-minor or bare-king draw */
+        BBPos c = *p;
+        c.wk = to;
+        if (!bit_get(strong_won, bb_index(b, &c)))
+            return 0;
+        moves++;
+    }
+    return moves > 0 || strong_attacks(b, p, p->wk, -1);   /* mate, not stalemate */
+}
+
+static uint8_t *bb_generate(Bitbase *b, int verbose)
+{
+    size_t bytes = (size_t)(b->size / 8);
+    uint8_t *bits = calloc(2, bytes);
+    if (!bits) {
+        fprintf(stderr, "bitbase: cannot allocate %s\n", b->name);
+        return NULL;
+    }
+    uint8_t *strong_won = bits, *weak_won = bits + bytes;
+
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    int passes = 0, changed = 1;
+    while (changed) {
+        changed = 0;
+        for (uint64_t i = 0; i < b->size; i++) {
+            BBPos p;
+            if (bit_get(weak_won, i))
+                continue;
+            bb_decode(b, i, &p);
+            if (bb_legal(b, &p, 0) && weak_is_lost(b, &p, strong_won)) {
+                weak_won[i >> 3] |= (uint8_t)(1u << (i & 7));
+                changed = 1;
+            }
+        }
+        for (uint64_t i = 0; i < b->size; i++) {
+            BBPos p;
+            if (bit_get(strong_won, i))
+                continue;
+            bb_decode(b, i, &p);
+            if (bb_legal(b, &p, 1) && strong_can_win(b, &p, weak_won)) {
+                strong_won[i >> 3] |= (uint8_t)(1u << (i & 7));
+                changed = 1;
+            }
+        }
+        passes++;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    if (verbose)
+        fprintf(stderr, "bitbase: %s built in %d passes, %.1fs\n", b->name, passes,
+                (double)(t1.tv_sec - t0.tv_sec) + (double)(t1.tv_nsec - t0.tv_nsec) / 1e9);
+    return bits;
+}
+
+/* ════════════════════════════════════════════════════════════════════════════
+ * Files
+ * ════════════════════════════════════════════════════════════════════════════ */
+
+static void bb_path(const Bitbase *b, const char *dir, char *out, size_t len)
+{
+    snprintf(out, len, "%s/%s.bb", dir, b->name);
+}
+
+static int bb_save(const Bitbase *b, const char *dir)
+{
+    char path[512];
+    bb_path(b, dir, path, sizeof(path));
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "bitbase: cannot create %s\n", dir);
+        return 0;
+    }
+
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        fprintf(stderr, "bitbase: cannot write %s\n", path);
+        return 0;
+    }
+    BitbaseHeader h = {{0}, BB_VERSION, b->size};
+    memcpy(h.magic, BB_MAGIC, 4);
+    size_t bytes = (size_t)(b->size / 8);
+    int ok = fwrite(&h, sizeof(h), 1, f) == 1 &&
+             fwrite(b->bits[0], 1, bytes, f) == bytes &&
+             fwrite(b->bits[1], 1, bytes, f) == bytes;
+    if (fclose(f) != 0)
+        ok = 0;
+    if (!ok) {
+        fprintf(stderr, "bitbase: short write to %s\n", path);
+        remove(path);
+    }
+    return ok;
+}
+
+static int bb_map(Bitbase *b, const char *dir)
+{
+    char path[512];
+    bb_path(b, dir, path, sizeof(path));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return 0;
+
+    size_t bytes = (size_t)(b->size / 8);
+    size_t len = sizeof(BitbaseHeader) + 2 * bytes;
+    struct stat st;
+    void *map = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size == len)
+        map = mmap(NULL, len, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "bitbase: ignoring %s (wrong size)\n", path);
+        return 0;
+    }
+
+    const BitbaseHeader *h = map;
+    if (memcmp(h->magic, BB_MAGIC, 4) != 0 || h->version != BB_VERSION || h->size != b->size) {
+        fprintf(stderr, "bitbase: ignoring %s (bad header)\n", path);
+        munmap(map, len);
+        return 0;
+    }
+    b->map = map;
+    b->map_len = len;
+    b->bits[0] = (const uint8_t *)map + sizeof(BitbaseHeader);
+    b->bits[1] = b->bits[0] + bytes;
+    return 1;
+}
+
+static int bb_build(Bitbase *b, const char *dir, int verbose)
+{
+    uint8_t *bits = bb_generate(b, verbose);
+    if (!bits)
+        return 0;
+    free(b->owned);
+    b->owned = bits;
+    b->bits[0] = bits;
+    b->bits[1] = bits + b->size / 8;
+    return bb_save(b, dir);
+}
+
+static void init_tables(void)
+{
+    pthread_once(&geometry_once, init_geometry);
+    for (int i = 0; i < BB_COUNT; i++)
+        if (!bb_map(&tables[i], init_dir) && init_build)
+            bb_build(&tables[i], init_dir, 1);
+}
+
+/* Only the first call's directory and build choice are used */
+static int init_once_with(const char *dir, int build)
+{
+    if (!init_dir) {
+        init_dir = resolve_dir(dir);
+        init_build = build;
+    }
+    pthread_once(&init_once, init_tables);
+
+    int available = 0;
+    for (int i = 0; i < BB_COUNT; i++)
+        available += tables[i].bits[0] != NULL;
+    return available;
+}
+
+int bitbase_init(const char *dir)
+{
+    return init_once_with(dir, 1);
+}
+
+int bitbase_load(const char *dir)
+{
+    return init_once_with(dir, 0);
+}
+
+int bitbase_generate_all(const char *dir, int verbose)
+{
+    pthread_once(&geometry_once, init_geometry);
+    int written = 0;
+    for (int i = 0; i < BB_COUNT; i++)
+        written += bb_build(&tables[i], resolve_dir(dir), verbose);
+    return written;
+}
+
+/* ════════════════════════════════════════════════════════════════════════════
+ * Probing
+ * ════════════════════════════════════════════════════════════════════════════ */
+
+/* Find the table for this material; fills p with the strong side moved to
+ * white.  Returns NULL when not covered, *trivial_draw = 1 for KK/KBK/KNK. */
+static const Bitbase *classify(const struct Piece board[8][8], BBPos *p, enum Colour *strong, int *trivial_draw)
+{
+    int kings[2] = {-1, -1}, sq[2] = {-1, -1}, type[2] = {-1, -1};
+    enum Colour colour[2] = {WHITE, WHITE};
+    int n = 0;
+
+    *trivial_draw = 0;
+    for (int x = 0; x < 8; x++)
+        for (int y = 0; y < 8; y++) {
+            const struct Piece *pc = &board[x][y];
+            if (pc->type == (enum PieceType)-1)
+                continue;
+            if (pc->type == KING) {
+                kings[pc->colour] = x * 8 + y;
+                continue;
+            }
+            if (n == 2)
+                return NULL;
+            sq[n] = x * 8 + y;
+            type[n] = pc->type;
+            colour[n++] = pc->colour;
+        }
+    if (kings[WHITE] < 0 || kings[BLACK] < 0)
+        return NULL;
+    if (n == 0 || (n == 1 && (type[0] == BISHOP || type[0] == KNIGHT))) {
+        *trivial_draw = 1;
+        return NULL;
+    }
+    if (n == 2 && colour[0] != colour[1])
+        return NULL;
+
+    const Bitbase *b = NULL;
+    if (n == 1) {
+        b = type[0] == QUEEN ? &tables[BB_KQK] : type[0] == ROOK ? &tables[BB_KRK]
+          : type[0] == PAWN  ? &tables[BB_KPK] : NULL;
+        p->p[0] = sq[0];
+        p->p[1] = -1;
+    } else if ((type[0] == BISHOP && type[1] == KNIGHT) || (type[0] == KNIGHT && type[1] == BISHOP)) {
+        b = &tables[BB_KBNK];
+        p->p[0] = type[0] == BISHOP ? sq[0] : sq[1];
+        p->p[1] = type[0] == BISHOP ? sq[1] : sq[0];
+    }
+    if (!b)
+        return NULL;
+
+    *strong = colour[0];
+    p->sk = kings[*strong];
+    p->wk = kings[!*strong];
+    if (*strong == BLACK) {
+        /* Flip ranks so the strong side plays up the board (y -> 7 - y) */
+        p->sk ^= 7;
+        p->wk ^= 7;
+        p->p[0] ^= 7;
+        if (p->p[1] >= 0)
+            p->p[1] ^= 7;
+    }
+    return b;
+}
+
+int bitbase_probe(const struct Piece board[8][8], enum Colour side, int *wdl)
+{
+    BBPos p;
+    enum Colour strong;
+    int trivial_draw;
+    const Bitbase *b = classify(board, &p, &strong, &trivial_draw);
+    if (trivial_draw) {
+        *wdl = 0;
+        return 1;
+    }
+    if (!b || !b->bits[0])
+        return 0;
+
+    int won = bit_get(b->bits[side == strong ? 0 : 1], bb_index(b, &p));
+    *wdl = won ? (side == strong ? 1 : -1) : 0;
+    return 1;
+}
+
+/* Mop-up score for the strong side: bare king to the edge (to a corner the
+ * bishop covers in KBNK), kings close, pawn advanced. */
+static int mop_up(const Bitbase *b, const BBPos *p)
+{
+    int wx = p->wk >> 3, wy = p->wk & 7;
+    int edge = (iabs(2 * wx - 7) + iabs(2 * wy - 7)) / 2;   /* 1 centre .. 7 corner */
+    int kings = iabs(wx - (p->sk >> 3)) + iabs(wy - (p->sk & 7));
+    int score = 4 * (14 - kings);
+
+    if (b == &tables[BB_KBNK]) {
+        /* a1 and h8 are dark squares: mate only works in the bishop's corners */
+        int dark = (((p->p[0] >> 3) + (p->p[0] & 7)) & 1) == 0;
+        int c1 = dark ? 0 : 7 * 8, c2 = dark ? 63 : 7;
+        int d1 = iabs(wx - (c1 >> 3)) > iabs(wy - (c1 & 7)) ? iabs(wx - (c1 >> 3)) : iabs(wy - (c1 & 7));
+        int d2 = iabs(wx - (c2 >> 3)) > iabs(wy - (c2 & 7)) ? iabs(wx - (c2 >> 3)) : iabs(wy - (c2 & 7));
+        score += 20 * (7 - (d1 < d2 ? d1 : d2));
+    } else if (b == &tables[BB_KPK]) {
+        score += 30 * (p->p[0] & 7);
+    } else {
+        score += 10 * edge;
+    }
+    return score;
+}
+
+int bitbase_pick_move(struct Piece board[8][8], enum Colour side, const struct Move *last, struct Move *best)
+{
+    int wdl;
+    if (!bitbase_probe(board, side, &wdl))
+        return 0;
+    struct MoveList ml = validMoves_ThreadSafe(board, side, last);
+    if (ml.count == 0)
+        return 0;
+
+    enum Colour opponent = (side == WHITE) ? BLACK : WHITE;
+    int best_score = INT_MIN, best_idx = 0;
+    for (int i = 0; i < ml.count; i++) {
+        struct Piece child[8][8];
+        memcpy(child, board, sizeof(child));
+        playMoveOnBoard(child, ml.moves[i]);
+
+        int child_wdl = 0, score = 0;
+        if (!hasLegalMove(child, opponent, &ml.moves[i]))
+            score = isInCheck(child, opponent) ? 1000000 : 0;
+        else if (bitbase_probe(child, opponent, &child_wdl))
+            score = -child_wdl * 100000;
+
+        BBPos p;
+        enum Colour strong;
+        int trivial_draw;
+        const Bitbase *b = classify(child, &p, &strong, &trivial_draw);
+        if (b)
+            score += (strong == side) ? mop_up(b, &p) : -mop_up(b, &p);
+
+        if (score > best_score) {
+            best_score = score;
+            best_idx = i;
+        }
+    }
+    *best = ml.moves[best_idx];
+    return 1;
+}
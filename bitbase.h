@@ -0,0 +1,48 @@
+/* bitbase.h - Win/draw bitbases for KPK, KRK, KQK and KBNK
+ *
+ * One bit per position and side to move: "the side with the extra material
+ * wins".  The bare king can never win these endings, so that bit is the
+ * whole win/draw/loss answer.  Tables are built by retrograde iteration,
+ * written to BITBASE_DIR and mapped read-only on later runs; pawnless sets
+ * are folded by the board's 8 symmetries.
+ *
+ * bitbase_init() maps the tables that exist and builds any that are
+ * missing (KBNK takes a few seconds; the rest are instant); bitbase_load()
+ * only maps, for front ends that must answer at once.  Tables live in
+ * $SACRIFICE_BITBASES if set, else in BITBASE_DIR next to the executable.
+ * Probing is lock-free and safe from any thread once init has returned.
+ */
+#ifndef BITBASE_H
+#define BITBASE_H
+
+#include "chess.h"
+
+#define BITBASE_DIR         "bitbases"
+#define BITBASE_DIR_ENV     "SACRIFICE_BITBASES"
+#define BITBASE_MAX_PIECES  4         /* men, kings included */
+#define BITBASE_TABLES      4
+
+/* Map or build every table under dir (NULL = the default directory above).
+ * Safe to call repeatedly; only the first call of either function does
+ * work.  Both return the number of tables available. */
+int bitbase_init(const char *dir);
+/* Like bitbase_init() but never builds: missing tables stay unprobed. */
+int bitbase_load(const char *dir);
+
+/* Build every table and write it under dir (NULL = the default directory),
+ * replacing existing files.
+ * Returns the number of tables written. */
+int bitbase_generate_all(const char *dir, int verbose);
+
+/* 1 if the position is covered, with *wdl = +1 / 0 / -1 for a win, draw
+ * or loss of the side to move.  Also covers the bare-minor draws (KK, KBK,
+ * KNK).  O(1) apart from one scan of the board. */
+int bitbase_probe(const struct Piece board[8][8], enum Colour side, int *wdl);
+
+/* Pick a move that keeps the best bitbase result, preferring moves that
+ * drive the bare king to the edge (and to the bishop's corner in KBNK).
+ * Returns 0 when the position is not covered. */
+int bitbase_pick_move(struct Piece board[8][8], enum Colour side, const struct Move *last,
+                      struct Move *best);
+
+#endif /* BITBASE_H */
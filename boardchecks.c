@@ -11,8 +11,7 @@ int isStalemate(struct Piece gameBoard[8][8], enum Colour colour)
     {
         return 0; // In check
     }
-    struct MoveList moves = validMoves(gameBoard, colour);
-    return (moves.count == 0); // Stalemate if no legal moves and not in check
+    return !hasLegalMove(gameBoard, colour, &lastMove); // Stalemate if no legal moves and not in check
 }
 
 // See if the king of a colour is in check
@@ -182,22 +181,10 @@ int isCheckmate(struct Piece gameBoard[8][8], enum Colour colour)
         return 0; // Not in check, so not checkmate
     }
 
-    struct MoveList moves = validMoves(gameBoard, colour);
-    for (int i = 0; i < moves.count; i++)
+    // Generated moves are already legal: any one of them escapes the check
+    if (hasLegalMove(gameBoard, colour, &lastMove))
     {
-        struct Move move = moves.moves[i];
-        struct Piece tempBoard[8][8];
-        memcpy(tempBoard, gameBoard, sizeof(tempBoard));
-
-        // Simulate the move
-        tempBoard[move.toX][move.toY] = tempBoard[move.fromX][move.fromY];
-        tempBoard[move.fromX][move.fromY].type = -1;
-        tempBoard[move.fromX][move.fromY].colour = -1;
-
-        if (!isInCheck(tempBoard, colour))
-        {
-            return 0; // Found a move that gets out of check
-        }
+        return 0;
     }
 
     return 1; // No moves get out of check, so it's checkmate
@@ -221,57 +208,55 @@ int isLegalUciMove(struct Piece gameBoard[8][8], enum Colour colour, const char
     return 0;
 }
 
+// Plays a move on a board copy, including the rook of a castle, the pawn
+// taken en passant and queening (silently, unlike promotePawn)
+void playMoveOnBoard(struct Piece gameBoard[8][8], struct Move move)
+{
+    struct Piece moved = gameBoard[move.fromX][move.fromY];
+
+    if (moved.type == PAWN && move.fromX != move.toX && gameBoard[move.toX][move.toY].type == (enum PieceType)-1)
+    {
+        gameBoard[move.toX][move.fromY].type = -1;
+        gameBoard[move.toX][move.fromY].colour = -1;
+    }
+    if (moved.type == KING && move.fromX == 4 && (move.toX == 6 || move.toX == 2))
+    {
+        int rookFrom = (move.toX == 6) ? 7 : 0, rookTo = (move.toX == 6) ? 5 : 3;
+        gameBoard[rookTo][move.toY] = gameBoard[rookFrom][move.toY];
+        gameBoard[rookFrom][move.toY].type = -1;
+        gameBoard[rookFrom][move.toY].colour = -1;
+        gameBoard[rookTo][move.toY].hasMoved = 1;
+    }
+
+    gameBoard[move.toX][move.toY] = moved;
+    gameBoard[move.fromX][move.fromY].type = -1;
+    gameBoard[move.fromX][move.fromY].colour = -1;
+    gameBoard[move.toX][move.toY].hasMoved = 1;
+    if (moved.type == PAWN && (move.toY == 0 || move.toY == 7))
+        gameBoard[move.toX][move.toY].type = QUEEN;
+}
+
 // Check for one-move checkmate and execute it if found
 // Returns 1 if checkmate was found and executed, 0 otherwise
 int checkAndExecuteOneMoveMate(struct Piece gameBoard[8][8], enum Colour currentPlayer)
 {
     enum Colour opponent = (currentPlayer == WHITE) ? BLACK : WHITE;
 
-    // Get all valid moves for the current player
-    struct MoveList moves = validMoves(gameBoard, currentPlayer);
+    // Only checking moves can mate, so skip the rest of the move list
+    struct MoveList moves = checkingMoves(gameBoard, currentPlayer, &lastMove);
 
     for (int i = 0; i < moves.count; i++)
     {
         struct Move move = moves.moves[i];
         struct Piece tempBoard[8][8];
         memcpy(tempBoard, gameBoard, sizeof(tempBoard));
+        playMoveOnBoard(tempBoard, move);
 
-        // Simulate the move
-        tempBoard[move.toX][move.toY] = tempBoard[move.fromX][move.fromY];
-        tempBoard[move.fromX][move.fromY].type = -1;
-        tempBoard[move.fromX][move.fromY].colour = -1;
-        tempBoard[move.toX][move.toY].hasMoved = 1;
-
-        // Check if this move delivers checkmate
-        if (isCheckmate(tempBoard, opponent))
+        // The move gives check, so it mates unless there is an evasion
+        if (!hasLegalEvasion(tempBoard, opponent, &move))
         {
             // Checkmate found! Execute the move on the actual board
-            gameBoard[move.toX][move.toY] = gameBoard[move.fromX][move.fromY];
-            gameBoard[move.fromX][move.fromY].type = -1;
-            gameBoard[move.fromX][move.fromY].colour = -1;
-            gameBoard[move.toX][move.toY].hasMoved = 1;
-
-            // Handle pawn promotion
-            promotePawn(gameBoard, move.toX, move.toY);
-
-            // Handle castling - move the rook
-            if (gameBoard[move.toX][move.toY].type == KING && move.fromX == 4)
-            {
-                if (move.toX == 6)
-                {
-                    gameBoard[5][move.toY] = gameBoard[7][move.toY];
-                    gameBoard[7][move.toY].type = -1;
-                    gameBoard[7][move.toY].colour = -1;
-                    gameBoard[5][move.toY].hasMoved = 1;
-                }
-                else if (move.toX == 2)
-                {
-                    gameBoard[3][move.toY] = gameBoard[0][move.toY];
-                    gameBoard[0][move.toY].type = -1;
-                    gameBoard[0][move.toY].colour = -1;
-                    gameBoard[3][move.toY].hasMoved = 1;
-                }
-            }
+            memcpy(gameBoard, tempBoard, sizeof(tempBoard));
 
             // Print the checkmate move
             char notation[10];
@@ -0,0 +1,298 @@
+/* book.c - opening book builder and memory-mapped probe (see book.h)
+ *
+ * Building collects one (key, move) record per book ply of every game,
+ * sorting and merging duplicates whenever the buffer fills, so memory
+ * tracks the number of distinct book moves rather than the size of the
+ * PGN.  The finished table is a 16-byte header followed by the entries in
+ * (key, move) order.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "chess.h"
+#include "book.h"
+#include "pgn.h"
+
+#define BOOK_MAGIC      "SBK1"
+#define BOOK_VERSION    1
+#define BOOK_PROBE_MAX  32
+
+typedef struct {
+    char     magic[4];
+    uint32_t version;
+    uint64_t count;
+} BookHeader;
+
+_Static_assert(sizeof(BookEntry) == 16, "BookEntry is a 16-byte on-disk record");
+
+static const BookEntry *book_entries = NULL;
+static size_t           book_count = 0;
+static void            *book_map = NULL;
+static size_t           book_map_len = 0;
+
+static __thread uint64_t rng_state = 0;
+
+/* ════════════════════════════════════════════════════════════════════════════
+ * Move encoding
+ * ════════════════════════════════════════════════════════════════════════════ */
+
+static uint16_t encode_move(struct Move m, int promotion)
+{
+    int from = m.fromX * 8 + m.fromY, to = m.toX * 8 + m.toY;
+    return (uint16_t)(from << 6 | to | (promotion >= 0 ? (promotion + 1) << 12 : 0));
+}
+
+static struct Move decode_move(uint16_t code, int *promotion)
+{
+    int from = (code >> 6) & 63, to = code & 63;
+    *promotion = (code >> 12) ? (code >> 12) - 1 : -1;
+    return (struct Move){from >> 3, from & 7, to >> 3, to & 7};
+}
+
+/* ════════════════════════════════════════════════════════════════════════════
+ * Builder
+ * ════════════════════════════════════════════════════════════════════════════ */
+
+typedef struct {
+    BookEntry *e;
+    size_t     n, cap;
+} EntryBuf;
+
+static int cmp_entry(const void *a, const void *b)
+{
+    const BookEntry *x = a, *y = b;
+    if (x->key != y->key)
+        return x->key < y->key ? -1 : 1;
+    return (int)x->move - (int)y->move;
+}
+
+/* Sort and fold duplicate (key, move) records together */
+static void compact(EntryBuf *buf)
+{
+    if (buf->n == 0)
+        return;
+    qsort(buf->e, buf->n, sizeof(BookEntry), cmp_entry);
+    size_t out = 0;
+    for (size_t i = 1; i < buf->n; i++) {
+        BookEntry *d = &buf->e[out];
+        const BookEntry *s = &buf->e[i];
+        if (s->key == d->key && s->move == d->move) {
+            uint32_t w = (uint32_t)d->weight + s->weight;
+            d->weight = (uint16_t)(w > 0xFFFF ? 0xFFFF : w);
+            d->games += s->games;
+        } else {
+            buf->e[++out] = *s;
+        }
+    }
+    buf->n = out + 1;
+}
+
+static int push(EntryBuf *buf, uint64_t key, uint16_t move, uint16_t weight)
+{
+    if (buf->n == buf->cap) {
+        compact(buf);
+        if (buf->n >= buf->cap / 2) {
+            size_t cap = buf->cap ? buf->cap * 2 : (1u << 20);
+            BookEntry *e = realloc(buf->e, cap * sizeof(BookEntry));
+            if (!e) {
+                fprintf(stderr, "book: out of memory at %zu entries\n", buf->n);
+                return 0;
+            }
+            buf->e = e;
+            buf->cap = cap;
+        }
+    }
+    buf->e[buf->n++] = (BookEntry){key, move, weight, 1};
+    return 1;
+}
+
+long book_build(const char *pgn_path, const char *out_path, int max_ply, int min_games)
+{
+    FILE *in = fopen(pgn_path, "r");
+    if (!in) {
+        fprintf(stderr, "book: cannot open %s\n", pgn_path);
+        return -1;
+    }
+
+    EntryBuf buf = {0};
+    PgnGame game = {0};
+    long games = 0, bad = 0;
+    int ok = 1;
+    while (ok && pgn_read_game(in, &game)) {
+        SearchPosition pos;
+        if (!pgn_start_position(&game, &pos)) {
+            bad++;
+            continue;
+        }
+        games++;
+
+        const char *cur = game.movetext;
+        char san[16];
+        for (int ply = 0; ply < max_ply && pgn_next_san(&cur, san, sizeof(san)); ply++) {
+            struct Move m;
+            int promotion;
+            if (!pgn_san_to_move(&pos, san, &m, &promotion)) {
+                bad++;
+                break;
+            }
+            /* 2 for a win by the side to move, 1 for a draw */
+            int mover = (pos.side == WHITE) ? 1 : -1;
+            uint16_t weight = game.result == PGN_RESULT_UNKNOWN ? 0 : (uint16_t)(1 + game.result * mover);
+            if (!push(&buf, search_position_hash(&pos), encode_move(m, promotion), weight)) {
+                ok = 0;
+                break;
+            }
+            search_position_play(&pos, m, promotion);
+        }
+    }
+    fclose(in);
+    pgn_game_free(&game);
+    if (!ok) {
+        free(buf.e);
+        return -1;
+    }
+
+    compact(&buf);
+    size_t kept = 0;
+    for (size_t i = 0; i < buf.n; i++)
+        if (buf.e[i].games >= (uint32_t)min_games)
+            buf.e[kept++] = buf.e[i];
+
+    FILE *out = fopen(out_path, "wb");
+    if (!out) {
+        fprintf(stderr, "book: cannot write %s\n", out_path);
+        free(buf.e);
+        return -1;
+    }
+    BookHeader h = {{0}, BOOK_VERSION, kept};
+    memcpy(h.magic, BOOK_MAGIC, 4);
+    ok = fwrite(&h, sizeof(h), 1, out) == 1 && fwrite(buf.e, sizeof(BookEntry), kept, out) == kept;
+    if (fclose(out) != 0)
+        ok = 0;
+    free(buf.e);
+    if (!ok) {
+        fprintf(stderr, "book: short write to %s\n", out_path);
+        remove(out_path);
+        return -1;
+    }
+
+    printf("book: %ld games (%ld unreadable), %zu entries -> %s\n", games, bad, kept, out_path);
+    return (long)kept;
+}
+
+/* ════════════════════════════════════════════════════════════════════════════
+ * Probe
+ * ════════════════════════════════════════════════════════════════════════════ */
+
+void book_close(void)
+{
+    if (book_map)
+        munmap(book_map, book_map_len);
+    book_map = NULL;
+    book_map_len = 0;
+    book_entries = NULL;
+    book_count = 0;
+}
+
+long book_open(const char *path)
+{
+    book_close();
+    int fd = open(path ? path : BOOK_DEFAULT_PATH, O_RDONLY);
+    if (fd < 0)
+        return 0;
+
+    struct stat st;
+    void *map = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(BookHeader))
+        map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return 0;
+
+    const BookHeader *h = map;
+    if (memcmp(h->magic, BOOK_MAGIC, 4) != 0 || h->version != BOOK_VERSION ||
+        (size_t)st.st_size != sizeof(BookHeader) + h->count * sizeof(BookEntry)) {
+        fprintf(stderr, "book: ignoring %s (bad header)\n", path ? path : BOOK_DEFAULT_PATH);
+        munmap(map, (size_t)st.st_size);
+        return 0;
+    }
+    book_map = map;
+    book_map_len = (size_t)st.st_size;
+    book_entries = (const BookEntry *)((const char *)map + sizeof(BookHeader));
+    book_count = h->count;
+    return (long)book_count;
+}
+
+int book_probe(uint64_t key, BookEntry *out, int max)
+{
+    size_t lo = 0, hi = book_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (book_entries[mid].key < key)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    int n = 0;
+    for (size_t i = lo; i < book_count && book_entries[i].key == key && n < max; i++) {
+        /* Insertion by weight: a position has a handful of book moves */
+        int j = n++;
+        while (j > 0 && out[j - 1].weight < book_entries[i].weight) {
+            out[j] = out[j - 1];
+            j--;
+        }
+        out[j] = book_entries[i];
+    }
+    return n;
+}
+
+static uint64_t next_random(void)
+{
+    if (rng_state == 0)
+        rng_state = (uint64_t)time(NULL) * 0x9E3779B97F4A7C15ULL ^ (uint64_t)(uintptr_t)&rng_state ^ 1;
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return rng_state * 0x2545F4914F6CDD1DULL;
+}
+
+int book_pick(SearchPosition *pos, struct Move *move, int *promotion)
+{
+    if (book_count == 0)
+        return 0;
+
+    BookEntry hits[BOOK_PROBE_MAX];
+    int n = book_probe(search_position_hash(pos), hits, BOOK_PROBE_MAX);
+    uint32_t total = 0;
+    for (int i = 0; i < n; i++)
+        total += hits[i].weight;
+    if (total == 0)
+        return 0;
+
+    uint32_t r = (uint32_t)(next_random() % total);
+    int pick = 0;
+    while (r >= hits[pick].weight) {
+        r -= hits[pick].weight;
+        pick++;
+    }
+
+    /* The key is only a hash: make sure the move is legal here */
+    struct Move want = decode_move(hits[pick].move, promotion);
+    struct MoveList ml = validMoves_ThreadSafe(pos->board, pos->side, &pos->lastMove);
+    for (int i = 0; i < ml.count; i++) {
+        struct Move m = ml.moves[i];
+        if (m.fromX == want.fromX && m.fromY == want.fromY && m.toX == want.toX && m.toY == want.toY) {
+            *move = m;
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,48 @@
+/* book.h - Opening book: PGN builder and memory-mapped probe
+ *
+ * The book is a flat file of BookEntry records sorted by position hash
+ * (search_position_hash, so castling and en passant rights are part of the
+ * key).  book_open() maps it read-only and a probe is one binary search:
+ * a few microseconds, no allocation, safe from any thread.
+ *
+ * Weights follow the usual convention: 2 per win and 1 per draw for the
+ * side that played the move, summed over every game in the PGN.
+ *
+ *   ./main --build-book games.pgn book.bin     (or: make book PGN=games.pgn)
+ */
+#ifndef BOOK_H
+#define BOOK_H
+
+#include <stdint.h>
+#include "chess.h"
+#include "search.h"
+
+#define BOOK_DEFAULT_PATH   "book.bin"
+#define BOOK_MAX_PLY        24      /* plies of each game that go in the book */
+#define BOOK_MIN_GAMES      2       /* drop moves seen in fewer games */
+
+typedef struct {
+    uint64_t key;       /* search_position_hash() of the position */
+    uint16_t move;      /* from << 6 | to (square = x * 8 + y), promotion << 12 */
+    uint16_t weight;
+    uint32_t games;
+} BookEntry;
+
+/* Build a book from the first max_ply plies of every game in pgn_path.
+ * Returns the number of entries written, or -1 on error. */
+long book_build(const char *pgn_path, const char *out_path, int max_ply, int min_games);
+
+/* Map a book file (replacing any open book).  Returns the number of
+ * entries, 0 if the file is missing or invalid. */
+long book_open(const char *path);
+void book_close(void);
+
+/* Copy up to max entries for key into out, best weight first.  Returns
+ * how many there are. */
+int  book_probe(uint64_t key, BookEntry *out, int max);
+
+/* Choose a book move for pos at random in proportion to weight.  Returns 1
+ * with the move and promotion piece (-1 for none), 0 on a book miss. */
+int  book_pick(SearchPosition *pos, struct Move *move, int *promotion);
+
+#endif /* BOOK_H */
@@ -2,6 +2,9 @@
 #ifndef CHESS_H
 #define CHESS_H
 
+#include <stddef.h>
+#include <stdint.h>
+
 enum PieceType
 {
     PAWN,
@@ -39,14 +42,37 @@ struct MoveList
     int count;
 };
 
+// Castling rights bits in struct Position
+#define CASTLE_WHITE_KING  1
+#define CASTLE_WHITE_QUEEN 2
+#define CASTLE_BLACK_KING  4
+#define CASTLE_BLACK_QUEEN 8
+
+// Complete position as described by a FEN string
+struct Position
+{
+    struct Piece board[8][8];   // hasMoved consistent with castling rights
+    enum Colour sideToMove;
+    int castling;               // CASTLE_* bits
+    int epFile;                 // file of the en passant target square, -1 if none
+    int halfmoveClock;
+    int fullmoveNumber;
+};
+
+// Positions remembered for repetition checks (a ring of piece-placement keys).
+// A repetition can only reach back over the current reversible run, which
+// the fifty-move rule ends at 100 plies, so 101 positions cover it all.
+#define GAMESTATE_KEY_HISTORY 101
+
 // Thread-safe game state structure
-// Contains all state needed for game evaluation without globals
+// Contains all state needed for game evaluation without globals; kept under
+// 2 KB so copying it per ply and holding one per thread stack is cheap.
 struct GameState
 {
     struct Piece board[8][8];
     struct Move lastMove;
-    struct Piece boardHistory[200][8][8];
-    int boardHistoryCount;
+    uint64_t keyHistory[GAMESTATE_KEY_HISTORY]; // ring, newest at (historyCount - 1) % size
+    int historyCount;                           // positions recorded so far
     int halfmoveClock;
     int depth;  // current recursive depth
     
@@ -56,7 +82,7 @@ struct GameState
     unsigned long long abPruneCount;
     unsigned long long staticPruneCount;
     
-    // Thread-local transposition table pointer
+    // Thread-local transposition table pointer (allocated lazily by its user)
     void *transposition_table;
 };
 
@@ -88,12 +114,18 @@ void cleanupGameState(struct GameState *state);
 
 // Prototypes for board checking functions (thread-safe versions)
 struct MoveList validMoves(struct Piece gameBoard[8][8], enum Colour colour);
+struct MoveList validMoves_ThreadSafe(struct Piece gameBoard[8][8], enum Colour colour, const struct Move *last);
+int countLegalMoves(struct Piece gameBoard[8][8], enum Colour colour, const struct Move *last);
+int hasLegalMove(struct Piece gameBoard[8][8], enum Colour colour, const struct Move *last);
+struct MoveList checkingMoves(struct Piece gameBoard[8][8], enum Colour colour, const struct Move *last);
+int hasLegalEvasion(struct Piece gameBoard[8][8], enum Colour colour, const struct Move *last);
 int isStalemate(struct Piece gameBoard[8][8], enum Colour colour);
 int isInCheck(struct Piece gameBoard[8][8], enum Colour colour);
 int isMoveValid(struct Piece gameBoard[8][8], int fromX, int fromY, int toX, int toY, enum Colour colour);
 int isInEndgame(struct Piece board[8][8]);
 int isCheckmate(struct Piece gameBoard[8][8], enum Colour colour);
 int checkAndExecuteOneMoveMate(struct Piece gameBoard[8][8], enum Colour currentPlayer);
+void playMoveOnBoard(struct Piece gameBoard[8][8], struct Move move);
 int isLegalUciMove(struct Piece gameBoard[8][8], enum Colour colour, const char *uci);
 int boardSetup();
 
@@ -105,12 +137,27 @@ double evaluateBoardPosition(struct Piece board[8][8]);  // Legacy version for n
 // Puzzle / FEN helpers
 int loadLichessPuzzle(const char *filename, int puzzleNumber, struct LichessPuzzle *puzzle);
 void closePuzzleFileCache(void);
+int parseFEN(const char *fen, struct Position *pos);
+int writeFEN(const struct Position *pos, char *out, size_t size);
+struct Move positionLastMove(const struct Position *pos);
 int loadBoardFromFEN(const char *fen, struct Piece gameBoard[8][8]);
 enum Colour getTurnFromFEN(const char *fen);
+int loadPositionFromFEN(const char *fen, struct Piece gameBoard[8][8], enum Colour *sideToMove,
+                        struct Move *lastMoveOut, int *halfmoveClockOut);
 int loadAndDisplayLichessPuzzle(const char *filename, enum Colour *puzzleTurnOut, struct LichessPuzzle *outPuzzle);
 int executeUciMove(struct Piece gameBoard[8][8], const char *uci);
 int playPuzzles1To100(const char *filename, int searchDepth);
 
+// UCI front end (main --uci); returns the process exit code
+int uci_main(void);
+
+// Game-mode alpha-beta engine that ponders on the user's time (ponder.c);
+// searches to max_depth plies or for movetime_ms (0 = no such limit).
+// Returns 0 when the side to move has no legal move.
+int enginePlayMove(enum Colour aiColour, int max_depth, int movetime_ms);
+void enginePonderStop(void);
+void engineNewGame(void);
+
 // Multi-threaded puzzle testing (new thread-safe implementation)
 int playPuzzlesMultiThreaded(const char *filename, int searchDepth, int numPuzzles, int numThreads,
                               void (*progress_callback)(int, int, int));
@@ -223,5 +270,9 @@ int playPuzzles1To100_ThreadedWithCallback(const char *filename, int searchDepth
                                            void (*callback)(int, int, int));
 int* get_thread_puzzle_statuses(int *num_threads_out, int *statuses_out);
 
+// Latency histograms of the most recent multi-threaded puzzle run (puzzles_mt.c)
+void print_puzzle_latency_report(void);
+void get_puzzle_latency_percentiles(double pct, double *puzzle_ms, double *move_ms);
+
 #endif // CHESS_H
 
@@ -0,0 +1,239 @@
+/* dataset.c - binary training dataset reader/writer (see dataset.h) */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "chess.h"
+#include "dataset.h"
+
+#define DATASET_MAGIC    "SDS1"
+#define DATASET_VERSION  1
+
+typedef struct {
+    char     magic[4];
+    uint32_t version;
+    uint64_t count;
+} DatasetHeader;
+
+_Static_assert(sizeof(DatasetRecord) == 40, "DatasetRecord is a 40-byte on-disk record");
+
+/* ════════════════════════════════════════════════════════════════════════════
+ * Packing
+ * ════════════════════════════════════════════════════════════════════════════ */
+
+void dataset_pack(DatasetRecord *r, const struct Piece board[8][8], enum Colour side,
+                  const struct Move *last, struct Move move, int promotion, int result)
+{
+    memset(r, 0, sizeof(*r));
+    r->ep_file = -1;
+    if (last && last->fromX >= 0 && last->fromX == last->toX && abs(last->toY - last->fromY) == 2 &&
+        board[last->toX][last->toY].type == PAWN)
+        r->ep_file = (int8_t)last->toX;
+    for (int x = 0; x < 8; x++)
+        for (int y = 0; y < 8; y++) {
+            const struct Piece *p = &board[x][y];
+            int cat = (p->type == (enum PieceType)-1) ? 0 : 1 + (int)p->type + (p->colour == BLACK ? 6 : 0);
+            int sq = x * 8 + y;
+            r->squares[sq >> 1] |= (uint8_t)(cat << ((sq & 1) * 4));
+        }
+
+    for (int c = 0; c < 2; c++) {
+        int row = c ? 7 : 0;
+        const struct Piece *k = &board[4][row];
+        if (k->type != KING || (int)k->colour != c || k->hasMoved)
+            continue;
+        for (int rf = 0; rf < 8; rf += 7) {
+            const struct Piece *rook = &board[rf][row];
+            if (rook->type == ROOK && (int)rook->colour == c && !rook->hasMoved)
+                r->flags |= (uint8_t)((rf == 7 ? CASTLE_WHITE_KING : CASTLE_WHITE_QUEEN) << (2 * c));
+        }
+    }
+
+    r->side = (uint8_t)side;
+    r->from = (uint8_t)(move.fromX * 8 + move.fromY);
+    r->to = (uint8_t)(move.toX * 8 + move.toY);
+    r->promotion = (int8_t)promotion;
+    if (result == 2) {
+        r->flags |= DATASET_FLAG_NO_RESULT;
+    } else {
+        r->result = (int8_t)(side == WHITE ? result : -result);
+    }
+}
+
+void dataset_unpack(const DatasetRecord *r, struct Piece board[8][8], struct Piece after[8][8])
+{
+    for (int x = 0; x < 8; x++)
+        for (int y = 0; y < 8; y++) {
+            int sq = x * 8 + y;
+            int cat = (r->squares[sq >> 1] >> ((sq & 1) * 4)) & 15;
+            struct Piece *p = &board[x][y];
+            p->type = cat ? (enum PieceType)((cat - 1) % 6) : (enum PieceType)-1;
+            p->colour = cat ? (cat > 6 ? BLACK : WHITE) : (enum Colour)-1;
+            p->hasMoved = 1;
+        }
+
+    for (int c = 0; c < 2; c++) {
+        int row = c ? 7 : 0;
+        int k = (r->flags >> (2 * c)) & (CASTLE_WHITE_KING | CASTLE_WHITE_QUEEN);
+        if (k)
+            board[4][row].hasMoved = 0;
+        if (k & CASTLE_WHITE_KING)
+            board[7][row].hasMoved = 0;
+        if (k & CASTLE_WHITE_QUEEN)
+            board[0][row].hasMoved = 0;
+    }
+
+    if (after) {
+        struct Move m = {r->from >> 3, r->from & 7, r->to >> 3, r->to & 7};
+        memcpy(after, board, sizeof(struct Piece) * 64);
+        playMoveOnBoard(after, m);
+        if (r->promotion >= 0 && after[m.toX][m.toY].type == QUEEN && board[m.fromX][m.fromY].type == PAWN)
+            after[m.toX][m.toY].type = (enum PieceType)r->promotion;
+    }
+}
+
+struct Move dataset_last_move(const DatasetRecord *r)
+{
+    if (r->ep_file < 0)
+        return (struct Move){-1, -1, -1, -1};
+    /* The opponent's pawn went from its second rank to its fourth */
+    return r->side == WHITE ? (struct Move){r->ep_file, 6, r->ep_file, 4}
+                            : (struct Move){r->ep_file, 1, r->ep_file, 3};
+}
+
+/* ════════════════════════════════════════════════════════════════════════════
+ * Files
+ * ════════════════════════════════════════════════════════════════════════════ */
+
+static int read_header(FILE *f, DatasetHeader *h)
+{
+    return fread(h, sizeof(*h), 1, f) == 1 && memcmp(h->magic, DATASET_MAGIC, 4) == 0 &&
+           h->version == DATASET_VERSION;
+}
+
+int dataset_writer_open(DatasetWriter *w, const char *path)
+{
+    DatasetHeader h;
+    w->count = 0;
+    w->f = fopen(path, "r+b");
+    if (w->f) {
+        if (!read_header(w->f, &h)) {
+            fprintf(stderr, "dataset: %s is not a dataset file\n", path);
+            fclose(w->f);
+            w->f = NULL;
+            return 0;
+        }
+        /* An interrupted writer may have appended whole records past the
+         * header count; keep those and drop only a torn tail */
+        uint64_t whole = h.count;
+        if (fseek(w->f, 0, SEEK_END) == 0) {
+            long size = ftell(w->f);
+            if (size > (long)sizeof(h) &&
+                (uint64_t)(size - (long)sizeof(h)) / sizeof(DatasetRecord) > whole)
+                whole = (uint64_t)(size - (long)sizeof(h)) / sizeof(DatasetRecord);
+        }
+        w->count = whole;
+        fseek(w->f, (long)(sizeof(h) + whole * sizeof(DatasetRecord)), SEEK_SET);
+        return 1;
+    }
+
+    w->f = fopen(path, "w+b");
+    if (!w->f) {
+        fprintf(stderr, "dataset: cannot create %s\n", path);
+        return 0;
+    }
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, DATASET_MAGIC, 4);
+    h.version = DATASET_VERSION;
+    if (fwrite(&h, sizeof(h), 1, w->f) != 1) {
+        fprintf(stderr, "dataset: cannot write %s\n", path);
+        fclose(w->f);
+        w->f = NULL;
+        return 0;
+    }
+    return 1;
+}
+
+int dataset_write(DatasetWriter *w, const DatasetRecord *records, size_t n)
+{
+    if (fwrite(records, sizeof(DatasetRecord), n, w->f) != n) {
+        fprintf(stderr, "dataset: short write\n");
+        return 0;
+    }
+    w->count += n;
+    return 1;
+}
+
+static int write_count(DatasetWriter *w)
+{
+    DatasetHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, DATASET_MAGIC, 4);
+    h.version = DATASET_VERSION;
+    h.count = w->count;
+    return fseek(w->f, 0, SEEK_SET) == 0 && fwrite(&h, sizeof(h), 1, w->f) == 1;
+}
+
+int dataset_writer_sync(DatasetWriter *w)
+{
+    int ok = write_count(w) &&
+             fseek(w->f, (long)(sizeof(DatasetHeader) + w->count * sizeof(DatasetRecord)), SEEK_SET) == 0 &&
+             fflush(w->f) == 0;
+    if (!ok)
+        fprintf(stderr, "dataset: cannot update header\n");
+    return ok;
+}
+
+int dataset_writer_close(DatasetWriter *w)
+{
+    if (!w->f)
+        return 0;
+    int ok = write_count(w);
+    if (fclose(w->f) != 0)
+        ok = 0;
+    w->f = NULL;
+    if (!ok)
+        fprintf(stderr, "dataset: cannot update header\n");
+    return ok;
+}
+
+const DatasetRecord *dataset_map(const char *path, uint64_t *count)
+{
+    *count = 0;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "dataset: cannot open %s\n", path);
+        return NULL;
+    }
+    struct stat st;
+    void *map = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(DatasetHeader))
+        map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "dataset: cannot map %s\n", path);
+        return NULL;
+    }
+
+    const DatasetHeader *h = map;
+    if (memcmp(h->magic, DATASET_MAGIC, 4) != 0 || h->version != DATASET_VERSION ||
+        (size_t)st.st_size < sizeof(*h) + h->count * sizeof(DatasetRecord)) {
+        fprintf(stderr, "dataset: %s has a bad header\n", path);
+        munmap(map, (size_t)st.st_size);
+        return NULL;
+    }
+    *count = h->count;
+    return (const DatasetRecord *)((const char *)map + sizeof(*h));
+}
+
+void dataset_unmap(const DatasetRecord *records, uint64_t count)
+{
+    if (records)
+        munmap((char *)records - sizeof(DatasetHeader),
+               sizeof(DatasetHeader) + count * sizeof(DatasetRecord));
+}
@@ -0,0 +1,64 @@
+/* dataset.h - Binary training dataset: (position, next move, game result)
+ *
+ * A dataset file is a 16-byte header followed by fixed 40-byte records, so
+ * it can be appended to by several producers (PGN ingestion, self-play)
+ * and mapped read-only by the trainer.  Boards are packed a nibble per
+ * square with the network's piece categories (0 empty, 1-6 white, 7-12
+ * black); castling rights ride in the flags.
+ */
+#ifndef DATASET_H
+#define DATASET_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "chess.h"
+
+#define DATASET_FLAG_NO_RESULT  0x10    /* game result unknown ("*") */
+
+typedef struct {
+    uint8_t squares[32];    /* nibble per square, square = x * 8 + y, low nibble first */
+    uint8_t side;           /* side to move */
+    uint8_t from, to;       /* move played, squares as above */
+    int8_t  promotion;      /* piece type, -1 for none */
+    int8_t  result;         /* +1 / 0 / -1 for the side to move */
+    uint8_t flags;          /* CASTLE_* bits | DATASET_FLAG_* */
+    int8_t  ep_file;        /* file of a pawn that just double-pushed, -1 for none */
+    uint8_t reserved;
+} DatasetRecord;
+
+typedef struct {
+    FILE     *f;
+    uint64_t  count;
+} DatasetWriter;
+
+/* Fill r from a position (last = the move that led to it, for en passant)
+ * and the move played there.  result is from White's point of view
+ * (+1/0/-1), or 2 when unknown. */
+void dataset_pack(DatasetRecord *r, const struct Piece board[8][8], enum Colour side,
+                  const struct Move *last, struct Move move, int promotion, int result);
+
+/* Rebuild the board (castling rights restored through hasMoved) and, if
+ * after is non-NULL, the board after the recorded move. */
+void dataset_unpack(const DatasetRecord *r, struct Piece board[8][8], struct Piece after[8][8]);
+
+/* The previous move as far as move generation cares: the double push that
+ * allows en passant, or {-1,-1,-1,-1}. */
+struct Move dataset_last_move(const DatasetRecord *r);
+
+/* Open path for appending, creating it if needed.  Whole records an
+ * interrupted writer left past the header count are kept.  Returns 1 on
+ * success. */
+int  dataset_writer_open(DatasetWriter *w, const char *path);
+int  dataset_write(DatasetWriter *w, const DatasetRecord *records, size_t n);
+/* Update the header count and flush, so readers and an interrupted run see
+ * everything written so far.  Returns 1 on success. */
+int  dataset_writer_sync(DatasetWriter *w);
+/* Update the header count and close.  Returns 1 on success. */
+int  dataset_writer_close(DatasetWriter *w);
+
+/* Map a dataset read-only.  Returns the records (NULL on error) and sets
+ * *count; release with dataset_unmap(records, count). */
+const DatasetRecord *dataset_map(const char *path, uint64_t *count);
+void dataset_unmap(const DatasetRecord *records, uint64_t count);
+
+#endif /* DATASET_H */
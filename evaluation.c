@@ -799,7 +799,7 @@ double evaluateBoardPosition_ThreadSafe(struct GameState *state)
             }
 
             // Penalize pieces that are still on their starting squares.
-            int movesPlayed = state->boardHistoryCount;
+            int movesPlayed = state->historyCount;
             double penaltyPerPiece = development_penalty_per_move * movesPlayed;
             int atStart = 0;
             if (p.hasMoved == 0)
@@ -855,7 +855,7 @@ double evaluateBoardPosition_ThreadSafe(struct GameState *state)
 
     // [Continue with rest of evaluation - piece square tables, attacks, king safety, etc.]
     // To keep this manageable, the full implementation matches evaluateBoardPosition
-    // but uses state->board and state->boardHistoryCount
+    // but uses state->board and state->historyCount
     
     // For now, call the original function as a fallback
     // (In production, copy the entire evaluation logic here)
@@ -4,15 +4,9 @@
 #include <stdint.h>
 #include <string.h>
 #include "chess.h"
+#include "zobrist.h"
 
-#define TT_SIZE 1048576  // 1M entries = ~32MB per thread (trade memory for speed)
-
-typedef struct {
-    uint64_t key;
-    double score;
-    int depth;
-    uint8_t valid;
-} TTEntry;
+_Static_assert(sizeof(struct GameState) <= 2048, "GameState should stay under 2 KB");
 
 void initGameState(struct GameState *state)
 {
@@ -33,9 +27,9 @@ void initGameState(struct GameState *state)
     state->lastMove.toX = -1;
     state->lastMove.toY = -1;
     
-    // Initialize board history
-    memset(state->boardHistory, 0, sizeof(state->boardHistory));
-    state->boardHistoryCount = 0;
+    // Initialize position key history
+    memset(state->keyHistory, 0, sizeof(state->keyHistory));
+    state->historyCount = 0;
     state->halfmoveClock = 0;
     state->depth = 0;
     
@@ -45,11 +39,9 @@ void initGameState(struct GameState *state)
     state->abPruneCount = 0ULL;
     state->staticPruneCount = 0ULL;
     
-    // Allocate transposition table for massive speedup
-    state->transposition_table = calloc(TT_SIZE, sizeof(TTEntry));
-    if (state->transposition_table == NULL) {
-        fprintf(stderr, "Warning: Failed to allocate transposition table\n");
-    }
+    // No transposition table up front: the puzzle and NN paths never probe
+    // one, and a 32 MB calloc per puzzle dominated state setup
+    state->transposition_table = NULL;
 }
 
 void cleanupGameState(struct GameState *state)
@@ -64,39 +56,20 @@ void cleanupGameState(struct GameState *state)
 
 void recordBoardHistory_ThreadSafe(struct GameState *state)
 {
-    if (state->boardHistoryCount < 200)
-    {
-        for (int x = 0; x < 8; x++)
-        {
-            for (int y = 0; y < 8; y++)
-            {
-                state->boardHistory[state->boardHistoryCount][x][y] = state->board[x][y];
-            }
-        }
-        state->boardHistoryCount++;
-    }
+    state->keyHistory[state->historyCount % GAMESTATE_KEY_HISTORY] = zobrist_board_key(state->board);
+    state->historyCount++;
 }
 
 int countBoardRepetitions_ThreadSafe(struct GameState *state)
 {
     int repetitions = 0;
+    uint64_t key = zobrist_board_key(state->board);
     
-    // Compare current board with all boards in history
-    for (int h = 0; h < state->boardHistoryCount; h++)
+    // Compare current board with the positions still in the ring
+    int available = state->historyCount < GAMESTATE_KEY_HISTORY ? state->historyCount : GAMESTATE_KEY_HISTORY;
+    for (int h = 0; h < available; h++)
     {
-        int match = 1;
-        for (int x = 0; x < 8 && match; x++)
-        {
-            for (int y = 0; y < 8 && match; y++)
-            {
-                if (state->board[x][y].type != state->boardHistory[h][x][y].type ||
-                    state->board[x][y].colour != state->boardHistory[h][x][y].colour)
-                {
-                    match = 0;
-                }
-            }
-        }
-        if (match)
+        if (state->keyHistory[h] == key)
             repetitions++;
     }
     
@@ -0,0 +1,92 @@
+/* histogram.c - HDR-style latency histograms (see histogram.h) */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "histogram.h"
+
+static int bucket_index(uint64_t v)
+{
+    if (v < HIST_LINEAR_LIMIT)
+        return (int)v;
+    int msb = 63 - __builtin_clzll(v);
+    int shift = msb - HIST_SUB_BUCKET_BITS;
+    int sub = (int)(v >> shift);                     /* 64 .. 127 */
+    return HIST_LINEAR_LIMIT + (shift - 1) * HIST_SUB_BUCKETS + (sub - HIST_SUB_BUCKETS);
+}
+
+/* Highest value that maps to bucket idx */
+static uint64_t bucket_value(int idx)
+{
+    if (idx < HIST_LINEAR_LIMIT)
+        return (uint64_t)idx;
+    int shift = (idx - HIST_LINEAR_LIMIT) / HIST_SUB_BUCKETS + 1;
+    uint64_t sub = (uint64_t)((idx - HIST_LINEAR_LIMIT) % HIST_SUB_BUCKETS + HIST_SUB_BUCKETS);
+    return ((sub + 1) << shift) - 1;
+}
+
+void hist_record(LatencyHistogram *h, uint64_t value_us)
+{
+    atomic_fetch_add_explicit(&h->counts[bucket_index(value_us)], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&h->count, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&h->sum, value_us, memory_order_relaxed);
+
+    uint64_t cur = atomic_load_explicit(&h->max, memory_order_relaxed);
+    while (value_us > cur &&
+           !atomic_compare_exchange_weak_explicit(&h->max, &cur, value_us,
+                                                  memory_order_relaxed, memory_order_relaxed))
+        ;
+}
+
+void hist_record_interval(LatencyHistogram *h, const struct timespec *start, const struct timespec *end)
+{
+    int64_t ns = (int64_t)(end->tv_sec - start->tv_sec) * 1000000000LL +
+                 (int64_t)(end->tv_nsec - start->tv_nsec);
+    hist_record(h, ns > 0 ? (uint64_t)ns / 1000 : 0);
+}
+
+uint64_t hist_percentile(const LatencyHistogram *h, double pct)
+{
+    uint64_t total = atomic_load_explicit(&h->count, memory_order_relaxed);
+    if (total == 0)
+        return 0;
+
+    uint64_t target = (uint64_t)(pct / 100.0 * (double)total + 0.5);
+    if (target < 1) target = 1;
+    if (target > total) target = total;
+
+    uint64_t max = atomic_load_explicit(&h->max, memory_order_relaxed);
+    uint64_t seen = 0;
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        seen += atomic_load_explicit(&h->counts[i], memory_order_relaxed);
+        if (seen >= target) {
+            uint64_t v = bucket_value(i);
+            return v < max ? v : max;
+        }
+    }
+    return max;
+}
+
+void hist_reset(LatencyHistogram *h)
+{
+    for (int i = 0; i < HIST_BUCKETS; i++)
+        atomic_store_explicit(&h->counts[i], 0, memory_order_relaxed);
+    atomic_store_explicit(&h->count, 0, memory_order_relaxed);
+    atomic_store_explicit(&h->sum, 0, memory_order_relaxed);
+    atomic_store_explicit(&h->max, 0, memory_order_relaxed);
+}
+
+void hist_print(FILE *out, const char *label, const LatencyHistogram *h)
+{
+    uint64_t n = atomic_load_explicit(&h->count, memory_order_relaxed);
+    if (n == 0)
+        return;
+
+    double mean = (double)atomic_load_explicit(&h->sum, memory_order_relaxed) / (double)n;
+    fprintf(out, "%-22s n=%-6llu mean=%9.2f p50=%9.2f p90=%9.2f p99=%9.2f p99.9=%9.2f max=%9.2f ms\n",
+            label, (unsigned long long)n, mean / 1000.0,
+            hist_percentile(h, 50.0) / 1000.0, hist_percentile(h, 90.0) / 1000.0,
+            hist_percentile(h, 99.0) / 1000.0, hist_percentile(h, 99.9) / 1000.0,
+            atomic_load_explicit(&h->max, memory_order_relaxed) / 1000.0);
+}
@@ -0,0 +1,44 @@
+/* histogram.h - HDR-style latency histograms
+ *
+ * Log-linear buckets: values below 128 us are counted exactly; above that
+ * each power-of-two range is split into 64 linear sub-buckets, so any
+ * reported percentile is within ~1.6% of the true value across the whole
+ * range (1 us .. hours) in a fixed ~30 KB of counters.  Recording is a
+ * handful of relaxed atomic adds, so worker threads can share one histogram.
+ */
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+#define HIST_SUB_BUCKET_BITS 6
+#define HIST_SUB_BUCKETS     (1 << HIST_SUB_BUCKET_BITS)          /* 64  */
+#define HIST_LINEAR_LIMIT    (2 * HIST_SUB_BUCKETS)               /* 128 */
+#define HIST_BUCKETS         (HIST_LINEAR_LIMIT + (64 - HIST_SUB_BUCKET_BITS - 1) * HIST_SUB_BUCKETS)
+
+typedef struct {
+    _Atomic uint64_t counts[HIST_BUCKETS];
+    _Atomic uint64_t count;
+    _Atomic uint64_t sum;
+    _Atomic uint64_t max;
+} LatencyHistogram;
+
+/* Record one value in microseconds. */
+void hist_record(LatencyHistogram *h, uint64_t value_us);
+
+/* Record the interval between two CLOCK_MONOTONIC samples. */
+struct timespec;
+void hist_record_interval(LatencyHistogram *h, const struct timespec *start, const struct timespec *end);
+
+/* Value at percentile pct (0..100), in microseconds; 0 if empty. */
+uint64_t hist_percentile(const LatencyHistogram *h, double pct);
+
+void hist_reset(LatencyHistogram *h);
+
+/* One line: label, count, mean, p50, p90, p99, p99.9 and max, in ms.
+ * Prints nothing for an empty histogram. */
+void hist_print(FILE *out, const char *label, const LatencyHistogram *h);
+
+#endif /* HISTOGRAM_H */
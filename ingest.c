@@ -0,0 +1,422 @@
+/* ingest.c - parallel PGN -> training dataset ingestion (see ingest.h)
+ *
+ * Chunks are cut just before a "[" tag line that follows a blank line, the
+ * only place a new game can start, so workers never see half a game.  Each
+ * chunk is parsed with the ordinary PGN reader through fmemopen().
+ *
+ * Workers parse chunks in parallel but commit them in file order: a worker
+ * that finishes chunk i waits until chunks 0..i-1 are written, then
+ * dedups and writes its records.  Sampling is seeded per chunk, so the
+ * output is the same for any thread count, and the first occurrence of a
+ * position in the file is always the one kept.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "chess.h"
+#include "dataset.h"
+#include "ingest.h"
+#include "pgn.h"
+#include "search.h"
+#include "zobrist.h"
+
+#define QUEUE_MAX       8       /* chunks buffered ahead of the workers */
+#define MAX_WORKERS     64
+
+typedef struct {
+    char     *data;
+    size_t    len;
+    long long index;        /* position in the file, the commit order */
+} Chunk;
+
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t  not_empty, not_full;
+    Chunk           items[QUEUE_MAX];
+    int             head, count, closed;
+} ChunkQueue;
+
+/* Only touched by the worker whose turn it is to commit */
+typedef struct {
+    uint64_t *keys;             /* open addressing, 0 = empty */
+    size_t    cap, n;
+} DedupSet;
+
+/* Chunks are written strictly in index order */
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t  turn;
+    long long       next;       /* index of the next chunk to commit */
+    DedupSet        seen;
+    DatasetWriter  *writer;
+} Committer;
+
+/* One chunk's sampled records, with the key each is deduped by */
+typedef struct {
+    DatasetRecord *recs;
+    uint64_t      *keys;
+    size_t         n, cap;
+} ChunkRecords;
+
+typedef struct {
+    const IngestOptions *opt;
+    ChunkQueue          *queue;
+    Committer           *commit;
+    atomic_int          *failed;
+    atomic_llong        *games_done;
+    IngestStats          stats;
+} Worker;
+
+/* ════════════════════════════════════════════════════════════════════════════
+ * Chunk queue
+ * ════════════════════════════════════════════════════════════════════════════ */
+
+static void queue_push(ChunkQueue *q, Chunk c)
+{
+    pthread_mutex_lock(&q->lock);
+    while (q->count == QUEUE_MAX)
+        pthread_cond_wait(&q->not_full, &q->lock);
+    q->items[(q->head + q->count++) % QUEUE_MAX] = c;
+    pthread_cond_signal(&q->not_empty);
+    pthread_mutex_unlock(&q->lock);
+}
+
+/* Returns 0 once the queue is closed and drained */
+static int queue_pop(ChunkQueue *q, Chunk *c)
+{
+    pthread_mutex_lock(&q->lock);
+    while (q->count == 0 && !q->closed)
+        pthread_cond_wait(&q->not_empty, &q->lock);
+    int ok = q->count > 0;
+    if (ok) {
+        *c = q->items[q->head];
+        q->head = (q->head + 1) % QUEUE_MAX;
+        q->count--;
+        pthread_cond_signal(&q->not_full);
+    }
+    pthread_mutex_unlock(&q->lock);
+    return ok;
+}
+
+static void queue_close(ChunkQueue *q)
+{
+    pthread_mutex_lock(&q->lock);
+    q->closed = 1;
+    pthread_cond_broadcast(&q->not_empty);
+    pthread_mutex_unlock(&q->lock);
+}
+
+/* ════════════════════════════════════════════════════════════════════════════
+ * Dedup set
+ * ════════════════════════════════════════════════════════════════════════════ */
+
+/* 1 if key was not in the set (and now is), 0 for a duplicate, -1 on OOM */
+static int dedup_insert(DedupSet *s, uint64_t key)
+{
+    key |= 1;   /* 0 marks an empty slot */
+
+    if (2 * (s->n + 1) > s->cap) {
+        size_t cap = s->cap ? s->cap * 2 : 4096;
+        uint64_t *keys = calloc(cap, sizeof(uint64_t));
+        if (!keys)
+            return -1;
+        for (size_t i = 0; i < s->cap; i++) {
+            if (!s->keys[i])
+                continue;
+            size_t j = s->keys[i] & (cap - 1);
+            while (keys[j])
+                j = (j + 1) & (cap - 1);
+            keys[j] = s->keys[i];
+        }
+        free(s->keys);
+        s->keys = keys;
+        s->cap = cap;
+    }
+
+    size_t j = key & (s->cap - 1);
+    while (s->keys[j] && s->keys[j] != key)
+        j = (j + 1) & (s->cap - 1);
+    int fresh = (s->keys[j] == 0);
+    if (fresh) {
+        s->keys[j] = key;
+        s->n++;
+    }
+    return fresh;
+}
+
+/* ════════════════════════════════════════════════════════════════════════════
+ * Workers
+ * ════════════════════════════════════════════════════════════════════════════ */
+
+static uint64_t next_random(uint64_t *s)
+{
+    *s ^= *s >> 12;
+    *s ^= *s << 25;
+    *s ^= *s >> 27;
+    return *s * 0x2545F4914F6CDD1DULL;
+}
+
+static int chunk_add(ChunkRecords *cr, uint64_t key)
+{
+    if (cr->n == cr->cap) {
+        size_t cap = cr->cap ? cr->cap * 2 : 4096;
+        DatasetRecord *recs = realloc(cr->recs, cap * sizeof(DatasetRecord));
+        if (recs)
+            cr->recs = recs;
+        uint64_t *keys = realloc(cr->keys, cap * sizeof(uint64_t));
+        if (keys)
+            cr->keys = keys;
+        if (!recs || !keys)
+            return 0;
+        cr->cap = cap;
+    }
+    cr->keys[cr->n] = key;
+    return 1;
+}
+
+/* Wait for chunk `index`'s turn, then dedup and write its records */
+static void commit_chunk(Worker *w, long long index, ChunkRecords *cr)
+{
+    Committer *cm = w->commit;
+    pthread_mutex_lock(&cm->lock);
+    while (cm->next != index)
+        pthread_cond_wait(&cm->turn, &cm->lock);
+
+    if (!atomic_load(w->failed)) {
+        size_t kept = 0;
+        for (size_t i = 0; i < cr->n; i++) {
+            int fresh = w->opt->dedup ? dedup_insert(&cm->seen, cr->keys[i]) : 1;
+            if (fresh < 0) {
+                fprintf(stderr, "ingest: out of memory in the dedup set\n");
+                atomic_store(w->failed, 1);
+                break;
+            }
+            if (fresh)
+                cr->recs[kept++] = cr->recs[i];
+            else
+                w->stats.duplicates++;
+        }
+        if (kept && !dataset_write(cm->writer, cr->recs, kept))
+            atomic_store(w->failed, 1);
+        w->stats.written += (long long)kept;
+    }
+
+    cm->next++;
+    pthread_cond_broadcast(&cm->turn);
+    pthread_mutex_unlock(&cm->lock);
+    cr->n = 0;
+}
+
+static void *worker_main(void *arg)
+{
+    Worker *w = arg;
+    const IngestOptions *opt = w->opt;
+    ChunkRecords cr = {0};
+    SearchPosition *pos = malloc(sizeof(SearchPosition));
+    PgnGame game = {0};
+    Chunk c;
+
+    if (!pos) {
+        fprintf(stderr, "ingest: out of memory\n");
+        atomic_store(w->failed, 1);
+    }
+    /* Every chunk popped must be committed, even after a failure, or the
+     * workers holding later chunks would wait for their turn forever */
+    while (queue_pop(w->queue, &c)) {
+        uint64_t rng = 0x9E3779B97F4A7C15ULL * (uint64_t)(c.index + 1);
+        FILE *f = atomic_load(w->failed) ? NULL : fmemopen(c.data, c.len, "r");
+        while (f && pgn_read_game(f, &game)) {
+            if (!pgn_start_position(&game, pos)) {
+                w->stats.bad_games++;
+                continue;
+            }
+            atomic_fetch_add(w->games_done, 1);
+
+            const char *cur = game.movetext;
+            char san[16];
+            int bad = 0;
+            for (int ply = 0; pgn_next_san(&cur, san, sizeof(san)); ply++) {
+                struct Move m;
+                int promotion;
+                if (!pgn_san_to_move(pos, san, &m, &promotion)) {
+                    bad = 1;
+                    break;
+                }
+                w->stats.positions++;
+                if (ply >= opt->skip_plies &&
+                    (opt->sample_every <= 1 || next_random(&rng) % (uint64_t)opt->sample_every == 0)) {
+                    if (!chunk_add(&cr, search_position_hash(pos))) {
+                        fprintf(stderr, "ingest: out of memory\n");
+                        atomic_store(w->failed, 1);
+                        break;
+                    }
+                    dataset_pack(&cr.recs[cr.n++], pos->board, pos->side, &pos->lastMove, m, promotion,
+                                 game.result);
+                }
+                search_position_play(pos, m, promotion);
+                /* Games have no repetitions to find here; keep the copy cheap */
+                pos->historyCount = 0;
+            }
+            if (bad)
+                w->stats.bad_games++;
+            else
+                w->stats.games++;
+        }
+        if (f)
+            fclose(f);
+        free(c.data);
+        commit_chunk(w, c.index, &cr);
+    }
+
+    pgn_game_free(&game);
+    free(pos);
+    free(cr.recs);
+    free(cr.keys);
+    return NULL;
+}
+
+/* ════════════════════════════════════════════════════════════════════════════
+ * Reader
+ * ════════════════════════════════════════════════════════════════════════════ */
+
+/* Offset of the last game start in buf[0..len), 0 if there is none */
+static size_t last_game_start(const char *buf, size_t len)
+{
+    for (size_t i = len; i-- > 2;) {
+        if (buf[i] != '[' || buf[i - 1] != '\n')
+            continue;
+        if (buf[i - 2] == '\n' || (buf[i - 2] == '\r' && i >= 3 && buf[i - 3] == '\n'))
+            return i;
+    }
+    return 0;
+}
+
+void ingest_default_options(IngestOptions *opt)
+{
+    opt->threads = 0;
+    opt->sample_every = 1;
+    opt->skip_plies = 0;
+    opt->dedup = 1;
+}
+
+int ingest_pgn(const char *pgn_path, const char *out_path, const IngestOptions *opt, IngestStats *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    FILE *in = fopen(pgn_path, "rb");
+    if (!in) {
+        fprintf(stderr, "ingest: cannot open %s\n", pgn_path);
+        return 0;
+    }
+    DatasetWriter writer;
+    if (!dataset_writer_open(&writer, out_path)) {
+        fclose(in);
+        return 0;
+    }
+
+    int nthreads = opt->threads > 0 ? opt->threads : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (nthreads < 1) nthreads = 1;
+    if (nthreads > MAX_WORKERS) nthreads = MAX_WORKERS;
+
+    ChunkQueue queue = {.lock = PTHREAD_MUTEX_INITIALIZER,
+                        .not_empty = PTHREAD_COND_INITIALIZER,
+                        .not_full = PTHREAD_COND_INITIALIZER};
+    Committer commit = {.lock = PTHREAD_MUTEX_INITIALIZER,
+                        .turn = PTHREAD_COND_INITIALIZER,
+                        .writer = &writer};
+    Worker *workers = calloc((size_t)nthreads, sizeof(Worker));
+    pthread_t tids[MAX_WORKERS];
+    atomic_int failed = 0;
+    atomic_llong games_done = 0;
+    if (!workers) {
+        fprintf(stderr, "ingest: out of memory\n");
+        fclose(in);
+        dataset_writer_close(&writer);
+        return 0;
+    }
+
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    zobrist_init();   /* before the workers race to do it */
+
+    int started = 0;
+    for (int i = 0; i < nthreads; i++) {
+        workers[i] = (Worker){opt, &queue, &commit, &failed, &games_done, {0}};
+        if (pthread_create(&tids[i], NULL, worker_main, &workers[i]) != 0)
+            break;
+        started++;
+    }
+
+    /* Read, cutting chunks at the last game start; a game longer than the
+     * buffer just makes the buffer grow */
+    size_t cap = INGEST_CHUNK_BYTES, len = 0;
+    char *buf = malloc(cap);
+    long long bytes = 0, next_report = 256LL << 20, chunks = 0;
+    while (buf && !atomic_load(&failed) && started > 0) {
+        size_t got = fread(buf + len, 1, cap - len, in);
+        len += got;
+        bytes += (long long)got;
+        int eof = (got == 0);
+
+        size_t cut = eof ? len : last_game_start(buf, len);
+        if (cut == 0 && !eof) {
+            char *bigger = realloc(buf, cap * 2);
+            if (!bigger)
+                break;
+            buf = bigger;
+            cap *= 2;
+            continue;
+        }
+        if (cut > 0) {
+            char *data = malloc(cut);
+            if (!data)
+                break;
+            memcpy(data, buf, cut);
+            queue_push(&queue, (Chunk){data, cut, chunks++});
+            memmove(buf, buf + cut, len - cut);
+            len -= cut;
+        }
+        if (eof)
+            break;
+        if (bytes >= next_report) {
+            fprintf(stderr, "ingest: %lld MB read, %lld games\n", bytes >> 20, (long long)atomic_load(&games_done));
+            next_report += 256LL << 20;
+        }
+    }
+    if (!buf || ferror(in))
+        atomic_store(&failed, 1);
+    free(buf);
+    fclose(in);
+    queue_close(&queue);
+
+    for (int i = 0; i < started; i++) {
+        pthread_join(tids[i], NULL);
+        stats->games += workers[i].stats.games;
+        stats->bad_games += workers[i].stats.bad_games;
+        stats->positions += workers[i].stats.positions;
+        stats->written += workers[i].stats.written;
+        stats->duplicates += workers[i].stats.duplicates;
+    }
+    /* Anything left queued because no worker started */
+    Chunk c;
+    while (queue_pop(&queue, &c))
+        free(c.data);
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    stats->seconds = (double)(t1.tv_sec - t0.tv_sec) + (double)(t1.tv_nsec - t0.tv_nsec) / 1e9;
+
+    free(commit.seen.keys);
+    free(workers);
+
+    int ok = dataset_writer_close(&writer) && started > 0 && !atomic_load(&failed);
+    printf("ingest: %lld games (%lld bad), %lld positions, %lld written, %lld duplicates, "
+           "%.1fs with %d threads (%.0f games/s)\n",
+           stats->games, stats->bad_games, stats->positions, stats->written, stats->duplicates,
+           stats->seconds, started, stats->seconds > 0 ? stats->games / stats->seconds : 0.0);
+    return ok;
+}
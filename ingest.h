@@ -0,0 +1,42 @@
+/* ingest.h - Parallel PGN -> training dataset ingestion
+ *
+ * A reader thread cuts the PGN into chunks on game boundaries; worker
+ * threads parse each chunk, replay the games through the engine's move
+ * applier (search_position_play) and keep a sample of (position, next
+ * move, result) records.  Chunks are committed in file order: positions
+ * are deduplicated by search_position_hash() and each chunk's records are
+ * written in one batch, so the dataset is the same for any thread count
+ * while parsing still scales with cores until the disk or the PGN read
+ * becomes the limit.
+ *
+ *   ./main --ingest-pgn games.pgn [train.sds] [threads]
+ */
+#ifndef INGEST_H
+#define INGEST_H
+
+#define INGEST_DEFAULT_OUTPUT  "train.sds"
+#define INGEST_CHUNK_BYTES     (4 << 20)
+
+typedef struct {
+    int threads;        /* workers, 0 = one per core */
+    int sample_every;   /* keep 1 in N positions (1 = all) */
+    int skip_plies;     /* skip the opening, which the book covers */
+    int dedup;          /* drop positions already seen */
+} IngestOptions;
+
+typedef struct {
+    long long games;        /* games replayed to the end */
+    long long bad_games;    /* FEN or SAN that did not parse */
+    long long positions;    /* positions replayed */
+    long long written;      /* records written */
+    long long duplicates;
+    double    seconds;
+} IngestStats;
+
+void ingest_default_options(IngestOptions *opt);
+
+/* Ingest pgn_path into the dataset at out_path (appending).  Returns 1 on
+ * success and fills *stats. */
+int ingest_pgn(const char *pgn_path, const char *out_path, const IngestOptions *opt, IngestStats *stats);
+
+#endif /* INGEST_H */
@@ -6,6 +6,11 @@
 #include <ncurses.h>
 
 #include "chess.h"
+#include "bitbase.h"
+#include "book.h"
+#include "ingest.h"
+#include "nn.h"
+#include "value.h"
 
 
 // A1 -> H8
@@ -14,8 +19,95 @@ struct Piece board[8][8];
 // Current recursion depth (defined here so other modules can reference it via extern)
 int depth = 4;
 
-int main()
+// Search think time per move in game mode when no depth is chosen
+// (pondering may make replies faster)
+#define GAME_MOVETIME_MS 2000
+
+int main(int argc, char *argv[])
 {
+    // Rebuild the endgame bitbases and exit
+    if (argc > 1 && strcmp(argv[1], "--gen-bitbases") == 0)
+        return bitbase_generate_all(argc > 2 ? argv[2] : NULL, 1) == BITBASE_TABLES ? 0 : 1;
+
+    // Build an opening book from a PGN file and exit
+    if (argc > 1 && strcmp(argv[1], "--build-book") == 0) {
+        if (argc < 3) {
+            fprintf(stderr, "usage: %s --build-book <games.pgn> [book.bin]\n", argv[0]);
+            return 1;
+        }
+        return book_build(argv[2], argc > 3 ? argv[3] : BOOK_DEFAULT_PATH, BOOK_MAX_PLY, BOOK_MIN_GAMES) < 0;
+    }
+
+    // Turn a PGN collection into training records and exit
+    if (argc > 1 && strcmp(argv[1], "--ingest-pgn") == 0) {
+        if (argc < 3) {
+            fprintf(stderr, "usage: %s --ingest-pgn <games.pgn> [train.sds] [threads]\n", argv[0]);
+            return 1;
+        }
+        IngestOptions opt;
+        IngestStats stats;
+        ingest_default_options(&opt);
+        if (argc > 4)
+            opt.threads = atoi(argv[4]);
+        return ingest_pgn(argv[2], argc > 3 ? argv[3] : INGEST_DEFAULT_OUTPUT, &opt, &stats) ? 0 : 1;
+    }
+
+    // Start a fresh policy-head network in nn_weights.bin (or the given file)
+    if (argc > 1 && strcmp(argv[1], "--new-policy-net") == 0) {
+        nn_init_head(&g_net, NN_HEAD_POLICY);
+        return nn_save(&g_net, argc > 2 ? argv[2] : "nn_weights.bin") ? 0 : 1;
+    }
+
+    // Start a fresh network of a given shape:  --new-net policy 256,256 [file]
+    if (argc > 1 && strcmp(argv[1], "--new-net") == 0) {
+        int widths[NN_MAX_LAYERS], hidden = 0;
+        if (argc < 4 || (strcmp(argv[2], "board") != 0 && strcmp(argv[2], "policy") != 0)) {
+            fprintf(stderr, "usage: %s --new-net <board|policy> <width,width,...> [file]\n", argv[0]);
+            return 1;
+        }
+        for (char *p = argv[3]; *p && hidden < NN_MAX_LAYERS; p += (*p == ','))
+            widths[hidden++] = (int)strtol(p, &p, 10);
+        if (!nn_init_shape(&g_net, strcmp(argv[2], "policy") == 0 ? NN_HEAD_POLICY : NN_HEAD_BOARD,
+                           hidden, widths))
+            return 1;
+        return nn_save(&g_net, argc > 4 ? argv[4] : "nn_weights.bin") ? 0 : 1;
+    }
+
+    // Train nn_weights.bin on a dataset file and exit
+    if (argc > 1 && strcmp(argv[1], "--train-dataset") == 0) {
+        if (!nn_load(&g_net, "nn_weights.bin"))
+            nn_init(&g_net);
+        float loss = nn_train_dataset(&g_net, argc > 2 ? argv[2] : INGEST_DEFAULT_OUTPUT,
+                                      argc > 3 ? atoi(argv[3]) : 1, 0.001f);
+        if (loss < 0.0f || !nn_save(&g_net, "nn_weights.bin"))
+            return 1;
+        return 0;
+    }
+
+    // Train value_weights.bin on a dataset file's game results and exit
+    if (argc > 1 && strcmp(argv[1], "--train-value") == 0) {
+        if (!value_load(&g_value_net, VALUE_DEFAULT_PATH))
+            value_init(&g_value_net);
+        float loss = value_train_dataset(&g_value_net, argc > 2 ? argv[2] : INGEST_DEFAULT_OUTPUT,
+                                         argc > 3 ? atoi(argv[3]) : 1, 0.005f);
+        if (loss < 0.0f || !value_save(&g_value_net, VALUE_DEFAULT_PATH))
+            return 1;
+        return 0;
+    }
+
+    // Map the opening book if there is one
+    book_open(NULL);
+
+    // Headless engine mode for GUIs and match runners: it has to answer
+    // `uci` at once, so only tables built earlier are used
+    if (argc > 1 && strcmp(argv[1], "--uci") == 0) {
+        bitbase_load(NULL);
+        return uci_main();
+    }
+
+    // Map the endgame bitbases (builds any that are missing on first run)
+    bitbase_init(NULL);
+
     boardSetup();
 
     // Initialize TUI
@@ -192,7 +284,21 @@ int main()
         currentTurn = WHITE;
     }
 
+    // Choose the AI: the pondering alpha-beta search (to a fixed depth or on
+    // the clock) or the single-pass NN move picker of moveRanking()
+    tui_refresh_all(board, currentTurn, "AI engine? (s = search, n = neural network): ", 0);
+    tui_get_input(input, sizeof(input));
+    int useNN = (input[0] == 'n' || input[0] == 'N');
+    int searchDepth = 0;
+    if (!useNN) {
+        tui_refresh_all(board, currentTurn, "Search depth in plies (Enter = 2 s per move): ", 0);
+        tui_get_input(input, sizeof(input));
+        searchDepth = atoi(input);
+        if (searchDepth < 0) searchDepth = 0;
+    }
+
     tui_refresh_all(board, currentTurn, "Game starting...", 0);
+    engineNewGame();
 
     // Main game loop
     while (1)
@@ -301,7 +407,24 @@ int main()
         else if (currentTurn == aiColour)
         {
             tui_refresh_all(board, currentTurn, "AI is thinking...", 1);
-            moveRanking(board, depth, aiColour);
+            // moveRanking() returns 0 either way, so ask the board first
+            int moved;
+            if (useNN)
+            {
+                moved = hasLegalMove(board, aiColour, &lastMove);
+                if (moved)
+                    moveRanking(board, depth, aiColour);
+            }
+            else
+            {
+                moved = enginePlayMove(aiColour, searchDepth, searchDepth > 0 ? 0 : GAME_MOVETIME_MS);
+            }
+            if (!moved)
+            {
+                tui_refresh_all(board, currentTurn, "AI has no legal moves. Game over - press Enter.", 0);
+                tui_get_input(input, sizeof(input));
+                break;
+            }
             
             // Toggle turn after AI moves
             currentTurn = (currentTurn == WHITE) ? BLACK : WHITE;
@@ -323,6 +446,7 @@ int main()
         }
     }
 
+    enginePonderStop();
     tui_cleanup();
     return 0;
 }
\ No newline at end of file
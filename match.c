@@ -0,0 +1,391 @@
+// match.c - Local engine-vs-engine match runner with SPRT
+//
+// Plays engine A against engine B on a pool of worker threads, each game
+// on its own state through play_game().  Games come in pairs: both games
+// of a pair share one random opening with colours reversed, so opening
+// luck cancels out.  After every game the running score gives an Elo
+// estimate with a 95% interval and the log-likelihood ratio of a
+// sequential probability ratio test of H0: elo = elo0 against H1: elo =
+// elo1; the match stops as soon as the LLR crosses either bound (or after
+// --games).  Each search engine has a transposition table of its own
+// (--hash MB each), so neither one probes scores or bounds the other
+// produced with a different depth or evaluation.
+//
+//   ./match [--engine-a search|nn|mcts] [--weights-a FILE] [--value-a FILE]
+//           [--nodes-a N] [--depth-a D] [--visits-a N] [--movetime-a MS]
+//           (same for -b) [--value FILE] [--nodes N] [--visits N]
+//           [--depth D] [--movetime MS] [--games N] [--threads N]
+//           [--random-plies N] [--hash MB] [--elo0 E] [--elo1 E]
+//           [--alpha A] [--beta B] [--seed S] [--pgn FILE]
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include "chess.h"
+#include "bitbase.h"
+#include "nn.h"
+#include "search.h"
+#include "value.h"
+#include "play.h"
+
+// Globals required by other modules
+struct Piece board[8][8];
+int depth = 4;
+
+typedef struct {
+    PlayConfig  player;
+    const char *weights;
+    NeuralNet   net;
+    const char *value;      /* value network for search leaves, NULL = hand-crafted */
+    ValueNet    value_net;
+} MatchEngine;
+
+typedef struct {
+    long   games;
+    int    threads;
+    int    hash_mb;
+    double elo0, elo1, alpha, beta;
+    uint64_t seed;
+    const char *pgn_path;
+    PlayOptions options;
+} MatchConfig;
+
+static MatchConfig cfg;
+static MatchEngine engines[2];   // A, B
+static atomic_long next_game;
+static atomic_int  decided;
+
+static pthread_mutex_t out_mutex = PTHREAD_MUTEX_INITIALIZER;
+static FILE *pgn_out;
+static long wins, draws, losses;   // from A's point of view
+static long decided_wins, decided_draws, decided_losses;   // when a bound was crossed
+static struct timespec started;
+
+/* ════════════════════════════════════════════════════════════════════════════
+ * Statistics
+ * ════════════════════════════════════════════════════════════════════════════ */
+
+static double elo_from_score(double s)
+{
+    if (s <= 0.0) s = 1e-6;
+    if (s >= 1.0) s = 1.0 - 1e-6;
+    return -400.0 * log10(1.0 / s - 1.0);
+}
+
+static double score_from_elo(double elo)
+{
+    return 1.0 / (1.0 + pow(10.0, -elo / 400.0));
+}
+
+typedef struct {
+    double elo, margin;   // estimate and half-width of the 95% interval
+    double llr, lower, upper;
+} MatchStats;
+
+/* Trinomial model: per-game score variance from the W/D/L counts, normal
+ * approximation for the interval and the usual GSPRT approximation
+ * LLR = n (s1 - s0)(2s - s0 - s1) / (2 var) for the test. */
+static MatchStats match_stats(long w, long d, long l)
+{
+    MatchStats st = {0};
+    st.lower = log(cfg.beta / (1.0 - cfg.alpha));
+    st.upper = log((1.0 - cfg.beta) / cfg.alpha);
+    double n = (double)(w + d + l);
+    if (n == 0)
+        return st;
+
+    double s = ((double)w + 0.5 * (double)d) / n;
+    double var = ((double)w * (1.0 - s) * (1.0 - s) + (double)d * (0.5 - s) * (0.5 - s) +
+                  (double)l * s * s) / n;
+    double se = sqrt(var / n);
+    st.elo = elo_from_score(s);
+    st.margin = (elo_from_score(s + 1.96 * se) - elo_from_score(s - 1.96 * se)) / 2.0;
+
+    if (var > 0) {
+        double s0 = score_from_elo(cfg.elo0), s1 = score_from_elo(cfg.elo1);
+        st.llr = n * (s1 - s0) * (2.0 * s - s0 - s1) / (2.0 * var);
+    }
+    return st;
+}
+
+static double elapsed_seconds(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - started.tv_sec) + (double)(now.tv_nsec - started.tv_nsec) / 1e9;
+}
+
+/* ════════════════════════════════════════════════════════════════════════════
+ * Workers
+ * ════════════════════════════════════════════════════════════════════════════ */
+
+static uint64_t pair_seed(long pair)
+{
+    uint64_t z = cfg.seed + (uint64_t)pair * 0x9E3779B97F4A7C15ULL;   // splitmix64
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z ^= z >> 31;
+    return z ? z : 1;
+}
+
+static void *worker_main(void *arg)
+{
+    (void)arg;
+    PlayedGame *g = malloc(sizeof(PlayedGame));
+    if (!g) {
+        fprintf(stderr, "match: out of memory\n");
+        return NULL;
+    }
+
+    long round;
+    while (!atomic_load(&decided) && (round = atomic_fetch_add(&next_game, 1)) < cfg.games) {
+        int a_white = (round % 2 == 0);
+        const MatchEngine *white = &engines[a_white ? 0 : 1];
+        const MatchEngine *black = &engines[a_white ? 1 : 0];
+        uint64_t rng = pair_seed(round / 2);
+        play_game(&white->player, &black->player, &cfg.options, &rng, g);
+
+        pthread_mutex_lock(&out_mutex);
+        if (pgn_out) {
+            play_write_pgn(pgn_out, g, "Sacrifice match", round + 1, white->player.name, black->player.name);
+            fflush(pgn_out);
+        }
+        int a_result = a_white ? g->result : -g->result;
+        if (a_result > 0) wins++;
+        else if (a_result < 0) losses++;
+        else draws++;
+
+        MatchStats st = match_stats(wins, draws, losses);
+        fprintf(stderr, "\rmatch: %ld games  +%ld =%ld -%ld  Elo %+.1f +/- %.1f  LLR %.2f [%.2f, %.2f]   ",
+                wins + draws + losses, wins, draws, losses, st.elo, st.margin, st.llr, st.lower, st.upper);
+        /* Games already in flight still finish and are counted above, but
+         * the verdict is the one that stopped the match */
+        if (!atomic_load(&decided) && (st.llr >= st.upper || st.llr <= st.lower)) {
+            decided_wins = wins;
+            decided_draws = draws;
+            decided_losses = losses;
+            atomic_store(&decided, 1);
+        }
+        pthread_mutex_unlock(&out_mutex);
+    }
+    free(g);
+    return NULL;
+}
+
+/* ════════════════════════════════════════════════════════════════════════════
+ * Command line
+ * ════════════════════════════════════════════════════════════════════════════ */
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s [--engine-a search|nn|mcts] [--weights-a FILE] [--value-a FILE]\n"
+            "          [--nodes-a N] [--depth-a D] [--visits-a N] [--movetime-a MS]\n"
+            "          (same options with -b for engine B)\n"
+            "          [--value FILE] [--nodes N] [--depth D] [--visits N] [--movetime MS]\n"
+            "          (both engines)\n"
+            "          [--games N] [--threads N] [--random-plies N] [--hash MB]\n"
+            "          [--elo0 E] [--elo1 E] [--alpha A] [--beta B] [--seed S] [--pgn FILE]\n"
+            "Plays A against B in colour-reversed pairs until the SPRT of elo0 against\n"
+            "elo1 decides or N games are played.  Default: search with 20000 nodes per\n"
+            "move for both, 1000 games, SPRT [0, 5] at alpha = beta = 0.05, one thread\n"
+            "per core.\n",
+            prog);
+}
+
+/* Per-engine option "--name-a" / "--name-b": returns the engine, or NULL */
+static MatchEngine *engine_option(const char *arg, const char *name)
+{
+    size_t len = strlen(name);
+    if (strlen(arg) != len + 2 || strncmp(arg, name, len) != 0 || arg[len] != '-')
+        return NULL;
+    return arg[len + 1] == 'a' ? &engines[0] : arg[len + 1] == 'b' ? &engines[1] : NULL;
+}
+
+static int set_limit(MatchEngine *only, const char *arg, const char *value)
+{
+    for (int i = 0; i < 2; i++) {
+        if (only && only != &engines[i])
+            continue;
+        SearchLimits *l = &engines[i].player.limits;
+        if (strstr(arg, "nodes")) l->nodes = atoll(value);
+        else if (strstr(arg, "depth")) l->depth = atoi(value);
+        else if (strstr(arg, "visits")) engines[i].player.mcts.visits = atoll(value);
+        else if (strstr(arg, "movetime")) l->movetime_ms = engines[i].player.mcts.movetime_ms = atoi(value);
+        else return 0;
+    }
+    return 1;
+}
+
+int main(int argc, char *argv[])
+{
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    cfg.games = 1000;
+    cfg.threads = cores > 0 ? (int)cores : 1;
+    cfg.hash_mb = 64;
+    cfg.elo0 = 0.0;
+    cfg.elo1 = 5.0;
+    cfg.alpha = cfg.beta = 0.05;
+    cfg.seed = (uint64_t)time(NULL);
+    cfg.options.random_plies = 8;
+    cfg.options.adjudicate = 1;
+    engines[0].weights = engines[1].weights = "nn_weights.bin";
+
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        const char *v = (i + 1 < argc) ? argv[i + 1] : NULL;
+        MatchEngine *e;
+        if (!v) {
+            usage(argv[0]);
+            return 1;
+        }
+        i++;
+        if ((e = engine_option(a, "--engine"))) {
+            if (strcmp(v, "nn") == 0) e->player.use_nn = 1;
+            else if (strcmp(v, "mcts") == 0) e->player.use_mcts = 1;
+            else if (strcmp(v, "search") != 0) { usage(argv[0]); return 1; }
+        } else if ((e = engine_option(a, "--weights"))) {
+            e->weights = v;
+        } else if ((e = engine_option(a, "--value"))) {
+            e->value = v;
+        } else if (strcmp(a, "--value") == 0) {
+            engines[0].value = engines[1].value = v;
+        } else if ((e = engine_option(a, "--nodes")) || (e = engine_option(a, "--depth")) ||
+                   (e = engine_option(a, "--visits")) || (e = engine_option(a, "--movetime"))) {
+            set_limit(e, a, v);
+        } else if (strcmp(a, "--nodes") == 0 || strcmp(a, "--depth") == 0 ||
+                   strcmp(a, "--visits") == 0 || strcmp(a, "--movetime") == 0) {
+            set_limit(NULL, a, v);
+        } else if (strcmp(a, "--games") == 0) {
+            cfg.games = atol(v);
+        } else if (strcmp(a, "--threads") == 0) {
+            cfg.threads = atoi(v);
+        } else if (strcmp(a, "--random-plies") == 0) {
+            cfg.options.random_plies = atoi(v);
+        } else if (strcmp(a, "--hash") == 0) {
+            cfg.hash_mb = atoi(v);
+        } else if (strcmp(a, "--elo0") == 0) {
+            cfg.elo0 = atof(v);
+        } else if (strcmp(a, "--elo1") == 0) {
+            cfg.elo1 = atof(v);
+        } else if (strcmp(a, "--alpha") == 0) {
+            cfg.alpha = atof(v);
+        } else if (strcmp(a, "--beta") == 0) {
+            cfg.beta = atof(v);
+        } else if (strcmp(a, "--seed") == 0) {
+            cfg.seed = strtoull(v, NULL, 10);
+        } else if (strcmp(a, "--pgn") == 0) {
+            cfg.pgn_path = v;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (cfg.threads < 1) cfg.threads = 1;
+    if (cfg.threads > SEARCH_MAX_THREADS) cfg.threads = SEARCH_MAX_THREADS;
+    if (cfg.alpha <= 0 || cfg.alpha >= 1 || cfg.beta <= 0 || cfg.beta >= 1 || cfg.elo1 <= cfg.elo0) {
+        fprintf(stderr, "match: need 0 < alpha, beta < 1 and elo0 < elo1\n");
+        return 1;
+    }
+
+    if (cfg.pgn_path) {
+        pgn_out = fopen(cfg.pgn_path, "a");
+        if (!pgn_out) {
+            fprintf(stderr, "match: cannot open %s for writing\n", cfg.pgn_path);
+            return 1;
+        }
+    }
+
+    suppress_engine_output = 1;
+    bitbase_init(NULL);
+    int any_search = 0;
+    static char names[2][128];
+    for (int i = 0; i < 2; i++) {
+        MatchEngine *e = &engines[i];
+        SearchLimits *l = &e->player.limits;
+        if (e->player.use_nn) {
+            if (!nn_load(&e->net, e->weights)) {
+                fprintf(stderr, "match: cannot load %s\n", e->weights);
+                return 1;
+            }
+            e->player.net = &e->net;
+            snprintf(names[i], sizeof(names[i]), "%c: nn %s", 'A' + i, e->weights);
+        } else if (e->player.use_mcts) {
+            /* Uniform priors without a move network */
+            if (nn_load(&e->net, e->weights))
+                e->player.mcts.policy = &e->net;
+            int n = snprintf(names[i], sizeof(names[i]), "%c: mcts", 'A' + i);
+            if (e->player.mcts.visits)
+                n += snprintf(names[i] + n, sizeof(names[i]) - (size_t)n, " visits %lld", e->player.mcts.visits);
+            if (e->player.mcts.movetime_ms)
+                n += snprintf(names[i] + n, sizeof(names[i]) - (size_t)n, " movetime %d", e->player.mcts.movetime_ms);
+            if (e->value) {
+                if (!value_load(&e->value_net, e->value))
+                    return 1;
+                e->player.mcts.value = &e->value_net;
+                snprintf(names[i] + n, sizeof(names[i]) - (size_t)n, " value %s", e->value);
+            }
+        } else {
+            any_search = 1;
+            if (!l->depth && !l->movetime_ms && !l->nodes)
+                l->nodes = 20000;
+            int n = snprintf(names[i], sizeof(names[i]), "%c: search", 'A' + i);
+            if (l->depth) n += snprintf(names[i] + n, sizeof(names[i]) - (size_t)n, " depth %d", l->depth);
+            if (l->nodes) n += snprintf(names[i] + n, sizeof(names[i]) - (size_t)n, " nodes %lld", l->nodes);
+            if (l->movetime_ms) n += snprintf(names[i] + n, sizeof(names[i]) - (size_t)n, " movetime %d", l->movetime_ms);
+            if (e->value) {
+                if (!value_load(&e->value_net, e->value))
+                    return 1;
+                l->value_net = &e->value_net;
+                snprintf(names[i] + n, sizeof(names[i]) - (size_t)n, " value %s", e->value);
+            }
+            l->table = search_table_new(cfg.hash_mb);
+        }
+        e->player.name = names[i];
+    }
+    if (any_search)
+        search_init(1, 1);   // workers search synchronously, each engine on its own TT
+
+    fprintf(stderr, "match: %s vs %s, up to %ld games on %d threads, SPRT [%.1f, %.1f]\n",
+            engines[0].player.name, engines[1].player.name, cfg.games, cfg.threads, cfg.elo0, cfg.elo1);
+
+    clock_gettime(CLOCK_MONOTONIC, &started);
+    pthread_t workers[SEARCH_MAX_THREADS];
+    for (int i = 0; i < cfg.threads; i++)
+        pthread_create(&workers[i], NULL, worker_main, NULL);
+    for (int i = 0; i < cfg.threads; i++)
+        pthread_join(workers[i], NULL);
+
+    long n = wins + draws + losses;
+    if (!atomic_load(&decided)) {
+        decided_wins = wins;
+        decided_draws = draws;
+        decided_losses = losses;
+    }
+    long dn = decided_wins + decided_draws + decided_losses;
+    MatchStats st = match_stats(decided_wins, decided_draws, decided_losses);
+    const char *verdict = st.llr >= st.upper ? "H1 accepted (A is stronger)"
+                        : st.llr <= st.lower ? "H0 accepted (A is not stronger)"
+                        : "inconclusive";
+    double secs = elapsed_seconds();
+    fprintf(stderr, "\nmatch: %ld games in %.1f s (%.0f games/h), A +%ld =%ld -%ld\n",
+            n, secs, secs > 0 ? (double)n * 3600.0 / secs : 0.0, wins, draws, losses);
+    fprintf(stderr, "match: SPRT after %ld games, A +%ld =%ld -%ld, Elo %+.1f +/- %.1f, LLR %.2f: %s\n",
+            dn, decided_wins, decided_draws, decided_losses, st.elo, st.margin, st.llr, verdict);
+
+    if (pgn_out)
+        fclose(pgn_out);
+    for (int i = 0; i < 2; i++)
+        if (engines[i].player.use_nn || engines[i].player.mcts.policy)
+            nn_free(&engines[i].net);
+    for (int i = 0; i < 2; i++)
+        search_table_free(engines[i].player.limits.table);
+    if (any_search)
+        search_shutdown();
+    return 0;
+}
@@ -0,0 +1,270 @@
+/* mate.c - depth-first proof-number (df-pn) mate solver
+ *
+ * Every node is looked at from the side to move: phi is the number of leaf
+ * proofs that side still needs to win, delta the number its opponent needs.
+ * At the attacker's turn phi/delta are the proof/disproof numbers, at the
+ * defender's turn they swap, so one routine handles both:
+ *
+ *     phi(n)   = min delta(child)
+ *     delta(n) = sum phi(child)
+ *
+ * mid() keeps expanding the child with the smallest delta until the node's
+ * own numbers reach the thresholds handed down by its parent, and leaves
+ * the result in the TT.  The attacker only tries checking moves, which is
+ * what keeps the tree small on mate puzzles.
+ *
+ * "remaining" counts the attacker moves still allowed.  It is part of the
+ * TT key: a position that is not mate in 2 may well be mate in 3.  A
+ * defender node with nothing remaining is settled on the spot: mated if it
+ * has no evasion, refuted otherwise.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "chess.h"
+#include "mate.h"
+#include "zobrist.h"
+
+#define PN_INF  (1u << 30)
+
+typedef struct {
+    uint64_t key;
+    uint32_t phi;
+    uint32_t delta;
+} MateEntry;
+
+struct MateSolver {
+    MateEntry *tt;
+    uint64_t   mask;
+    long long  nodes;
+    long long  limit;
+};
+
+typedef struct {
+    struct Piece board[8][8];
+    enum Colour  side;
+    struct Move  last;
+} MateNode;
+
+/* ════════════════════════════════════════════════════════════════════════════
+ * Transposition table
+ * ════════════════════════════════════════════════════════════════════════════ */
+
+static uint64_t node_key(const MateNode *n, int remaining)
+{
+    uint64_t h = zobrist_board_key(n->board);
+    if (n->side == BLACK)
+        h ^= zobrist_side;
+
+    const struct Move *l = &n->last;
+    if (l->fromX >= 0 && l->fromX == l->toX && abs(l->toY - l->fromY) == 2 &&
+        n->board[l->toX][l->toY].type == PAWN)
+        h ^= zobrist_ep[l->toX];
+
+    return h ^ (0x9E3779B97F4A7C15ULL * (uint64_t)(remaining + 1));
+}
+
+static int tt_probe(const MateSolver *s, uint64_t key, uint32_t *phi, uint32_t *delta)
+{
+    const MateEntry *e = &s->tt[key & s->mask];
+    if (e->key != key)
+        return 0;
+    *phi = e->phi;
+    *delta = e->delta;
+    return 1;
+}
+
+static void tt_store(MateSolver *s, uint64_t key, uint32_t phi, uint32_t delta)
+{
+    MateEntry *e = &s->tt[key & s->mask];
+    e->key = key;
+    e->phi = phi;
+    e->delta = delta;
+}
+
+MateSolver *mate_solver_new(int tt_bits)
+{
+    if (tt_bits < 10) tt_bits = 10;
+    if (tt_bits > 26) tt_bits = 26;
+
+    MateSolver *s = calloc(1, sizeof(*s));
+    if (!s)
+        return NULL;
+    s->tt = calloc((size_t)1 << tt_bits, sizeof(MateEntry));
+    if (!s->tt) {
+        fprintf(stderr, "mate: cannot allocate a 2^%d entry table\n", tt_bits);
+        free(s);
+        return NULL;
+    }
+    s->mask = ((uint64_t)1 << tt_bits) - 1;
+    zobrist_init();
+    return s;
+}
+
+void mate_solver_free(MateSolver *s)
+{
+    if (!s)
+        return;
+    free(s->tt);
+    free(s);
+}
+
+void mate_solver_clear(MateSolver *s)
+{
+    memset(s->tt, 0, (size_t)(s->mask + 1) * sizeof(MateEntry));
+}
+
+long long mate_solver_nodes(const MateSolver *s)
+{
+    return s->nodes;
+}
+
+/* ════════════════════════════════════════════════════════════════════════════
+ * Search
+ * ════════════════════════════════════════════════════════════════════════════ */
+
+static void child_of(const MateNode *n, struct Move m, MateNode *c)
+{
+    memcpy(c->board, n->board, sizeof(c->board));
+    playMoveOnBoard(c->board, m);
+    c->side = (n->side == WHITE) ? BLACK : WHITE;
+    c->last = m;
+}
+
+static uint32_t add_saturated(uint32_t a, uint32_t b)
+{
+    return (a + b >= PN_INF) ? PN_INF : a + b;
+}
+
+static void mid(MateSolver *s, MateNode *n, int attacker, int remaining,
+                uint32_t thphi, uint32_t thdelta)
+{
+    uint64_t key = node_key(n, remaining);
+    s->nodes++;
+
+    /* Out of attacker moves.  The pre-stored entries below normally cover
+     * this, but the always-replace TT can lose them, and without these
+     * cases the recursion would have no depth bound. */
+    if (attacker && remaining <= 0) {
+        tt_store(s, key, PN_INF, 0);
+        return;
+    }
+    if (!attacker && remaining == 0) {
+        int mated = isInCheck(n->board, n->side) && !hasLegalEvasion(n->board, n->side, &n->last);
+        tt_store(s, key, mated ? PN_INF : 0, mated ? 0 : PN_INF);
+        return;
+    }
+
+    struct MoveList moves = attacker ? checkingMoves(n->board, n->side, &n->last)
+                                     : validMoves_ThreadSafe(n->board, n->side, &n->last);
+    if (moves.count == 0) {
+        tt_store(s, key, PN_INF, 0);   /* no check to give, or mated */
+        return;
+    }
+
+    /* Child keys once; defender replies to a check are settled right away
+     * when they are mate or when the attacker has no moves left */
+    uint64_t keys[sizeof(moves.moves) / sizeof(moves.moves[0])];
+    int child_remaining = attacker ? remaining - 1 : remaining;
+    for (int i = 0; i < moves.count; i++) {
+        MateNode c;
+        uint32_t phi, delta;
+        child_of(n, moves.moves[i], &c);
+        keys[i] = node_key(&c, child_remaining);
+        if (!attacker || tt_probe(s, keys[i], &phi, &delta))
+            continue;
+        if (!hasLegalEvasion(c.board, c.side, &c.last))
+            tt_store(s, keys[i], PN_INF, 0);
+        else if (child_remaining == 0)
+            tt_store(s, keys[i], 0, PN_INF);
+    }
+
+    for (;;) {
+        uint32_t phi = PN_INF, delta = 0, delta2 = PN_INF, best_phi = 0;
+        int best = -1;
+        for (int i = 0; i < moves.count; i++) {
+            uint32_t cphi = 1, cdelta = 1;
+            tt_probe(s, keys[i], &cphi, &cdelta);
+            delta = add_saturated(delta, cphi);
+            if (cdelta < phi) {
+                delta2 = phi;
+                phi = cdelta;
+                best = i;
+                best_phi = cphi;
+            } else if (cdelta < delta2) {
+                delta2 = cdelta;
+            }
+        }
+
+        if (phi >= thphi || delta >= thdelta || phi >= PN_INF || delta >= PN_INF ||
+            best < 0 || s->nodes >= s->limit) {
+            tt_store(s, key, phi, delta);
+            return;
+        }
+
+        MateNode c;
+        child_of(n, moves.moves[best], &c);
+        mid(s, &c, !attacker, child_remaining,
+            thdelta + best_phi - delta, thphi < delta2 + 1 ? thphi : delta2 + 1);
+    }
+}
+
+/* Is the reply position after one of the root moves proven mated? */
+static int child_is_mated(MateSolver *s, MateNode *child, int remaining)
+{
+    uint32_t phi, delta;
+    uint64_t key = node_key(child, remaining);
+    if (!tt_probe(s, key, &phi, &delta)) {
+        mid(s, child, 0, remaining, PN_INF, PN_INF);
+        if (!tt_probe(s, key, &phi, &delta))
+            return 0;
+    }
+    return delta == 0;
+}
+
+int mate_solve(MateSolver *s, struct Piece board[8][8], enum Colour side, const struct Move *last,
+               int max_moves, long long node_limit, struct Move *best)
+{
+    *best = (struct Move){-1, -1, -1, -1};
+    if (max_moves > MATE_MAX_MOVES)
+        max_moves = MATE_MAX_MOVES;
+
+    MateNode root;
+    memcpy(root.board, board, sizeof(root.board));
+    root.side = side;
+    root.last = *last;
+    s->nodes = 0;
+    s->limit = node_limit;
+
+    /* Shortest mate first: each length reuses the table of the last */
+    for (int n = 1; n <= max_moves && s->nodes < node_limit; n++) {
+        uint32_t phi, delta;
+        mid(s, &root, 1, n, PN_INF, PN_INF);
+        if (!tt_probe(s, node_key(&root, n), &phi, &delta) || phi != 0)
+            continue;
+
+        struct MoveList moves = checkingMoves(root.board, side, &root.last);
+        for (int i = 0; i < moves.count; i++) {
+            MateNode c;
+            child_of(&root, moves.moves[i], &c);
+            if (child_is_mated(s, &c, n - 1)) {
+                *best = moves.moves[i];
+                return n;
+            }
+        }
+    }
+    return 0;
+}
+
+int mate_theme_length(const char *themes)
+{
+    for (const char *p = strstr(themes, "mateIn"); p; p = strstr(p + 1, "mateIn")) {
+        int n = p[6] - '0';
+        if ((p == themes || p[-1] == ' ') && n >= 1 && n <= MATE_MAX_MOVES &&
+            (p[7] == '\0' || p[7] == ' ' || p[7] == '\n'))
+            return n;
+    }
+    return 0;
+}
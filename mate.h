@@ -0,0 +1,42 @@
+/* mate.h - Depth-first proof-number mate solver
+ *
+ * Proves "side to move mates in at most N moves" with df-pn: the attacker
+ * only plays checking moves (checkingMoves), the defender every legal
+ * reply, and proof/disproof numbers steer the search towards the most
+ * forcing lines.  Each solver owns its transposition table, so one solver
+ * per thread needs no locking.
+ *
+ *   MateSolver *s = mate_solver_new(MATE_TT_BITS_DEFAULT);
+ *   struct Move m;
+ *   int n = mate_solve(s, board, WHITE, &last, 3, MATE_NODES_DEFAULT, &m);
+ *   mate_solver_free(s);
+ */
+#ifndef MATE_H
+#define MATE_H
+
+#include "chess.h"
+
+#define MATE_MAX_MOVES        5         /* longest mate the themes ask for  */
+#define MATE_TT_BITS_DEFAULT  18        /* 2^18 entries, 4 MB per solver    */
+#define MATE_NODES_DEFAULT    200000    /* node budget per mate_solve()     */
+
+typedef struct MateSolver MateSolver;
+
+MateSolver *mate_solver_new(int tt_bits);
+void        mate_solver_free(MateSolver *s);
+void        mate_solver_clear(MateSolver *s);
+
+/* Look for a mate by `side` in at most max_moves of its own moves.  Returns
+ * the mate length (1..max_moves) and the first move in *best, or 0 when no
+ * mate was proven within node_limit nodes (best->fromX = -1). */
+int mate_solve(MateSolver *s, struct Piece board[8][8], enum Colour side, const struct Move *last,
+               int max_moves, long long node_limit, struct Move *best);
+
+/* Nodes expanded by the last mate_solve() call. */
+long long mate_solver_nodes(const MateSolver *s);
+
+/* N for a Lichess theme list containing "mateInN" (1..MATE_MAX_MOVES),
+ * 0 otherwise. */
+int mate_theme_length(const char *themes);
+
+#endif /* MATE_H */
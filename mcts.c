@@ -0,0 +1,499 @@
+/* mcts.c - Monte Carlo tree search engine (see mcts.h) */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+
+#include "chess.h"
+#include "bitbase.h"
+#include "mcts.h"
+#include "nn.h"
+#include "search.h"
+#include "value.h"
+
+#define VALUE_ONE  65536    /* fixed-point unit of the atomic value sums */
+
+enum { NODE_NEW = 0, NODE_BUSY, NODE_EXPANDED, NODE_TERMINAL };
+
+/* One tree node.  value sums the playout results from the point of view
+ * of the player who made `move`, so a parent picks its child by plain Q. */
+typedef struct {
+    struct Move  move;          /* from the parent; pawns promote to a queen */
+    float        prior;
+    float        exact;         /* NODE_TERMINAL: the known value */
+    int          first_child;   /* arena index, valid once NODE_EXPANDED */
+    int          child_count;
+    atomic_int   state;
+    atomic_int   visits;        /* completed playouts + virtual losses */
+    atomic_llong value;         /* in VALUE_ONE units */
+} MCTSNode;
+
+typedef struct {
+    MCTSNode          *nodes;
+    long long          capacity;
+    atomic_llong       used;
+    const MCTSLimits  *limits;
+    const SearchPosition *root;
+    atomic_int        *stop;
+    atomic_int         done;        /* budget spent or arena full */
+    atomic_llong       reserved;    /* playouts handed out */
+    atomic_llong       playouts;    /* playouts backed up */
+    atomic_int         seldepth;
+    struct timespec    start;
+} MCTSTree;
+
+/* A leaf waiting for the batched evaluation */
+typedef struct {
+    SearchPosition pos;
+    int            path[SEARCH_MAX_PLY];
+    int            len;
+    int            expand;       /* 0: value only (path too deep or arena full) */
+    struct MoveList moves;
+    float          value;        /* side to move at the leaf */
+} MCTSLeaf;
+
+static long long elapsed_ms(const MCTSTree *t)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)(now.tv_sec - t->start.tv_sec) * 1000 +
+           (now.tv_nsec - t->start.tv_nsec) / 1000000;
+}
+
+/* ════════════════════════════════════════════════════════════════════════════
+ * Leaf scoring
+ * ════════════════════════════════════════════════════════════════════════════ */
+
+/* Centipawns to an expected score in [-1, 1] and back */
+static float cp_to_value(int cp)
+{
+    return 2.0f / (1.0f + expf(-(float)cp / VALUE_CP_SCALE)) - 1.0f;
+}
+
+static int value_to_cp(float v)
+{
+    if (v > 0.999f) v = 0.999f;
+    if (v < -0.999f) v = -0.999f;
+    return (int)lrintf(VALUE_CP_SCALE * logf((1.0f + v) / (1.0f - v)));
+}
+
+static int is_repetition(const SearchPosition *pos)
+{
+    uint64_t key = search_position_hash(pos);
+    int limit = pos->historyCount - pos->halfmoveClock;
+    if (limit < 0) limit = 0;
+    for (int i = pos->historyCount - 2; i >= limit; i -= 2)
+        if (pos->history[i] == key)
+            return 1;
+    return 0;
+}
+
+/* Game-theoretic value of a leaf for the side to move, if it has one.
+ * Fills leaf->moves either way.  The root is always expanded: a draw or
+ * bitbase verdict there still needs a move to play. */
+static int exact_value(MCTSLeaf *leaf, float *value)
+{
+    SearchPosition *pos = &leaf->pos;
+    leaf->moves = validMoves_ThreadSafe(pos->board, pos->side, &pos->lastMove);
+    if (leaf->moves.count == 0) {
+        *value = isInCheck(pos->board, pos->side) ? -1.0f : 0.0f;
+        return 1;
+    }
+    if (leaf->len == 1)
+        return 0;
+    if (pos->halfmoveClock >= 100 || is_repetition(pos)) {
+        *value = 0.0f;
+        return 1;
+    }
+
+    int pieces = 0;
+    for (int x = 0; x < 8; x++)
+        for (int y = 0; y < 8; y++)
+            pieces += (pos->board[x][y].type != (enum PieceType)-1);
+    int wdl;
+    if (pieces <= BITBASE_MAX_PIECES && bitbase_probe(pos->board, pos->side, &wdl)) {
+        *value = (float)wdl;
+        return 1;
+    }
+    return 0;
+}
+
+static float leaf_value(const MCTSTree *t, const SearchPosition *pos)
+{
+    if (t->limits->value)
+        return cp_to_value(value_evaluate(t->limits->value, pos->board, pos->side));
+    return cp_to_value(search_evaluate(pos));
+}
+
+/* Softmax of the move network's preferences, or uniform without one */
+static void leaf_priors(const MCTSTree *t, MCTSLeaf *leaf, const float *nn_out, float *priors)
+{
+    int n = leaf->moves.count;
+    if (!nn_out) {
+        for (int i = 0; i < n; i++)
+            priors[i] = 1.0f / (float)n;
+        return;
+    }
+    nn_score_moves(t->limits->policy, nn_out, leaf->pos.board, &leaf->moves, priors);
+    float max = priors[0], sum = 0.0f;
+    for (int i = 1; i < n; i++)
+        if (priors[i] > max)
+            max = priors[i];
+    for (int i = 0; i < n; i++) {
+        priors[i] = expf(priors[i] - max);
+        sum += priors[i];
+    }
+    for (int i = 0; i < n; i++)
+        priors[i] /= sum;
+}
+
+/* ════════════════════════════════════════════════════════════════════════════
+ * Tree operations
+ * ════════════════════════════════════════════════════════════════════════════ */
+
+/* Take (sign = +1) or give back (sign = -1) a virtual loss along a path */
+static void virtual_loss(MCTSTree *t, const int *path, int len, int sign)
+{
+    for (int i = 0; i < len; i++) {
+        MCTSNode *node = &t->nodes[path[i]];
+        atomic_fetch_add_explicit(&node->visits, sign, memory_order_relaxed);
+        atomic_fetch_sub_explicit(&node->value, (long long)sign * VALUE_ONE, memory_order_relaxed);
+    }
+}
+
+/* Turn the virtual losses into real visits worth `value` (side to move at
+ * the leaf) */
+static void backup(MCTSTree *t, const int *path, int len, float value)
+{
+    float v = -value;   /* the leaf's value for the player who moved into it */
+    for (int i = len - 1; i >= 0; i--) {
+        long long add = (long long)lrintf((v + 1.0f) * VALUE_ONE);
+        atomic_fetch_add_explicit(&t->nodes[path[i]].value, add, memory_order_relaxed);
+        v = -v;
+    }
+    atomic_fetch_add_explicit(&t->playouts, 1, memory_order_relaxed);
+}
+
+/* Hang the leaf's moves under its node.  Returns 0 when the arena is full. */
+static int expand(MCTSTree *t, int index, const MCTSLeaf *leaf, const float *priors)
+{
+    MCTSNode *node = &t->nodes[index];
+    int n = leaf->moves.count;
+    long long first = atomic_fetch_add(&t->used, n);
+    if (first + n > t->capacity) {
+        atomic_store(&t->done, 1);
+        atomic_store_explicit(&node->state, NODE_NEW, memory_order_release);
+        return 0;
+    }
+    for (int i = 0; i < n; i++) {
+        MCTSNode *c = &t->nodes[first + i];
+        c->move = leaf->moves.moves[i];
+        c->prior = priors[i];
+        c->exact = 0.0f;
+        c->first_child = -1;
+        c->child_count = 0;
+        atomic_init(&c->state, NODE_NEW);
+        atomic_init(&c->visits, 0);
+        atomic_init(&c->value, 0);
+    }
+    node->first_child = (int)first;
+    node->child_count = n;
+    atomic_store_explicit(&node->state, NODE_EXPANDED, memory_order_release);
+    return 1;
+}
+
+static int select_child(const MCTSTree *t, const MCTSNode *node)
+{
+    float cpuct = t->limits->cpuct > 0.0f ? t->limits->cpuct : MCTS_CPUCT;
+    int parent_visits = atomic_load_explicit(&node->visits, memory_order_relaxed);
+    float explore = cpuct * sqrtf((float)(parent_visits > 1 ? parent_visits : 1));
+    int best = node->first_child;
+    float best_score = -1e30f;
+    for (int i = 0; i < node->child_count; i++) {
+        const MCTSNode *c = &t->nodes[node->first_child + i];
+        int n = atomic_load_explicit(&c->visits, memory_order_relaxed);
+        /* Unvisited children count as a draw */
+        float q = n ? (float)atomic_load_explicit(&c->value, memory_order_relaxed) /
+                      VALUE_ONE / (float)n : 0.0f;
+        float score = q + explore * c->prior / (float)(1 + n);
+        if (score > best_score) {
+            best_score = score;
+            best = node->first_child + i;
+        }
+    }
+    return best;
+}
+
+/* Walk from the root to a leaf, taking virtual losses on the way.
+ * Returns 1 with the leaf filled in, 0 if another thread is expanding the
+ * node reached (the path is released again). */
+static int select_leaf(MCTSTree *t, MCTSLeaf *leaf)
+{
+    leaf->pos = *t->root;
+    leaf->len = 0;
+    leaf->expand = 1;
+    int index = 0;
+    for (;;) {
+        MCTSNode *node = &t->nodes[index];
+        leaf->path[leaf->len++] = index;
+        virtual_loss(t, &index, 1, 1);
+
+        int state = atomic_load_explicit(&node->state, memory_order_acquire);
+        if (state == NODE_NEW) {
+            int expected = NODE_NEW;
+            if (atomic_compare_exchange_strong(&node->state, &expected, NODE_BUSY))
+                return 1;
+            state = expected;   /* another thread expanded it, possibly to a terminal */
+        }
+        if (state == NODE_TERMINAL) {
+            leaf->expand = 0;
+            leaf->value = node->exact;
+            return 1;
+        }
+        if (state == NODE_BUSY) {
+            virtual_loss(t, leaf->path, leaf->len, -1);
+            return 0;
+        }
+        if (leaf->len == SEARCH_MAX_PLY) {
+            leaf->expand = 0;   /* evaluate without growing the tree further */
+            leaf->value = leaf_value(t, &leaf->pos);
+            return 1;
+        }
+        index = select_child(t, node);
+        search_position_play(&leaf->pos, t->nodes[index].move, -1);
+    }
+}
+
+/* ════════════════════════════════════════════════════════════════════════════
+ * Workers
+ * ════════════════════════════════════════════════════════════════════════════ */
+
+typedef struct {
+    MCTSTree *tree;
+    MCTSLeaf *leaves;
+    float    *inputs;
+    float    *outputs;
+} MCTSWorker;
+
+static int should_stop(MCTSTree *t)
+{
+    if (atomic_load_explicit(&t->done, memory_order_relaxed))
+        return 1;
+    if (atomic_load_explicit(&t->playouts, memory_order_relaxed) == 0)
+        return 0;   /* like search.c's first iteration: always have a move */
+    if ((t->stop && atomic_load_explicit(t->stop, memory_order_relaxed)) ||
+        (t->limits->movetime_ms > 0 && elapsed_ms(t) >= t->limits->movetime_ms)) {
+        atomic_store(&t->done, 1);
+        return 1;
+    }
+    return 0;
+}
+
+/* Evaluate a batch: exact values first, then one network call for the
+ * priors of everything left, then expansion and backup */
+static void evaluate_batch(MCTSWorker *w, int count)
+{
+    MCTSTree *t = w->tree;
+    const struct NeuralNet *net = t->limits->policy;
+    int pending[MCTS_MAX_BATCH], npending = 0;
+
+    for (int i = 0; i < count; i++) {
+        MCTSLeaf *leaf = &w->leaves[i];
+        if (!leaf->expand)
+            continue;
+        MCTSNode *node = &t->nodes[leaf->path[leaf->len - 1]];
+        if (exact_value(leaf, &leaf->value)) {
+            node->exact = leaf->value;
+            atomic_store_explicit(&node->state, NODE_TERMINAL, memory_order_release);
+            leaf->expand = 0;
+            continue;
+        }
+        leaf->value = leaf_value(t, &leaf->pos);
+        if (net)
+            nn_encode_board(leaf->pos.board, w->inputs + (size_t)npending * NN_INPUT_SIZE);
+        pending[npending++] = i;
+    }
+    if (net && npending)
+        nn_forward_batch(net, w->inputs, w->outputs, npending);
+
+    for (int k = 0; k < npending; k++) {
+        MCTSLeaf *leaf = &w->leaves[pending[k]];
+        float priors[224];
+        leaf_priors(t, leaf, net ? w->outputs + (size_t)k * (size_t)net->output_size : NULL, priors);
+        expand(t, leaf->path[leaf->len - 1], leaf, priors);
+    }
+
+    for (int i = 0; i < count; i++) {
+        MCTSLeaf *leaf = &w->leaves[i];
+        backup(t, leaf->path, leaf->len, leaf->value);
+        int depth = leaf->len - 1, seen = atomic_load(&t->seldepth);
+        while (depth > seen && !atomic_compare_exchange_weak(&t->seldepth, &seen, depth))
+            ;
+    }
+}
+
+static void *worker_main(void *arg)
+{
+    MCTSWorker *w = arg;
+    MCTSTree *t = w->tree;
+    int batch = t->limits->batch > 0 ? t->limits->batch : MCTS_BATCH;
+    if (batch > MCTS_MAX_BATCH) batch = MCTS_MAX_BATCH;
+
+    while (!should_stop(t)) {
+        int count = 0, misses = 0;
+        while (count < batch && misses < batch) {
+            if (t->limits->visits > 0 &&
+                atomic_fetch_add(&t->reserved, 1) >= t->limits->visits) {
+                atomic_store(&t->done, 1);
+                break;
+            }
+            if (select_leaf(t, &w->leaves[count])) {
+                count++;
+            } else {
+                /* Collided with a node another thread is expanding */
+                misses++;
+                if (t->limits->visits > 0)
+                    atomic_fetch_sub(&t->reserved, 1);
+            }
+        }
+        if (count)
+            evaluate_batch(w, count);
+        else
+            sched_yield();
+    }
+    return NULL;
+}
+
+static int worker_alloc(MCTSWorker *w, MCTSTree *t)
+{
+    const struct NeuralNet *net = t->limits->policy;
+    w->tree = t;
+    w->leaves = malloc(MCTS_MAX_BATCH * sizeof(MCTSLeaf));
+    w->inputs = net ? malloc((size_t)MCTS_MAX_BATCH * NN_INPUT_SIZE * sizeof(float)) : NULL;
+    w->outputs = net ? malloc((size_t)MCTS_MAX_BATCH * (size_t)net->output_size * sizeof(float)) : NULL;
+    return w->leaves && (!net || (w->inputs && w->outputs));
+}
+
+static void worker_free(MCTSWorker *w)
+{
+    free(w->leaves);
+    free(w->inputs);
+    free(w->outputs);
+}
+
+/* ════════════════════════════════════════════════════════════════════════════
+ * Search
+ * ════════════════════════════════════════════════════════════════════════════ */
+
+static int most_visited(const MCTSTree *t, const MCTSNode *node)
+{
+    int best = -1, best_visits = -1;
+    for (int i = 0; i < node->child_count; i++) {
+        int n = atomic_load(&t->nodes[node->first_child + i].visits);
+        if (n > best_visits) {
+            best_visits = n;
+            best = node->first_child + i;
+        }
+    }
+    return best;
+}
+
+long long mcts_arena_nodes(int mb)
+{
+    return (long long)mb * 1024 * 1024 / (long long)sizeof(MCTSNode);
+}
+
+SearchResult mcts_search(const SearchPosition *pos, const MCTSLimits *limits, atomic_int *stop)
+{
+    SearchResult r;
+    memset(&r, 0, sizeof(r));
+    r.best = r.ponder = (struct Move){-1, -1, -1, -1};
+
+    SearchPosition scratch = *pos;
+    if (validMoves_ThreadSafe(scratch.board, scratch.side, &scratch.lastMove).count == 0)
+        return r;   /* mated or stalemated: nothing to search */
+
+    MCTSLimits lim = *limits;
+    if (!lim.visits && !lim.movetime_ms && !stop)
+        lim.visits = MCTS_DEFAULT_VISITS;
+    int threads = lim.threads > 0 ? lim.threads : 1;
+    if (threads > SEARCH_MAX_THREADS) threads = SEARCH_MAX_THREADS;
+
+    MCTSTree t;
+    memset(&t, 0, sizeof(t));
+    t.capacity = lim.arena_nodes > 0 ? lim.arena_nodes : MCTS_ARENA_NODES;
+    t.nodes = malloc((size_t)t.capacity * sizeof(MCTSNode));
+    t.limits = &lim;
+    t.root = pos;
+    t.stop = stop;
+    atomic_init(&t.used, 1);
+    clock_gettime(CLOCK_MONOTONIC, &t.start);
+
+    MCTSWorker workers[SEARCH_MAX_THREADS];
+    int started = 0;
+    if (!t.nodes) {
+        fprintf(stderr, "mcts: cannot allocate %lld nodes\n", t.capacity);
+        return r;
+    }
+    memset(&t.nodes[0], 0, sizeof(MCTSNode));
+    atomic_init(&t.nodes[0].state, NODE_NEW);
+
+    for (; started < threads; started++)
+        if (!worker_alloc(&workers[started], &t)) {
+            worker_free(&workers[started]);
+            break;
+        }
+    if (started == 0) {
+        fprintf(stderr, "mcts: out of memory\n");
+        free(t.nodes);
+        return r;
+    }
+
+    pthread_t helpers[SEARCH_MAX_THREADS];
+    int running = 1;
+    for (; running < started; running++)
+        if (pthread_create(&helpers[running], NULL, worker_main, &workers[running]) != 0)
+            break;
+    worker_main(&workers[0]);
+    for (int i = 1; i < running; i++)
+        pthread_join(helpers[i], NULL);
+    for (int i = 0; i < started; i++)
+        worker_free(&workers[i]);
+
+    /* Best move and PV: most-visited children from the root down */
+    const MCTSNode *node = &t.nodes[0];
+    while (r.pv_len < SEARCH_MAX_PLY &&
+           atomic_load(&node->state) == NODE_EXPANDED && node->child_count > 0) {
+        int c = most_visited(&t, node);
+        if (atomic_load(&t.nodes[c].visits) == 0)
+            break;
+        r.pv[r.pv_len++] = t.nodes[c].move;
+        node = &t.nodes[c];
+    }
+    if (r.pv_len > 0) {
+        r.best = r.pv[0];
+        const MCTSNode *b = &t.nodes[most_visited(&t, &t.nodes[0])];
+        int n = atomic_load(&b->visits);
+        r.score = value_to_cp((float)atomic_load(&b->value) / VALUE_ONE / (float)n);
+    } else if (atomic_load(&t.nodes[0].state) == NODE_EXPANDED && t.nodes[0].child_count > 0) {
+        const MCTSNode *root = &t.nodes[0];
+        int best = root->first_child;
+        for (int i = 1; i < root->child_count; i++)
+            if (t.nodes[root->first_child + i].prior > t.nodes[best].prior)
+                best = root->first_child + i;
+        r.best = t.nodes[best].move;
+    }
+    if (r.pv_len > 1)
+        r.ponder = r.pv[1];
+    r.nodes = atomic_load(&t.playouts);
+    r.depth = atomic_load(&t.seldepth);
+    r.time_ms = (int)elapsed_ms(&t);
+
+    free(t.nodes);
+    return r;
+}
@@ -0,0 +1,61 @@
+/* mcts.h - Monte Carlo tree search engine with network priors
+ *
+ * PUCT tree search in the AlphaZero style, an alternative to the alpha-beta
+ * engine in search.h.  Each playout walks the tree by
+ *
+ *   Q(child) + cpuct × P(child) × sqrt(N(parent)) / (1 + N(child))
+ *
+ * and expands one new leaf: the move network (nn.h) gives the priors P over
+ * its legal moves, the value network (value.h) or the hand-crafted
+ * evaluation its value.  Checkmate and stalemate are scored exactly
+ * instead, and so are repetitions, the fifty-move rule and bitbase
+ * positions below the root (the root is always expanded so there is a
+ * move to play).
+ *
+ * Tree nodes come from one arena allocated per search; children are bumped
+ * off it in a block with a single atomic add.  Threads share the tree
+ * without locks: visit counts and value sums are atomic, a node is expanded
+ * by whichever thread claims it first (compare-and-swap on its state), and
+ * every node on a playout's path takes a virtual loss until its value is
+ * backed up, which steers other threads onto different lines.  Each thread
+ * collects up to `batch` leaves before evaluating them with one
+ * nn_forward_batch() call.
+ */
+#ifndef MCTS_H
+#define MCTS_H
+
+#include <stdatomic.h>
+#include "chess.h"
+#include "search.h"
+
+struct NeuralNet;
+struct ValueNet;
+
+#define MCTS_DEFAULT_VISITS  800       /* when no visit, time or stop limit is given */
+#define MCTS_ARENA_NODES     (1 << 20) /* default node pool, ~40 MB */
+#define MCTS_BATCH           8         /* leaves per batched evaluation */
+#define MCTS_MAX_BATCH       64
+#define MCTS_CPUCT           1.5f
+
+typedef struct {
+    long long visits;        /* playouts, 0 = no limit                     */
+    int       movetime_ms;   /* 0 = no limit                               */
+    int       threads;       /* 0 = 1                                      */
+    int       batch;         /* leaves per batched evaluation, 0 = MCTS_BATCH */
+    float     cpuct;         /* exploration constant, 0 = MCTS_CPUCT       */
+    long long arena_nodes;   /* tree node pool, 0 = MCTS_ARENA_NODES       */
+    const struct NeuralNet *policy;  /* priors, NULL = uniform             */
+    const struct ValueNet  *value;   /* leaf values, NULL = hand-crafted   */
+} MCTSLimits;
+
+/* Search pos on the calling thread plus limits->threads - 1 helpers until
+ * the visit or time budget is spent, the arena fills or *stop is set (stop
+ * may be NULL).  Without any limit or stop flag, MCTS_DEFAULT_VISITS
+ * playouts are run.  In the result, nodes counts playouts, depth the
+ * deepest playout, and best/pv follow the most-visited children. */
+SearchResult mcts_search(const SearchPosition *pos, const MCTSLimits *limits, atomic_int *stop);
+
+/* Tree nodes that fit in mb megabytes, for MCTSLimits.arena_nodes */
+long long mcts_arena_nodes(int mb);
+
+#endif /* MCTS_H */
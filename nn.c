@@ -1,4 +1,4 @@
-/* nn.c - deep MLP chess move selector (10 hidden layers)
+/* nn.c - deep MLP chess move selector (shape read from the weight file)
  *
  * Replaces evaluation.c.  The engine no longer uses minimax search or
  * hand-crafted piece-value heuristics.  Instead a deep dense network maps
@@ -21,6 +21,11 @@
 
 #include "chess.h"
 #include "nn.h"
+#include "bitbase.h"
+#include "book.h"
+#include "dataset.h"
+#include "stats.h"
+#include "trace.h"
 
 /* ── Global network instance ─────────────────────────────────────────────── */
 NeuralNet g_net = {0};
@@ -40,6 +45,9 @@ extern int           halfmoveClock;
 extern int           depth;
 extern int           suppress_engine_output;
 
+/* ── Training mutex wait times (reported by puzzles_mt.c) ────────────────── */
+LatencyHistogram nn_train_lock_wait_hist;
+
 /* ── Mutex for thread-safe puzzle evaluation ─────────────────────────────── */
 static pthread_mutex_t nn_eval_mutex = PTHREAD_MUTEX_INITIALIZER;
 
@@ -75,47 +83,115 @@ void nn_encode_board(const struct Piece b[8][8], float *out)
  * Network lifecycle
  * ════════════════════════════════════════════════════════════════════════════ */
 
-void nn_init(NeuralNet *net)
+static int head_outputs(enum NNHead head)
+{
+    return (head == NN_HEAD_POLICY) ? NN_POLICY_SIZE : NN_OUTPUT_SIZE;
+}
+
+/* Fill widths[] for a head and hidden layer widths; 0 if the shape is out of
+ * range (the forward pass keeps hidden activations on the stack). */
+static int nn_shape(int widths[NN_MAX_LAYERS + 1], int *layers, enum NNHead head,
+                    int hidden_layers, const int *hidden_widths)
 {
-    const size_t w_bytes = (size_t)NN_LAYER_SIZE * NN_LAYER_SIZE * sizeof(float);
-    const size_t b_bytes = (size_t)NN_LAYER_SIZE * sizeof(float);
+    if (hidden_layers < 0 || hidden_layers >= NN_MAX_LAYERS)
+        return 0;
+    widths[0] = NN_INPUT_SIZE;
+    for (int l = 0; l < hidden_layers; l++) {
+        if (hidden_widths[l] < 1 || hidden_widths[l] > NN_MAX_LAYER_SIZE)
+            return 0;
+        widths[l + 1] = hidden_widths[l];
+    }
+    widths[hidden_layers + 1] = head_outputs(head);
+    *layers = hidden_layers + 1;
+    return 1;
+}
 
-    for (int l = 0; l < NN_TOTAL_LAYERS; l++) {
-        net->weights_layers[l] = malloc(w_bytes);
-        net->bias_layers[l] = malloc(b_bytes);
-        if (!net->weights_layers[l] || !net->bias_layers[l]) {
-            fprintf(stderr, "nn_init: out of memory\n");
-            exit(EXIT_FAILURE);
+/* Allocate (uninitialised) weights and training scratch for the given head
+ * and widths.  Returns 0 if out of memory, leaving nothing allocated. */
+static int nn_alloc(NeuralNet *net, enum NNHead head, int layers, const int *widths)
+{
+    net->head = head;
+    net->layers = layers;
+    memcpy(net->widths, widths, (size_t)(layers + 1) * sizeof(int));
+    net->output_size = widths[layers];
+    for (int l = 0; l < layers; l++) {
+        const size_t rows = (size_t)widths[l + 1];
+        net->weights_layers[l] = malloc(rows * (size_t)widths[l] * sizeof(float));
+        net->bias_layers[l] = malloc(rows * sizeof(float));
+        net->acts[l] = malloc((size_t)widths[l] * sizeof(float));
+        net->deltas[l] = (l < layers - 1) ? malloc(rows * sizeof(float)) : NULL;
+        if (!net->weights_layers[l] || !net->bias_layers[l] || !net->acts[l] ||
+            (l < layers - 1 && !net->deltas[l])) {
+            nn_free(net);
+            return 0;
         }
     }
 
     net->weights = net->weights_layers[0];
     net->bias = net->bias_layers[0];
+    return 1;
+}
+
+void nn_init(NeuralNet *net)
+{
+    nn_init_head(net, NN_HEAD_BOARD);
+}
+
+void nn_init_head(NeuralNet *net, enum NNHead head)
+{
+    int hidden[NN_DEFAULT_HIDDEN_LAYERS];
+    for (int l = 0; l < NN_DEFAULT_HIDDEN_LAYERS; l++)
+        hidden[l] = NN_DEFAULT_LAYER_SIZE;
+    if (!nn_init_shape(net, head, NN_DEFAULT_HIDDEN_LAYERS, hidden))
+        exit(EXIT_FAILURE);
+}
+
+int nn_init_shape(NeuralNet *net, enum NNHead head, int hidden_layers, const int *hidden_widths)
+{
+    int widths[NN_MAX_LAYERS + 1], layers;
+    if (!nn_shape(widths, &layers, head, hidden_layers, hidden_widths)) {
+        fprintf(stderr, "nn_init: unsupported shape (%d hidden layers, at most %d wide)\n",
+                hidden_layers, NN_MAX_LAYER_SIZE);
+        return 0;
+    }
+    nn_free(net);
+    if (!nn_alloc(net, head, layers, widths)) {
+        fprintf(stderr, "nn_init: out of memory\n");
+        return 0;
+    }
 
     /* Xavier initialisation per layer: scale = 1 / sqrt(fan_in) */
-    float scale = 1.0f / sqrtf((float)NN_LAYER_SIZE);
     srand((unsigned int)time(NULL));
-    for (int l = 0; l < NN_TOTAL_LAYERS; l++) {
+    for (int l = 0; l < net->layers; l++) {
+        const int rows = net->widths[l + 1], cols = net->widths[l];
+        const float scale = 1.0f / sqrtf((float)cols);
         float *w = net->weights_layers[l];
         float *b = net->bias_layers[l];
-        for (int i = 0; i < NN_LAYER_SIZE * NN_LAYER_SIZE; i++)
+        for (size_t i = 0; i < (size_t)rows * cols; i++)
             w[i] = ((float)rand() / (float)RAND_MAX * 2.0f - 1.0f) * scale;
-        memset(b, 0, b_bytes);
+        memset(b, 0, (size_t)rows * sizeof(float));
     }
 
 #ifdef USE_CUDA
-    nn_gpu_init(net);   /* upload freshly Xavier-initialised weights to GPU */
+    if (head == NN_HEAD_BOARD)
+        nn_gpu_init(net);   /* upload freshly Xavier-initialised weights to GPU */
 #endif
+    return 1;
 }
 
 void nn_free(NeuralNet *net)
 {
-    for (int l = 0; l < NN_TOTAL_LAYERS; l++) {
+    for (int l = 0; l < NN_MAX_LAYERS; l++) {
         free(net->weights_layers[l]);
         free(net->bias_layers[l]);
+        free(net->acts[l]);
+        free(net->deltas[l]);
         net->weights_layers[l] = NULL;
         net->bias_layers[l] = NULL;
+        net->acts[l] = NULL;
+        net->deltas[l] = NULL;
     }
+    net->layers = 0;
     net->weights = NULL;
     net->bias    = NULL;
 }
@@ -129,26 +205,89 @@ static float sigmoid(float x)
     return 1.0f / (1.0f + expf(-x));
 }
 
+/* out = act(W · in + b) for one layer; the policy head stays linear */
+static void layer_forward(const NeuralNet *net, int l, const float *in, float *out)
+{
+    const float *w = net->weights_layers[l];
+    const float *b = net->bias_layers[l];
+    const int rows = net->widths[l + 1], cols = net->widths[l];
+    const int linear = (l == net->layers - 1 && net->head == NN_HEAD_POLICY);
+    for (int i = 0; i < rows; i++) {
+        float acc = b[i];
+        const float *row = w + (size_t)i * cols;
+        for (int j = 0; j < cols; j++)
+            acc += row[j] * in[j];
+        out[i] = linear ? acc : sigmoid(acc);
+    }
+}
+
 void nn_forward(const NeuralNet *net, const float *input, float *output)
 {
-    float cur[NN_LAYER_SIZE];
-    float nxt[NN_LAYER_SIZE];
+    TRACE_SCOPE("nn_forward");
+    float a[NN_MAX_LAYER_SIZE];
+    float b[NN_MAX_LAYER_SIZE];
+    const float *cur = input;
+    float *nxt = a;
+
+    for (int l = 0; l < net->layers - 1; l++) {
+        layer_forward(net, l, cur, nxt);
+        cur = nxt;
+        nxt = (nxt == a) ? b : a;
+    }
+    layer_forward(net, net->layers - 1, cur, output);
+
+    stats_inc(STAT_NN_FORWARDS);
+}
+
+/* Batched forward pass over `batch` contiguous input vectors.
+ * Each weight row is streamed once per layer and applied to every sample in
+ * the batch while it is hot in L1, instead of once per sample.             */
+void nn_forward_batch(const NeuralNet *net, const float *inputs, float *outputs, int batch)
+{
+    TRACE_SCOPE("nn_forward_batch");
+    if (batch <= 0)
+        return;
+
+    int widest = NN_INPUT_SIZE;
+    for (int l = 1; l < net->layers; l++)
+        if (net->widths[l] > widest)
+            widest = net->widths[l];
+    const size_t n = (size_t)batch * widest;
+    float *cur = malloc(n * sizeof(float));
+    float *nxt = malloc(n * sizeof(float));
+    if (!cur || !nxt) {
+        free(cur);
+        free(nxt);
+        for (int s = 0; s < batch; s++)
+            nn_forward(net, inputs + (size_t)s * NN_INPUT_SIZE,
+                       outputs + (size_t)s * net->output_size);
+        return;
+    }
 
-    memcpy(cur, input, NN_LAYER_SIZE * sizeof(float));
-    for (int l = 0; l < NN_TOTAL_LAYERS; l++) {
+    memcpy(cur, inputs, (size_t)batch * NN_INPUT_SIZE * sizeof(float));
+    for (int l = 0; l < net->layers; l++) {
         const float *w = net->weights_layers[l];
         const float *b = net->bias_layers[l];
-        for (int i = 0; i < NN_LAYER_SIZE; i++) {
-            float acc = b[i];
-            const float *row = w + (size_t)i * NN_LAYER_SIZE;
-            for (int j = 0; j < NN_LAYER_SIZE; j++)
-                acc += row[j] * cur[j];
-            nxt[i] = sigmoid(acc);
+        const int last = (l == net->layers - 1);
+        const int rows = net->widths[l + 1], cols = net->widths[l];
+        const int linear = last && net->head == NN_HEAD_POLICY;
+        float *dst = last ? outputs : nxt;
+        for (int i = 0; i < rows; i++) {
+            const float *row = w + (size_t)i * cols;
+            for (int s = 0; s < batch; s++) {
+                const float *in = cur + (size_t)s * cols;
+                float acc = b[i];
+                for (int j = 0; j < cols; j++)
+                    acc += row[j] * in[j];
+                dst[(size_t)s * rows + i] = linear ? acc : sigmoid(acc);
+            }
         }
-        memcpy(cur, nxt, NN_LAYER_SIZE * sizeof(float));
+        float *t = cur; cur = nxt; nxt = t;
     }
 
-    memcpy(output, cur, NN_OUTPUT_SIZE * sizeof(float));
+    free(cur);
+    free(nxt);
+    stats_add(STAT_NN_FORWARDS, (uint64_t)batch);
 }
 
 /* ════════════════════════════════════════════════════════════════════════════
@@ -210,26 +349,62 @@ struct Move nn_pick_move(const NeuralNet *net,
                          struct Piece     gameBoard[8][8],
                          enum Colour      colour)
 {
+    return nn_pick_move_from(net, gameBoard, colour, &lastMove);
+}
+
+struct Move nn_pick_move_from(const NeuralNet       *net,
+                              struct Piece           gameBoard[8][8],
+                              enum Colour            colour,
+                              const struct Move     *last)
+{
+    TRACE_SCOPE("nn_pick_move");
+
+    /* Known endings are played from the bitbases, not the network */
+    struct Move known;
+    if (bitbase_pick_move(gameBoard, colour, last, &known))
+        return known;
+
     /* Encode the current board and run the forward pass */
     float input[NN_INPUT_SIZE];
-    float nn_out[NN_OUTPUT_SIZE];
+    float nn_out[NN_MAX_OUTPUT_SIZE];
     nn_encode_board(gameBoard, input);
     nn_forward(net, input, nn_out);
 
     /* Enumerate all legal moves */
-    struct MoveList moves = validMoves(gameBoard, colour);
+    struct MoveList moves = validMoves_ThreadSafe(gameBoard, colour, last);
     if (moves.count == 0)
         return (struct Move){-1, -1, -1, -1};
 
+    float score[sizeof(moves.moves) / sizeof(moves.moves[0])];
+    nn_score_moves(net, nn_out, gameBoard, &moves, score);
+    int best = 0;
+    for (int m = 1; m < moves.count; m++)
+        if (score[m] > score[best])
+            best = m;
+    return moves.moves[best];
+}
+
+void nn_score_moves(const NeuralNet      *net,
+                    const float          *nn_out,
+                    struct Piece          gameBoard[8][8],
+                    const struct MoveList *moves,
+                    float                *scores)
+{
+    /* Policy head: one lookup per legal move.  Promotions are always to a
+     * queen, so the promotion logits do not affect the choice. */
+    if (net->head == NN_HEAD_POLICY) {
+        for (int m = 0; m < moves->count; m++)
+            scores[m] = nn_out[nn_policy_index(moves->moves[m])];
+        return;
+    }
+
     /* For each legal move, encode the resulting board and measure L2 distance
      * to the NN output.  The move that produces the nearest board wins.     */
-    float        best_dist = FLT_MAX;
-    int          best_idx  = 0;
     float        candidate[NN_OUTPUT_SIZE];
     struct Piece tmp[8][8];
 
-    for (int m = 0; m < moves.count; m++) {
-        apply_move_to_copy(gameBoard, tmp, moves.moves[m]);
+    for (int m = 0; m < moves->count; m++) {
+        apply_move_to_copy(gameBoard, tmp, moves->moves[m]);
         nn_encode_board(tmp, candidate);
 
         float dist = 0.0f;
@@ -237,13 +412,8 @@ struct Move nn_pick_move(const NeuralNet *net,
             float d = nn_out[i] - candidate[i];
             dist += d * d;
         }
-        if (dist < best_dist) {
-            best_dist = dist;
-            best_idx  = m;
-        }
+        scores[m] = -dist;
     }
-
-    return moves.moves[best_idx];
 }
 
 /* ════════════════════════════════════════════════════════════════════════════
@@ -260,11 +430,28 @@ int moveRanking(struct Piece currentBoard[8][8],
     if (!g_net.weights)
         nn_init(&g_net);
 
-    /* Immediate checkmate always takes priority */
-    if (checkAndExecuteOneMoveMate(currentBoard, aiColour))
+    struct timespec t_start, t_end;
+    StatsSnapshot before, after;
+    clock_gettime(CLOCK_MONOTONIC, &t_start);
+    stats_snapshot(&before);
+
+    /* Book moves first, as in enginePlayMove */
+    SearchPosition book_pos;
+    struct Move chosen;
+    int book_promotion = -1;
+    search_position_from_board(&book_pos, currentBoard, aiColour, &lastMove);
+    book_pos.halfmoveClock = halfmoveClock;
+    int from_book = book_pick(&book_pos, &chosen, &book_promotion);
+
+    /* Immediate checkmate always takes priority over the network */
+    if (!from_book && checkAndExecuteOneMoveMate(currentBoard, aiColour))
         return 999999999;
 
-    struct Move chosen = nn_pick_move(&g_net, currentBoard, aiColour);
+    if (!from_book)
+        chosen = nn_pick_move(&g_net, currentBoard, aiColour);
+
+    clock_gettime(CLOCK_MONOTONIC, &t_end);
+    stats_snapshot(&after);
 
     if (chosen.fromX == -1) {
         if (!suppress_engine_output)
@@ -297,8 +484,11 @@ int moveRanking(struct Piece currentBoard[8][8],
         board[chosen.toX][chosen.fromY].colour = -1;
     }
 
-    /* Pawn promotion */
+    /* Pawn promotion (a book move may under-promote) */
+    int promoting = board[chosen.toX][chosen.toY].type == PAWN && (chosen.toY == 7 || chosen.toY == 0);
     promotePawn(board, chosen.toX, chosen.toY);
+    if (promoting && book_promotion >= 0)
+        board[chosen.toX][chosen.toY].type = (enum PieceType)book_promotion;
 
     /* Castling: move the rook on the global board */
     if (board[chosen.toX][chosen.toY].type == KING && chosen.fromX == 4) {
@@ -328,7 +518,13 @@ int moveRanking(struct Piece currentBoard[8][8],
     lastMove.toX   = chosen.toX;
     lastMove.toY   = chosen.toY;
 
-    tui_update_stats(0.0, 0, 0, 0, 0, 0.0);
+    /* Positions = candidate moves considered during this decision */
+    tui_update_stats((double)(t_end.tv_sec - t_start.tv_sec) +
+                         (double)(t_end.tv_nsec - t_start.tv_nsec) / 1e9,
+                     after.counters[STAT_MOVES_GENERATED] - before.counters[STAT_MOVES_GENERATED],
+                     after.counters[STAT_TT_HITS] - before.counters[STAT_TT_HITS],
+                     after.counters[STAT_CUTOFFS] - before.counters[STAT_CUTOFFS],
+                     0, 0.0);
     tui_add_move(notation);
     tui_set_predicted_sequence(notation);
     tui_validate_puzzle_move(notation);
@@ -371,6 +567,9 @@ int moveRanking_Synchronized(struct Piece currentBoard[8][8],
  *   W[i][j] -= lr * delta_i * input[j]
  *   bias[i] -= lr * delta_i
  *
+ * Policy head: Loss = -log softmax(logits)[expected move], so
+ *   delta_i = softmax_i - [i == expected]               ← linear head, no sigmoid
+ *
  * Thread-safe: serialised through nn_train_mutex so concurrent threads write to
  * the shared weight matrix one at a time (Hogwild-style serial updates).
  * ════════════════════════════════════════════════════════════════════════════ */
@@ -410,6 +609,119 @@ static void nn_gpu_flush_pending_locked(void)
 }
 #endif
 
+/* Take nn_train_mutex, recording how long it took */
+static void train_lock(void)
+{
+    struct timespec t_wait, t_locked;
+    TRACE_BEGIN(lock_wait, "nn_train_lock_wait");
+    clock_gettime(CLOCK_MONOTONIC, &t_wait);
+    pthread_mutex_lock(&nn_train_mutex);
+    clock_gettime(CLOCK_MONOTONIC, &t_locked);
+    TRACE_END(lock_wait);
+    hist_record_interval(&nn_train_lock_wait_hist, &t_wait, &t_locked);
+}
+
+/* Forward pass from input keeping the activations backprop needs in
+ * net->acts (acts[l] is layer l's input), out the head's output.  Caller
+ * holds nn_train_mutex. */
+static void forward_keep(NeuralNet *net, const float *input, float *out)
+{
+    memcpy(net->acts[0], input, NN_INPUT_SIZE * sizeof(float));
+    for (int l = 0; l < net->layers - 1; l++)
+        layer_forward(net, l, net->acts[l], net->acts[l + 1]);
+    layer_forward(net, net->layers - 1, net->acts[net->layers - 1], out);
+}
+
+/* Backpropagate the head's delta (loss gradient w.r.t. its pre-activations)
+ * through the sigmoid hidden layers, then apply the SGD update.  Caller
+ * holds nn_train_mutex. */
+static void backprop_locked(NeuralNet *net, const float *out_delta, float learning_rate)
+{
+    const int out_l = net->layers - 1;
+
+    for (int l = out_l - 1; l >= 0; l--) {
+        const float *w_next = net->weights_layers[l + 1];
+        const float *d_next = (l + 1 == out_l) ? out_delta : net->deltas[l + 1];
+        const int rows = net->widths[l + 2], cols = net->widths[l + 1];
+        const float *a = net->acts[l + 1];
+        for (int j = 0; j < cols; j++) {
+            float sum = 0.0f;
+            for (int k = 0; k < rows; k++)
+                sum += w_next[(size_t)k * cols + j] * d_next[k];
+            net->deltas[l][j] = sum * a[j] * (1.0f - a[j]);
+        }
+    }
+
+    for (int l = 0; l < net->layers; l++) {
+        float *w = net->weights_layers[l];
+        float *b = net->bias_layers[l];
+        const float *in = net->acts[l];
+        const float *d = (l == out_l) ? out_delta : net->deltas[l];
+        const int rows = net->widths[l + 1], cols = net->widths[l];
+        for (int i = 0; i < rows; i++) {
+            float delta = d[i];
+            float *row = w + (size_t)i * cols;
+            for (int j = 0; j < cols; j++)
+                row[j] -= learning_rate * delta * in[j];
+            b[i] -= learning_rate * delta;
+        }
+    }
+}
+
+/* Recover the move that turns before into after, since teacher-forcing
+ * targets arrive as boards.  Castling also moves a rook; the king's move is
+ * the one reported.  Returns 0 unless exactly one move explains the diff. */
+static int board_diff_move(const struct Piece before[8][8], const struct Piece after[8][8],
+                           struct Move *move, int *promotion)
+{
+    int found = 0, king = 0;
+    for (int fx = 0; fx < 8; fx++)
+        for (int fy = 0; fy < 8; fy++) {
+            const struct Piece *p = &before[fx][fy];
+            if (p->type == (enum PieceType)-1 || after[fx][fy].type != (enum PieceType)-1)
+                continue;
+            for (int tx = 0; tx < 8; tx++)
+                for (int ty = 0; ty < 8; ty++) {
+                    const struct Piece *q = &after[tx][ty];
+                    if (q->type == (enum PieceType)-1 || q->colour != p->colour ||
+                        (before[tx][ty].type == q->type && before[tx][ty].colour == q->colour))
+                        continue;
+                    int promoted = (p->type == PAWN && q->type != PAWN && (ty == 0 || ty == 7));
+                    if (q->type != p->type && !promoted)
+                        continue;
+                    if (king && p->type != KING)
+                        continue;
+                    if (p->type == KING && !king)
+                        found = 0;
+                    king |= (p->type == KING);
+                    found++;
+                    *move = (struct Move){fx, fy, tx, ty};
+                    *promotion = promoted ? (int)q->type : -1;
+                }
+        }
+    return found == 1;
+}
+
+/* Replace logits z[0..n) by the cross-entropy gradient softmax(z) -
+ * onehot(target); returns the loss -log softmax(z)[target]. */
+static float softmax_xent(float *z, int n, int target)
+{
+    float max = z[0];
+    for (int i = 1; i < n; i++)
+        if (z[i] > max)
+            max = z[i];
+    float sum = 0.0f;
+    for (int i = 0; i < n; i++) {
+        z[i] = expf(z[i] - max);
+        sum += z[i];
+    }
+    for (int i = 0; i < n; i++)
+        z[i] /= sum;
+    float loss = -logf(z[target] > 1e-30f ? z[target] : 1e-30f);
+    z[target] -= 1.0f;
+    return loss;
+}
+
 float nn_train_step(NeuralNet *net,
                     const struct Piece input_board[8][8],
                     const struct Piece target_board[8][8],
@@ -417,13 +729,24 @@ float nn_train_step(NeuralNet *net,
 {
     if (!net->weights_layers[0]) return 0.0f;
 
+    if (net->head == NN_HEAD_POLICY) {
+        struct Move move;
+        int promotion;
+        if (!board_diff_move(input_board, target_board, &move, &promotion))
+            return 0.0f;
+        return nn_train_move(net, input_board, move, promotion, learning_rate);
+    }
+
+    TRACE_SCOPE("nn_train_step");
+    stats_inc(STAT_NN_TRAIN_STEPS);
+
     float input[NN_INPUT_SIZE];
     float target[NN_OUTPUT_SIZE];
 
     nn_encode_board(input_board,  input);
     nn_encode_board(target_board, target);
 
-    pthread_mutex_lock(&nn_train_mutex);
+    train_lock();
 
 #ifdef USE_CUDA
     if (nn_gpu_is_ready()) {
@@ -456,73 +779,132 @@ float nn_train_step(NeuralNet *net,
 #endif
 
     /* ── CPU fallback ──────────────────────────────────────────────────── */
-    float activations[NN_TOTAL_LAYERS + 1][NN_LAYER_SIZE];
-    float deltas[NN_TOTAL_LAYERS][NN_LAYER_SIZE];
-
-    memcpy(activations[0], input, NN_LAYER_SIZE * sizeof(float));
-
-    for (int l = 0; l < NN_TOTAL_LAYERS; l++) {
-        float *out = activations[l + 1];
-        const float *in = activations[l];
-        const float *w = net->weights_layers[l];
-        const float *b = net->bias_layers[l];
-        for (int i = 0; i < NN_LAYER_SIZE; i++) {
-            float acc = b[i];
-            const float *row = w + (size_t)i * NN_LAYER_SIZE;
-            for (int j = 0; j < NN_LAYER_SIZE; j++)
-                acc += row[j] * in[j];
-            out[i] = sigmoid(acc);
-        }
-    }
+    float out[NN_OUTPUT_SIZE];
+    forward_keep(net, input, out);
 
     float total_loss = 0.0f;
-    const int out_l = NN_TOTAL_LAYERS - 1;
-    for (int i = 0; i < NN_LAYER_SIZE; i++) {
-        float out = activations[NN_TOTAL_LAYERS][i];
-        float err = out - target[i];
+    for (int i = 0; i < NN_OUTPUT_SIZE; i++) {
+        float err = out[i] - target[i];
         total_loss += err * err;
-        deltas[out_l][i] = 2.0f * err * out * (1.0f - out);
+        out[i] = 2.0f * err * out[i] * (1.0f - out[i]);   /* now the delta */
     }
+    backprop_locked(net, out, learning_rate);
 
-    for (int l = NN_TOTAL_LAYERS - 2; l >= 0; l--) {
-        const float *w_next = net->weights_layers[l + 1];
-        for (int j = 0; j < NN_LAYER_SIZE; j++) {
-            float sum = 0.0f;
-            for (int k = 0; k < NN_LAYER_SIZE; k++)
-                sum += w_next[(size_t)k * NN_LAYER_SIZE + j] * deltas[l + 1][k];
-            float a = activations[l + 1][j];
-            deltas[l][j] = sum * a * (1.0f - a);
-        }
+    pthread_mutex_unlock(&nn_train_mutex);
+    return total_loss / NN_OUTPUT_SIZE;
+}
+
+float nn_train_move(NeuralNet *net,
+                    const struct Piece board[8][8],
+                    struct Move move,
+                    int promotion,
+                    float learning_rate)
+{
+    if (!net->weights_layers[0] || net->head != NN_HEAD_POLICY) return 0.0f;
+
+    TRACE_SCOPE("nn_train_step");
+    stats_inc(STAT_NN_TRAIN_STEPS);
+
+    int promotes = (board[move.fromX][move.fromY].type == PAWN && (move.toY == 0 || move.toY == 7));
+    if (!promotes)
+        promotion = -1;
+    else if (promotion < KNIGHT || promotion > QUEEN)
+        promotion = QUEEN;
+
+    float input[NN_INPUT_SIZE];
+    float out[NN_POLICY_SIZE];
+    nn_encode_board(board, input);
+
+    train_lock();
+    forward_keep(net, input, out);
+
+    /* Moves and promotion pieces are separate softmaxes; a move that does
+     * not promote leaves the promotion logits alone. */
+    float loss = softmax_xent(out, NN_POLICY_MOVES, nn_policy_index(move));
+    if (promotion >= 0)
+        loss += softmax_xent(out + NN_POLICY_MOVES, NN_POLICY_SIZE - NN_POLICY_MOVES, promotion - KNIGHT);
+    else
+        memset(out + NN_POLICY_MOVES, 0, (NN_POLICY_SIZE - NN_POLICY_MOVES) * sizeof(float));
+    backprop_locked(net, out, learning_rate);
+
+    pthread_mutex_unlock(&nn_train_mutex);
+    return loss;
+}
+
+/* ════════════════════════════════════════════════════════════════════════════
+ * Training from a dataset file (dataset.h)
+ * ════════════════════════════════════════════════════════════════════════════ */
+
+float nn_train_dataset(NeuralNet *net, const char *path, int epochs, float learning_rate)
+{
+    uint64_t count;
+    const DatasetRecord *recs = dataset_map(path, &count);
+    if (!recs)
+        return -1.0f;
+    uint64_t *order = malloc((count ? count : 1) * sizeof(uint64_t));
+    if (!order) {
+        dataset_unmap(recs, count);
+        return -1.0f;
     }
 
-    for (int l = 0; l < NN_TOTAL_LAYERS; l++) {
-        float *w = net->weights_layers[l];
-        float *b = net->bias_layers[l];
-        const float *in = activations[l];
-        const float *d = deltas[l];
-        for (int i = 0; i < NN_LAYER_SIZE; i++) {
-            float delta = d[i];
-            float *row = w + (size_t)i * NN_LAYER_SIZE;
-            for (int j = 0; j < NN_LAYER_SIZE; j++)
-                row[j] -= learning_rate * delta * in[j];
-            b[i] -= learning_rate * delta;
+    double epoch_loss = 0.0;
+    for (int e = 0; e < epochs; e++) {
+        /* Fresh shuffle each epoch: games arrive in order, SGD wants them mixed */
+        for (uint64_t i = 0; i < count; i++)
+            order[i] = i;
+        for (uint64_t i = count; i > 1; i--) {
+            uint64_t j = (((uint64_t)rand() << 31) ^ (uint64_t)rand()) % i;
+            uint64_t t = order[i - 1];
+            order[i - 1] = order[j];
+            order[j] = t;
+        }
+
+        double sum = 0.0;
+        for (uint64_t i = 0; i < count; i++) {
+            struct Piece before[8][8], after[8][8];
+            const DatasetRecord *r = &recs[order[i]];
+            if (net->head == NN_HEAD_POLICY) {
+                struct Move m = {r->from >> 3, r->from & 7, r->to >> 3, r->to & 7};
+                dataset_unpack(r, before, NULL);
+                sum += nn_train_move(net, (const struct Piece (*)[8])before, m, r->promotion, learning_rate);
+            } else {
+                dataset_unpack(r, before, after);
+                sum += nn_train_step(net, (const struct Piece (*)[8])before,
+                                     (const struct Piece (*)[8])after, learning_rate);
+            }
+            if ((i + 1) % 10000 == 0)
+                printf("train: epoch %d  %llu/%llu  loss %.6f\n", e + 1,
+                       (unsigned long long)(i + 1), (unsigned long long)count, sum / (double)(i + 1));
         }
+        epoch_loss = count ? sum / (double)count : 0.0;
+        printf("train: epoch %d done, %llu samples, loss %.6f\n", e + 1,
+               (unsigned long long)count, epoch_loss);
     }
 
-    pthread_mutex_unlock(&nn_train_mutex);
-    return total_loss / NN_OUTPUT_SIZE;
+    free(order);
+    dataset_unmap(recs, count);
+    return (float)epoch_loss;
 }
 
 /* ════════════════════════════════════════════════════════════════════════════
  * Weight persistence
  * ════════════════════════════════════════════════════════════════════════════ */
 
+/* File layout: "NNDP", version, then
+ *   version 4:    layers, head, widths[0..layers]
+ *   version 2, 3: layers, width, (3) head and output size — every layer but
+ *                 the head width wide
+ * then each layer's weights and biases.  Version 2 files are board-head
+ * networks; files without the magic are the old single layer, copied into
+ * every layer of the default shape. */
+#define NN_FILE_VERSION 4
+
 int nn_save(const NeuralNet *net, const char *filepath)
 {
     if (!net->weights_layers[0]) return 0;
 #ifdef USE_CUDA
     /* Flush GPU weights to CPU before writing to disk */
-    if (nn_gpu_is_ready()) {
+    if (nn_gpu_is_ready() && net->head == NN_HEAD_BOARD) {
         pthread_mutex_lock(&nn_train_mutex);
         nn_gpu_flush_pending_locked();
         nn_gpu_sync_to_cpu((NeuralNet *)net);
@@ -532,21 +914,57 @@ int nn_save(const NeuralNet *net, const char *filepath)
     FILE *f = fopen(filepath, "wb");
     if (!f) return 0;
     const char magic[4] = {'N', 'N', 'D', 'P'};
-    uint32_t version = 2;
-    uint32_t layers = NN_TOTAL_LAYERS;
-    uint32_t width = NN_LAYER_SIZE;
+    uint32_t version = NN_FILE_VERSION;
+    uint32_t layers = (uint32_t)net->layers;
+    uint32_t head = (uint32_t)net->head;
     fwrite(magic, 1, 4, f);
     fwrite(&version, sizeof(version), 1, f);
     fwrite(&layers, sizeof(layers), 1, f);
-    fwrite(&width, sizeof(width), 1, f);
+    fwrite(&head, sizeof(head), 1, f);
+    for (int l = 0; l <= net->layers; l++) {
+        uint32_t width = (uint32_t)net->widths[l];
+        fwrite(&width, sizeof(width), 1, f);
+    }
 
-    const size_t w_count = (size_t)NN_LAYER_SIZE * NN_LAYER_SIZE;
-    for (int l = 0; l < NN_TOTAL_LAYERS; l++) {
-        fwrite(net->weights_layers[l], sizeof(float), w_count,      f);
-        fwrite(net->bias_layers[l],    sizeof(float), NN_LAYER_SIZE, f);
+    for (int l = 0; l < net->layers; l++) {
+        const size_t rows = (size_t)net->widths[l + 1];
+        fwrite(net->weights_layers[l], sizeof(float), rows * (size_t)net->widths[l], f);
+        fwrite(net->bias_layers[l],    sizeof(float), rows,                          f);
     }
-    fclose(f);
-    return 1;
+    return fclose(f) == 0;
+}
+
+/* Read the header after the magic into head, layers and widths; 0 if it is
+ * malformed or describes a shape this build cannot run. */
+static int nn_read_header(FILE *f, enum NNHead *head, int *layers, int widths[NN_MAX_LAYERS + 1])
+{
+    uint32_t version, n, h = NN_HEAD_BOARD;
+    if (fread(&version, sizeof(version), 1, f) != 1 || version < 2 || version > NN_FILE_VERSION ||
+        fread(&n, sizeof(n), 1, f) != 1 || n < 1 || n > NN_MAX_LAYERS)
+        return 0;
+
+    int hidden[NN_MAX_LAYERS];
+    uint32_t w[NN_MAX_LAYERS + 1];
+    if (version >= 4) {
+        if (fread(&h, sizeof(h), 1, f) != 1 || fread(w, sizeof(uint32_t), n + 1, f) != n + 1)
+            return 0;
+    } else {
+        uint32_t width, outputs = NN_OUTPUT_SIZE;
+        if (fread(&width, sizeof(width), 1, f) != 1 ||
+            (version >= 3 && (fread(&h, sizeof(h), 1, f) != 1 ||
+                              fread(&outputs, sizeof(outputs), 1, f) != 1)))
+            return 0;
+        for (uint32_t l = 0; l < n; l++)
+            w[l] = width;
+        w[n] = outputs;
+    }
+    if (h != NN_HEAD_BOARD && h != NN_HEAD_POLICY)
+        return 0;
+    for (uint32_t l = 1; l < n; l++)
+        hidden[l - 1] = (int)(w[l] > NN_MAX_LAYER_SIZE ? 0 : w[l]);
+    *head = (enum NNHead)h;
+    return w[0] == NN_INPUT_SIZE && w[n] == (uint32_t)head_outputs(*head) &&
+           nn_shape(widths, layers, *head, (int)n - 1, hidden);
 }
 
 int nn_load(NeuralNet *net, const char *filepath)
@@ -554,63 +972,67 @@ int nn_load(NeuralNet *net, const char *filepath)
     FILE *f = fopen(filepath, "rb");
     if (!f) return 0;
 
-    if (!net->weights_layers[0]) {
-        const size_t w_bytes = (size_t)NN_LAYER_SIZE * NN_LAYER_SIZE * sizeof(float);
-        const size_t b_bytes = (size_t)NN_LAYER_SIZE * sizeof(float);
-        for (int l = 0; l < NN_TOTAL_LAYERS; l++) {
-            net->weights_layers[l] = malloc(w_bytes);
-            net->bias_layers[l] = malloc(b_bytes);
-            if (!net->weights_layers[l] || !net->bias_layers[l]) {
-                fclose(f);
-                return 0;
-            }
-        }
-        net->weights = net->weights_layers[0];
-        net->bias = net->bias_layers[0];
-    }
-
     char magic[4] = {0};
+    enum NNHead head = NN_HEAD_BOARD;
+    int layers, widths[NN_MAX_LAYERS + 1];
     size_t rm = fread(magic, 1, 4, f);
-    if (rm == 4 && magic[0] == 'N' && magic[1] == 'N' && magic[2] == 'D' && magic[3] == 'P') {
-        uint32_t version = 0, layers = 0, width = 0;
-        if (fread(&version, sizeof(version), 1, f) != 1 ||
-            fread(&layers, sizeof(layers), 1, f) != 1 ||
-            fread(&width, sizeof(width), 1, f) != 1) {
-            fclose(f);
-            return 0;
-        }
-        if (version != 2 || layers != (uint32_t)NN_TOTAL_LAYERS || width != (uint32_t)NN_LAYER_SIZE) {
+    int tagged = (rm == 4 && magic[0] == 'N' && magic[1] == 'N' && magic[2] == 'D' && magic[3] == 'P');
+    if (tagged) {
+        if (!nn_read_header(f, &head, &layers, widths)) {
+            fprintf(stderr, "nn_load: %s: unsupported network header\n", filepath);
             fclose(f);
             return 0;
         }
+    } else {
+        int hidden[NN_DEFAULT_HIDDEN_LAYERS];
+        for (int l = 0; l < NN_DEFAULT_HIDDEN_LAYERS; l++)
+            hidden[l] = NN_DEFAULT_LAYER_SIZE;
+        nn_shape(widths, &layers, head, NN_DEFAULT_HIDDEN_LAYERS, hidden);
+    }
+
+    /* (Re)allocate when the net is empty or shaped differently */
+    if (net->weights_layers[0] &&
+        (net->head != head || net->layers != layers ||
+         memcmp(net->widths, widths, (size_t)(layers + 1) * sizeof(int)) != 0))
+        nn_free(net);
+    if (!net->weights_layers[0] && !nn_alloc(net, head, layers, widths)) {
+        fclose(f);
+        return 0;
+    }
 
-        const size_t w_count = (size_t)NN_LAYER_SIZE * NN_LAYER_SIZE;
-        for (int l = 0; l < NN_TOTAL_LAYERS; l++) {
-            size_t rw = fread(net->weights_layers[l], sizeof(float), w_count,      f);
-            size_t rb = fread(net->bias_layers[l],    sizeof(float), NN_LAYER_SIZE, f);
-            if (rw != w_count || rb != (size_t)NN_LAYER_SIZE) {
+    if (tagged) {
+        for (int l = 0; l < net->layers; l++) {
+            const size_t rows = (size_t)net->widths[l + 1], cols = (size_t)net->widths[l];
+            size_t rw = fread(net->weights_layers[l], sizeof(float), rows * cols, f);
+            size_t rb = fread(net->bias_layers[l],    sizeof(float), rows,        f);
+            if (rw != rows * cols || rb != rows) {
                 fclose(f);
+                nn_free(net);
                 return 0;
             }
         }
         fclose(f);
     } else {
         rewind(f);
-        const size_t w_count = (size_t)NN_LAYER_SIZE * NN_LAYER_SIZE;
-        size_t rw = fread(net->weights_layers[0], sizeof(float), w_count,      f);
-        size_t rb = fread(net->bias_layers[0],    sizeof(float), NN_LAYER_SIZE, f);
+        const size_t w_count = (size_t)NN_DEFAULT_LAYER_SIZE * NN_DEFAULT_LAYER_SIZE;
+        size_t rw = fread(net->weights_layers[0], sizeof(float), w_count,               f);
+        size_t rb = fread(net->bias_layers[0],    sizeof(float), NN_DEFAULT_LAYER_SIZE, f);
         fclose(f);
-        if (rw != w_count || rb != (size_t)NN_LAYER_SIZE) return 0;
+        if (rw != w_count || rb != (size_t)NN_DEFAULT_LAYER_SIZE) {
+            nn_free(net);
+            return 0;
+        }
 
-        for (int l = 1; l < NN_TOTAL_LAYERS; l++) {
+        for (int l = 1; l < net->layers; l++) {
             memcpy(net->weights_layers[l], net->weights_layers[0], w_count * sizeof(float));
-            memcpy(net->bias_layers[l], net->bias_layers[0], NN_LAYER_SIZE * sizeof(float));
+            memcpy(net->bias_layers[l], net->bias_layers[0], NN_DEFAULT_LAYER_SIZE * sizeof(float));
         }
     }
 
 #ifdef USE_CUDA
     /* Push loaded weights to GPU (nn_gpu_init is idempotent) */
-    nn_gpu_init(net);
+    if (net->head == NN_HEAD_BOARD)
+        nn_gpu_init(net);
 #endif
     return 1;
 }
@@ -6,31 +6,64 @@
  *                         cat 1-6  = white PAWN, KNIGHT, BISHOP, ROOK, QUEEN, KING
  *                         cat 7-12 = black PAWN, KNIGHT, BISHOP, ROOK, QUEEN, KING
  *
- *   Layer  (1 dense layer): output = sigmoid(W · input + b)
+ *   Layers (dense, sigmoid): h = sigmoid(W · in + b), as many and as wide
+ *                            as the weight file says — by default 10 hidden
+ *                            layers of 832, but e.g. 832→256→256→out runs
+ *                            many times faster and fits in L2
  *
- *   Output (832 neurons): same encoding — the predicted board state after a move
- *
- * Legal-move guarantee:
- *   The raw NN output is decoded by finding the legal move whose resulting board
- *   encoding has the smallest L2 distance to the NN output vector.
+ *   Output, one of two heads (recorded in the weight file):
+ *     board  (832 neurons): same encoding — the predicted board state after a
+ *                           move; decoded by finding the legal move whose
+ *                           resulting board encoding has the smallest L2
+ *                           distance to the NN output vector.
+ *     policy (4100 logits): one per from-square × to-square pair, plus four
+ *                           for the promotion piece (N, B, R, Q); decoded by
+ *                           an argmax over the legal moves' logits.
  */
 #ifndef NN_H
 #define NN_H
 
 #include "chess.h"
+#include "histogram.h"
 
 #define NN_SQUARES     64
 #define NN_PIECE_CATS  13                              /* 0=empty, 1-6=white, 7-12=black */
 #define NN_INPUT_SIZE  (NN_SQUARES * NN_PIECE_CATS)   /* 832 */
 #define NN_OUTPUT_SIZE NN_INPUT_SIZE                   /* 832 */
-#define NN_HIDDEN_LAYERS 10
-#define NN_TOTAL_LAYERS (NN_HIDDEN_LAYERS + 1)        /* hidden + output */
-#define NN_LAYER_SIZE NN_INPUT_SIZE                    /* fixed-width MLP */
+#define NN_DEFAULT_HIDDEN_LAYERS 10                    /* shape of nn_init / old files */
+#define NN_DEFAULT_LAYER_SIZE NN_INPUT_SIZE
+#define NN_MAX_LAYERS  16                              /* hidden + output */
+#define NN_MAX_LAYER_SIZE 2048                         /* widest hidden layer */
+#define NN_POLICY_MOVES (NN_SQUARES * NN_SQUARES)     /* from × to: 4096 */
+#define NN_POLICY_SIZE (NN_POLICY_MOVES + 4)          /* + promotion N, B, R, Q */
+#define NN_MAX_OUTPUT_SIZE NN_POLICY_SIZE
+
+enum NNHead {
+    NN_HEAD_BOARD  = 0,     /* NN_OUTPUT_SIZE sigmoid outputs: the desired board */
+    NN_HEAD_POLICY = 1,     /* NN_POLICY_SIZE move logits                      */
+};
+
+/* Policy-head logit of a move; squares are x * 8 + y as in the encoding */
+static inline int nn_policy_index(struct Move m)
+{
+    return (m.fromX * 8 + m.fromY) * NN_SQUARES + m.toX * 8 + m.toY;
+}
+
+typedef struct NeuralNet {
+    /* Shape, read from the weight file: layer l maps widths[l] inputs to
+     * widths[l + 1] outputs, widths[0] is NN_INPUT_SIZE and widths[layers]
+     * the head's output_size. */
+    int    layers;                           /* hidden + output */
+    int    widths[NN_MAX_LAYERS + 1];
+    float *weights_layers[NN_MAX_LAYERS];    /* each [widths[l + 1]][widths[l]] */
+    float *bias_layers[NN_MAX_LAYERS];       /* each [widths[l + 1]] */
+    enum NNHead head;
+    int    output_size;                      /* NN_OUTPUT_SIZE or NN_POLICY_SIZE */
 
-typedef struct {
-    /* Per-layer params for a fixed-width deep MLP (832 -> ... -> 832). */
-    float *weights_layers[NN_TOTAL_LAYERS];  /* each [NN_LAYER_SIZE][NN_LAYER_SIZE] */
-    float *bias_layers[NN_TOTAL_LAYERS];     /* each [NN_LAYER_SIZE] */
+    /* Backprop scratch (used under the training mutex): acts[l] is layer
+     * l's input, deltas[l] the gradient at hidden layer l's output. */
+    float *acts[NN_MAX_LAYERS];
+    float *deltas[NN_MAX_LAYERS];
 
     /* Legacy aliases used by single-layer CUDA path. */
     float *weights;
@@ -40,34 +73,85 @@ typedef struct {
 /* Global network instance — lazy-initialised on first move */
 extern NeuralNet g_net;
 
-/* Initialise network with Xavier-scaled random weights */
+/* Initialise network with Xavier-scaled random weights (board head) */
 void nn_init(NeuralNet *net);
 
+/* As nn_init, with the given output head */
+void nn_init_head(NeuralNet *net, enum NNHead head);
+
+/* As nn_init_head, with hidden_layers hidden layers of the given widths
+ * (between them at most NN_MAX_LAYERS - 1 layers of at most
+ * NN_MAX_LAYER_SIZE).  Returns 0 for a bad shape or out of memory. */
+int nn_init_shape(NeuralNet *net, enum NNHead head, int hidden_layers, const int *hidden_widths);
+
 /* Free heap-allocated weight and bias arrays */
 void nn_free(NeuralNet *net);
 
 /* Encode an 8×8 board into a one-hot float vector of length NN_INPUT_SIZE */
 void nn_encode_board(const struct Piece board[8][8], float *out);
 
-/* Forward pass: output[i] = sigmoid( sum_j W[i][j]*input[j] + bias[i] ) */
+/* Forward pass: output[i] = sigmoid( sum_j W[i][j]*input[j] + bias[i] ), or
+ * the raw logits for a policy head.  output holds net->output_size floats. */
 void nn_forward(const NeuralNet *net, const float *input, float *output);
 
+/* Forward pass for `batch` inputs laid out back to back (batch × NN_INPUT_SIZE).
+ * Produces the same outputs as calling nn_forward on each one.             */
+void nn_forward_batch(const NeuralNet *net, const float *inputs, float *outputs, int batch);
+
 /* Pick the legal move whose resulting board encoding is nearest (L2) to the
- * raw NN output.  Returns the chosen Move; does NOT modify board. */
+ * raw NN output, or with the highest policy logit.  Returns the chosen Move;
+ * does NOT modify board. */
 struct Move nn_pick_move(const NeuralNet *net,
                          struct Piece board[8][8],
                          enum Colour colour);
 
+/* As nn_pick_move, with the previous move (for en passant) passed in
+ * instead of read from the global lastMove, so any thread may call it. */
+struct Move nn_pick_move_from(const NeuralNet *net,
+                              struct Piece board[8][8],
+                              enum Colour colour,
+                              const struct Move *last);
+
+/* Preference of each legal move given the network's output for the board
+ * (higher = better): the policy logit, or minus the L2 distance between the
+ * board after the move and the predicted board.  nn_pick_move plays the
+ * highest; the search uses them to order moves near the root. */
+void nn_score_moves(const NeuralNet      *net,
+                    const float          *output,
+                    struct Piece          board[8][8],
+                    const struct MoveList *moves,
+                    float                *scores);
+
 /* One SGD step: teach the network that input_board should map to target_board.
- * Thread-safe (uses an internal mutex).  Returns mean MSE loss. */
+ * A policy head is taught the move between the two boards instead (see
+ * nn_train_move).  Thread-safe (uses an internal mutex).  Returns mean MSE
+ * loss, or the cross-entropy for a policy head. */
 float nn_train_step(NeuralNet *net,
                     const struct Piece input_board[8][8],
                     const struct Piece target_board[8][8],
                     float learning_rate);
 
-/* Persist weights to / restore weights from a binary file.
- * nn_load initialises the network if not already allocated.
- * Both return 1 on success, 0 on failure.                   */
+/* One policy-head SGD step: softmax cross-entropy of the from × to logits
+ * against move, plus of the promotion logits when move promotes (promotion
+ * -1 = queen).  Returns the loss, 0 for a board-head network. */
+float nn_train_move(NeuralNet *net,
+                    const struct Piece board[8][8],
+                    struct Move move,
+                    int promotion,
+                    float learning_rate);
+
+/* Run `epochs` shuffled passes of nn_train_step over a dataset file
+ * (dataset.h): each record's board -> board after its move, or -> its move
+ * (nn_train_move) for a policy head.  Returns the
+ * last epoch's mean loss, or -1 if the file cannot be read. */
+float nn_train_dataset(NeuralNet *net, const char *path, int epochs, float learning_rate);
+
+/* Time spent waiting for the training mutex in nn_train_step (us) */
+extern LatencyHistogram nn_train_lock_wait_hist;
+
+/* Persist weights to / restore weights from a binary file.  The file
+ * records the head and every layer width; nn_load (re)allocates the
+ * network to match.  Both return 1 on success, 0 on failure. */
 int nn_save(const NeuralNet *net, const char *filepath);
 int nn_load(NeuralNet *net,       const char *filepath);
 
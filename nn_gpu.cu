@@ -33,10 +33,14 @@
 
 #define NN_GPU_MAX_BATCH 64
 
-static float *d_weights_layers[NN_TOTAL_LAYERS] = {0};
-static float *d_bias_layers[NN_TOTAL_LAYERS] = {0};
-static float *d_acts[NN_TOTAL_LAYERS + 1] = {0};
-static float *d_deltas[NN_TOTAL_LAYERS] = {0};
+/* Shape of the mirrored network (NeuralNet.layers / widths) */
+static int g_layers = 0;
+static int g_widths[NN_MAX_LAYERS + 1] = {0};
+
+static float *d_weights_layers[NN_MAX_LAYERS] = {0};
+static float *d_bias_layers[NN_MAX_LAYERS] = {0};
+static float *d_acts[NN_MAX_LAYERS + 1] = {0};
+static float *d_deltas[NN_MAX_LAYERS] = {0};
 static float *d_target = NULL;
 
 static cublasHandle_t g_cublas = NULL;
@@ -65,16 +69,17 @@ __global__ void k_output_delta(float *__restrict__ delta,
     }
 }
 
+/* delta[j] for a layer of n outputs feeding a layer of rows outputs */
 __global__ void k_hidden_delta(float *__restrict__ delta,
                                const float *__restrict__ delta_next,
                                const float *__restrict__ weights_next,
                                const float *__restrict__ act,
-                               int n)
+                               int n, int rows)
 {
     int j = blockIdx.x * blockDim.x + threadIdx.x;
     if (j < n) {
         float sum = 0.0f;
-        for (int k = 0; k < n; k++) {
+        for (int k = 0; k < rows; k++) {
             sum += weights_next[(size_t)k * n + j] * delta_next[k];
         }
         float a = act[j];
@@ -82,17 +87,56 @@ __global__ void k_hidden_delta(float *__restrict__ delta,
     }
 }
 
+static size_t w_bytes(int l)
+{
+    return (size_t)g_widths[l + 1] * g_widths[l] * sizeof(float);
+}
+
+static size_t v_bytes(int l)
+{
+    return (size_t)g_widths[l] * sizeof(float);
+}
+
+static int same_shape(const NeuralNet *net)
+{
+    if (net->layers != g_layers)
+        return 0;
+    for (int l = 0; l <= g_layers; l++)
+        if (net->widths[l] != g_widths[l])
+            return 0;
+    return 1;
+}
+
+/* Row-major W [rows][cols] is column-major [cols][rows], so op T gives
+ * y = W · x; the bias + sigmoid kernel finishes the layer. */
+static void layer_forward_gpu(int l)
+{
+    const float alpha = 1.0f;
+    const float beta = 0.0f;
+    const int rows = g_widths[l + 1], cols = g_widths[l];
+    const int T = 256;
+    CUBLAS_CHECK(cublasSgemv(g_cublas, CUBLAS_OP_T,
+                             cols, rows,
+                             &alpha,
+                             d_weights_layers[l], cols,
+                             d_acts[l], 1,
+                             &beta,
+                             d_acts[l + 1], 1));
+
+    k_bias_sigmoid<<<(rows + T - 1) / T, T>>>(d_acts[l + 1], d_bias_layers[l], rows);
+    CUDA_CHECK(cudaGetLastError());
+}
+
 extern "C" int nn_gpu_init(NeuralNet *net)
 {
-    const int n = NN_LAYER_SIZE;
-    const size_t w_sz = (size_t)n * n * sizeof(float);
-    const size_t v_sz = (size_t)n * sizeof(float);
+    if (g_gpu_ready && !same_shape(net))
+        nn_gpu_free();
 
     if (g_gpu_ready) {
-        for (int l = 0; l < NN_TOTAL_LAYERS; l++) {
-            CUDA_CHECK(cudaMemcpy(d_weights_layers[l], net->weights_layers[l], w_sz,
+        for (int l = 0; l < g_layers; l++) {
+            CUDA_CHECK(cudaMemcpy(d_weights_layers[l], net->weights_layers[l], w_bytes(l),
                                   cudaMemcpyHostToDevice));
-            CUDA_CHECK(cudaMemcpy(d_bias_layers[l], net->bias_layers[l], v_sz,
+            CUDA_CHECK(cudaMemcpy(d_bias_layers[l], net->bias_layers[l], v_bytes(l + 1),
                                   cudaMemcpyHostToDevice));
         }
         return 1;
@@ -100,46 +144,46 @@ extern "C" int nn_gpu_init(NeuralNet *net)
 
     CUDA_CHECK(cudaSetDevice(0));
 
-    for (int l = 0; l < NN_TOTAL_LAYERS; l++) {
-        CUDA_CHECK(cudaMalloc(&d_weights_layers[l], w_sz));
-        CUDA_CHECK(cudaMalloc(&d_bias_layers[l], v_sz));
+    g_layers = net->layers;
+    for (int l = 0; l <= g_layers; l++)
+        g_widths[l] = net->widths[l];
+
+    for (int l = 0; l < g_layers; l++) {
+        CUDA_CHECK(cudaMalloc(&d_weights_layers[l], w_bytes(l)));
+        CUDA_CHECK(cudaMalloc(&d_bias_layers[l], v_bytes(l + 1)));
     }
 
-    for (int l = 0; l < NN_TOTAL_LAYERS + 1; l++)
-        CUDA_CHECK(cudaMalloc(&d_acts[l], v_sz));
+    for (int l = 0; l < g_layers + 1; l++)
+        CUDA_CHECK(cudaMalloc(&d_acts[l], v_bytes(l)));
 
-    for (int l = 0; l < NN_TOTAL_LAYERS; l++)
-        CUDA_CHECK(cudaMalloc(&d_deltas[l], v_sz));
+    for (int l = 0; l < g_layers; l++)
+        CUDA_CHECK(cudaMalloc(&d_deltas[l], v_bytes(l + 1)));
 
-    CUDA_CHECK(cudaMalloc(&d_target, v_sz));
+    CUDA_CHECK(cudaMalloc(&d_target, v_bytes(g_layers)));
 
-    for (int l = 0; l < NN_TOTAL_LAYERS; l++) {
-        CUDA_CHECK(cudaMemcpy(d_weights_layers[l], net->weights_layers[l], w_sz,
+    for (int l = 0; l < g_layers; l++) {
+        CUDA_CHECK(cudaMemcpy(d_weights_layers[l], net->weights_layers[l], w_bytes(l),
                               cudaMemcpyHostToDevice));
-        CUDA_CHECK(cudaMemcpy(d_bias_layers[l], net->bias_layers[l], v_sz,
+        CUDA_CHECK(cudaMemcpy(d_bias_layers[l], net->bias_layers[l], v_bytes(l + 1),
                               cudaMemcpyHostToDevice));
     }
 
     CUBLAS_CHECK(cublasCreate(&g_cublas));
     g_gpu_ready = 1;
 
-    fprintf(stderr, "[nn_gpu] Deep MLP GPU ready (%d hidden layers, width %d)\n",
-            NN_HIDDEN_LAYERS, NN_LAYER_SIZE);
+    fprintf(stderr, "[nn_gpu] Deep MLP GPU ready (%d hidden layers, first width %d)\n",
+            g_layers - 1, g_widths[1]);
     return 1;
 }
 
 extern "C" void nn_gpu_sync_to_cpu(NeuralNet *net)
 {
-    if (!g_gpu_ready) return;
+    if (!g_gpu_ready || !same_shape(net)) return;
 
-    const int n = NN_LAYER_SIZE;
-    const size_t w_sz = (size_t)n * n * sizeof(float);
-    const size_t v_sz = (size_t)n * sizeof(float);
-
-    for (int l = 0; l < NN_TOTAL_LAYERS; l++) {
-        CUDA_CHECK(cudaMemcpy(net->weights_layers[l], d_weights_layers[l], w_sz,
+    for (int l = 0; l < g_layers; l++) {
+        CUDA_CHECK(cudaMemcpy(net->weights_layers[l], d_weights_layers[l], w_bytes(l),
                               cudaMemcpyDeviceToHost));
-        CUDA_CHECK(cudaMemcpy(net->bias_layers[l], d_bias_layers[l], v_sz,
+        CUDA_CHECK(cudaMemcpy(net->bias_layers[l], d_bias_layers[l], v_bytes(l + 1),
                               cudaMemcpyDeviceToHost));
     }
 }
@@ -148,7 +192,7 @@ extern "C" void nn_gpu_free(void)
 {
     if (!g_gpu_ready) return;
 
-    for (int l = 0; l < NN_TOTAL_LAYERS; l++) {
+    for (int l = 0; l < NN_MAX_LAYERS; l++) {
         cudaFree(d_weights_layers[l]);
         cudaFree(d_bias_layers[l]);
         cudaFree(d_deltas[l]);
@@ -157,7 +201,7 @@ extern "C" void nn_gpu_free(void)
         d_deltas[l] = NULL;
     }
 
-    for (int l = 0; l < NN_TOTAL_LAYERS + 1; l++) {
+    for (int l = 0; l < NN_MAX_LAYERS + 1; l++) {
         cudaFree(d_acts[l]);
         d_acts[l] = NULL;
     }
@@ -167,6 +211,7 @@ extern "C" void nn_gpu_free(void)
 
     cublasDestroy(g_cublas);
     g_cublas = NULL;
+    g_layers = 0;
     g_gpu_ready = 0;
 }
 
@@ -179,30 +224,13 @@ extern "C" void nn_forward_gpu(const float *h_input, float *h_output)
 {
     if (!g_gpu_ready) return;
 
-    const int n = NN_LAYER_SIZE;
-    const float alpha = 1.0f;
-    const float beta = 0.0f;
-    const int T = 256;
-    const int B = (n + T - 1) / T;
-
-    CUDA_CHECK(cudaMemcpy(d_acts[0], h_input, (size_t)n * sizeof(float),
+    CUDA_CHECK(cudaMemcpy(d_acts[0], h_input, v_bytes(0),
                           cudaMemcpyHostToDevice));
 
-    for (int l = 0; l < NN_TOTAL_LAYERS; l++) {
-        CUBLAS_CHECK(cublasSgemv(g_cublas, CUBLAS_OP_T,
-                                 n, n,
-                                 &alpha,
-                                 d_weights_layers[l], n,
-                                 d_acts[l], 1,
-                                 &beta,
-                                 d_acts[l + 1], 1));
-
-        k_bias_sigmoid<<<B, T>>>(d_acts[l + 1], d_bias_layers[l], n);
-        CUDA_CHECK(cudaGetLastError());
-    }
+    for (int l = 0; l < g_layers; l++)
+        layer_forward_gpu(l);
 
-    CUDA_CHECK(cudaMemcpy(h_output, d_acts[NN_TOTAL_LAYERS],
-                          (size_t)n * sizeof(float),
+    CUDA_CHECK(cudaMemcpy(h_output, d_acts[g_layers], v_bytes(g_layers),
                           cudaMemcpyDeviceToHost));
 }
 
@@ -212,55 +240,43 @@ extern "C" float nn_train_step_gpu(const float *h_input,
 {
     if (!g_gpu_ready) return 0.0f;
 
-    const int n = NN_LAYER_SIZE;
-    const int last = NN_TOTAL_LAYERS - 1;
-    const float one = 1.0f;
-    const float zero = 0.0f;
+    const int last = g_layers - 1;
     const float neg_lr = -lr;
-
     const int T = 256;
-    const int B = (n + T - 1) / T;
 
-    CUDA_CHECK(cudaMemcpy(d_acts[0], h_input, (size_t)n * sizeof(float),
+    CUDA_CHECK(cudaMemcpy(d_acts[0], h_input, v_bytes(0),
                           cudaMemcpyHostToDevice));
-    CUDA_CHECK(cudaMemcpy(d_target, h_target, (size_t)n * sizeof(float),
+    CUDA_CHECK(cudaMemcpy(d_target, h_target, v_bytes(g_layers),
                           cudaMemcpyHostToDevice));
 
-    for (int l = 0; l < NN_TOTAL_LAYERS; l++) {
-        CUBLAS_CHECK(cublasSgemv(g_cublas, CUBLAS_OP_T,
-                                 n, n,
-                                 &one,
-                                 d_weights_layers[l], n,
-                                 d_acts[l], 1,
-                                 &zero,
-                                 d_acts[l + 1], 1));
-
-        k_bias_sigmoid<<<B, T>>>(d_acts[l + 1], d_bias_layers[l], n);
-        CUDA_CHECK(cudaGetLastError());
-    }
+    for (int l = 0; l < g_layers; l++)
+        layer_forward_gpu(l);
 
-    k_output_delta<<<B, T>>>(d_deltas[last], d_acts[NN_TOTAL_LAYERS], d_target, n);
+    const int out_n = g_widths[g_layers];
+    k_output_delta<<<(out_n + T - 1) / T, T>>>(d_deltas[last], d_acts[g_layers], d_target, out_n);
     CUDA_CHECK(cudaGetLastError());
 
     for (int l = last - 1; l >= 0; l--) {
-        k_hidden_delta<<<B, T>>>(d_deltas[l],
-                                 d_deltas[l + 1],
-                                 d_weights_layers[l + 1],
-                                 d_acts[l + 1],
-                                 n);
+        const int n = g_widths[l + 1];
+        k_hidden_delta<<<(n + T - 1) / T, T>>>(d_deltas[l],
+                                               d_deltas[l + 1],
+                                               d_weights_layers[l + 1],
+                                               d_acts[l + 1],
+                                               n, g_widths[l + 2]);
         CUDA_CHECK(cudaGetLastError());
     }
 
-    for (int l = 0; l < NN_TOTAL_LAYERS; l++) {
+    for (int l = 0; l < g_layers; l++) {
+        const int rows = g_widths[l + 1], cols = g_widths[l];
         CUBLAS_CHECK(cublasSger(g_cublas,
-                                n, n,
+                                cols, rows,
                                 &neg_lr,
                                 d_acts[l], 1,
                                 d_deltas[l], 1,
-                                d_weights_layers[l], n));
+                                d_weights_layers[l], cols));
 
         CUBLAS_CHECK(cublasSaxpy(g_cublas,
-                                 n,
+                                 rows,
                                  &neg_lr,
                                  d_deltas[l], 1,
                                  d_bias_layers[l], 1));
@@ -277,12 +293,11 @@ extern "C" float nn_train_step_gpu_batch(const float *input_batch,
     if (!g_gpu_ready || batch_size <= 0) return 0.0f;
     if (batch_size > NN_GPU_MAX_BATCH) batch_size = NN_GPU_MAX_BATCH;
 
-    const int n = NN_LAYER_SIZE;
     const float step_lr = lr / (float)batch_size;
 
     for (int b = 0; b < batch_size; b++) {
-        const float *in = input_batch + (size_t)b * n;
-        const float *tg = target_batch + (size_t)b * n;
+        const float *in = input_batch + (size_t)b * NN_INPUT_SIZE;
+        const float *tg = target_batch + (size_t)b * NN_OUTPUT_SIZE;
         nn_train_step_gpu(in, tg, step_lr);
     }
 
@@ -0,0 +1,316 @@
+/* pgn.c - minimal PGN reader and SAN move resolver (see pgn.h) */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "chess.h"
+#include "pgn.h"
+
+#define PGN_LINE_MAX 4096
+
+static int append(PgnGame *g, size_t *used, const char *s, size_t n)
+{
+    if (*used + n + 2 > g->cap) {
+        size_t cap = g->cap ? g->cap * 2 : 4096;
+        while (cap < *used + n + 2)
+            cap *= 2;
+        char *p = realloc(g->movetext, cap);
+        if (!p) {
+            fprintf(stderr, "pgn: out of memory\n");
+            return 0;
+        }
+        g->movetext = p;
+        g->cap = cap;
+    }
+    memcpy(g->movetext + *used, s, n);
+    *used += n;
+    g->movetext[(*used)++] = '\n';   /* keeps ';' comments to their line */
+    g->movetext[*used] = '\0';
+    return 1;
+}
+
+/* [Tag "value"] -> copies value when the tag matches */
+static int tag_value(const char *line, const char *tag, char *out, size_t len)
+{
+    size_t n = strlen(tag);
+    if (line[0] != '[' || strncmp(line + 1, tag, n) != 0 || line[1 + n] != ' ')
+        return 0;
+    const char *q = strchr(line, '"');
+    if (!q)
+        return 0;
+    const char *e = strchr(q + 1, '"');
+    size_t vlen = e ? (size_t)(e - q - 1) : strlen(q + 1);
+    if (vlen >= len)
+        vlen = len - 1;
+    memcpy(out, q + 1, vlen);
+    out[vlen] = '\0';
+    return 1;
+}
+
+int pgn_read_game(FILE *f, PgnGame *g)
+{
+    char line[PGN_LINE_MAX];
+    char value[128];
+    size_t used = 0;
+    int in_moves = 0, seen_any = 0;
+
+    g->result = PGN_RESULT_UNKNOWN;
+    g->fen[0] = '\0';
+    if (g->movetext)
+        g->movetext[0] = '\0';
+
+    for (;;) {
+        long start = ftell(f);
+        if (!fgets(line, sizeof(line), f))
+            break;
+        char *p = line;
+        while (*p == ' ' || *p == '\t')
+            p++;
+        p[strcspn(p, "\r\n")] = '\0';
+
+        if (*p == '[') {
+            if (in_moves) {
+                /* Next game's tags: leave them for the next call */
+                fseek(f, start, SEEK_SET);
+                break;
+            }
+            seen_any = 1;
+            if (tag_value(p, "Result", value, sizeof(value))) {
+                g->result = strcmp(value, "1-0") == 0 ? 1 : strcmp(value, "0-1") == 0 ? -1
+                          : strcmp(value, "1/2-1/2") == 0 ? 0 : PGN_RESULT_UNKNOWN;
+            } else {
+                tag_value(p, "FEN", g->fen, sizeof(g->fen));
+            }
+            continue;
+        }
+        if (*p == '\0' || *p == '%')
+            continue;
+        in_moves = seen_any = 1;
+        if (!append(g, &used, p, strlen(p)))
+            return 0;
+    }
+    if (!g->movetext && seen_any && !append(g, &used, "", 0))
+        return 0;
+    return seen_any;
+}
+
+void pgn_game_free(PgnGame *g)
+{
+    free(g->movetext);
+    g->movetext = NULL;
+    g->cap = 0;
+}
+
+int pgn_start_position(const PgnGame *g, SearchPosition *pos)
+{
+    if (g->fen[0] == '\0') {
+        search_position_startpos(pos);
+        return 1;
+    }
+    return search_position_from_fen(pos, g->fen);
+}
+
+int pgn_next_san(const char **cursor, char *san, size_t len)
+{
+    const char *p = *cursor;
+    for (;;) {
+        while (*p && isspace((unsigned char)*p))
+            p++;
+        if (!*p)
+            break;
+
+        if (*p == '{') {                        /* comment */
+            const char *e = strchr(p, '}');
+            p = e ? e + 1 : p + strlen(p);
+            continue;
+        }
+        if (*p == ';') {                        /* rest-of-line comment */
+            while (*p && *p != '\n')
+                p++;
+            continue;
+        }
+        if (*p == '(') {                        /* variation, possibly nested */
+            int depth = 0;
+            for (; *p; p++) {
+                if (*p == '{') {
+                    const char *e = strchr(p, '}');
+                    p = e ? e : p + strlen(p) - 1;
+                } else if (*p == '(') {
+                    depth++;
+                } else if (*p == ')' && --depth == 0) {
+                    p++;
+                    break;
+                }
+            }
+            continue;
+        }
+
+        const char *start = p;
+        while (*p && !isspace((unsigned char)*p) && *p != '{' && *p != '(' && *p != ')' && *p != ';')
+            p++;
+        size_t n = (size_t)(p - start);
+        if (*p == ')')
+            p++;
+
+        /* Move number, possibly glued to its move ("12.e4", "12...Nf6") */
+        const char *dot = isdigit((unsigned char)*start) ? memchr(start, '.', n) : NULL;
+        if (dot) {
+            while (dot < start + n && *dot == '.')
+                dot++;
+            n -= (size_t)(dot - start);
+            start = dot;
+            if (!n)
+                continue;
+        }
+        /* NAGs and results; "0-0" castling also starts with a digit */
+        if (*start == '$' || *start == '*' ||
+            (isdigit((unsigned char)*start) && !(n >= 3 && strncmp(start, "0-0", 3) == 0)))
+            continue;
+        if (n >= len)
+            n = len - 1;
+        memcpy(san, start, n);
+        san[n] = '\0';
+        *cursor = p;
+        return 1;
+    }
+    *cursor = p;
+    return 0;
+}
+
+static int piece_from_letter(char c)
+{
+    switch (c) {
+    case 'N': return KNIGHT;
+    case 'B': return BISHOP;
+    case 'R': return ROOK;
+    case 'Q': return QUEEN;
+    case 'K': return KING;
+    default:  return -1;
+    }
+}
+
+int pgn_san_to_move(SearchPosition *pos, const char *san, struct Move *move, int *promotion)
+{
+    char s[16];
+    size_t n = 0;
+    for (const char *p = san; *p && n < sizeof(s) - 1; p++)
+        if (*p != 'x' && *p != '+' && *p != '#' && *p != '!' && *p != '?' && *p != '=')
+            s[n++] = *p;
+    s[n] = '\0';
+
+    *promotion = -1;
+    struct MoveList ml = validMoves_ThreadSafe(pos->board, pos->side, &pos->lastMove);
+    int row = (pos->side == WHITE) ? 0 : 7;
+
+    if (strcmp(s, "O-O") == 0 || strcmp(s, "0-0") == 0 ||
+        strcmp(s, "O-O-O") == 0 || strcmp(s, "0-0-0") == 0) {
+        int toX = (n == 3) ? 6 : 2;
+        for (int i = 0; i < ml.count; i++) {
+            struct Move m = ml.moves[i];
+            if (m.fromX == 4 && m.fromY == row && m.toX == toX && m.toY == row &&
+                pos->board[4][row].type == KING) {
+                *move = m;
+                return 1;
+            }
+        }
+        return 0;
+    }
+
+    int piece = PAWN;
+    size_t i = 0;
+    if (n && piece_from_letter(s[0]) >= 0) {
+        piece = piece_from_letter(s[0]);
+        i = 1;
+    }
+    if (piece == PAWN && n >= 3 && piece_from_letter(s[n - 1]) >= 0) {
+        *promotion = piece_from_letter(s[n - 1]);
+        s[--n] = '\0';
+    }
+    if (n < i + 2)
+        return 0;
+
+    int toX = s[n - 2] - 'a', toY = s[n - 1] - '1';
+    if (toX < 0 || toX > 7 || toY < 0 || toY > 7)
+        return 0;
+    int fromX = -1, fromY = -1;
+    for (size_t j = i; j < n - 2; j++) {
+        if (s[j] >= 'a' && s[j] <= 'h') fromX = s[j] - 'a';
+        else if (s[j] >= '1' && s[j] <= '8') fromY = s[j] - '1';
+        else return 0;
+    }
+
+    int found = 0;
+    for (int k = 0; k < ml.count; k++) {
+        struct Move m = ml.moves[k];
+        if (m.toX != toX || m.toY != toY || (int)pos->board[m.fromX][m.fromY].type != piece)
+            continue;
+        if ((fromX >= 0 && m.fromX != fromX) || (fromY >= 0 && m.fromY != fromY))
+            continue;
+        if (piece == PAWN && fromX < 0 && m.fromX != toX)
+            continue;   /* a pawn capture always names its file */
+        *move = m;
+        found++;
+    }
+    return found == 1;
+}
+
+/* Disambiguation follows the standard: file first, then rank, then both */
+void pgn_move_to_san(SearchPosition *pos, struct Move m, int promotion, char *out, size_t len)
+{
+    static const char letters[] = "PNBRQK";
+    const struct Piece *p = &pos->board[m.fromX][m.fromY];
+    char s[16];
+    size_t n = 0;
+
+    if (p->type == KING && abs(m.toX - m.fromX) == 2) {
+        n = (size_t)snprintf(s, sizeof(s), m.toX == 6 ? "O-O" : "O-O-O");
+    } else {
+        int capture = pos->board[m.toX][m.toY].type != (enum PieceType)-1 ||
+                      (p->type == PAWN && m.fromX != m.toX);
+        if (p->type == PAWN) {
+            if (capture)
+                s[n++] = (char)('a' + m.fromX);
+        } else {
+            s[n++] = letters[p->type];
+            /* Disambiguate against other pieces of the type reaching the square */
+            struct MoveList ml = validMoves_ThreadSafe(pos->board, pos->side, &pos->lastMove);
+            int same = 0, same_file = 0, same_rank = 0;
+            for (int i = 0; i < ml.count; i++) {
+                struct Move o = ml.moves[i];
+                if (o.toX != m.toX || o.toY != m.toY || (o.fromX == m.fromX && o.fromY == m.fromY) ||
+                    pos->board[o.fromX][o.fromY].type != p->type)
+                    continue;
+                same++;
+                same_file += (o.fromX == m.fromX);
+                same_rank += (o.fromY == m.fromY);
+            }
+            if (same) {
+                if (!same_file)
+                    s[n++] = (char)('a' + m.fromX);
+                else if (!same_rank)
+                    s[n++] = (char)('1' + m.fromY);
+                else {
+                    s[n++] = (char)('a' + m.fromX);
+                    s[n++] = (char)('1' + m.fromY);
+                }
+            }
+        }
+        if (capture)
+            s[n++] = 'x';
+        s[n++] = (char)('a' + m.toX);
+        s[n++] = (char)('1' + m.toY);
+        if (p->type == PAWN && (m.toY == 0 || m.toY == 7)) {
+            s[n++] = '=';
+            s[n++] = letters[promotion >= 0 ? promotion : QUEEN];
+        }
+    }
+
+    SearchPosition after = *pos;
+    search_position_play(&after, m, promotion);
+    if (isInCheck(after.board, after.side))
+        s[n++] = hasLegalMove(after.board, after.side, &after.lastMove) ? '+' : '#';
+    s[n] = '\0';
+    snprintf(out, len, "%s", s);
+}
@@ -0,0 +1,53 @@
+/* pgn.h - Minimal PGN reader and SAN move resolver
+ *
+ * Reads one game at a time: the tag pairs that matter here (Result, FEN)
+ * and the raw movetext.  pgn_next_san() then walks the movetext, skipping
+ * move numbers, comments, variations, NAGs and the result token, and
+ * pgn_san_to_move() resolves each SAN token against a SearchPosition;
+ * pgn_move_to_san() goes the other way for writers.
+ *
+ *   PgnGame g = {0};
+ *   while (pgn_read_game(f, &g)) {
+ *       const char *cur = g.movetext;
+ *       char san[16];
+ *       while (pgn_next_san(&cur, san, sizeof(san))) ...
+ *   }
+ *   pgn_game_free(&g);
+ */
+#ifndef PGN_H
+#define PGN_H
+
+#include <stdio.h>
+#include "chess.h"
+#include "search.h"
+
+#define PGN_RESULT_UNKNOWN  2   /* "*" or missing */
+
+typedef struct {
+    int     result;         /* +1 white won, 0 draw, -1 black won, or PGN_RESULT_UNKNOWN */
+    char    fen[128];       /* FEN tag, "" for the standard start */
+    char   *movetext;       /* NUL-terminated, owned; reused across games */
+    size_t  cap;
+} PgnGame;
+
+/* Read the next game from f into g.  Returns 1 on success, 0 at EOF. */
+int  pgn_read_game(FILE *f, PgnGame *g);
+void pgn_game_free(PgnGame *g);
+
+/* Starting position of g (its FEN tag, or the standard start).  Returns 0
+ * if the FEN tag does not parse. */
+int  pgn_start_position(const PgnGame *g, SearchPosition *pos);
+
+/* Copy the next SAN token at *cursor into san and advance.  Returns 0 when
+ * the movetext is exhausted. */
+int  pgn_next_san(const char **cursor, char *san, size_t len);
+
+/* Resolve a SAN move ("Nbd7", "exd6", "O-O-O", "e8=Q+") in pos.  Returns 1
+ * with the move and its promotion piece (-1 for none), 0 if it is not a
+ * unique legal move. */
+int  pgn_san_to_move(SearchPosition *pos, const char *san, struct Move *move, int *promotion);
+
+/* Write the SAN for m, a legal move in pos, with its "+" / "#" suffix. */
+void pgn_move_to_san(SearchPosition *pos, struct Move m, int promotion, char *out, size_t len);
+
+#endif /* PGN_H */
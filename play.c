@@ -0,0 +1,187 @@
+/* play.c - engine-vs-engine games (see play.h) */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "bitbase.h"
+#include "chess.h"
+#include "pgn.h"
+#include "play.h"
+
+uint64_t play_random(uint64_t *state)
+{
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545F4914F6CDD1DULL;
+}
+
+/* Times the current position occurred before (history holds every
+ * earlier position of the game) */
+static int repetitions(const SearchPosition *pos, uint64_t key)
+{
+    int n = 0;
+    for (int i = pos->historyCount - 2; i >= 0 && i >= pos->historyCount - pos->halfmoveClock; i -= 2)
+        n += (pos->history[i] == key);
+    return n;
+}
+
+/* Bare kings, or a lone minor piece against a bare king */
+static int insufficient_material(const struct Piece board[8][8])
+{
+    int minors = 0;
+    for (int x = 0; x < 8; x++)
+        for (int y = 0; y < 8; y++) {
+            enum PieceType t = board[x][y].type;
+            if (t == (enum PieceType)-1 || t == KING)
+                continue;
+            if (t != BISHOP && t != KNIGHT)
+                return 0;
+            minors++;
+        }
+    return minors <= 1;
+}
+
+static struct Move choose_move(const PlayConfig *cfg, SearchPosition *pos, PlayedGame *g)
+{
+    if (cfg->use_nn) {
+        struct Piece scratch[8][8];
+        memcpy(scratch, pos->board, sizeof(scratch));
+        return nn_pick_move_from(cfg->net, scratch, pos->side, &pos->lastMove);
+    }
+    SearchResult r = cfg->use_mcts ? mcts_search(pos, &cfg->mcts, NULL)
+                                   : search_position(pos, &cfg->limits, NULL);
+    g->nodes += r.nodes;
+    return r.best;
+}
+
+void play_game(const PlayConfig *white, const PlayConfig *black, const PlayOptions *opt,
+               uint64_t *rng, PlayedGame *g)
+{
+    SearchPosition *pos = malloc(sizeof(SearchPosition));
+    int max_plies = (opt->max_plies > 0 && opt->max_plies < PLAY_MAX_PLIES) ? opt->max_plies : PLAY_MAX_PLIES;
+
+    memset(g, 0, sizeof(*g));
+    g->termination = "ply limit";
+    if (!pos) {
+        g->termination = "out of memory";
+        return;
+    }
+    search_position_startpos(pos);
+
+    for (;;) {
+        int wdl;
+        if (!hasLegalMove(pos->board, pos->side, &pos->lastMove)) {
+            int mated = isInCheck(pos->board, pos->side);
+            g->result = mated ? (pos->side == WHITE ? -1 : 1) : 0;
+            g->termination = mated ? "checkmate" : "stalemate";
+            break;
+        }
+        if (pos->halfmoveClock >= 100) {
+            g->termination = "fifty-move rule";
+            break;
+        }
+        if (repetitions(pos, search_position_hash(pos)) >= 2) {
+            g->termination = "repetition";
+            break;
+        }
+        if (insufficient_material(pos->board)) {
+            g->termination = "insufficient material";
+            break;
+        }
+        if (opt->adjudicate && bitbase_probe(pos->board, pos->side, &wdl)) {
+            g->result = (pos->side == WHITE) ? wdl : -wdl;
+            g->termination = "bitbase adjudication";
+            break;
+        }
+        if (g->count >= max_plies)
+            break;
+
+        struct Move m;
+        if (g->count < opt->random_plies) {
+            struct MoveList ml = validMoves_ThreadSafe(pos->board, pos->side, &pos->lastMove);
+            m = ml.moves[play_random(rng) % (uint64_t)ml.count];
+            g->random_plies++;
+        } else {
+            m = choose_move(pos->side == WHITE ? white : black, pos, g);
+        }
+        if (m.fromX < 0) {
+            /* Cannot happen with legal moves left; score it as a forfeit */
+            g->result = (pos->side == WHITE) ? -1 : 1;
+            g->termination = "no move";
+            break;
+        }
+
+        g->moves[g->count] = m;
+        g->promotions[g->count] = -1;   /* both pickers promote to a queen */
+        g->count++;
+        search_position_play(pos, m, -1);
+    }
+    free(pos);
+}
+
+static const char *result_string(int result)
+{
+    return result > 0 ? "1-0" : result < 0 ? "0-1" : "1/2-1/2";
+}
+
+void play_write_pgn(FILE *f, const PlayedGame *g, const char *event, long round,
+                    const char *white, const char *black)
+{
+    SearchPosition *pos = malloc(sizeof(SearchPosition));
+    if (!pos)
+        return;
+    search_position_startpos(pos);
+
+    char date[16];
+    time_t now = time(NULL);
+    struct tm tm;
+    localtime_r(&now, &tm);
+    strftime(date, sizeof(date), "%Y.%m.%d", &tm);
+
+    fprintf(f, "[Event \"%s\"]\n[Site \"local\"]\n[Date \"%s\"]\n[Round \"%ld\"]\n"
+               "[White \"%s\"]\n[Black \"%s\"]\n[Result \"%s\"]\n[Termination \"%s\"]\n"
+               "[PlyCount \"%d\"]\n\n",
+            event, date, round, white, black, result_string(g->result), g->termination, g->count);
+
+    int col = 0;
+    for (int i = 0; i < g->count; i++) {
+        char san[16], word[24];
+        pgn_move_to_san(pos, g->moves[i], g->promotions[i], san, sizeof(san));
+        int n = (i % 2 == 0) ? snprintf(word, sizeof(word), "%d. %s", i / 2 + 1, san)
+                             : snprintf(word, sizeof(word), "%s", san);
+        if (col + n + 1 > 79) {
+            fputc('\n', f);
+            col = 0;
+        } else if (col) {
+            fputc(' ', f);
+            col++;
+        }
+        fputs(word, f);
+        col += n;
+        search_position_play(pos, g->moves[i], g->promotions[i]);
+    }
+    fprintf(f, "%s%s\n\n", col ? " " : "", result_string(g->result));
+    free(pos);
+}
+
+int play_game_records(const PlayedGame *g, DatasetRecord *out)
+{
+    SearchPosition *pos = malloc(sizeof(SearchPosition));
+    if (!pos)
+        return 0;
+    search_position_startpos(pos);
+
+    int n = 0;
+    for (int i = 0; i < g->count; i++) {
+        if (i >= g->random_plies)
+            dataset_pack(&out[n++], pos->board, pos->side, &pos->lastMove, g->moves[i],
+                         g->promotions[i], g->result);
+        search_position_play(pos, g->moves[i], g->promotions[i]);
+        pos->historyCount = 0;
+    }
+    free(pos);
+    return n;
+}
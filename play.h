@@ -0,0 +1,64 @@
+/* play.h - Engine-vs-engine games for self-play and matches
+ *
+ * play_game() plays one complete game between two engine configurations on
+ * the calling thread: no globals, no pool, so any number of games can run
+ * side by side.  Search players use search_position() (on limits.table,
+ * or the shared TT), MCTS players mcts_search(), NN players
+ * nn_pick_move_from().  The first random_plies plies are random legal moves
+ * so repeated games do not all follow one line.
+ */
+#ifndef PLAY_H
+#define PLAY_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "chess.h"
+#include "dataset.h"
+#include "mcts.h"
+#include "nn.h"
+#include "search.h"
+
+#define PLAY_MAX_PLIES  400     /* adjudicated a draw beyond this */
+
+typedef struct {
+    const char      *name;
+    int              use_nn;    /* NN move picker instead of search */
+    const NeuralNet *net;       /* weights for use_nn */
+    SearchLimits     limits;    /* per-move search limits */
+    int              use_mcts;  /* MCTS instead of alpha-beta */
+    MCTSLimits       mcts;      /* per-move MCTS limits */
+} PlayConfig;
+
+typedef struct {
+    int random_plies;   /* uniformly random opening plies */
+    int max_plies;      /* 0 = PLAY_MAX_PLIES */
+    int adjudicate;     /* end games the bitbases already know */
+} PlayOptions;
+
+typedef struct {
+    struct Move moves[PLAY_MAX_PLIES];
+    int         promotions[PLAY_MAX_PLIES];
+    int         count;
+    int         random_plies;   /* how many of the moves were random */
+    int         result;         /* +1 white won, 0 draw, -1 black won */
+    const char *termination;    /* "checkmate", "stalemate", "repetition", ... */
+    long long   nodes;          /* search nodes (MCTS playouts) over the whole game */
+} PlayedGame;
+
+/* Play white against black from the standard start.  rng is the caller's
+ * xorshift state for the random opening. */
+void play_game(const PlayConfig *white, const PlayConfig *black, const PlayOptions *opt,
+               uint64_t *rng, PlayedGame *g);
+
+/* Append g to f as PGN (caller serialises writers). */
+void play_write_pgn(FILE *f, const PlayedGame *g, const char *event, long round,
+                    const char *white, const char *black);
+
+/* Pack the engine-chosen positions of g (the random opening is skipped)
+ * into out, which must hold g->count records.  Returns the number packed. */
+int  play_game_records(const PlayedGame *g, DatasetRecord *out);
+
+/* xorshift64* step, shared by the drivers for per-thread randomness */
+uint64_t play_random(uint64_t *state);
+
+#endif /* PLAY_H */
@@ -0,0 +1,140 @@
+/* ponder.c - alpha-beta engine for game mode, pondering on the user's time
+ *
+ * After each engine move the search pool keeps working on the position
+ * after the reply it expects (the second PV move), filling the shared TT
+ * while the user types.  When the user plays that move the ponder search is
+ * converted in place with search_ponderhit(): the move budget is counted
+ * from when pondering began, so a long think by the user means an instant
+ * reply.  Any other move stops the ponder search and a fresh search starts
+ * with the TT already warm.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "chess.h"
+#include "book.h"
+#include "search.h"
+#include "stats.h"
+
+static SearchPosition game_pos;      /* mirrors the global board + key history */
+static SearchPosition ponder_pos;    /* position being pondered */
+static int            have_game_pos = 0;
+static int            pondering = 0;
+static SearchResult   last_result;
+
+static void on_done(const SearchResult *r, void *user)
+{
+    (void)user;
+    last_result = *r;   /* read after search_wait(), which orders the write */
+}
+
+/* Rebuild the search position from the globals, keeping the key history
+ * when the board follows on from the last position we saw. */
+static void sync_game_position(enum Colour side)
+{
+    SearchPosition now;
+    search_position_from_board(&now, board, side, &lastMove);
+    now.halfmoveClock = halfmoveClock;
+
+    int n = have_game_pos ? game_pos.historyCount : 0;
+    if (have_game_pos) {
+        /* Append the previous position so repetitions are seen */
+        if (n == SEARCH_HISTORY_MAX) {
+            memmove(game_pos.history, game_pos.history + 1, (SEARCH_HISTORY_MAX - 1) * sizeof(uint64_t));
+            n--;
+        }
+        game_pos.history[n++] = search_position_hash(&game_pos);
+    }
+    memcpy(now.history, game_pos.history, (size_t)n * sizeof(uint64_t));
+    now.historyCount = n;
+    game_pos = now;
+    have_game_pos = 1;
+}
+
+void engineNewGame(void)
+{
+    enginePonderStop();
+    search_clear();
+    have_game_pos = 0;
+}
+
+void enginePonderStop(void)
+{
+    if (!pondering)
+        return;
+    search_stop();
+    search_wait();
+    pondering = 0;
+}
+
+int enginePlayMove(enum Colour aiColour, int max_depth, int movetime_ms)
+{
+    struct timespec t_start, t_end;
+    StatsSnapshot before, after;
+    clock_gettime(CLOCK_MONOTONIC, &t_start);
+    stats_snapshot(&before);
+
+    sync_game_position(aiColour);
+
+    SearchLimits limits = {0};
+    limits.depth = max_depth;
+    limits.movetime_ms = movetime_ms;
+
+    /* Book moves cost no engine time (and leave nothing to ponder on) */
+    struct Move book_move;
+    int promotion = -1;
+    if (book_pick(&game_pos, &book_move, &promotion)) {
+        enginePonderStop();
+        memset(&last_result, 0, sizeof(last_result));
+        last_result.best = book_move;
+        last_result.ponder.fromX = -1;
+    } else if (pondering && search_position_hash(&ponder_pos) == search_position_hash(&game_pos)) {
+        search_ponderhit();   /* keep the tree built on the user's time */
+        search_wait();
+    } else {
+        enginePonderStop();
+        search_start(&game_pos, &limits, NULL, on_done, NULL);
+        search_wait();
+    }
+    pondering = 0;
+
+    SearchResult r = last_result;
+    if (r.best.fromX < 0) {
+        if (!suppress_engine_output)
+            printf("No valid moves available.\n");
+        return 0;
+    }
+
+    char notation[8];
+    search_move_to_uci(&game_pos, r.best, notation);
+
+    /* Play on the mirror, then copy back to the globals the game uses */
+    search_position_play(&game_pos, r.best, promotion);
+    memcpy(board, game_pos.board, sizeof(game_pos.board));
+    lastMove = game_pos.lastMove;
+    halfmoveClock = game_pos.halfmoveClock;
+    recordBoardHistory();
+
+    clock_gettime(CLOCK_MONOTONIC, &t_end);
+    stats_snapshot(&after);
+    tui_update_stats((double)(t_end.tv_sec - t_start.tv_sec) +
+                         (double)(t_end.tv_nsec - t_start.tv_nsec) / 1e9,
+                     r.nodes,
+                     after.counters[STAT_TT_HITS] - before.counters[STAT_TT_HITS],
+                     after.counters[STAT_CUTOFFS] - before.counters[STAT_CUTOFFS],
+                     0, r.score);
+    tui_add_move(notation);
+    tui_set_predicted_sequence(notation);
+
+    /* Think about the expected reply while the user is on move */
+    if (r.ponder.fromX >= 0) {
+        ponder_pos = game_pos;
+        search_position_play(&ponder_pos, r.ponder, -1);
+        limits.ponder = 1;
+        search_start(&ponder_pos, &limits, NULL, on_done, NULL);
+        pondering = 1;
+    }
+    return 1;
+}
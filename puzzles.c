@@ -3,6 +3,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include "chess.h"
+#include "trace.h"
 
 // Empty stub for compatibility (not used in file-based loading)
 void closePuzzleFileCache(void)
@@ -14,6 +15,7 @@ void closePuzzleFileCache(void)
 // Returns 1 on success, 0 on failure
 int loadLichessPuzzle(const char *filename, int puzzleNumber, struct LichessPuzzle *puzzle)
 {
+    TRACE_SCOPE("loadLichessPuzzle");
     FILE *file = fopen(filename, "r");
     if (!file)
     {
@@ -95,106 +97,278 @@ int loadLichessPuzzle(const char *filename, int puzzleNumber, struct LichessPuzz
 }
 
 
-// Parses FEN string and loads it into the board
-// Returns 1 on success, 0 on failure
-int loadBoardFromFEN(const char *fen, struct Piece gameBoard[8][8])
+static int fenPieceType(char c)
 {
-    // Initialize empty board
-    for (int i = 0; i < 8; i++)
+    switch (c | 0x20)   // lower-case
     {
-        for (int j = 0; j < 8; j++)
-        {
-            gameBoard[i][j].type = -1;
-            gameBoard[i][j].colour = -1;
-            gameBoard[i][j].hasMoved = 0;
-        }
+    case 'p': return PAWN;
+    case 'n': return KNIGHT;
+    case 'b': return BISHOP;
+    case 'r': return ROOK;
+    case 'q': return QUEEN;
+    case 'k': return KING;
+    default:  return -1;
     }
+}
+
+// Reads an unsigned decimal field; returns 0 if there are no digits
+static int fenNumber(const char **p, int *value)
+{
+    const char *c = *p;
+    int v = 0;
+    if (*c < '0' || *c > '9')
+        return 0;
+    while (*c >= '0' && *c <= '9' && v < 100000)
+        v = v * 10 + (*c++ - '0');
+    *value = v;
+    *p = c;
+    return 1;
+}
+
+// Single-pass FEN/EPD parser: no copies, no allocation.  Fills the whole
+// position, deriving hasMoved from the castling rights (kings and rooks
+// without a right are "moved") and from the pawn start ranks.  Trailing
+// fields may be omitted (EPD stops after the ep square; a bare placement
+// defaults to "w - - 0 1").  Returns the number of characters consumed, so
+// EPD operations can be read from fen + result, or 0 if the FEN is invalid.
+int parseFEN(const char *fen, struct Position *pos)
+{
+    TRACE_SCOPE("parseFEN");
+    const char *c = fen;
+    int kings[2] = {0, 0};
 
-    char fenCopy[256];
-    strcpy(fenCopy, fen);
+    while (*c == ' ')
+        c++;
 
-    // Get the board position part (before the space)
-    char *boardStr = strtok(fenCopy, " ");
-    if (!boardStr)
+    // 1. Piece placement, rank 8 to rank 1
+    for (int rank = 7; rank >= 0; rank--)
+    {
+        int file = 0;
+        while (file < 8)
+        {
+            char ch = *c++;
+            if (ch >= '1' && ch <= '8')
+            {
+                int run = ch - '0';
+                if (file + run > 8)
+                    return 0;
+                for (int k = 0; k < run; k++, file++)
+                {
+                    pos->board[file][rank].type = -1;
+                    pos->board[file][rank].colour = -1;
+                    pos->board[file][rank].hasMoved = 0;
+                }
+                continue;
+            }
+            int type = fenPieceType(ch);
+            if (type < 0)
+                return 0;
+            enum Colour colour = (ch >= 'a') ? BLACK : WHITE;
+            if (type == KING)
+                kings[colour]++;
+            if (type == PAWN && (rank == 0 || rank == 7))
+                return 0;
+            pos->board[file][rank].type = type;
+            pos->board[file][rank].colour = colour;
+            // Kings and rooks get their rights from the castling field below
+            pos->board[file][rank].hasMoved =
+                (type == PAWN) ? rank != ((colour == WHITE) ? 1 : 6) : (type == KING || type == ROOK);
+            file++;
+        }
+        if (rank > 0 && *c++ != '/')
+            return 0;
+    }
+    if (kings[WHITE] != 1 || kings[BLACK] != 1)
         return 0;
 
-    int file = 0, rank = 7; // Start from top-left (rank 8, file a)
+    pos->sideToMove = WHITE;
+    pos->castling = 0;
+    pos->epFile = -1;
+    pos->halfmoveClock = 0;
+    pos->fullmoveNumber = 1;
+
+    // 2. Side to move
+    if (*c != ' ')
+        return (*c == '\0') ? (int)(c - fen) : 0;
+    c++;
+    if (*c == 'w' || *c == 'b')
+        pos->sideToMove = (*c++ == 'w') ? WHITE : BLACK;
+    else
+        return 0;
 
-    for (int i = 0; boardStr[i] != '\0'; i++)
+    // 3. Castling rights: only honoured when king and rook are at home
+    if (*c == ' ')
     {
-        char c = boardStr[i];
+        c++;
+        if (*c == '-')
+            c++;
+        else
+        {
+            for (; *c && *c != ' '; c++)
+            {
+                int right, row, rookFile;
+                switch (*c)
+                {
+                case 'K': right = CASTLE_WHITE_KING;  row = 0; rookFile = 7; break;
+                case 'Q': right = CASTLE_WHITE_QUEEN; row = 0; rookFile = 0; break;
+                case 'k': right = CASTLE_BLACK_KING;  row = 7; rookFile = 7; break;
+                case 'q': right = CASTLE_BLACK_QUEEN; row = 7; rookFile = 0; break;
+                default: return 0;
+                }
+                enum Colour colour = (row == 0) ? WHITE : BLACK;
+                struct Piece *king = &pos->board[4][row], *rook = &pos->board[rookFile][row];
+                if (king->type == KING && king->colour == colour &&
+                    rook->type == ROOK && rook->colour == colour)
+                {
+                    pos->castling |= right;
+                    king->hasMoved = 0;
+                    rook->hasMoved = 0;
+                }
+            }
+        }
+    }
 
-        if (c == '/')
+    // 4. En passant target square
+    if (*c == ' ')
+    {
+        c++;
+        if (*c == '-')
+            c++;
+        else if (c[0] >= 'a' && c[0] <= 'h' && c[1] == (pos->sideToMove == WHITE ? '6' : '3'))
         {
-            file = 0;
-            rank--;
-            continue;
+            pos->epFile = c[0] - 'a';
+            c += 2;
         }
+        else
+            return 0;
+    }
 
-        // Empty squares
-        if (c >= '1' && c <= '8')
+    // 5-6. Clocks (absent in EPD, where operations follow instead)
+    if (c[0] == ' ' && c[1] >= '0' && c[1] <= '9')
+    {
+        c++;
+        fenNumber(&c, &pos->halfmoveClock);
+        if (c[0] == ' ' && c[1] >= '0' && c[1] <= '9')
         {
-            file += (c - '0');
-            continue;
+            c++;
+            fenNumber(&c, &pos->fullmoveNumber);
         }
+    }
+    if (pos->fullmoveNumber < 1)
+        pos->fullmoveNumber = 1;
 
-        if (file >= 8 || rank < 0)
-            return 0; // Invalid FEN
+    return (int)(c - fen);
+}
 
-        // Parse piece
-        enum Colour colour = (c >= 'a' && c <= 'z') ? BLACK : WHITE;
+// Writes pos as a FEN string.  Returns the length written, or 0 if `size`
+// is too small (the longest FEN is under 100 characters).
+int writeFEN(const struct Position *pos, char *out, size_t size)
+{
+    static const char letters[6] = {'p', 'n', 'b', 'r', 'q', 'k'};
+    char buf[128];
+    char *o = buf;
 
-        switch (c)
+    for (int rank = 7; rank >= 0; rank--)
+    {
+        int empty = 0;
+        for (int file = 0; file < 8; file++)
         {
-        case 'P':
-        case 'p':
-            gameBoard[file][rank].type = PAWN;
-            break;
-        case 'N':
-        case 'n':
-            gameBoard[file][rank].type = KNIGHT;
-            break;
-        case 'B':
-        case 'b':
-            gameBoard[file][rank].type = BISHOP;
-            break;
-        case 'R':
-        case 'r':
-            gameBoard[file][rank].type = ROOK;
-            break;
-        case 'Q':
-        case 'q':
-            gameBoard[file][rank].type = QUEEN;
-            break;
-        case 'K':
-        case 'k':
-            gameBoard[file][rank].type = KING;
-            break;
-        default:
-            return 0; // Invalid piece
+            const struct Piece *p = &pos->board[file][rank];
+            if (p->type == (enum PieceType)-1)
+            {
+                empty++;
+                continue;
+            }
+            if (empty)
+                *o++ = (char)('0' + empty);
+            empty = 0;
+            char ch = letters[p->type];
+            *o++ = (p->colour == WHITE) ? (char)(ch - 0x20) : ch;
         }
+        if (empty)
+            *o++ = (char)('0' + empty);
+        if (rank > 0)
+            *o++ = '/';
+    }
 
-        gameBoard[file][rank].colour = colour;
-        file++;
+    *o++ = ' ';
+    *o++ = (pos->sideToMove == WHITE) ? 'w' : 'b';
+    *o++ = ' ';
+    if (!pos->castling)
+        *o++ = '-';
+    if (pos->castling & CASTLE_WHITE_KING)  *o++ = 'K';
+    if (pos->castling & CASTLE_WHITE_QUEEN) *o++ = 'Q';
+    if (pos->castling & CASTLE_BLACK_KING)  *o++ = 'k';
+    if (pos->castling & CASTLE_BLACK_QUEEN) *o++ = 'q';
+    *o++ = ' ';
+    if (pos->epFile >= 0)
+    {
+        *o++ = (char)('a' + pos->epFile);
+        *o++ = (pos->sideToMove == WHITE) ? '6' : '3';
     }
+    else
+        *o++ = '-';
+    o += snprintf(o, (size_t)(buf + sizeof(buf) - o), " %d %d", pos->halfmoveClock, pos->fullmoveNumber);
+
+    size_t len = (size_t)(o - buf);
+    if (len + 1 > size)
+        return 0;
+    memcpy(out, buf, len + 1);
+    return (int)len;
+}
+
+// The en passant target expressed as the double pawn push that created it,
+// which is how move generation (validMoves_ThreadSafe) sees en passant
+struct Move positionLastMove(const struct Position *pos)
+{
+    if (pos->epFile < 0)
+        return (struct Move){-1, -1, -1, -1};
+    if (pos->sideToMove == WHITE)
+        return (struct Move){pos->epFile, 6, pos->epFile, 4};   // black pawn just moved two
+    return (struct Move){pos->epFile, 1, pos->epFile, 3};       // white pawn just moved two
+}
 
+// Parses FEN string and loads it into the board
+// Returns 1 on success, 0 on failure
+int loadBoardFromFEN(const char *fen, struct Piece gameBoard[8][8])
+{
+    struct Position pos;
+    if (!parseFEN(fen, &pos))
+        return 0;
+    memcpy(gameBoard, pos.board, sizeof(pos.board));
     return 1;
 }
 
 
+// Loads a full FEN position: placement plus side to move, castling rights
+// (kings and rooks without rights are marked as moved), en passant target
+// (expressed as the double pawn push that created it) and halfmove clock.
+// Returns 1 on success, 0 on failure
+int loadPositionFromFEN(const char *fen, struct Piece gameBoard[8][8], enum Colour *sideToMove,
+                        struct Move *lastMoveOut, int *halfmoveClockOut)
+{
+    struct Position pos;
+    if (!parseFEN(fen, &pos))
+        return 0;
+    memcpy(gameBoard, pos.board, sizeof(pos.board));
+    if (sideToMove)
+        *sideToMove = pos.sideToMove;
+    if (lastMoveOut)
+        *lastMoveOut = positionLastMove(&pos);
+    if (halfmoveClockOut)
+        *halfmoveClockOut = pos.halfmoveClock;
+    return 1;
+}
+
 // Extracts whose turn it is from FEN (returns WHITE or BLACK)
 enum Colour getTurnFromFEN(const char *fen)
 {
-    char fenCopy[256];
-    strcpy(fenCopy, fen);
-
-    strtok(fenCopy, " "); // Skip board part
-    char *turn = strtok(NULL, " ");
-
-    if (!turn)
+    // Skip the placement field only; no need to parse the board again
+    const char *c = strchr(fen, ' ');
+    if (!c)
         return WHITE; // Default to white
 
-    return (turn[0] == 'w') ? WHITE : BLACK;
+    return (c[1] == 'b') ? BLACK : WHITE;
 }
 
 
@@ -4,8 +4,14 @@
 #include <stdlib.h>
 #include <string.h>
 #include <pthread.h>
+#include <time.h>
+#include <stdatomic.h>
 #include "chess.h"
 #include "nn.h"
+#include "stats.h"
+#include "trace.h"
+#include "histogram.h"
+#include "mate.h"
 
 #define MAX_THREADS 256
 
@@ -13,17 +19,98 @@
 int PUZZLE_TEST_COUNT = 500;
 
 // Global thread status tracking for TUI
+// Per-puzzle fields are atomics so workers publish them without a lock and the
+// TUI render thread can sample them at any time; status_mutex only guards
+// slot assignment when a run starts.
 typedef struct {
     int thread_id;
-    int current_puzzle;
-    int last_result;  // -1 = not started, 0 = fail, 1 = pass
-    int is_active;
+    atomic_int current_puzzle;
+    atomic_int last_result;  // -1 = not started, 0 = fail, 1 = pass
+    atomic_int is_active;
 } ThreadStatus;
 
 static ThreadStatus global_thread_statuses[MAX_THREADS];
-static int global_num_threads = 0;
+static atomic_int global_num_threads = 0;
 static pthread_mutex_t status_mutex = PTHREAD_MUTEX_INITIALIZER;
 
+// Latency histograms for the most recent run, reset when a run starts.
+// Broken down by puzzle rating band and by solution length (AI moves).
+#define RATING_BANDS 5
+#define LENGTH_BANDS 4
+static const char *rating_band_names[RATING_BANDS] = {"<1000", "1000-1499", "1500-1999", "2000-2499", "2500+"};
+static const char *length_band_names[LENGTH_BANDS] = {"1 move", "2 moves", "3 moves", "4+ moves"};
+
+// Mate-themed puzzles are routed to the proof-number solver, the rest to
+// the generic NN picker; each route keeps its own tally and latency
+#define ROUTE_GENERIC 0
+#define ROUTE_MATE    1
+#define ROUTES        2
+static const char *route_names[ROUTES] = {"generic", "mate"};
+static atomic_int route_total[ROUTES];
+static atomic_int route_passed[ROUTES];
+
+static struct {
+    LatencyHistogram puzzle;
+    LatencyHistogram move;
+    LatencyHistogram lock_wait;
+    LatencyHistogram puzzle_by_rating[RATING_BANDS];
+    LatencyHistogram move_by_rating[RATING_BANDS];
+    LatencyHistogram puzzle_by_length[LENGTH_BANDS];
+    LatencyHistogram puzzle_by_route[ROUTES];
+} latency;
+
+static int rating_band(int rating)
+{
+    if (rating < 1000) return 0;
+    if (rating < 1500) return 1;
+    if (rating < 2000) return 2;
+    if (rating < 2500) return 3;
+    return 4;
+}
+
+// Number of engine moves in a Lichess solution: the first move is the
+// opponent's setup move, then the engine and opponent alternate.
+static int solution_ai_moves(const char *moves)
+{
+    int tokens = 0, in_token = 0;
+    for (const char *c = moves; *c; c++) {
+        if (*c == ' ') {
+            in_token = 0;
+        } else if (!in_token) {
+            in_token = 1;
+            tokens++;
+        }
+    }
+    return tokens / 2;
+}
+
+static void reset_latency_histograms(void)
+{
+    hist_reset(&latency.puzzle);
+    hist_reset(&latency.move);
+    hist_reset(&latency.lock_wait);
+    for (int i = 0; i < RATING_BANDS; i++) {
+        hist_reset(&latency.puzzle_by_rating[i]);
+        hist_reset(&latency.move_by_rating[i]);
+    }
+    for (int i = 0; i < LENGTH_BANDS; i++)
+        hist_reset(&latency.puzzle_by_length[i]);
+    for (int i = 0; i < ROUTES; i++) {
+        hist_reset(&latency.puzzle_by_route[i]);
+        atomic_store(&route_total[i], 0);
+        atomic_store(&route_passed[i], 0);
+    }
+    hist_reset(&nn_train_lock_wait_hist);
+}
+
+// Per-puzzle timing context carried from load to report
+typedef struct {
+    struct timespec start;
+    int rating;          // -1 until the puzzle row is parsed
+    int ai_moves;
+    int route;           // ROUTE_GENERIC or ROUTE_MATE
+} PuzzleTiming;
+
 // Thread worker arguments
 typedef struct {
     const char *puzzle_file;
@@ -34,6 +121,7 @@ typedef struct {
     void (*progress_callback)(int completed, int total, int passes);
     pthread_mutex_t *results_lock;
     int *completed_count;
+    int *pass_count;       // running pass total, guarded by results_lock
     int total_puzzles;
     int   train_nn;        /* 1 = gradient-train the NN (teacher forcing) */
     float learning_rate;  /* SGD step size when train_nn = 1 */
@@ -112,6 +200,85 @@ static int executeUciMove_ThreadSafe(struct GameState *state, const char *uci)
     return 1;
 }
 
+// Record a finished puzzle: store the result, publish the thread status and
+// report progress.  Keeps a running pass count so the callback never rescans
+// the results array while holding results_lock.
+static void report_puzzle_result(ThreadWorkerArgs *args, int thread_id, int puzzle_idx, int passed,
+                                 const PuzzleTiming *timing)
+{
+    args->results[puzzle_idx] = passed;
+
+    struct timespec t_end;
+    clock_gettime(CLOCK_MONOTONIC, &t_end);
+    hist_record_interval(&latency.puzzle, &timing->start, &t_end);
+    if (timing->rating >= 0) {
+        hist_record_interval(&latency.puzzle_by_rating[rating_band(timing->rating)], &timing->start, &t_end);
+        if (timing->ai_moves > 0) {
+            int band = timing->ai_moves > LENGTH_BANDS ? LENGTH_BANDS - 1 : timing->ai_moves - 1;
+            hist_record_interval(&latency.puzzle_by_length[band], &timing->start, &t_end);
+        }
+    }
+    hist_record_interval(&latency.puzzle_by_route[timing->route], &timing->start, &t_end);
+    atomic_fetch_add(&route_total[timing->route], 1);
+    if (passed)
+        atomic_fetch_add(&route_passed[timing->route], 1);
+    stats_inc(passed ? STAT_PUZZLES_PASSED : STAT_PUZZLES_FAILED);
+
+    if (thread_id >= 0)
+        atomic_store_explicit(&global_thread_statuses[thread_id].last_result, passed, memory_order_relaxed);
+
+    struct timespec t_lock;
+    TRACE_BEGIN(lock_wait, "progress_lock_wait");
+    clock_gettime(CLOCK_MONOTONIC, &t_lock);
+    pthread_mutex_lock(args->results_lock);
+    clock_gettime(CLOCK_MONOTONIC, &t_end);
+    TRACE_END(lock_wait);
+    hist_record_interval(&latency.lock_wait, &t_lock, &t_end);
+    TRACE_BEGIN(lock_hold, "progress_report");
+    (*args->completed_count)++;
+    if (passed)
+        (*args->pass_count)++;
+    if (args->progress_callback && ((*args->completed_count) % 5 == 0 || *args->completed_count == 1))
+        args->progress_callback(*args->completed_count, args->total_puzzles, *args->pass_count);
+    TRACE_END(lock_hold);
+    pthread_mutex_unlock(args->results_lock);
+}
+
+// One engine decision, recorded in the per-move latency histograms
+static struct Move timed_pick_move(struct Piece gameBoard[8][8], enum Colour colour, int rating)
+{
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    struct Move m = nn_pick_move(&g_net, gameBoard, colour);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    hist_record_interval(&latency.move, &t0, &t1);
+    if (rating >= 0)
+        hist_record_interval(&latency.move_by_rating[rating_band(rating)], &t0, &t1);
+    return m;
+}
+
+// One AI decision: the mate solver for a mate-themed puzzle (moves_left > 0),
+// then the generic picker when no mate was proven within the node budget.
+// The whole decision is a single latency sample.
+static struct Move timed_decide(MateSolver *mate, struct GameState *state, enum Colour colour,
+                                int moves_left, int rating)
+{
+    struct timespec t0, t1;
+    struct Move m = {-1, -1, -1, -1};
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    if (moves_left > 0)
+        mate_solve(mate, state->board, colour, &state->lastMove, moves_left, MATE_NODES_DEFAULT, &m);
+    if (m.fromX < 0)
+        m = nn_pick_move(&g_net, state->board, colour);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    hist_record_interval(&latency.move, &t0, &t1);
+    if (rating >= 0)
+        hist_record_interval(&latency.move_by_rating[rating_band(rating)], &t0, &t1);
+    return m;
+}
+
 // Worker thread function - processes a range of puzzles
 static void* puzzle_worker_thread(void *arg)
 {
@@ -133,78 +300,58 @@ static void* puzzle_worker_thread(void *arg)
         }
     }
     pthread_mutex_unlock(&status_mutex);
+
+    // One solver per worker: its TT is private, so no locking
+    MateSolver *mate = args->train_nn ? NULL : mate_solver_new(MATE_TT_BITS_DEFAULT);
     
     for (int puzzle_idx = args->start_puzzle; puzzle_idx < args->end_puzzle; puzzle_idx++)
     {
+        TRACE_SCOPE("puzzle");
+        PuzzleTiming timing = {.rating = -1, .ai_moves = 0, .route = ROUTE_GENERIC};
+        clock_gettime(CLOCK_MONOTONIC, &timing.start);
+
         // Update thread status - starting new puzzle
         if (thread_id >= 0)
         {
-            pthread_mutex_lock(&status_mutex);
-            global_thread_statuses[thread_id].current_puzzle = puzzle_idx;
-            global_thread_statuses[thread_id].is_active = 1;
-            pthread_mutex_unlock(&status_mutex);
+            atomic_store_explicit(&global_thread_statuses[thread_id].current_puzzle, puzzle_idx, memory_order_relaxed);
+            atomic_store_explicit(&global_thread_statuses[thread_id].is_active, 1, memory_order_relaxed);
         }
         
         // Create thread-local game state
         struct GameState state;
+        TRACE_BEGIN(init_state, "initGameState");
         initGameState(&state);
+        TRACE_END(init_state);
         
         // Load puzzle
         struct LichessPuzzle puzzle;
         if (!loadLichessPuzzle(args->puzzle_file, puzzle_idx, &puzzle))
         {
-            args->results[puzzle_idx] = 0;
-            
-            if (thread_id >= 0)
-            {
-                pthread_mutex_lock(&status_mutex);
-                global_thread_statuses[thread_id].last_result = 0;
-                pthread_mutex_unlock(&status_mutex);
-            }
-            
-            pthread_mutex_lock(args->results_lock);
-            (*args->completed_count)++;
-            if (args->progress_callback && ((*args->completed_count) % 5 == 0 || *args->completed_count == 1))
-            {
-                int passes = 0;
-                for (int i = 0; i < args->total_puzzles; i++)
-                    if (args->results[i] == 1) passes++;
-                args->progress_callback(*args->completed_count, args->total_puzzles, passes);
-            }
-            pthread_mutex_unlock(args->results_lock);
-            
+            report_puzzle_result(args, thread_id, puzzle_idx, 0, &timing);
             cleanupGameState(&state);
             continue;
         }
         
-        // Load FEN position
-        if (!loadBoardFromFEN(puzzle.fen, state.board))
+        timing.rating = puzzle.rating;
+        timing.ai_moves = solution_ai_moves(puzzle.moves);
+        int mate_moves_left = mate ? mate_theme_length(puzzle.themes) : 0;
+        if (mate_moves_left > 0)
+            timing.route = ROUTE_MATE;
+
+        // Load FEN position (one pass: board, side, castling, ep, clocks)
+        struct Position fenPos;
+        if (!parseFEN(puzzle.fen, &fenPos))
         {
-            args->results[puzzle_idx] = 0;
-            
-            if (thread_id >= 0)
-            {
-                pthread_mutex_lock(&status_mutex);
-                global_thread_statuses[thread_id].last_result = 0;
-                pthread_mutex_unlock(&status_mutex);
-            }
-            
-            pthread_mutex_lock(args->results_lock);
-            (*args->completed_count)++;
-            if (args->progress_callback && ((*args->completed_count) % 5 == 0 || *args->completed_count == 1))
-            {
-                int passes = 0;
-                for (int i = 0; i < args->total_puzzles; i++)
-                    if (args->results[i] == 1) passes++;
-                args->progress_callback(*args->completed_count, args->total_puzzles, passes);
-            }
-            pthread_mutex_unlock(args->results_lock);
-            
+            report_puzzle_result(args, thread_id, puzzle_idx, 0, &timing);
             cleanupGameState(&state);
             continue;
         }
+        memcpy(state.board, fenPos.board, sizeof(state.board));
+        state.lastMove = positionLastMove(&fenPos);
+        state.halfmoveClock = fenPos.halfmoveClock;
         
-        enum Colour sideToMove = getTurnFromFEN(puzzle.fen);
+        enum Colour sideToMove = fenPos.sideToMove;
+        stats_inc(STAT_PUZZLES_LOADED);
         
         // Parse puzzle moves
         char movesCopy[512];
@@ -217,19 +364,7 @@ static void* puzzle_worker_thread(void *arg)
         {
             if (!executeUciMove_ThreadSafe(&state, token))
             {
-                args->results[puzzle_idx] = 0;
-                
-                pthread_mutex_lock(args->results_lock);
-                (*args->completed_count)++;
-                if (args->progress_callback && ((*args->completed_count) % 5 == 0 || *args->completed_count == 1))
-                {
-                    int passes = 0;
-                    for (int i = 0; i < args->total_puzzles; i++)
-                        if (args->results[i] == 1) passes++;
-                    args->progress_callback(*args->completed_count, args->total_puzzles, passes);
-                }
-                pthread_mutex_unlock(args->results_lock);
-                
+                report_puzzle_result(args, thread_id, puzzle_idx, 0, &timing);
                 cleanupGameState(&state);
                 continue;
             }
@@ -270,7 +405,7 @@ static void* puzzle_worker_thread(void *arg)
                  * This matches the training score definition and avoids
                  * expensive CPU-side move search on every ply. */
                 if (!nn_first_move_checked) {
-                    struct Move nn_choice = nn_pick_move(&g_net, state.board, aiColour);
+                    struct Move nn_choice = timed_pick_move(state.board, aiColour, timing.rating);
                     char nn_uci[32] = "";
                     if (nn_choice.fromX >= 0)
                         snprintf(nn_uci, sizeof(nn_uci), "%c%d%c%d",
@@ -297,7 +432,10 @@ static void* puzzle_worker_thread(void *arg)
                 continue;  /* skip non-training path below */
             }
 
-            struct Move nn_choice = nn_pick_move(&g_net, state.board, aiColour);
+            struct Move nn_choice = timed_decide(mate, &state, aiColour, mate_moves_left, timing.rating);
+            if (mate_moves_left > 0)
+                mate_moves_left--;
+            stats_inc(STAT_PUZZLE_AI_MOVES);
             
             if (nn_choice.fromX < 0)
             {
@@ -391,35 +529,17 @@ static void* puzzle_worker_thread(void *arg)
             }
         }
         
-        // Store result
-        args->results[puzzle_idx] =
-            (args->train_nn ? nn_first_move_correct : puzzle_success) ? 1 : 0;
-        
-        // Update thread status with result
-        if (thread_id >= 0)
-        {
-            pthread_mutex_lock(&status_mutex);
-            global_thread_statuses[thread_id].last_result =
-                (args->train_nn ? nn_first_move_correct : puzzle_success) ? 1 : 0;
-            pthread_mutex_unlock(&status_mutex);
-        }
-        
-        // Update progress
-        pthread_mutex_lock(args->results_lock);
-        (*args->completed_count)++;
-        if (args->progress_callback && ((*args->completed_count) % 5 == 0 || *args->completed_count == 1))
-        {
-            int passes = 0;
-            for (int i = 0; i < args->total_puzzles; i++)
-                if (args->results[i] == 1) passes++;
-            args->progress_callback(*args->completed_count, args->total_puzzles, passes);
-        }
-        pthread_mutex_unlock(args->results_lock);
+        // Store result, thread status and progress
+        report_puzzle_result(args, thread_id, puzzle_idx,
+                             (args->train_nn ? nn_first_move_correct : puzzle_success) ? 1 : 0,
+                             &timing);
         
         // Cleanup
         cleanupGameState(&state);
     }
     
+    mate_solver_free(mate);
+
     // Don't mark thread as inactive yet - keep status visible
     // Will be cleared after all threads complete
     
@@ -434,10 +554,16 @@ int playPuzzlesMultiThreaded(const char *filename, int searchDepth, int numPuzzl
         numThreads = 1;
     if (numThreads > MAX_THREADS)
         numThreads = MAX_THREADS;
-    
+
+    // Load NN weights once before spawning threads (workers only read g_net)
+    if (!g_net.weights)
+    {
+        if (!nn_load(&g_net, "nn_weights.bin"))
+            nn_init(&g_net);
+    }
+
     // Initialize global thread status tracking
     pthread_mutex_lock(&status_mutex);
-    global_num_threads = numThreads;
     for (int i = 0; i < MAX_THREADS; i++)
     {
         global_thread_statuses[i].thread_id = -1;
@@ -445,7 +571,10 @@ int playPuzzlesMultiThreaded(const char *filename, int searchDepth, int numPuzzl
         global_thread_statuses[i].last_result = -1;
         global_thread_statuses[i].is_active = 0;
     }
+    global_num_threads = numThreads;
     pthread_mutex_unlock(&status_mutex);
+
+    reset_latency_histograms();
     
     // Allocate results array
     int *results = (int *)calloc(numPuzzles, sizeof(int));
@@ -458,6 +587,7 @@ int playPuzzlesMultiThreaded(const char *filename, int searchDepth, int numPuzzl
     // Shared state for progress tracking
     pthread_mutex_t results_lock = PTHREAD_MUTEX_INITIALIZER;
     int completed_count = 0;
+    int pass_count = 0;
     
     // Create threads
     pthread_t threads[MAX_THREADS];
@@ -479,6 +609,7 @@ int playPuzzlesMultiThreaded(const char *filename, int searchDepth, int numPuzzl
         thread_args[i].progress_callback = progress_callback;
         thread_args[i].results_lock = &results_lock;
         thread_args[i].completed_count = &completed_count;
+        thread_args[i].pass_count = &pass_count;
         thread_args[i].total_puzzles = numPuzzles;
         thread_args[i].train_nn = 0;
         thread_args[i].learning_rate = 0.0f;
@@ -536,22 +667,22 @@ int playPuzzles1To100_Threaded(const char *filename, int searchDepth, int numThr
     return playPuzzles1To100_MultiThreaded(filename, searchDepth, numThreads);
 }
 
-// Get thread status for TUI display
+// Get thread status for TUI display (lock-free snapshot, safe to call at frame rate)
 int* get_thread_puzzle_statuses(int *num_threads_out, int *statuses_out)
 {
-    pthread_mutex_lock(&status_mutex);
-    
-    *num_threads_out = global_num_threads;
-    
+    int n = atomic_load_explicit(&global_num_threads, memory_order_acquire);
+    if (n > MAX_THREADS)
+        n = MAX_THREADS;
+
+    *num_threads_out = n;
+
     // Copy status information
-    for (int i = 0; i < global_num_threads && i < MAX_THREADS; i++)
+    for (int i = 0; i < n; i++)
     {
-        statuses_out[i * 2] = global_thread_statuses[i].current_puzzle;
-        statuses_out[i * 2 + 1] = global_thread_statuses[i].last_result;
+        statuses_out[i * 2] = atomic_load_explicit(&global_thread_statuses[i].current_puzzle, memory_order_relaxed);
+        statuses_out[i * 2 + 1] = atomic_load_explicit(&global_thread_statuses[i].last_result, memory_order_relaxed);
     }
-    
-    pthread_mutex_unlock(&status_mutex);
-    
+
     return statuses_out;
 }
 
@@ -579,20 +710,23 @@ int playPuzzlesMultiThreaded_Train(const char *filename, float learning_rate,
 
     /* Initialise thread status tracking */
     pthread_mutex_lock(&status_mutex);
-    global_num_threads = numThreads;
     for (int i = 0; i < MAX_THREADS; i++) {
         global_thread_statuses[i].thread_id   = -1;
         global_thread_statuses[i].current_puzzle = -1;
         global_thread_statuses[i].last_result = -1;
         global_thread_statuses[i].is_active   = 0;
     }
+    global_num_threads = numThreads;
     pthread_mutex_unlock(&status_mutex);
 
+    reset_latency_histograms();
+
     int *results = (int *)calloc(numPuzzles, sizeof(int));
     if (!results) { fprintf(stderr, "OOM in playPuzzlesMultiThreaded_Train\n"); return 0; }
 
     pthread_mutex_t results_lock = PTHREAD_MUTEX_INITIALIZER;
     int completed_count = 0;
+    int pass_count = 0;
 
     pthread_t threads[MAX_THREADS];
     ThreadWorkerArgs thread_args[MAX_THREADS];
@@ -612,6 +746,7 @@ int playPuzzlesMultiThreaded_Train(const char *filename, float learning_rate,
         thread_args[i].progress_callback= progress_callback;
         thread_args[i].results_lock     = &results_lock;
         thread_args[i].completed_count  = &completed_count;
+        thread_args[i].pass_count       = &pass_count;
         thread_args[i].total_puzzles    = numPuzzles;
         thread_args[i].train_nn         = 1;
         thread_args[i].learning_rate    = learning_rate;
@@ -652,3 +787,44 @@ int playPuzzles1To100_MT_Train(const char *filename, float learning_rate, int nu
                                           PUZZLE_TEST_COUNT, numThreads,
                                           puzzle_progress_callback);
 }
+
+// Print the latency histograms of the last run (headless drivers)
+void print_puzzle_latency_report(void)
+{
+    printf("\nLatency (per puzzle, per engine move, lock waits):\n");
+    hist_print(stdout, "puzzle", &latency.puzzle);
+    for (int i = 0; i < RATING_BANDS; i++) {
+        char label[48];
+        snprintf(label, sizeof(label), "  rating %s", rating_band_names[i]);
+        hist_print(stdout, label, &latency.puzzle_by_rating[i]);
+    }
+    for (int i = 0; i < LENGTH_BANDS; i++) {
+        char label[48];
+        snprintf(label, sizeof(label), "  %s", length_band_names[i]);
+        hist_print(stdout, label, &latency.puzzle_by_length[i]);
+    }
+    for (int i = 0; i < ROUTES; i++) {
+        int total = atomic_load(&route_total[i]);
+        int passed = atomic_load(&route_passed[i]);
+        char label[48];
+        snprintf(label, sizeof(label), "  %s %d/%d passed", route_names[i], passed, total);
+        hist_print(stdout, label, &latency.puzzle_by_route[i]);
+    }
+    hist_print(stdout, "engine move", &latency.move);
+    for (int i = 0; i < RATING_BANDS; i++) {
+        char label[48];
+        snprintf(label, sizeof(label), "  rating %s", rating_band_names[i]);
+        hist_print(stdout, label, &latency.move_by_rating[i]);
+    }
+    hist_print(stdout, "progress lock wait", &latency.lock_wait);
+    hist_print(stdout, "train lock wait", &nn_train_lock_wait_hist);
+}
+
+// Percentile (0..100) of the last run's per-puzzle and per-move latency, in ms
+void get_puzzle_latency_percentiles(double pct, double *puzzle_ms, double *move_ms)
+{
+    if (puzzle_ms)
+        *puzzle_ms = hist_percentile(&latency.puzzle, pct) / 1000.0;
+    if (move_ms)
+        *move_ms = hist_percentile(&latency.move, pct) / 1000.0;
+}
@@ -2,6 +2,7 @@
 #include <stdio.h>
 #include <string.h>
 #include "chess.h"
+#include "stats.h"
 
 // Global state
 struct Move lastMove = {-1, -1, -1, -1};
@@ -71,10 +72,164 @@ int boardSetup()
     board[4][7].colour = BLACK;
 }
 
+// Legal moves using the global lastMove for en passant
 struct MoveList validMoves(struct Piece gameBoard[8][8], enum Colour colour)
 {
-    struct MoveList moveList;
-    moveList.count = 0;
+    return validMoves_ThreadSafe(gameBoard, colour, &lastMove);
+}
+
+static int absInt(int v)
+{
+    return v < 0 ? -v : v;
+}
+
+static int signInt(int v)
+{
+    return (v > 0) - (v < 0);
+}
+
+// Squares strictly between (ax, ay) and (bx, by) are empty, treating the
+// vacated square (vx, vy) as empty.  The two squares must share a line.
+static int rayClear(struct Piece gameBoard[8][8], int ax, int ay, int bx, int by, int vx, int vy)
+{
+    int sx = signInt(bx - ax), sy = signInt(by - ay);
+    for (int x = ax + sx, y = ay + sy; x != bx || y != by; x += sx, y += sy)
+    {
+        if (gameBoard[x][y].type != (enum PieceType)-1 && !(x == vx && y == vy))
+            return 0;
+    }
+    return 1;
+}
+
+// Would a piece of this type and colour standing on (x, y) attack (tx, ty)?
+// (vx, vy) is a square to treat as empty, or -1 when nothing was vacated.
+static int attacksSquare(struct Piece gameBoard[8][8], int type, enum Colour colour,
+                         int x, int y, int tx, int ty, int vx, int vy)
+{
+    int dx = tx - x, dy = ty - y;
+    int adx = absInt(dx), ady = absInt(dy);
+    switch (type)
+    {
+    case PAWN:
+        return adx == 1 && dy == ((colour == WHITE) ? 1 : -1);
+    case KNIGHT:
+        return adx * ady == 2;
+    case BISHOP:
+        return adx == ady && adx != 0 && rayClear(gameBoard, x, y, tx, ty, vx, vy);
+    case ROOK:
+        return (dx == 0) != (dy == 0) && rayClear(gameBoard, x, y, tx, ty, vx, vy);
+    case QUEEN:
+        return (adx == ady || dx == 0 || dy == 0) && adx + ady != 0 && rayClear(gameBoard, x, y, tx, ty, vx, vy);
+    default:
+        return 0; // Kings never give check
+    }
+}
+
+// En passant and castling move a second piece, so play them out in full
+static int givesCheckSlow(struct Piece gameBoard[8][8], int fx, int fy, int tx, int ty)
+{
+    struct Piece tmp[8][8];
+    memcpy(tmp, gameBoard, sizeof(tmp));
+    enum Colour colour = tmp[fx][fy].colour;
+
+    if (tmp[fx][fy].type == PAWN)
+    {
+        tmp[tx][fy].type = -1; // The pawn taken en passant
+        tmp[tx][fy].colour = -1;
+    }
+    else
+    {
+        int rookFrom = (tx > fx) ? 7 : 0, rookTo = (tx > fx) ? 5 : 3;
+        tmp[rookTo][fy] = tmp[rookFrom][fy];
+        tmp[rookFrom][fy].type = -1;
+        tmp[rookFrom][fy].colour = -1;
+    }
+    tmp[tx][ty] = tmp[fx][fy];
+    tmp[fx][fy].type = -1;
+    tmp[fx][fy].colour = -1;
+
+    return isInCheck(tmp, (colour == WHITE) ? BLACK : WHITE);
+}
+
+// Does moving (fx, fy) -> (tx, ty) check the enemy king on (kx, ky)?
+// Decided from geometry alone: a direct check from the moved piece (queening
+// pawns count as queens, as promotePawn does), or a discovered check from a
+// slider behind the vacated square.
+static int givesCheck(struct Piece gameBoard[8][8], int fx, int fy, int tx, int ty, int kx, int ky)
+{
+    struct Piece p = gameBoard[fx][fy];
+
+    if ((p.type == PAWN && fx != tx && gameBoard[tx][ty].type == (enum PieceType)-1) ||
+        (p.type == KING && absInt(tx - fx) > 1))
+        return givesCheckSlow(gameBoard, fx, fy, tx, ty);
+
+    int type = (p.type == PAWN && (ty == 0 || ty == 7)) ? QUEEN : p.type;
+    if (attacksSquare(gameBoard, type, p.colour, tx, ty, kx, ky, fx, fy))
+        return 1;
+
+    // Discovered check: walk from the king through the vacated square
+    int dx = fx - kx, dy = fy - ky;
+    if (!(dx == 0 || dy == 0 || absInt(dx) == absInt(dy)))
+        return 0;
+    int sx = signInt(dx), sy = signInt(dy);
+    for (int x = kx + sx, y = ky + sy; x >= 0 && x < 8 && y >= 0 && y < 8; x += sx, y += sy)
+    {
+        if (x == tx && y == ty)
+            return 0; // The moved piece still blocks this line
+        if ((x == fx && y == fy) || gameBoard[x][y].type == (enum PieceType)-1)
+            continue;
+        if (gameBoard[x][y].colour != p.colour)
+            return 0;
+        int t = gameBoard[x][y].type;
+        return t == QUEEN || t == ((sx && sy) ? BISHOP : ROOK);
+    }
+    return 0;
+}
+
+// Emit a legal move: store it when a list is wanted, and stop as soon as
+// the caller has seen enough (stopAfter == 0 means generate everything)
+#define EMIT_MOVE(fx, fy, tx, ty)                                   \
+    do {                                                            \
+        if (out)                                                    \
+            out[count] = (struct Move){fx, fy, tx, ty};             \
+        if (++count == stopAfter)                                   \
+            return count;                                           \
+    } while (0)
+
+// Legality costs a king scan per move, so when only checks are wanted the
+// cheap geometric test runs first and rejects most candidates
+#define TRY_MOVE(fx, fy, tx, ty)                                                             \
+    do {                                                                                     \
+        if ((!checksOnly || givesCheck(gameBoard, fx, fy, tx, ty, enemyKingX, enemyKingY)) && \
+            isMoveValid(gameBoard, fx, fy, tx, ty, colour))                                  \
+            EMIT_MOVE(fx, fy, tx, ty);                                                       \
+    } while (0)
+
+// Shared legal move generator behind validMoves_ThreadSafe, countLegalMoves,
+// hasLegalMove and checkingMoves.  En passant is decided by the caller's last
+// move, so search threads with their own positions never read the shared
+// lastMove.  The board is modified temporarily but always restored before
+// returning.
+static int generateLegalMoves(struct Piece gameBoard[8][8], enum Colour colour, const struct Move *last,
+                              struct Move *out, int stopAfter, int checksOnly)
+{
+    int count = 0;
+    int enemyKingX = -1, enemyKingY = -1;
+
+    if (checksOnly)
+    {
+        for (int i = 0; i < 64 && enemyKingX == -1; i++)
+        {
+            struct Piece k = gameBoard[i / 8][i % 8];
+            if (k.type == KING && k.colour != colour)
+            {
+                enemyKingX = i / 8;
+                enemyKingY = i % 8;
+            }
+        }
+        if (enemyKingX == -1)
+            return 0; // Nothing to check on custom boards without a king
+    }
 
     int inCheck = isInCheck(gameBoard, colour);
 
@@ -95,13 +250,11 @@ struct MoveList validMoves(struct Piece gameBoard[8][8], enum Colour colour)
 
                 // Forward 1 square
                 if (j + dir >= 0 && j + dir < 8 && gameBoard[i][j + dir].type == -1)
-                    if (isMoveValid(gameBoard, i, j, i, j + dir, colour))
-                        moveList.moves[moveList.count++] = (struct Move){i, j, i, j + dir};
+                    TRY_MOVE(i, j, i, j + dir);
 
                 // Forward 2 from start row
                 if (j == startRow && gameBoard[i][j + dir].type == -1 && gameBoard[i][j + 2 * dir].type == -1)
-                    if (isMoveValid(gameBoard, i, j, i, j + 2 * dir, colour))
-                        moveList.moves[moveList.count++] = (struct Move){i, j, i, j + 2 * dir};
+                    TRY_MOVE(i, j, i, j + 2 * dir);
 
                 // Captures
                 for (int di = -1; di <= 1; di += 2)
@@ -111,20 +264,18 @@ struct MoveList validMoves(struct Piece gameBoard[8][8], enum Colour colour)
                     if (ni >= 0 && ni < 8 && nj >= 0 && nj < 8)
                     {
                         if (gameBoard[ni][nj].type != -1 && gameBoard[ni][nj].colour != colour)
-                            if (isMoveValid(gameBoard, i, j, ni, nj, colour))
-                                moveList.moves[moveList.count++] = (struct Move){i, j, ni, nj};
+                            TRY_MOVE(i, j, ni, nj);
 
                         // En passant - only valid if opponent just moved a pawn two squares
                         // White pawns on y=4 can capture black pawns that just moved to rank 5
                         // Black pawns on y=3 can capture white pawns that just moved to rank 4
                         if (gameBoard[ni][j].type == PAWN && gameBoard[ni][j].colour != colour)
                         {
-                            if (lastMove.fromX == ni && lastMove.toX == ni &&
-                                ((colour == WHITE && j == 4 && lastMove.fromY == 6 && lastMove.toY == 4) ||
-                                 (colour == BLACK && j == 3 && lastMove.fromY == 1 && lastMove.toY == 3)))
+                            if (last->fromX == ni && last->toX == ni &&
+                                ((colour == WHITE && j == 4 && last->fromY == 6 && last->toY == 4) ||
+                                 (colour == BLACK && j == 3 && last->fromY == 1 && last->toY == 3)))
                             {
-                                if (isMoveValid(gameBoard, i, j, ni, nj, colour))
-                                    moveList.moves[moveList.count++] = (struct Move){i, j, ni, nj};
+                                TRY_MOVE(i, j, ni, nj);
                             }
                         }
                     }
@@ -140,8 +291,7 @@ struct MoveList validMoves(struct Piece gameBoard[8][8], enum Colour colour)
                     int ni = i + knightMoves[k][0], nj = j + knightMoves[k][1];
                     if (ni >= 0 && ni < 8 && nj >= 0 && nj < 8 &&
                         (gameBoard[ni][nj].type == -1 || gameBoard[ni][nj].colour != colour))
-                        if (isMoveValid(gameBoard, i, j, ni, nj, colour))
-                            moveList.moves[moveList.count++] = (struct Move){i, j, ni, nj};
+                        TRY_MOVE(i, j, ni, nj);
                 }
                 break;
             }
@@ -191,14 +341,12 @@ struct MoveList validMoves(struct Piece gameBoard[8][8], enum Colour colour)
                     {
                         if (gameBoard[ni][nj].type == -1)
                         {
-                            if (isMoveValid(gameBoard, i, j, ni, nj, colour))
-                                moveList.moves[moveList.count++] = (struct Move){i, j, ni, nj};
+                            TRY_MOVE(i, j, ni, nj);
                         }
                         else
                         {
                             if (gameBoard[ni][nj].colour != colour)
-                                if (isMoveValid(gameBoard, i, j, ni, nj, colour))
-                                    moveList.moves[moveList.count++] = (struct Move){i, j, ni, nj};
+                                TRY_MOVE(i, j, ni, nj);
                             break;
                         }
                         ni += dirs[d][0];
@@ -219,14 +367,13 @@ struct MoveList validMoves(struct Piece gameBoard[8][8], enum Colour colour)
                         int ni = i + dx, nj = j + dy;
                         if (ni >= 0 && ni < 8 && nj >= 0 && nj < 8 &&
                             (gameBoard[ni][nj].type == -1 || gameBoard[ni][nj].colour != colour))
-                            if (isMoveValid(gameBoard, i, j, ni, nj, colour))
-                                moveList.moves[moveList.count++] = (struct Move){i, j, ni, nj};
+                            TRY_MOVE(i, j, ni, nj);
                     }
                 }
 
-                // Castling
+                // Castling (hasMoved of king and rook carries the rights)
                 int row = j;
-                if (!p.hasMoved && !isInCheck(gameBoard, colour))
+                if (!p.hasMoved && i == 4 && row == ((colour == WHITE) ? 0 : 7) && !inCheck)
                 {
                     // Kingside
                     if (gameBoard[7][row].type == ROOK && gameBoard[7][row].colour == colour && !gameBoard[7][row].hasMoved)
@@ -237,11 +384,12 @@ struct MoveList validMoves(struct Piece gameBoard[8][8], enum Colour colour)
                             gameBoard[i][j].type = -1;
                             gameBoard[i][j].colour = -1;
                             gameBoard[5][row] = tmp;
-                            if (!isInCheck(gameBoard, colour))
-                                moveList.moves[moveList.count++] = (struct Move){i, j, 6, row};
+                            int passSafe = !isInCheck(gameBoard, colour);
                             gameBoard[5][row].type = -1;
                             gameBoard[5][row].colour = -1;
                             gameBoard[i][j] = tmp;
+                            if (passSafe)
+                                TRY_MOVE(i, j, 6, row);
                         }
                     }
                     // Queenside
@@ -253,11 +401,12 @@ struct MoveList validMoves(struct Piece gameBoard[8][8], enum Colour colour)
                             gameBoard[i][j].type = -1;
                             gameBoard[i][j].colour = -1;
                             gameBoard[3][row] = tmp;
-                            if (!isInCheck(gameBoard, colour))
-                                moveList.moves[moveList.count++] = (struct Move){i, j, 2, row};
+                            int passSafe = !isInCheck(gameBoard, colour);
                             gameBoard[3][row].type = -1;
                             gameBoard[3][row].colour = -1;
                             gameBoard[i][j] = tmp;
+                            if (passSafe)
+                                TRY_MOVE(i, j, 2, row);
                         }
                     }
                 }
@@ -270,9 +419,149 @@ struct MoveList validMoves(struct Piece gameBoard[8][8], enum Colour colour)
         }
     }
 
+    return count;
+}
+
+#undef TRY_MOVE
+#undef EMIT_MOVE
+
+struct MoveList validMoves_ThreadSafe(struct Piece gameBoard[8][8], enum Colour colour, const struct Move *last)
+{
+    struct MoveList moveList;
+    moveList.count = generateLegalMoves(gameBoard, colour, last, moveList.moves, 0, 0);
+
+    stats_inc(STAT_MOVEGEN_CALLS);
+    stats_add(STAT_MOVES_GENERATED, (uint64_t)moveList.count);
+    return moveList;
+}
+
+// Number of legal moves without building a list (mobility, perft leaves)
+int countLegalMoves(struct Piece gameBoard[8][8], enum Colour colour, const struct Move *last)
+{
+    return generateLegalMoves(gameBoard, colour, last, NULL, 0, 0);
+}
+
+// 1 if the side has any legal move; stops at the first one found, so
+// checkmate/stalemate tests usually cost a fraction of full generation
+int hasLegalMove(struct Piece gameBoard[8][8], enum Colour colour, const struct Move *last)
+{
+    return generateLegalMoves(gameBoard, colour, last, NULL, 1, 0) > 0;
+}
+
+// Legal moves that give check, direct or discovered.  Only these can mate,
+// so mate searches look at a handful of moves instead of the full list.
+struct MoveList checkingMoves(struct Piece gameBoard[8][8], enum Colour colour, const struct Move *last)
+{
+    struct MoveList moveList;
+    moveList.count = generateLegalMoves(gameBoard, colour, last, moveList.moves, 0, 1);
     return moveList;
 }
 
+// Does a side in check have any legal reply?  Only king steps, captures of
+// the checker and interpositions can help, so only those are tried; in
+// double check just the king steps.
+int hasLegalEvasion(struct Piece gameBoard[8][8], enum Colour colour, const struct Move *last)
+{
+    enum Colour enemy = (colour == WHITE) ? BLACK : WHITE;
+    int kx = -1, ky = -1;
+    for (int i = 0; i < 64 && kx == -1; i++)
+    {
+        if (gameBoard[i / 8][i % 8].type == KING && gameBoard[i / 8][i % 8].colour == colour)
+        {
+            kx = i / 8;
+            ky = i % 8;
+        }
+    }
+    if (kx == -1)
+        return hasLegalMove(gameBoard, colour, last);
+
+    // King steps first: the usual escape, and the only one in double check
+    for (int dx = -1; dx <= 1; dx++)
+    {
+        for (int dy = -1; dy <= 1; dy++)
+        {
+            int nx = kx + dx, ny = ky + dy;
+            if ((dx || dy) && nx >= 0 && nx < 8 && ny >= 0 && ny < 8 &&
+                gameBoard[nx][ny].colour != colour && isMoveValid(gameBoard, kx, ky, nx, ny, colour))
+                return 1;
+        }
+    }
+
+    int checkers = 0, cx = -1, cy = -1;
+    for (int x = 0; x < 8; x++)
+    {
+        for (int y = 0; y < 8; y++)
+        {
+            if (gameBoard[x][y].colour == enemy &&
+                attacksSquare(gameBoard, gameBoard[x][y].type, enemy, x, y, kx, ky, -1, -1))
+            {
+                checkers++;
+                cx = x;
+                cy = y;
+            }
+        }
+    }
+    if (checkers == 0)
+        return hasLegalMove(gameBoard, colour, last); // Not in check after all
+    if (checkers > 1)
+        return 0;
+
+    // Capture the checker, or block on a square between it and the king
+    int targets[8][2];
+    int ntargets = 0;
+    targets[ntargets][0] = cx;
+    targets[ntargets++][1] = cy;
+    int checkerType = gameBoard[cx][cy].type;
+    if (checkerType == BISHOP || checkerType == ROOK || checkerType == QUEEN)
+    {
+        int sx = signInt(kx - cx), sy = signInt(ky - cy);
+        for (int x = cx + sx, y = cy + sy; x != kx || y != ky; x += sx, y += sy)
+        {
+            targets[ntargets][0] = x;
+            targets[ntargets++][1] = y;
+        }
+    }
+
+    int dir = (colour == WHITE) ? 1 : -1;
+    int startRow = (colour == WHITE) ? 1 : 6;
+    for (int x = 0; x < 8; x++)
+    {
+        for (int y = 0; y < 8; y++)
+        {
+            struct Piece p = gameBoard[x][y];
+            if (p.colour != colour || p.type == KING)
+                continue;
+
+            for (int t = 0; t < ntargets; t++)
+            {
+                int tx = targets[t][0], ty = targets[t][1];
+                int reaches;
+                if (p.type == PAWN && gameBoard[tx][ty].type == (enum PieceType)-1)
+                    reaches = tx == x && (ty == y + dir ||
+                                          (ty == y + 2 * dir && y == startRow && gameBoard[x][y + dir].type == (enum PieceType)-1));
+                else
+                    reaches = attacksSquare(gameBoard, p.type, colour, x, y, tx, ty, -1, -1);
+                if (reaches && isMoveValid(gameBoard, x, y, tx, ty, colour))
+                    return 1;
+            }
+
+            // A pawn that just double-stepped into check can be taken en passant
+            if (p.type == PAWN && checkerType == PAWN && y == cy && absInt(x - cx) == 1 &&
+                last->toX == cx && last->toY == cy && last->fromX == cx && absInt(last->fromY - cy) == 2)
+            {
+                struct Piece taken = gameBoard[cx][cy];
+                gameBoard[cx][cy].type = -1;
+                gameBoard[cx][cy].colour = -1;
+                int ok = isMoveValid(gameBoard, x, y, cx, cy + dir, colour);
+                gameBoard[cx][cy] = taken;
+                if (ok)
+                    return 1;
+            }
+        }
+    }
+    return 0;
+}
+
 // Adds current move to board history
 void recordBoardHistory()
 {
@@ -0,0 +1,1226 @@
+/* search.c - alpha-beta search engine with a persistent thread pool
+ *
+ * Iterative deepening, principal variation search and a captures-only
+ * quiescence search over validMoves_ThreadSafe().  Move ordering uses the
+ * TT move, MVV-LVA for captures, two killers per ply and a history table;
+ * optionally the move network (nn.h) ranks the quiet moves of the first few
+ * plies.
+ * All threads share one lock-free transposition table (key XOR data
+ * verification) that survives between searches; helper threads run Lazy
+ * SMP on the same root with staggered depths.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "chess.h"
+#include "bitbase.h"
+#include "nn.h"
+#include "search.h"
+#include "stats.h"
+#include "trace.h"
+#include "value.h"
+#include "zobrist.h"
+
+#define INF_SCORE     (SEARCH_MATE + 1)
+#define CHECK_EVERY   2048    /* nodes between limit checks */
+#define EVAL_CACHE    (1 << 14)   /* per-thread value-network cache entries */
+#define NN_ORDER_BRANCHING  35          /* typical legal moves per position */
+#define NN_ORDER_CACHE_MIN  64
+#define NN_ORDER_CACHE_MAX  (1 << 14)   /* per-thread move-network rankings, ~11 MB */
+#define NN_ORDER_BATCH  32        /* positions per nn_forward_batch() call */
+
+/* ════════════════════════════════════════════════════════════════════════════
+ * Zobrist hashing
+ * ════════════════════════════════════════════════════════════════════════════ */
+
+/* Search node: everything needed to generate moves and evaluate, without
+ * the game history (kept once per thread as a key stack). */
+typedef struct {
+    struct Piece board[8][8];
+    enum Colour  side;
+    struct Move  lastMove;
+    int          halfmoveClock;
+    int          pieces;        /* men on the board, kings included */
+} Node;
+
+static int castle_right(const struct Piece b[8][8], enum Colour c, int rookFile)
+{
+    int row = (c == WHITE) ? 0 : 7;
+    return b[4][row].type == KING && b[4][row].colour == c && !b[4][row].hasMoved &&
+           b[rookFile][row].type == ROOK && b[rookFile][row].colour == c && !b[rookFile][row].hasMoved;
+}
+
+static uint64_t node_hash(const Node *n)
+{
+    uint64_t h = zobrist_board_key(n->board);
+    if (n->side == BLACK)
+        h ^= zobrist_side;
+    if (castle_right(n->board, WHITE, 7)) h ^= zobrist_castle[0];
+    if (castle_right(n->board, WHITE, 0)) h ^= zobrist_castle[1];
+    if (castle_right(n->board, BLACK, 7)) h ^= zobrist_castle[2];
+    if (castle_right(n->board, BLACK, 0)) h ^= zobrist_castle[3];
+
+    const struct Move *l = &n->lastMove;
+    if (l->fromX >= 0 && l->fromX == l->toX && abs(l->toY - l->fromY) == 2 &&
+        n->board[l->toX][l->toY].type == PAWN)
+        h ^= zobrist_ep[l->toX];
+    return h;
+}
+
+/* Apply m in place.  promotion < 0 promotes to a queen. */
+static void node_play(Node *n, struct Move m, int promotion)
+{
+    struct Piece (*b)[8] = n->board;
+    struct Piece moving = b[m.fromX][m.fromY];
+    int capture = (b[m.toX][m.toY].type != (enum PieceType)-1);
+
+    if (moving.type == PAWN && m.fromX != m.toX && !capture) {
+        b[m.toX][m.fromY].type = -1;
+        b[m.toX][m.fromY].colour = -1;
+        capture = 1;
+    }
+
+    b[m.toX][m.toY] = moving;
+    b[m.toX][m.toY].hasMoved = 1;
+    b[m.fromX][m.fromY].type = -1;
+    b[m.fromX][m.fromY].colour = -1;
+
+    if (moving.type == PAWN && (m.toY == 7 || m.toY == 0))
+        b[m.toX][m.toY].type = (promotion >= 0) ? (enum PieceType)promotion : QUEEN;
+
+    if (moving.type == KING && m.fromX == 4 && (m.toX == 6 || m.toX == 2)) {
+        int rf = (m.toX == 6) ? 7 : 0, rt = (m.toX == 6) ? 5 : 3;
+        b[rt][m.toY] = b[rf][m.toY];
+        b[rt][m.toY].hasMoved = 1;
+        b[rf][m.toY].type = -1;
+        b[rf][m.toY].colour = -1;
+    }
+
+    n->halfmoveClock = (moving.type == PAWN || capture) ? 0 : n->halfmoveClock + 1;
+    n->pieces -= capture;
+    n->lastMove = m;
+    n->side = (n->side == WHITE) ? BLACK : WHITE;
+}
+
+static void node_from_position(Node *n, const SearchPosition *pos)
+{
+    memcpy(n->board, pos->board, sizeof(n->board));
+    n->side = pos->side;
+    n->lastMove = pos->lastMove;
+    n->halfmoveClock = pos->halfmoveClock;
+    n->pieces = 0;
+    for (int x = 0; x < 8; x++)
+        for (int y = 0; y < 8; y++)
+            n->pieces += (n->board[x][y].type != (enum PieceType)-1);
+}
+
+static struct MoveList node_moves(Node *n)
+{
+    return validMoves_ThreadSafe(n->board, n->side, &n->lastMove);
+}
+
+/* ════════════════════════════════════════════════════════════════════════════
+ * Positions (public)
+ * ════════════════════════════════════════════════════════════════════════════ */
+
+void search_position_from_board(SearchPosition *pos, struct Piece b[8][8],
+                                enum Colour side, const struct Move *last)
+{
+    zobrist_init();
+    memcpy(pos->board, b, sizeof(pos->board));
+    pos->side = side;
+    pos->lastMove = last ? *last : (struct Move){-1, -1, -1, -1};
+    pos->halfmoveClock = 0;
+    pos->historyCount = 0;
+}
+
+void search_position_startpos(SearchPosition *pos)
+{
+    search_position_from_fen(pos, "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+}
+
+int search_position_from_fen(SearchPosition *pos, const char *fen)
+{
+    zobrist_init();
+    memset(pos, 0, sizeof(*pos));
+    if (!loadPositionFromFEN(fen, pos->board, &pos->side, &pos->lastMove, &pos->halfmoveClock))
+        return 0;
+    return 1;
+}
+
+uint64_t search_position_hash(const SearchPosition *pos)
+{
+    zobrist_init();
+    Node n;
+    node_from_position(&n, pos);
+    return node_hash(&n);
+}
+
+void search_position_play(SearchPosition *pos, struct Move m, int promotion)
+{
+    if (pos->historyCount == SEARCH_HISTORY_MAX) {
+        memmove(pos->history, pos->history + 1, (SEARCH_HISTORY_MAX - 1) * sizeof(uint64_t));
+        pos->historyCount--;
+    }
+    pos->history[pos->historyCount++] = search_position_hash(pos);
+
+    Node n;
+    node_from_position(&n, pos);
+    node_play(&n, m, promotion);
+    memcpy(pos->board, n.board, sizeof(pos->board));
+    pos->side = n.side;
+    pos->lastMove = n.lastMove;
+    pos->halfmoveClock = n.halfmoveClock;
+}
+
+int search_position_play_uci(SearchPosition *pos, const char *uci)
+{
+    if (!uci || strlen(uci) < 4)
+        return 0;
+    struct Move want = {uci[0] - 'a', uci[1] - '1', uci[2] - 'a', uci[3] - '1'};
+
+    int promotion = -1;
+    switch (uci[4]) {
+    case 'q': promotion = QUEEN; break;
+    case 'r': promotion = ROOK; break;
+    case 'b': promotion = BISHOP; break;
+    case 'n': promotion = KNIGHT; break;
+    default: break;
+    }
+
+    Node n;
+    node_from_position(&n, pos);
+    struct MoveList ml = node_moves(&n);
+    for (int i = 0; i < ml.count; i++) {
+        struct Move m = ml.moves[i];
+        if (m.fromX == want.fromX && m.fromY == want.fromY && m.toX == want.toX && m.toY == want.toY) {
+            search_position_play(pos, m, promotion);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void search_move_to_uci(const SearchPosition *pos, struct Move m, char out[8])
+{
+    if (m.fromX < 0) {
+        strcpy(out, "0000");
+        return;
+    }
+    int promo = pos && pos->board[m.fromX][m.fromY].type == PAWN && (m.toY == 7 || m.toY == 0);
+    out[0] = (char)('a' + m.fromX);
+    out[1] = (char)('1' + m.fromY);
+    out[2] = (char)('a' + m.toX);
+    out[3] = (char)('1' + m.toY);
+    out[4] = promo ? 'q' : '\0';
+    out[5] = '\0';
+}
+
+/* ════════════════════════════════════════════════════════════════════════════
+ * Evaluation: material plus light piece-square terms
+ * ════════════════════════════════════════════════════════════════════════════ */
+
+static const int piece_value[6] = {100, 320, 330, 500, 900, 0};
+
+static int node_evaluate(const Node *n)
+{
+    int score = 0;   /* white's point of view */
+    for (int x = 0; x < 8; x++)
+        for (int y = 0; y < 8; y++) {
+            const struct Piece *p = &n->board[x][y];
+            if (p->type == (enum PieceType)-1)
+                continue;
+            int rank = (p->colour == WHITE) ? y : 7 - y;
+            int centre = 6 - (abs(2 * x - 7) + abs(2 * y - 7)) / 2;   /* 0 at corners, 6 in centre */
+            int v = piece_value[p->type];
+            switch (p->type) {
+            case PAWN:   v += rank * rank; break;
+            case KNIGHT: v += centre * 5; break;
+            case BISHOP: v += centre * 3; break;
+            case QUEEN:  v += centre; break;
+            case KING:   v += (rank == 0) ? 10 : 0; break;
+            default: break;
+            }
+            score += (p->colour == WHITE) ? v : -v;
+        }
+    return (n->side == WHITE) ? score : -score;
+}
+
+int search_evaluate(const SearchPosition *pos)
+{
+    Node n;
+    node_from_position(&n, pos);
+    return node_evaluate(&n);
+}
+
+/* ════════════════════════════════════════════════════════════════════════════
+ * Transposition table
+ * ════════════════════════════════════════════════════════════════════════════ */
+
+enum { TT_NONE = 0, TT_UPPER = 1, TT_LOWER = 2, TT_EXACT = 3 };
+
+typedef struct {
+    _Atomic uint64_t key;    /* hash ^ data, so torn writes fail verification */
+    _Atomic uint64_t data;
+} TTSlot;
+
+struct SearchTable {
+    TTSlot    *slots;
+    uint64_t   mask;
+    atomic_int generation;
+};
+
+static SearchTable shared_tt;   /* the pool's, and search_position()'s by default */
+
+/* data layout: from(6) to(6) has_move(1) score+32768(16) depth(8) flag(2) gen(8) */
+static uint64_t tt_pack(struct Move m, int score, int depth, int flag, int gen)
+{
+    uint64_t has = (m.fromX >= 0);
+    uint64_t from = has ? (uint64_t)(m.fromX * 8 + m.fromY) : 0;
+    uint64_t to = has ? (uint64_t)(m.toX * 8 + m.toY) : 0;
+    return from | (to << 6) | (has << 12) | ((uint64_t)(score + 32768) << 13) |
+           ((uint64_t)(depth & 0xFF) << 29) | ((uint64_t)flag << 37) | ((uint64_t)(gen & 0xFF) << 39);
+}
+
+static int tt_probe(const SearchTable *tt, uint64_t key, struct Move *move, int *score, int *depth, int *flag)
+{
+    stats_inc(STAT_TT_PROBES);
+    TTSlot *s = &tt->slots[key & tt->mask];
+    uint64_t data = atomic_load_explicit(&s->data, memory_order_relaxed);
+    uint64_t k = atomic_load_explicit(&s->key, memory_order_relaxed);
+    if ((k ^ data) != key || ((data >> 37) & 3) == TT_NONE)
+        return 0;
+
+    if ((data >> 12) & 1) {
+        int from = (int)(data & 63), to = (int)((data >> 6) & 63);
+        *move = (struct Move){from / 8, from % 8, to / 8, to % 8};
+    } else {
+        *move = (struct Move){-1, -1, -1, -1};
+    }
+    *score = (int)((data >> 13) & 0xFFFF) - 32768;
+    *depth = (int)((data >> 29) & 0xFF);
+    *flag = (int)((data >> 37) & 3);
+    stats_inc(STAT_TT_HITS);
+    return 1;
+}
+
+static void tt_store(SearchTable *tt, uint64_t key, struct Move move, int score, int depth, int flag)
+{
+    TTSlot *s = &tt->slots[key & tt->mask];
+    int gen = atomic_load_explicit(&tt->generation, memory_order_relaxed);
+    uint64_t old = atomic_load_explicit(&s->data, memory_order_relaxed);
+    uint64_t old_key = atomic_load_explicit(&s->key, memory_order_relaxed) ^ old;
+    int old_depth = (int)((old >> 29) & 0xFF);
+    int old_gen = (int)((old >> 39) & 0xFF);
+
+    /* Keep deeper results from this search unless it is the same position */
+    if (old_key != key && old_gen == (gen & 0xFF) && old_depth > depth)
+        return;
+    /* Keep the old best move when re-storing the same position without one */
+    if (old_key == key && move.fromX < 0 && ((old >> 12) & 1)) {
+        int from = (int)(old & 63), to = (int)((old >> 6) & 63);
+        move = (struct Move){from / 8, from % 8, to / 8, to % 8};
+    }
+
+    uint64_t data = tt_pack(move, score, depth, flag, gen);
+    atomic_store_explicit(&s->data, data, memory_order_relaxed);
+    atomic_store_explicit(&s->key, key ^ data, memory_order_relaxed);
+    stats_inc(STAT_TT_STORES);
+}
+
+static int score_to_tt(int score, int ply)
+{
+    if (score > SEARCH_MATE_BOUND) return score + ply;
+    if (score < -SEARCH_MATE_BOUND) return score - ply;
+    return score;
+}
+
+static int score_from_tt(int score, int ply)
+{
+    if (score > SEARCH_MATE_BOUND) return score - ply;
+    if (score < -SEARCH_MATE_BOUND) return score + ply;
+    return score;
+}
+
+static void tt_allocate(SearchTable *tt, int hash_mb)
+{
+    if (hash_mb < 1) hash_mb = 1;
+    uint64_t want = ((uint64_t)hash_mb << 20) / sizeof(TTSlot);
+    uint64_t entries = 1;
+    while (entries * 2 <= want)
+        entries *= 2;
+
+    free(tt->slots);
+    tt->slots = calloc(entries, sizeof(TTSlot));
+    if (!tt->slots) {
+        fprintf(stderr, "search: cannot allocate %d MB hash, using 1 MB\n", hash_mb);
+        entries = (1u << 20) / sizeof(TTSlot);
+        tt->slots = calloc(entries, sizeof(TTSlot));
+        if (!tt->slots) {
+            fprintf(stderr, "search: out of memory\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    tt->mask = entries - 1;
+}
+
+SearchTable *search_table_new(int hash_mb)
+{
+    SearchTable *tt = calloc(1, sizeof(*tt));
+    if (!tt) {
+        fprintf(stderr, "search: out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    zobrist_init();
+    tt_allocate(tt, hash_mb);
+    return tt;
+}
+
+void search_table_free(SearchTable *tt)
+{
+    if (!tt)
+        return;
+    free(tt->slots);
+    free(tt);
+}
+
+int search_hashfull(void)
+{
+    if (!shared_tt.slots)
+        return 0;
+    int gen = atomic_load(&shared_tt.generation) & 0xFF;
+    int used = 0, sample = (shared_tt.mask + 1 < 1000) ? (int)(shared_tt.mask + 1) : 1000;
+    for (int i = 0; i < sample; i++) {
+        uint64_t d = atomic_load_explicit(&shared_tt.slots[i].data, memory_order_relaxed);
+        if (((d >> 37) & 3) != TT_NONE && (int)((d >> 39) & 0xFF) == gen)
+            used++;
+    }
+    return used * 1000 / sample;
+}
+
+/* ════════════════════════════════════════════════════════════════════════════
+ * Per-thread search state
+ * ════════════════════════════════════════════════════════════════════════════ */
+
+typedef struct {
+    uint64_t key;
+    int      score;
+} EvalCacheEntry;
+
+/* The move network's ranking of one position's moves, 0 = its favourite */
+typedef struct {
+    uint64_t key;
+    int      count;
+    uint16_t move[224];     /* from * 64 + to, in node_moves() order */
+    uint8_t  rank[224];
+} NNOrderEntry;
+
+typedef struct {
+    int          id;
+    Node         root;
+    SearchLimits limits;
+    atomic_int  *stop;
+    atomic_int  *pondering;       /* limits suspended while set, may be NULL */
+    atomic_llong *shared_nodes;   /* pool-wide node total, NULL when alone */
+    SearchTable  *tt;
+
+    long long    nodes;
+    long long    nodes_flushed;
+    int          completed_depth;
+    struct timespec t_start;
+    long long    soft_ms, hard_ms;  /* 0 = no time limit */
+
+    uint64_t     keys[SEARCH_HISTORY_MAX + SEARCH_MAX_PLY + 1];
+    int          key_count;        /* game history + current path */
+    int          root_key_count;
+
+    struct Move  pv[SEARCH_MAX_PLY][SEARCH_MAX_PLY];
+    int          pv_len[SEARCH_MAX_PLY];
+    struct Move  killers[SEARCH_MAX_PLY][2];
+    int          history[2][64][64];
+
+    const ValueNet *eval_cache_net;    /* network the cache was filled by */
+    EvalCacheEntry eval_cache[EVAL_CACHE];
+    NNOrderEntry  *nn_order;           /* allocated when order_net is set */
+    int            nn_order_size;      /* entries, a power of two */
+
+    SearchResult result;
+} SearchThread;
+
+static long long elapsed_ms(const SearchThread *t)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)(now.tv_sec - t->t_start.tv_sec) * 1000 +
+           (now.tv_nsec - t->t_start.tv_nsec) / 1000000;
+}
+
+/* Work out soft (don't start another iteration) and hard (abort) budgets */
+static void plan_time(SearchThread *t)
+{
+    const SearchLimits *l = &t->limits;
+    t->soft_ms = t->hard_ms = 0;
+    if (l->infinite)
+        return;
+    if (l->movetime_ms > 0) {
+        t->soft_ms = t->hard_ms = l->movetime_ms;
+        return;
+    }
+
+    int time = (t->root.side == WHITE) ? l->wtime : l->btime;
+    int inc = (t->root.side == WHITE) ? l->winc : l->binc;
+    if (time <= 0)
+        return;
+
+    int mtg = (l->movestogo > 0) ? l->movestogo : 30;
+    long long budget = time / mtg + inc * 3 / 4;
+    long long cap = time - 50;   /* keep a safety margin for I/O latency */
+    if (cap < 1) cap = 1;
+    if (budget > cap) budget = cap;
+    t->soft_ms = budget;
+    t->hard_ms = (budget * 3 < cap) ? budget * 3 : cap;
+}
+
+/* Room for every position ranked within order_plies of the root (the
+ * plies below it are batched in as children), at half load so the
+ * direct-mapped slots rarely collide */
+static int nn_order_entries(int order_plies)
+{
+    long long ranked = 0, level = 1;
+    for (int p = 0; p < order_plies && ranked < NN_ORDER_CACHE_MAX; p++) {
+        ranked += level;
+        level *= NN_ORDER_BRANCHING;
+    }
+    int size = NN_ORDER_CACHE_MIN;
+    while (size < NN_ORDER_CACHE_MAX && size < 2 * ranked)
+        size *= 2;
+    return size;
+}
+
+static void thread_free(SearchThread *t)
+{
+    if (!t)
+        return;
+    free(t->nn_order);
+    free(t);
+}
+
+static void thread_prepare(SearchThread *t, const SearchPosition *pos, const SearchLimits *limits,
+                           atomic_int *stop, atomic_int *pondering, atomic_llong *shared_nodes)
+{
+    node_from_position(&t->root, pos);
+    t->limits = *limits;
+    t->stop = stop;
+    t->pondering = pondering;
+    t->shared_nodes = shared_nodes;
+    t->tt = limits->table ? limits->table : &shared_tt;
+    t->nodes = t->nodes_flushed = 0;
+    t->completed_depth = 0;
+    clock_gettime(CLOCK_MONOTONIC, &t->t_start);
+    plan_time(t);
+
+    memcpy(t->keys, pos->history, (size_t)pos->historyCount * sizeof(uint64_t));
+    t->key_count = t->root_key_count = pos->historyCount;
+    memset(t->killers, 0xFF, sizeof(t->killers));
+    if (t->eval_cache_net != limits->value_net) {
+        memset(t->eval_cache, 0, sizeof(t->eval_cache));
+        t->eval_cache_net = limits->value_net;
+    }
+    if (limits->order_net) {
+        int want = nn_order_entries(limits->order_plies);
+        if (want != t->nn_order_size) {
+            free(t->nn_order);
+            t->nn_order = malloc((size_t)want * sizeof(NNOrderEntry));
+            t->nn_order_size = t->nn_order ? want : 0;
+        }
+        if (t->nn_order)   /* the weights may have been trained since */
+            memset(t->nn_order, 0, (size_t)t->nn_order_size * sizeof(NNOrderEntry));
+    }
+    memset(&t->result, 0, sizeof(t->result));
+    t->result.best = t->result.ponder = (struct Move){-1, -1, -1, -1};
+}
+
+static int is_pondering(const SearchThread *t)
+{
+    return t->pondering && atomic_load_explicit(t->pondering, memory_order_relaxed);
+}
+
+static long long total_nodes(const SearchThread *t)
+{
+    if (t->shared_nodes)
+        return atomic_load_explicit(t->shared_nodes, memory_order_relaxed) + (t->nodes - t->nodes_flushed);
+    return t->nodes;
+}
+
+/* Called every CHECK_EVERY nodes; sets the stop flag on hard limits */
+static void check_limits(SearchThread *t)
+{
+    if (t->shared_nodes) {
+        atomic_fetch_add_explicit(t->shared_nodes, t->nodes - t->nodes_flushed, memory_order_relaxed);
+        t->nodes_flushed = t->nodes;
+    }
+    if (t->id != 0 || t->completed_depth < 1 || is_pondering(t))
+        return;   /* only the main thread enforces limits, after depth 1 */
+    if ((t->hard_ms > 0 && elapsed_ms(t) >= t->hard_ms) ||
+        (t->limits.nodes > 0 && total_nodes(t) >= t->limits.nodes))
+        atomic_store(t->stop, 1);
+}
+
+static int should_stop(const SearchThread *t)
+{
+    return t->completed_depth >= 1 && atomic_load_explicit(t->stop, memory_order_relaxed);
+}
+
+static int is_repetition(const SearchThread *t, uint64_t key, int halfmove)
+{
+    /* Same side to move every two plies; stop at the last irreversible move */
+    int limit = t->key_count - halfmove;
+    if (limit < 0) limit = 0;
+    for (int i = t->key_count - 2; i >= limit; i -= 2)
+        if (t->keys[i] == key)
+            return 1;
+    return 0;
+}
+
+/* Leaf evaluation: the hand-crafted terms, or the value network behind a
+ * small per-thread cache (transpositions and re-searches revisit leaves). */
+static int evaluate(SearchThread *t, const Node *n)
+{
+    const ValueNet *net = t->limits.value_net;
+    if (!net)
+        return node_evaluate(n);
+
+    uint64_t key = node_hash(n);
+    EvalCacheEntry *e = &t->eval_cache[key & (EVAL_CACHE - 1)];
+    if (e->key == key) {
+        stats_inc(STAT_EVAL_CACHE_HITS);
+        return e->score;
+    }
+    e->key = key;
+    e->score = value_evaluate(net, n->board, n->side);
+    return e->score;
+}
+
+/* ════════════════════════════════════════════════════════════════════════════
+ * Move ordering
+ * ════════════════════════════════════════════════════════════════════════════ */
+
+static int same_move(struct Move a, struct Move b)
+{
+    return a.fromX == b.fromX && a.fromY == b.fromY && a.toX == b.toX && a.toY == b.toY;
+}
+
+static int is_capture(const Node *n, struct Move m)
+{
+    if (n->board[m.toX][m.toY].type != (enum PieceType)-1)
+        return 1;
+    return n->board[m.fromX][m.fromY].type == PAWN && m.fromX != m.toX;
+}
+
+static int is_promotion(const Node *n, struct Move m)
+{
+    return n->board[m.fromX][m.fromY].type == PAWN && (m.toY == 7 || m.toY == 0);
+}
+
+/* ── Move network near the root ──────────────────────────────────────────── */
+
+static NNOrderEntry *nn_order_slot(SearchThread *t, uint64_t key)
+{
+    return &t->nn_order[key & (uint64_t)(t->nn_order_size - 1)];
+}
+
+/* Run the move network over `count` positions, NN_ORDER_BATCH at a time,
+ * and cache each one's move ranking */
+static void nn_order_fill(SearchThread *t, Node nodes[], const uint64_t keys[], int count)
+{
+    const NeuralNet *net = t->limits.order_net;
+    float *in = malloc((size_t)NN_ORDER_BATCH * NN_INPUT_SIZE * sizeof(float));
+    float *out = malloc((size_t)NN_ORDER_BATCH * (size_t)net->output_size * sizeof(float));
+    if (!in || !out) {
+        free(in);
+        free(out);
+        return;   /* heuristics only */
+    }
+
+    for (int b = 0; b < count; b += NN_ORDER_BATCH) {
+        int size = (count - b < NN_ORDER_BATCH) ? count - b : NN_ORDER_BATCH;
+        for (int i = 0; i < size; i++)
+            nn_encode_board(nodes[b + i].board, in + (size_t)i * NN_INPUT_SIZE);
+        nn_forward_batch(net, in, out, size);
+
+        for (int i = 0; i < size; i++) {
+            Node *n = &nodes[b + i];
+            struct MoveList ml = node_moves(n);
+            float score[224];
+            nn_score_moves(net, out + (size_t)i * (size_t)net->output_size, n->board, &ml, score);
+
+            NNOrderEntry *e = nn_order_slot(t, keys[b + i]);
+            e->key = keys[b + i];
+            e->count = ml.count;
+            for (int m = 0; m < ml.count; m++) {
+                int rank = 0;
+                for (int k = 0; k < ml.count; k++)
+                    rank += score[k] > score[m] || (score[k] == score[m] && k < m);
+                e->move[m] = (uint16_t)nn_policy_index(ml.moves[m]);
+                e->rank[m] = (uint8_t)rank;
+            }
+        }
+    }
+    free(in);
+    free(out);
+}
+
+/* The ranking for a node about to be searched.  When its children will be
+ * ordered by the network too, the ones not yet cached go through it in the
+ * same batches, so a node costs one batched call instead of one per child. */
+static const NNOrderEntry *nn_order_prepare(SearchThread *t, const Node *n, uint64_t key,
+                                            const struct MoveList *ml, int depth, int ply)
+{
+    Node *batch = malloc((size_t)(ml->count + 1) * sizeof(Node));
+    uint64_t keys[225];
+    int count = 0;
+    if (!batch)
+        return NULL;
+
+    if (ply + 1 < t->limits.order_plies && depth > 1)
+        for (int i = 0; i < ml->count; i++) {
+            Node *child = &batch[count];
+            *child = *n;
+            node_play(child, ml->moves[i], -1);
+            uint64_t ck = node_hash(child);
+            if (nn_order_slot(t, ck)->key != ck)
+                keys[count++] = ck;
+        }
+    if (nn_order_slot(t, key)->key != key) {   /* last, so no child evicts it */
+        batch[count] = *n;
+        keys[count++] = key;
+    }
+    if (count)
+        nn_order_fill(t, batch, keys, count);
+    free(batch);
+
+    NNOrderEntry *e = nn_order_slot(t, key);
+    return (e->key == key) ? e : NULL;
+}
+
+/* Network rank of move i of the node's move list, -1 if not ranked */
+static int nn_order_rank(const NNOrderEntry *e, int i, struct Move m)
+{
+    uint16_t want = (uint16_t)nn_policy_index(m);
+    if (i < e->count && e->move[i] == want)
+        return e->rank[i];
+    for (int k = 0; k < e->count; k++)
+        if (e->move[k] == want)
+            return e->rank[k];
+    return -1;
+}
+
+/* With nn, the network's ranking orders the quiet moves ahead of killers
+ * and history; the TT move, captures and promotions still come first, since
+ * handing those to the network cost cutoffs.  scores[] must be filled before
+ * pick_move() reorders ml. */
+static void order_moves(const SearchThread *t, const Node *n, struct MoveList *ml,
+                        struct Move tt_move, int ply, const NNOrderEntry *nn, int scores[])
+{
+    for (int i = 0; i < ml->count; i++) {
+        struct Move m = ml->moves[i];
+        int s, rank;
+        if (same_move(m, tt_move)) {
+            s = 1000000;
+        } else if (is_capture(n, m)) {
+            enum PieceType victim = n->board[m.toX][m.toY].type;
+            int v = (victim == (enum PieceType)-1) ? piece_value[PAWN] : piece_value[victim];
+            s = 100000 + v * 10 - piece_value[n->board[m.fromX][m.fromY].type] / 10;
+        } else if (is_promotion(n, m)) {
+            s = 90000;
+        } else if (nn && (rank = nn_order_rank(nn, i, m)) >= 0) {
+            s = 85000 - rank;
+        } else if (ply < SEARCH_MAX_PLY && same_move(m, t->killers[ply][0])) {
+            s = 80000;
+        } else if (ply < SEARCH_MAX_PLY && same_move(m, t->killers[ply][1])) {
+            s = 79000;
+        } else {
+            s = t->history[n->side][m.fromX * 8 + m.fromY][m.toX * 8 + m.toY];
+        }
+        scores[i] = s;
+    }
+}
+
+/* Selection sort step: bring the best remaining move to index i */
+static void pick_move(struct MoveList *ml, int scores[], int i)
+{
+    int best = i;
+    for (int j = i + 1; j < ml->count; j++)
+        if (scores[j] > scores[best])
+            best = j;
+    if (best != i) {
+        struct Move tm = ml->moves[i]; ml->moves[i] = ml->moves[best]; ml->moves[best] = tm;
+        int ts = scores[i]; scores[i] = scores[best]; scores[best] = ts;
+    }
+}
+
+/* ════════════════════════════════════════════════════════════════════════════
+ * Search
+ * ════════════════════════════════════════════════════════════════════════════ */
+
+static int quiescence(SearchThread *t, Node *n, int alpha, int beta, int ply)
+{
+    if ((++t->nodes & (CHECK_EVERY - 1)) == 0)
+        check_limits(t);
+    if (should_stop(t))
+        return 0;
+
+    /* Mated or stalemated leaves must not stand pat; stops at the first
+     * legal move, so this costs far less than the generation below */
+    if (!hasLegalMove(n->board, n->side, &n->lastMove))
+        return isInCheck(n->board, n->side) ? -SEARCH_MATE + ply : 0;
+
+    int stand = evaluate(t, n);
+    if (stand >= beta || ply >= SEARCH_MAX_PLY - 1)
+        return stand;
+    if (stand > alpha)
+        alpha = stand;
+
+    struct MoveList ml = node_moves(n);
+    int scores[224];
+    int count = 0;
+    for (int i = 0; i < ml.count; i++)   /* keep captures and promotions */
+        if (is_capture(n, ml.moves[i]) || is_promotion(n, ml.moves[i]))
+            ml.moves[count++] = ml.moves[i];
+    ml.count = count;
+    order_moves(t, n, &ml, (struct Move){-1, -1, -1, -1}, SEARCH_MAX_PLY, NULL, scores);
+
+    for (int i = 0; i < ml.count; i++) {
+        pick_move(&ml, scores, i);
+        Node child = *n;
+        node_play(&child, ml.moves[i], -1);
+        int score = -quiescence(t, &child, -beta, -alpha, ply + 1);
+        if (should_stop(t))
+            return 0;
+        if (score >= beta) {
+            stats_inc(STAT_CUTOFFS);
+            return score;
+        }
+        if (score > alpha)
+            alpha = score;
+    }
+    return alpha;
+}
+
+static int negamax(SearchThread *t, Node *n, int depth, int alpha, int beta, int ply)
+{
+    t->pv_len[ply] = 0;
+    if (depth <= 0)
+        return quiescence(t, n, alpha, beta, ply);
+
+    if ((++t->nodes & (CHECK_EVERY - 1)) == 0)
+        check_limits(t);
+    if (should_stop(t))
+        return 0;
+
+    uint64_t key = node_hash(n);
+    if (ply > 0) {
+        if (n->halfmoveClock >= 100 || is_repetition(t, key, n->halfmoveClock))
+            return 0;
+        if (ply >= SEARCH_MAX_PLY - 1)
+            return evaluate(t, n);
+
+        /* Exact result from the bitbases; the evaluation on top keeps the
+         * strong side making progress towards mate */
+        int wdl;
+        if (n->pieces <= BITBASE_MAX_PIECES && bitbase_probe(n->board, n->side, &wdl))
+            return wdl ? wdl * SEARCH_KNOWN_WIN + node_evaluate(n) : 0;
+    }
+
+    struct Move tt_move = {-1, -1, -1, -1};
+    int tt_score, tt_depth, tt_flag;
+    int pv_node = (beta - alpha > 1);
+    if (tt_probe(t->tt, key, &tt_move, &tt_score, &tt_depth, &tt_flag) && !pv_node && tt_depth >= depth) {
+        tt_score = score_from_tt(tt_score, ply);
+        if (tt_flag == TT_EXACT ||
+            (tt_flag == TT_LOWER && tt_score >= beta) ||
+            (tt_flag == TT_UPPER && tt_score <= alpha))
+            return tt_score;
+    }
+
+    struct MoveList ml = node_moves(n);
+    if (ml.count == 0)
+        return isInCheck(n->board, n->side) ? -SEARCH_MATE + ply : 0;
+
+    const NNOrderEntry *nn = NULL;
+    if (t->nn_order && t->limits.order_net && ply < t->limits.order_plies)
+        nn = nn_order_prepare(t, n, key, &ml, depth, ply);
+
+    int scores[224];
+    order_moves(t, n, &ml, tt_move, ply, nn, scores);
+
+    int alpha_orig = alpha;
+    int best = -INF_SCORE;
+    struct Move best_move = {-1, -1, -1, -1};
+    t->keys[t->key_count++] = key;
+
+    for (int i = 0; i < ml.count; i++) {
+        pick_move(&ml, scores, i);
+        struct Move m = ml.moves[i];
+        Node child = *n;
+        node_play(&child, m, -1);
+
+        int score;
+        if (i == 0) {
+            score = -negamax(t, &child, depth - 1, -beta, -alpha, ply + 1);
+        } else {
+            /* PVS: prove the move is no better with a null window first */
+            score = -negamax(t, &child, depth - 1, -alpha - 1, -alpha, ply + 1);
+            if (score > alpha && score < beta)
+                score = -negamax(t, &child, depth - 1, -beta, -alpha, ply + 1);
+        }
+        if (should_stop(t)) {
+            t->key_count--;
+            return 0;
+        }
+
+        if (score > best) {
+            best = score;
+            best_move = m;
+            if (score > alpha) {
+                alpha = score;
+                t->pv[ply][0] = m;
+                int child_len = (ply + 1 < SEARCH_MAX_PLY) ? t->pv_len[ply + 1] : 0;
+                if (child_len > SEARCH_MAX_PLY - 1) child_len = SEARCH_MAX_PLY - 1;
+                memcpy(&t->pv[ply][1], t->pv[ply + 1], (size_t)child_len * sizeof(struct Move));
+                t->pv_len[ply] = child_len + 1;
+            }
+        }
+        if (alpha >= beta) {
+            stats_inc(STAT_CUTOFFS);
+            if (!is_capture(n, m)) {
+                if (!same_move(m, t->killers[ply][0])) {
+                    t->killers[ply][1] = t->killers[ply][0];
+                    t->killers[ply][0] = m;
+                }
+                int *h = &t->history[n->side][m.fromX * 8 + m.fromY][m.toX * 8 + m.toY];
+                *h += depth * depth;
+                if (*h > 70000) *h /= 2;
+            }
+            break;
+        }
+    }
+    t->key_count--;
+
+    int flag = (best >= beta) ? TT_LOWER : (best > alpha_orig ? TT_EXACT : TT_UPPER);
+    tt_store(t->tt, key, best_move, score_to_tt(best, ply), depth, flag);
+    return best;
+}
+
+/* Iterative deepening.  Thread 0 owns the result and reports progress;
+ * helpers (id > 0) start one ply deeper on odd ids to diversify the tree. */
+static void iterate(SearchThread *t, SearchInfoFn on_info, void *user)
+{
+    TRACE_SCOPE("search_iterate");
+    int max_depth = (t->limits.depth > 0) ? t->limits.depth : SEARCH_MAX_PLY - 1;
+    if (max_depth > SEARCH_MAX_PLY - 1) max_depth = SEARCH_MAX_PLY - 1;
+
+    /* Always have a legal move to play, even if stopped immediately */
+    struct MoveList root_moves = node_moves(&t->root);
+    if (root_moves.count > 0)
+        t->result.best = root_moves.moves[0];
+
+    int start = 1 + ((t->id > 0) ? (t->id & 1) : 0);
+    for (int d = start; d <= max_depth && root_moves.count > 0; d++) {
+        int score = negamax(t, &t->root, d, -INF_SCORE, INF_SCORE, 0);
+        if (should_stop(t))
+            break;
+
+        t->completed_depth = d;
+        if (t->id != 0)
+            continue;
+
+        SearchResult *r = &t->result;
+        r->score = score;
+        r->depth = d;
+        r->pv_len = t->pv_len[0];
+        memcpy(r->pv, t->pv[0], (size_t)r->pv_len * sizeof(struct Move));
+        if (r->pv_len > 0)
+            r->best = r->pv[0];
+        r->ponder = (r->pv_len > 1) ? r->pv[1] : (struct Move){-1, -1, -1, -1};
+        r->nodes = total_nodes(t);
+        r->time_ms = (int)elapsed_ms(t);
+        if (on_info)
+            on_info(r, user);
+
+        if (t->soft_ms > 0 && !is_pondering(t) && elapsed_ms(t) >= t->soft_ms)
+            break;
+        if (score > SEARCH_MATE_BOUND || score < -SEARCH_MATE_BOUND) {
+            if (!t->limits.infinite && d >= SEARCH_MATE - (score > 0 ? score : -score))
+                break;   /* mate found and fully resolved */
+        }
+    }
+
+    if (t->shared_nodes)
+        atomic_fetch_add_explicit(t->shared_nodes, t->nodes - t->nodes_flushed, memory_order_relaxed);
+    t->nodes_flushed = t->nodes;
+}
+
+/* ════════════════════════════════════════════════════════════════════════════
+ * Thread pool
+ * ════════════════════════════════════════════════════════════════════════════ */
+
+static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  pool_wake = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t  pool_done = PTHREAD_COND_INITIALIZER;
+static pthread_t       pool_threads[SEARCH_MAX_THREADS];
+static SearchThread   *pool_ctx[SEARCH_MAX_THREADS];
+static int             pool_size = 0;
+static int             pool_generation = 0;
+static int             pool_busy = 0;        /* threads still working on the job */
+static int             pool_running = 0;     /* a job is in flight */
+static int             pool_quit = 0;
+static int             hash_size_mb = 64;
+static int             initialised = 0;
+
+static atomic_int      pool_stop = 0;
+static atomic_int      pool_pondering = 0;
+static atomic_llong    pool_nodes = 0;
+
+static SearchPosition  job_pos;
+static SearchLimits    job_limits;
+static SearchInfoFn    job_info;
+static SearchDoneFn    job_done;
+static void           *job_user;
+
+static void *pool_worker(void *arg)
+{
+    SearchThread *t = arg;
+    int seen = 0;
+
+    for (;;) {
+        pthread_mutex_lock(&pool_mutex);
+        while (!pool_quit && pool_generation == seen)
+            pthread_cond_wait(&pool_wake, &pool_mutex);
+        if (pool_quit) {
+            pthread_mutex_unlock(&pool_mutex);
+            break;
+        }
+        seen = pool_generation;
+        pthread_mutex_unlock(&pool_mutex);
+
+        thread_prepare(t, &job_pos, &job_limits, &pool_stop, &pool_pondering, &pool_nodes);
+        iterate(t, t->id == 0 ? job_info : NULL, job_user);
+
+        if (t->id == 0) {
+            /* UCI: an infinite or ponder search must not report before
+             * `stop` (or, when pondering, before `ponderhit`) */
+            while ((job_limits.infinite || atomic_load(&pool_pondering)) && !atomic_load(&pool_stop)) {
+                struct timespec ms = {0, 1000000};
+                nanosleep(&ms, NULL);
+            }
+            atomic_store(&pool_stop, 1);
+
+            pthread_mutex_lock(&pool_mutex);
+            while (pool_busy > 1)
+                pthread_cond_wait(&pool_done, &pool_mutex);
+            pthread_mutex_unlock(&pool_mutex);
+
+            t->result.nodes = atomic_load(&pool_nodes);
+            t->result.time_ms = (int)elapsed_ms(t);
+            if (job_done)
+                job_done(&t->result, job_user);
+        }
+
+        pthread_mutex_lock(&pool_mutex);
+        pool_busy--;
+        if (t->id == 0)
+            pool_running = 0;
+        pthread_cond_broadcast(&pool_done);
+        pthread_mutex_unlock(&pool_mutex);
+    }
+    return NULL;
+}
+
+static void pool_resize(int threads)
+{
+    if (threads < 1) threads = 1;
+    if (threads > SEARCH_MAX_THREADS) threads = SEARCH_MAX_THREADS;
+
+    /* Tear down the old pool (idle by contract) */
+    pthread_mutex_lock(&pool_mutex);
+    pool_quit = 1;
+    pthread_cond_broadcast(&pool_wake);
+    pthread_mutex_unlock(&pool_mutex);
+    for (int i = 0; i < pool_size; i++) {
+        pthread_join(pool_threads[i], NULL);
+        thread_free(pool_ctx[i]);
+        pool_ctx[i] = NULL;
+    }
+
+    pthread_mutex_lock(&pool_mutex);
+    pool_quit = 0;
+    pool_generation = 0;
+    pool_size = 0;
+    pthread_mutex_unlock(&pool_mutex);
+
+    for (int i = 0; i < threads; i++) {
+        pool_ctx[i] = calloc(1, sizeof(SearchThread));
+        if (!pool_ctx[i]) {
+            fprintf(stderr, "search: out of memory for thread %d\n", i);
+            break;
+        }
+        pool_ctx[i]->id = i;
+        if (pthread_create(&pool_threads[i], NULL, pool_worker, pool_ctx[i]) != 0) {
+            fprintf(stderr, "search: failed to create thread %d\n", i);
+            free(pool_ctx[i]);
+            pool_ctx[i] = NULL;
+            break;
+        }
+        pool_size++;
+    }
+    if (pool_size == 0) {
+        fprintf(stderr, "search: no search threads available\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+void search_init(int threads, int hash_mb)
+{
+    zobrist_init();
+    if (initialised)
+        return;
+    hash_size_mb = hash_mb;
+    tt_allocate(&shared_tt, hash_mb);
+    pool_resize(threads);
+    initialised = 1;
+}
+
+static void ensure_init(void)
+{
+    if (!initialised)
+        search_init(1, hash_size_mb);
+}
+
+void search_set_threads(int threads)
+{
+    ensure_init();
+    search_wait();
+    if (threads != pool_size)
+        pool_resize(threads);
+}
+
+void search_set_hash(int hash_mb)
+{
+    ensure_init();
+    search_wait();
+    if (hash_mb != hash_size_mb) {
+        hash_size_mb = hash_mb;
+        tt_allocate(&shared_tt, hash_mb);
+    }
+}
+
+void search_clear(void)
+{
+    ensure_init();
+    search_wait();
+    memset(shared_tt.slots, 0, (shared_tt.mask + 1) * sizeof(TTSlot));
+    for (int i = 0; i < pool_size; i++) {
+        memset(pool_ctx[i]->history, 0, sizeof(pool_ctx[i]->history));
+        pool_ctx[i]->eval_cache_net = NULL;   /* weights may have been reloaded */
+    }
+}
+
+void search_shutdown(void)
+{
+    if (!initialised)
+        return;
+    search_stop();
+    search_wait();
+    pthread_mutex_lock(&pool_mutex);
+    pool_quit = 1;
+    pthread_cond_broadcast(&pool_wake);
+    pthread_mutex_unlock(&pool_mutex);
+    for (int i = 0; i < pool_size; i++) {
+        pthread_join(pool_threads[i], NULL);
+        thread_free(pool_ctx[i]);
+        pool_ctx[i] = NULL;
+    }
+    pool_size = 0;
+    free(shared_tt.slots);
+    shared_tt.slots = NULL;
+    initialised = 0;
+}
+
+void search_start(const SearchPosition *pos, const SearchLimits *limits,
+                  SearchInfoFn on_info, SearchDoneFn on_done, void *user)
+{
+    ensure_init();
+    search_wait();
+
+    job_pos = *pos;
+    job_limits = *limits;
+    job_info = on_info;
+    job_done = on_done;
+    job_user = user;
+    atomic_store(&pool_stop, 0);
+    atomic_store(&pool_pondering, limits->ponder);
+    atomic_store(&pool_nodes, 0);
+    atomic_fetch_add(&shared_tt.generation, 1);
+
+    pthread_mutex_lock(&pool_mutex);
+    pool_busy = pool_size;
+    pool_running = 1;
+    pool_generation++;
+    pthread_cond_broadcast(&pool_wake);
+    pthread_mutex_unlock(&pool_mutex);
+}
+
+void search_stop(void)
+{
+    atomic_store(&pool_stop, 1);
+}
+
+void search_ponderhit(void)
+{
+    atomic_store(&pool_pondering, 0);
+}
+
+void search_wait(void)
+{
+    pthread_mutex_lock(&pool_mutex);
+    while (pool_running || pool_busy > 0)
+        pthread_cond_wait(&pool_done, &pool_mutex);
+    pthread_mutex_unlock(&pool_mutex);
+}
+
+int search_is_running(void)
+{
+    pthread_mutex_lock(&pool_mutex);
+    int running = pool_running;
+    pthread_mutex_unlock(&pool_mutex);
+    return running;
+}
+
+SearchResult search_position(const SearchPosition *pos, const SearchLimits *limits, atomic_int *stop)
+{
+    ensure_init();
+
+    atomic_int local_stop = 0;
+    SearchThread *t = calloc(1, sizeof(SearchThread));
+    if (!t) {
+        SearchResult none = {0};
+        none.best = none.ponder = (struct Move){-1, -1, -1, -1};
+        return none;
+    }
+
+    t->id = 0;
+    thread_prepare(t, pos, limits, stop ? stop : &local_stop, NULL, NULL);
+    iterate(t, NULL, NULL);
+
+    SearchResult r = t->result;
+    r.nodes = t->nodes;
+    r.time_ms = (int)elapsed_ms(t);
+    thread_free(t);
+    return r;
+}
@@ -0,0 +1,114 @@
+/* search.h - Alpha-beta search engine with a persistent thread pool
+ *
+ * Iterative-deepening PVS with quiescence, a shared lock-free transposition
+ * table and Lazy SMP helpers.  The thread pool and TT live for the whole
+ * process so consecutive searches (UCI `go` after `go`) start warm.
+ *
+ * Two entry points:
+ *   search_start()/search_wait()  asynchronous search on the shared pool,
+ *                                  stoppable with search_stop() (UCI).
+ *   search_position()             synchronous single-threaded search on the
+ *                                  caller's thread, for batch workers.
+ */
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include "chess.h"
+
+struct ValueNet;
+struct NeuralNet;
+typedef struct SearchTable SearchTable;
+
+#define SEARCH_MAX_PLY      64
+#define SEARCH_MAX_THREADS  64
+#define SEARCH_HISTORY_MAX  512
+#define SEARCH_MATE         30000
+#define SEARCH_MATE_BOUND   (SEARCH_MATE - SEARCH_MAX_PLY)
+#define SEARCH_KNOWN_WIN    20000   /* bitbase win, below every mate score */
+
+/* A searchable position: board, side to move, en passant context and the
+ * hash keys of earlier positions for repetition detection. */
+typedef struct {
+    struct Piece board[8][8];
+    enum Colour  side;
+    struct Move  lastMove;
+    int          halfmoveClock;
+    uint64_t     history[SEARCH_HISTORY_MAX];
+    int          historyCount;
+} SearchPosition;
+
+typedef struct {
+    int       depth;        /* max depth, 0 = no limit                     */
+    long long nodes;        /* node budget, 0 = no limit                   */
+    int       movetime_ms;  /* fixed time per move, 0 = not set            */
+    int       wtime, btime, winc, binc, movestogo;  /* clock, ms           */
+    int       infinite;     /* search until search_stop()                  */
+    int       ponder;       /* no time/node limits until search_ponderhit() */
+    const struct ValueNet *value_net;  /* leaf evaluator (value.h), NULL = hand-crafted */
+    const struct NeuralNet *order_net; /* move-ordering network (nn.h), NULL = heuristics */
+    int       order_plies;  /* plies from the root ordered by order_net     */
+    SearchTable *table;     /* TT for search_position(), NULL = the shared one */
+} SearchLimits;
+
+typedef struct {
+    struct Move best;
+    struct Move ponder;     /* expected reply, fromX = -1 if unknown       */
+    int         score;      /* centipawns from the side to move            */
+    int         depth;      /* last completed iteration                    */
+    long long   nodes;
+    int         time_ms;
+    struct Move pv[SEARCH_MAX_PLY];
+    int         pv_len;
+} SearchResult;
+
+/* Called by the main search thread after each completed iteration. */
+typedef void (*SearchInfoFn)(const SearchResult *progress, void *user);
+/* Called once when an asynchronous search finishes. */
+typedef void (*SearchDoneFn)(const SearchResult *result, void *user);
+
+/* ── Positions ───────────────────────────────────────────────────────────── */
+void     search_position_startpos(SearchPosition *pos);
+int      search_position_from_fen(SearchPosition *pos, const char *fen);
+void     search_position_from_board(SearchPosition *pos, struct Piece board[8][8],
+                                    enum Colour side, const struct Move *last);
+/* Play a UCI move ("e2e4", "e7e8n") if legal.  Returns 1 on success. */
+int      search_position_play_uci(SearchPosition *pos, const char *uci);
+void     search_position_play(SearchPosition *pos, struct Move m, int promotion);
+uint64_t search_position_hash(const SearchPosition *pos);
+/* Format m as UCI; promotions get a 'q' suffix (the generator's choice). */
+void     search_move_to_uci(const SearchPosition *pos, struct Move m, char out[8]);
+
+/* ── Engine lifecycle / configuration (call while idle) ─────────────────── */
+void search_init(int threads, int hash_mb);
+void search_set_threads(int threads);
+void search_set_hash(int hash_mb);
+void search_clear(void);        /* new game: wipe TT and move-ordering tables */
+void search_shutdown(void);
+int  search_hashfull(void);     /* permille of TT slots in use (sampled)      */
+
+/* ── Asynchronous search on the pool ────────────────────────────────────── */
+void search_start(const SearchPosition *pos, const SearchLimits *limits,
+                  SearchInfoFn on_info, SearchDoneFn on_done, void *user);
+void search_stop(void);
+/* The opponent played the pondered move: apply the normal limits, counted
+ * from when the ponder search started. */
+void search_ponderhit(void);
+void search_wait(void);
+int  search_is_running(void);
+
+/* ── Private transposition tables ──────────────────────────────────────── */
+/* For callers whose searches must not see each other's entries, e.g. two
+ * differently configured engines in one match; set SearchLimits.table. */
+SearchTable *search_table_new(int hash_mb);
+void         search_table_free(SearchTable *table);
+
+/* ── Synchronous single-threaded search (shares the TT by default) ──────── */
+SearchResult search_position(const SearchPosition *pos, const SearchLimits *limits,
+                             atomic_int *stop);
+
+/* Static evaluation in centipawns from the side to move's point of view. */
+int search_evaluate(const SearchPosition *pos);
+
+#endif /* SEARCH_H */
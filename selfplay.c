@@ -0,0 +1,240 @@
+// selfplay.c - Parallel engine-vs-engine game generator
+//
+// Each worker thread plays whole games with play_game() on its own
+// position and RNG, pulling game numbers from a shared counter, so any
+// number of games run side by side on the shared TT.  Finished games are
+// appended to a PGN file and their engine-chosen positions (the random
+// opening is skipped) to a binary training dataset, both as soon as each
+// game ends, so an interrupted run keeps everything it finished.
+//
+//   ./selfplay [--games N] [--threads N] [--engine search|nn|mcts] [--depth D]
+//              [--nodes N] [--visits N] [--movetime MS] [--random-plies N]
+//              [--hash MB] [--weights FILE] [--value FILE] [--pgn FILE]
+//              [--dataset FILE] [--no-adjudicate]
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include "chess.h"
+#include "bitbase.h"
+#include "nn.h"
+#include "search.h"
+#include "value.h"
+#include "dataset.h"
+#include "play.h"
+
+// Globals required by other modules
+struct Piece board[8][8];
+int depth = 4;
+
+typedef struct {
+    long games;
+    int  threads;
+    int  hash_mb;
+    const char *weights;
+    const char *value_path;
+    const char *pgn_path;
+    const char *dataset_path;
+    PlayConfig   player;
+    PlayOptions  options;
+} SelfplayConfig;
+
+static SelfplayConfig cfg;
+static ValueNet value_net;
+static atomic_long next_game;
+
+static pthread_mutex_t out_mutex = PTHREAD_MUTEX_INITIALIZER;
+static FILE *pgn_out;
+static DatasetWriter dataset_out;
+static int dataset_open;
+static long finished, white_wins, draws, black_wins;
+static long long total_plies, total_records, total_nodes;
+static struct timespec started;
+
+static double elapsed_seconds(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - started.tv_sec) + (double)(now.tv_nsec - started.tv_nsec) / 1e9;
+}
+
+static void *worker_main(void *arg)
+{
+    uint64_t rng = 0x9E3779B97F4A7C15ULL ^ ((uint64_t)(uintptr_t)arg * 0xBF58476D1CE4E5B9ULL) ^
+                   (uint64_t)time(NULL);
+    PlayedGame *g = malloc(sizeof(PlayedGame));
+    DatasetRecord *records = malloc(PLAY_MAX_PLIES * sizeof(DatasetRecord));
+    if (!g || !records) {
+        fprintf(stderr, "selfplay: out of memory\n");
+        free(g);
+        free(records);
+        return NULL;
+    }
+    play_random(&rng);
+
+    long round;
+    while ((round = atomic_fetch_add(&next_game, 1)) < cfg.games) {
+        play_game(&cfg.player, &cfg.player, &cfg.options, &rng, g);
+        int n = dataset_open ? play_game_records(g, records) : 0;
+
+        pthread_mutex_lock(&out_mutex);
+        if (pgn_out) {
+            play_write_pgn(pgn_out, g, "Sacrifice self-play", round + 1, cfg.player.name, cfg.player.name);
+            fflush(pgn_out);
+        }
+        if (n && dataset_write(&dataset_out, records, (size_t)n) && dataset_writer_sync(&dataset_out))
+            total_records += n;
+        finished++;
+        if (g->result > 0) white_wins++;
+        else if (g->result < 0) black_wins++;
+        else draws++;
+        total_plies += g->count;
+        total_nodes += g->nodes;
+        double secs = elapsed_seconds();
+        fprintf(stderr, "\rselfplay: %ld/%ld games  +%ld =%ld -%ld  %.0f games/h   ",
+                finished, cfg.games, white_wins, draws, black_wins,
+                secs > 0 ? (double)finished * 3600.0 / secs : 0.0);
+        pthread_mutex_unlock(&out_mutex);
+    }
+    free(g);
+    free(records);
+    return NULL;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s [--games N] [--threads N] [--engine search|nn|mcts] [--depth D]\n"
+            "          [--nodes N] [--visits N] [--movetime MS] [--random-plies N]\n"
+            "          [--hash MB] [--weights FILE] [--value FILE] [--pgn FILE]\n"
+            "          [--dataset FILE] [--no-adjudicate]\n"
+            "Plays the engine against itself, appending the games to selfplay.pgn and\n"
+            "their positions to selfplay.sds.  Default: 100 games, search\n"
+            "with 20000 nodes per move, 8 random opening plies, one thread per core.\n"
+            "MCTS runs --visits playouts per move (default 800) with priors from\n"
+            "--weights (uniform if missing) and leaf values from --value.\n"
+            "--value makes the search evaluate leaves with that value network.\n"
+            "Pass an empty string to --pgn or --dataset to skip that output.\n",
+            prog);
+}
+
+int main(int argc, char *argv[])
+{
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    cfg.games = 100;
+    cfg.threads = cores > 0 ? (int)cores : 1;
+    cfg.hash_mb = 64;
+    cfg.weights = "nn_weights.bin";
+    cfg.pgn_path = "selfplay.pgn";
+    cfg.dataset_path = "selfplay.sds";
+    cfg.options.random_plies = 8;
+    cfg.options.adjudicate = 1;
+
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        const char *v = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (strcmp(a, "--games") == 0 && v) {
+            cfg.games = atol(v); i++;
+        } else if (strcmp(a, "--threads") == 0 && v) {
+            cfg.threads = atoi(v); i++;
+        } else if (strcmp(a, "--engine") == 0 && v) {
+            if (strcmp(v, "nn") == 0) cfg.player.use_nn = 1;
+            else if (strcmp(v, "mcts") == 0) cfg.player.use_mcts = 1;
+            else if (strcmp(v, "search") != 0) { usage(argv[0]); return 1; }
+            i++;
+        } else if (strcmp(a, "--depth") == 0 && v) {
+            cfg.player.limits.depth = atoi(v); i++;
+        } else if (strcmp(a, "--nodes") == 0 && v) {
+            cfg.player.limits.nodes = atoll(v); i++;
+        } else if (strcmp(a, "--visits") == 0 && v) {
+            cfg.player.mcts.visits = atoll(v); i++;
+        } else if (strcmp(a, "--movetime") == 0 && v) {
+            cfg.player.limits.movetime_ms = cfg.player.mcts.movetime_ms = atoi(v); i++;
+        } else if (strcmp(a, "--random-plies") == 0 && v) {
+            cfg.options.random_plies = atoi(v); i++;
+        } else if (strcmp(a, "--hash") == 0 && v) {
+            cfg.hash_mb = atoi(v); i++;
+        } else if (strcmp(a, "--weights") == 0 && v) {
+            cfg.weights = v; i++;
+        } else if (strcmp(a, "--value") == 0 && v) {
+            cfg.value_path = v; i++;
+        } else if (strcmp(a, "--pgn") == 0 && v) {
+            cfg.pgn_path = v; i++;
+        } else if (strcmp(a, "--dataset") == 0 && v) {
+            cfg.dataset_path = v; i++;
+        } else if (strcmp(a, "--no-adjudicate") == 0) {
+            cfg.options.adjudicate = 0;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (cfg.threads < 1) cfg.threads = 1;
+    if (cfg.threads > SEARCH_MAX_THREADS) cfg.threads = SEARCH_MAX_THREADS;
+    if (!cfg.player.limits.depth && !cfg.player.limits.movetime_ms && !cfg.player.limits.nodes)
+        cfg.player.limits.nodes = 20000;
+    cfg.player.name = cfg.player.use_nn ? "Sacrifice NN" : cfg.player.use_mcts ? "Sacrifice MCTS" :
+                      cfg.value_path ? "Sacrifice value" : "Sacrifice";
+    if (cfg.value_path) {
+        if (!value_load(&value_net, cfg.value_path))
+            return 1;
+        cfg.player.limits.value_net = cfg.player.mcts.value = &value_net;
+    }
+
+    suppress_engine_output = 1;
+    bitbase_init(NULL);
+    if (cfg.player.use_nn) {
+        if (!nn_load(&g_net, cfg.weights)) {
+            fprintf(stderr, "selfplay: cannot load %s\n", cfg.weights);
+            return 1;
+        }
+        cfg.player.net = &g_net;
+    } else if (cfg.player.use_mcts) {
+        if (nn_load(&g_net, cfg.weights))
+            cfg.player.mcts.policy = &g_net;
+    } else {
+        search_init(1, cfg.hash_mb);   // workers search synchronously on the shared TT
+    }
+
+    if (*cfg.pgn_path) {
+        pgn_out = fopen(cfg.pgn_path, "a");
+        if (!pgn_out) {
+            fprintf(stderr, "selfplay: cannot open %s for writing\n", cfg.pgn_path);
+            return 1;
+        }
+    }
+    if (*cfg.dataset_path) {
+        if (!dataset_writer_open(&dataset_out, cfg.dataset_path))
+            return 1;
+        dataset_open = 1;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &started);
+    pthread_t workers[SEARCH_MAX_THREADS];
+    for (int i = 0; i < cfg.threads; i++)
+        pthread_create(&workers[i], NULL, worker_main, (void *)(uintptr_t)(i + 1));
+    for (int i = 0; i < cfg.threads; i++)
+        pthread_join(workers[i], NULL);
+
+    double secs = elapsed_seconds();
+    fprintf(stderr, "\nselfplay: %ld games in %.1f s (%.0f games/h, %d threads), "
+                    "+%ld =%ld -%ld, %.1f plies/game, %lld positions, %.0f nodes/s\n",
+            finished, secs, secs > 0 ? (double)finished * 3600.0 / secs : 0.0, cfg.threads,
+            white_wins, draws, black_wins, finished ? (double)total_plies / (double)finished : 0.0,
+            total_records, secs > 0 ? (double)total_nodes / secs : 0.0);
+
+    int ok = 1;
+    if (pgn_out && fclose(pgn_out) != 0)
+        ok = 0;
+    if (dataset_open && !dataset_writer_close(&dataset_out))
+        ok = 0;
+    if (cfg.player.use_nn || cfg.player.use_mcts)
+        nn_free(&g_net);
+    else
+        search_shutdown();
+    return ok ? 0 : 1;
+}
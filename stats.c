@@ -0,0 +1,122 @@
+/* stats.c - Per-thread hot-path counters (see stats.h) */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#include "stats.h"
+
+#define STATS_MAX_SLOTS 512
+#define STATS_CACHE_LINE 64
+
+/* One slot per live thread.  Only the owning thread writes its counters, so
+ * relaxed load + store is enough; readers may see a slightly stale value. */
+typedef struct {
+    _Alignas(STATS_CACHE_LINE) _Atomic uint64_t counters[STAT_COUNT];
+    atomic_int in_use;
+} StatsSlot;
+
+static StatsSlot slots[STATS_MAX_SLOTS];
+
+/* Shared fallback once every slot is owned; updated with atomic adds. */
+static StatsSlot overflow_slot;
+
+static __thread StatsSlot *tls_slot = NULL;
+static pthread_key_t  slot_key;
+static pthread_once_t slot_key_once = PTHREAD_ONCE_INIT;
+
+static const char *counter_names[STAT_COUNT] = {
+    "movegen_calls",
+    "moves_generated",
+    "nn_forwards",
+    "nn_train_steps",
+    "value_evals",
+    "eval_cache_hits",
+    "tt_probes",
+    "tt_hits",
+    "tt_stores",
+    "cutoffs",
+    "puzzles_loaded",
+    "puzzle_ai_moves",
+    "puzzles_passed",
+    "puzzles_failed",
+};
+
+/* Thread exit: hand the slot back.  Its counts stay in place and the next
+ * owner keeps adding to them, so snapshots never lose work. */
+static void release_slot(void *p)
+{
+    StatsSlot *slot = p;
+    atomic_store_explicit(&slot->in_use, 0, memory_order_release);
+}
+
+static void make_slot_key(void)
+{
+    pthread_key_create(&slot_key, release_slot);
+}
+
+static StatsSlot *claim_slot(void)
+{
+    pthread_once(&slot_key_once, make_slot_key);
+
+    for (int i = 0; i < STATS_MAX_SLOTS; i++) {
+        int expected = 0;
+        if (atomic_compare_exchange_strong(&slots[i].in_use, &expected, 1)) {
+            pthread_setspecific(slot_key, &slots[i]);
+            return &slots[i];
+        }
+    }
+    return &overflow_slot;
+}
+
+void stats_add(enum StatCounter c, uint64_t n)
+{
+    StatsSlot *slot = tls_slot;
+    if (!slot)
+        slot = tls_slot = claim_slot();
+
+    if (slot == &overflow_slot) {
+        atomic_fetch_add_explicit(&slot->counters[c], n, memory_order_relaxed);
+        return;
+    }
+
+    uint64_t v = atomic_load_explicit(&slot->counters[c], memory_order_relaxed);
+    atomic_store_explicit(&slot->counters[c], v + n, memory_order_relaxed);
+}
+
+void stats_snapshot(StatsSnapshot *out)
+{
+    memset(out, 0, sizeof(*out));
+    for (int i = 0; i < STATS_MAX_SLOTS; i++) {
+        if (atomic_load_explicit(&slots[i].in_use, memory_order_acquire))
+            out->threads++;
+        for (int c = 0; c < STAT_COUNT; c++)
+            out->counters[c] += atomic_load_explicit(&slots[i].counters[c], memory_order_relaxed);
+    }
+    for (int c = 0; c < STAT_COUNT; c++)
+        out->counters[c] += atomic_load_explicit(&overflow_slot.counters[c], memory_order_relaxed);
+}
+
+void stats_reset(void)
+{
+    for (int i = 0; i < STATS_MAX_SLOTS; i++)
+        for (int c = 0; c < STAT_COUNT; c++)
+            atomic_store_explicit(&slots[i].counters[c], 0, memory_order_relaxed);
+    for (int c = 0; c < STAT_COUNT; c++)
+        atomic_store_explicit(&overflow_slot.counters[c], 0, memory_order_relaxed);
+}
+
+const char *stats_name(enum StatCounter c)
+{
+    return (c >= 0 && c < STAT_COUNT) ? counter_names[c] : "unknown";
+}
+
+void stats_write_json(FILE *out, const StatsSnapshot *snap)
+{
+    fprintf(out, "{");
+    for (int c = 0; c < STAT_COUNT; c++)
+        fprintf(out, "%s\"%s\": %llu", c ? ", " : "", counter_names[c],
+                (unsigned long long)snap->counters[c]);
+    fprintf(out, "}");
+}
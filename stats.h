@@ -0,0 +1,57 @@
+/* stats.h - Per-thread hot-path counters with an aggregated snapshot
+ *
+ * Each thread that bumps a counter claims its own cache-line-aligned slot on
+ * first use, so increments are a plain load/add/store on a line no other
+ * thread writes.  stats_snapshot() sums every slot for reporting (TUI stats
+ * panel, bench JSON).  Slots are recycled when their thread exits; totals
+ * keep accumulating, so all counters are monotonic for the process lifetime
+ * unless stats_reset() is called.
+ */
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+enum StatCounter {
+    STAT_MOVEGEN_CALLS,      /* validMoves() invocations                  */
+    STAT_MOVES_GENERATED,    /* legal moves returned by validMoves()      */
+    STAT_NN_FORWARDS,        /* positions run through the network         */
+    STAT_NN_TRAIN_STEPS,     /* nn_train_step() calls                     */
+    STAT_VALUE_EVALS,        /* value network leaf evaluations            */
+    STAT_EVAL_CACHE_HITS,    /* search leaf evaluations served from cache */
+    STAT_TT_PROBES,          /* transposition table lookups               */
+    STAT_TT_HITS,            /* lookups that returned a usable entry      */
+    STAT_TT_STORES,          /* entries written                           */
+    STAT_CUTOFFS,            /* alpha-beta / futility cutoffs             */
+    STAT_PUZZLES_LOADED,     /* puzzle rows read and parsed               */
+    STAT_PUZZLE_AI_MOVES,    /* engine decisions made inside puzzles      */
+    STAT_PUZZLES_PASSED,
+    STAT_PUZZLES_FAILED,
+    STAT_COUNT
+};
+
+typedef struct {
+    uint64_t counters[STAT_COUNT];
+    int      threads;        /* slots currently owned by a live thread */
+} StatsSnapshot;
+
+/* Add n to a counter for the calling thread. */
+void stats_add(enum StatCounter c, uint64_t n);
+
+static inline void stats_inc(enum StatCounter c) { stats_add(c, 1); }
+
+/* Sum all per-thread slots.  Safe to call from any thread at any time;
+ * values are a consistent-enough view for reporting, not a barrier. */
+void stats_snapshot(StatsSnapshot *out);
+
+/* Zero every slot.  Call between runs when no worker threads are active. */
+void stats_reset(void);
+
+/* Human-readable counter name ("movegen_calls", ...) used in reports. */
+const char *stats_name(enum StatCounter c);
+
+/* Write the snapshot as a flat JSON object: {"movegen_calls": N, ...} */
+void stats_write_json(FILE *out, const StatsSnapshot *snap);
+
+#endif /* STATS_H */
@@ -2,6 +2,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "chess.h"
+#include "trace.h"
 
 // Global required by other modules
 struct Piece board[8][8];
@@ -41,6 +42,11 @@ int main(int argc, char *argv[])
     printf("Passed: %d\n", passes);
     printf("Failed: %d\n", num_puzzles - passes);
     printf("Success rate: %.2f%%\n", (100.0 * passes) / num_puzzles);
+    print_puzzle_latency_report();
+
+    // Per-thread timelines when built with make TRACE=1
+    if (trace_enabled() && trace_export_chrome("trace.json"))
+        printf("Trace written to trace.json\n");
     
     return 0;
 }
@@ -0,0 +1,192 @@
+/* trace.c - Per-thread span ring buffers and Chrome trace export (see trace.h) */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include "trace.h"
+
+#ifdef SACRIFICE_TRACE
+
+#define TRACE_MAX_BUFFERS   256
+#define TRACE_RING_EVENTS   (1 << 16)   /* per buffer, ~2 MB */
+
+typedef struct {
+    const char *name;
+    uint64_t    start_ns;
+    uint64_t    dur_ns;
+    uint32_t    tid;
+} TraceEvent;
+
+/* Buffers are recycled when their thread exits, so a long training session
+ * that spawns fresh workers every iteration reuses a bounded pool.  Each
+ * event carries its own tid, so recycled buffers still export correctly. */
+typedef struct {
+    TraceEvent *events;
+    uint64_t    written;   /* total events ever written (ring index = written % size) */
+    atomic_int  in_use;
+} TraceBuffer;
+
+static TraceBuffer buffers[TRACE_MAX_BUFFERS];
+static atomic_int  buffers_dropped = 0;
+
+static __thread TraceBuffer *tls_buffer = NULL;
+static __thread uint32_t     tls_tid = 0;
+static __thread int          tls_claim_failed = 0;   /* drop this thread's spans */
+static pthread_key_t  buffer_key;
+static pthread_once_t buffer_key_once = PTHREAD_ONCE_INIT;
+
+static uint64_t now_ns(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec * 1000000000ULL + (uint64_t)t.tv_nsec;
+}
+
+static void release_buffer(void *p)
+{
+    TraceBuffer *buf = p;
+    atomic_store_explicit(&buf->in_use, 0, memory_order_release);
+}
+
+static void make_buffer_key(void)
+{
+    pthread_key_create(&buffer_key, release_buffer);
+}
+
+static TraceBuffer *claim_buffer(void)
+{
+    pthread_once(&buffer_key_once, make_buffer_key);
+
+    for (int i = 0; i < TRACE_MAX_BUFFERS; i++) {
+        int expected = 0;
+        if (!atomic_compare_exchange_strong(&buffers[i].in_use, &expected, 1))
+            continue;
+        if (!buffers[i].events) {
+            buffers[i].events = calloc(TRACE_RING_EVENTS, sizeof(TraceEvent));
+            if (!buffers[i].events) {
+                atomic_store(&buffers[i].in_use, 0);
+                return NULL;
+            }
+        }
+        pthread_setspecific(buffer_key, &buffers[i]);
+        return &buffers[i];
+    }
+    return NULL;
+}
+
+TraceSpan trace_span_begin(const char *name)
+{
+    TraceSpan span = {name, now_ns()};
+    return span;
+}
+
+void trace_span_end(TraceSpan *span)
+{
+    uint64_t end = now_ns();
+
+    TraceBuffer *buf = tls_buffer;
+    if (!buf) {
+        if (tls_claim_failed)
+            return;
+        buf = tls_buffer = claim_buffer();
+        tls_tid = (uint32_t)syscall(SYS_gettid);
+        if (!buf) {
+            /* Scan and count once per thread, not once per span */
+            tls_claim_failed = 1;
+            atomic_fetch_add(&buffers_dropped, 1);
+            return;
+        }
+    }
+
+    TraceEvent *ev = &buf->events[buf->written % TRACE_RING_EVENTS];
+    ev->name = span->name;
+    ev->start_ns = span->start_ns;
+    ev->dur_ns = end - span->start_ns;
+    ev->tid = tls_tid;
+    buf->written++;
+}
+
+int trace_enabled(void)
+{
+    return 1;
+}
+
+/* Export while workers are idle (after a run); live buffers are read
+ * without synchronisation. */
+int trace_export_chrome(const char *filepath)
+{
+    FILE *f = fopen(filepath, "w");
+    if (!f) {
+        fprintf(stderr, "trace: cannot open %s for writing\n", filepath);
+        return 0;
+    }
+
+    /* Timestamps are relative to the earliest recorded span */
+    uint64_t epoch = UINT64_MAX;
+    for (int i = 0; i < TRACE_MAX_BUFFERS; i++) {
+        TraceBuffer *buf = &buffers[i];
+        if (!buf->events) continue;
+        uint64_t n = buf->written < TRACE_RING_EVENTS ? buf->written : TRACE_RING_EVENTS;
+        for (uint64_t k = 0; k < n; k++)
+            if (buf->events[k].start_ns < epoch)
+                epoch = buf->events[k].start_ns;
+    }
+    if (epoch == UINT64_MAX)
+        epoch = 0;
+
+    fprintf(f, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    int first = 1;
+    for (int i = 0; i < TRACE_MAX_BUFFERS; i++) {
+        TraceBuffer *buf = &buffers[i];
+        if (!buf->events) continue;
+        uint64_t n = buf->written < TRACE_RING_EVENTS ? buf->written : TRACE_RING_EVENTS;
+        for (uint64_t k = 0; k < n; k++) {
+            const TraceEvent *ev = &buf->events[k];
+            fprintf(f, "%s{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %u, "
+                       "\"ts\": %.3f, \"dur\": %.3f}",
+                    first ? "" : ",\n", ev->name, ev->tid,
+                    (double)(ev->start_ns - epoch) / 1000.0, (double)ev->dur_ns / 1000.0);
+            first = 0;
+        }
+    }
+    fprintf(f, "\n]}\n");
+    fclose(f);
+
+    int dropped = atomic_load(&buffers_dropped);
+    if (dropped)
+        fprintf(stderr, "trace: %d thread(s) found no free buffer and were not traced\n", dropped);
+    return 1;
+}
+
+#else /* !SACRIFICE_TRACE */
+
+TraceSpan trace_span_begin(const char *name)
+{
+    TraceSpan span = {name, 0};
+    return span;
+}
+
+void trace_span_end(TraceSpan *span)
+{
+    (void)span;
+}
+
+int trace_enabled(void)
+{
+    return 0;
+}
+
+int trace_export_chrome(const char *filepath)
+{
+    (void)filepath;
+    fprintf(stderr, "trace: tracing not compiled in (rebuild with make TRACE=1)\n");
+    return 0;
+}
+
+#endif /* SACRIFICE_TRACE */
@@ -0,0 +1,53 @@
+/* trace.h - Scoped timing spans with Chrome trace-event export
+ *
+ * Compiled out unless the build defines SACRIFICE_TRACE (make TRACE=1); the
+ * macros then expand to nothing and cost nothing.  When enabled, each thread
+ * appends completed spans to its own ring buffer (oldest spans are
+ * overwritten once it fills), and trace_export_chrome() writes every buffer
+ * as Chrome/Perfetto trace JSON — open it in chrome://tracing or
+ * ui.perfetto.dev to see per-thread timelines.
+ *
+ *   void f(void) {
+ *       TRACE_SCOPE("f");                 // ends when f returns
+ *       TRACE_BEGIN(load, "load");
+ *       ...
+ *       TRACE_END(load);
+ *   }
+ *
+ * Span names must be string literals (only the pointer is stored).
+ */
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+typedef struct {
+    const char *name;
+    uint64_t    start_ns;
+} TraceSpan;
+
+TraceSpan trace_span_begin(const char *name);
+void      trace_span_end(TraceSpan *span);
+
+/* Write all recorded spans as Chrome trace-event JSON.
+ * Returns 1 on success, 0 on failure or when tracing is compiled out. */
+int trace_export_chrome(const char *filepath);
+
+/* 1 when built with SACRIFICE_TRACE */
+int trace_enabled(void);
+
+#ifdef SACRIFICE_TRACE
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b)  TRACE_CONCAT_(a, b)
+#define TRACE_BEGIN(var, name) TraceSpan var = trace_span_begin(name)
+#define TRACE_END(var)         trace_span_end(&(var))
+#define TRACE_SCOPE(name) \
+    TraceSpan TRACE_CONCAT(trace_scope_, __LINE__) \
+        __attribute__((cleanup(trace_span_end))) = trace_span_begin(name)
+#else
+#define TRACE_BEGIN(var, name) do { } while (0)
+#define TRACE_END(var)         do { } while (0)
+#define TRACE_SCOPE(name)      do { } while (0)
+#endif
+
+#endif /* TRACE_H */
@@ -6,40 +6,15 @@
 #include <stdint.h>
 #include <time.h>
 #include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
 #include "chess.h"
 #include "nn.h"
+#include "stats.h"
 
 // Mutex for thread-safe ncurses access
 static pthread_mutex_t tui_mutex = PTHREAD_MUTEX_INITIALIZER;
 
-// Context shared between tui_run_training_threaded and the live progress callback
-typedef struct {
-    int iteration;
-    int total_iterations;
-    int best_score;
-    int best_iteration;
-    IterationHistory last_5[5];
-    int history_count;
-    struct timespec t_start;
-    float learning_rate;
-} TrainingDisplayCtx;
-
-static TrainingDisplayCtx g_train_ctx;
-
-// Called every 5 puzzles by worker threads — updates display while threads run
-static void training_progress_cb(int completed, int total, int passes)
-{
-    (void)completed; (void)total;
-    struct timespec t_now;
-    clock_gettime(CLOCK_MONOTONIC, &t_now);
-    int elapsed = (int)(t_now.tv_sec - g_train_ctx.t_start.tv_sec);
-    tui_nn_training_display(
-        g_train_ctx.iteration, g_train_ctx.total_iterations,
-        passes, g_train_ctx.best_score, g_train_ctx.best_iteration,
-        g_train_ctx.last_5, g_train_ctx.history_count,
-        elapsed, g_train_ctx.learning_rate);
-}
-
 // Color pairs
 #define COLOR_WHITE_PIECE 1
 #define COLOR_BLACK_PIECE 2
@@ -377,6 +352,16 @@ void tui_draw_stats(enum Colour current_turn)
     wattron(stats_win, COLOR_PAIR(COLOR_INFO));
     wprintw(stats_win, "%llu", (unsigned long long)game_stats.ab_prunes);
     
+    // Process-wide hot-path counters (all threads)
+    StatsSnapshot snap;
+    stats_snapshot(&snap);
+    wattron(stats_win, COLOR_PAIR(COLOR_HIGHLIGHT));
+    mvwprintw(stats_win, 8, 2, "NN fwd:     ");
+    wattron(stats_win, COLOR_PAIR(COLOR_INFO));
+    wprintw(stats_win, "%llu  gen %llu",
+            (unsigned long long)snap.counters[STAT_NN_FORWARDS],
+            (unsigned long long)snap.counters[STAT_MOVEGEN_CALLS]);
+
     wattron(stats_win, COLOR_PAIR(COLOR_HIGHLIGHT));
     // Show puzzle status if active
     if (puzzle_state.is_active || puzzle_state.move_index > 0) {
@@ -925,204 +910,463 @@ int tui_load_lichess_puzzle(const char *filename, enum Colour *puzzleTurnOut)
     return 1;
 }
 
-// Run puzzles with live TUI display
-void tui_run_puzzle_test(const char *filename, int searchDepth)
+// Draw the per-thread puzzle status grid starting at row y of win and
+// stopping before row max_y.  thread_statuses holds (puzzle, result) pairs
+// as filled in by get_thread_puzzle_statuses.
+static void draw_thread_status_grid(WINDOW *win, int y, int max_y,
+                                    int num_threads, const int *thread_statuses)
 {
-    suppress_engine_output = 1;  // Suppress engine stdout output
-    
-    int correctMoves = 0;
-    int totalMoves = 0;
-    int puzzlesPassed = 0;
-    int puzzlesFailed = 0;
-
-    for (int puzzleNum = 0; puzzleNum < PUZZLE_TEST_COUNT; puzzleNum++)
-    {
-        struct LichessPuzzle puzzle;
-        if (!loadLichessPuzzle(filename, puzzleNum, &puzzle))
-        {
-            continue;
-        }
+    if (num_threads > 0) {
+        int max_y_win, max_x_win;
+        getmaxyx(win, max_y_win, max_x_win);
+        (void)max_y_win;
+        int thread_entry_width = 11;
+        int threads_per_row = (max_x_win - 4) / thread_entry_width;
+        if (threads_per_row < 1) threads_per_row = 1;
 
-        // Clear previous checkmate message
-        last_checkmate_message[0] = '\0';
-
-        // Reset board and load FEN
-        memset(board, 0, sizeof(board));
-        for (int i = 0; i < 8; i++)
-        {
-            for (int j = 0; j < 8; j++)
-            {
-                board[i][j].type = -1;
-                board[i][j].colour = -1;
-                board[i][j].hasMoved = 0;
-            }
-        }
+        for (int i = 0; i < num_threads && y < max_y; i++) {
+            int puzzle_idx = thread_statuses[i * 2];
+            int result     = thread_statuses[i * 2 + 1];
 
-        enum Colour sideToMove = WHITE;
-        if (!loadBoardFromFEN(puzzle.fen, board))
-        {
-            continue;
+            const char *status_char = "-";
+            int color = COLOR_INFO;
+            if (result == 1) { status_char = "!"; color = COLOR_SUCCESS; }
+            else if (result == 0) { status_char = "X"; color = COLOR_WARNING; }
+
+            int col = 2 + (i % threads_per_row) * thread_entry_width;
+            wattron(win, COLOR_PAIR(color));
+            if (puzzle_idx >= 0)
+                mvwprintw(win, y, col, "T%02d:[%3d]%s", i, puzzle_idx, status_char);
+            else
+                mvwprintw(win, y, col, "T%02d: idle", i);
+            if ((i + 1) % threads_per_row == 0) y++;
+            wattroff(win, COLOR_PAIR(color));
         }
+    } else {
+        wattron(win, COLOR_PAIR(COLOR_INFO));
+        mvwprintw(win, y, 2, "No active threads");
+        wattroff(win, COLOR_PAIR(COLOR_INFO));
+    }
+}
 
-        sideToMove = getTurnFromFEN(puzzle.fen);
+// ============================================================================
+// LIVE RENDER THREAD
+// ============================================================================
+//
+// Long-running jobs (puzzle test, training) publish their progress into
+// render_state with relaxed atomic stores.  A dedicated render thread samples
+// it at TUI_RENDER_HZ, redraws only the windows whose inputs changed and
+// flushes them with a single doupdate(), so worker threads never touch ncurses
+// or wait on tui_mutex.
+
+#define TUI_RENDER_HZ 10
+#define TUI_MAX_THREAD_STATUSES 512
+
+enum RenderMode { RENDER_IDLE, RENDER_PUZZLE_TEST, RENDER_TRAINING };
+
+// Published state: written by engine/worker threads, read by the render thread
+static struct {
+    atomic_int completed;
+    atomic_int total;
+    atomic_int passes;
+    atomic_int iteration;
+    atomic_int total_iterations;
+    atomic_int best_score;
+    atomic_int best_iteration;
+    atomic_int history_count;
+    atomic_int history_iteration[5];
+    atomic_int history_passes[5];
+    _Atomic float learning_rate;
+} render_state;
+
+// Plain copy of render_state plus thread statuses, taken once per frame
+typedef struct {
+    int completed, total, passes;
+    int iteration, total_iterations;
+    int best_score, best_iteration;
+    int history_count;
+    IterationHistory last_5[5];
+    float learning_rate;
+    int elapsed_seconds;
+    double elapsed;          // precise elapsed time, not used for change detection
+    int num_threads;
+    int thread_statuses[TUI_MAX_THREAD_STATUSES];
+} RenderSnapshot;
+
+// Configured by render_start() before the render thread is created
+static int render_mode = RENDER_IDLE;
+static int render_num_threads = 0;
+static int render_search_depth = 0;
+static struct timespec render_t_start;
+
+static pthread_t render_thread;
+static atomic_int render_running = 0;
+
+// Owned by whoever is rendering (the render thread while it runs)
+static RenderSnapshot render_last;
+static int render_have_last = 0;
+
+// Puzzle test layout (created for the duration of tui_run_puzzle_test)
+static WINDOW *ptest_summary_win = NULL;
+static WINDOW *ptest_threads_win = NULL;
+
+static void render_publish_progress(int completed, int total, int passes)
+{
+    atomic_store_explicit(&render_state.completed, completed, memory_order_relaxed);
+    atomic_store_explicit(&render_state.total, total, memory_order_relaxed);
+    atomic_store_explicit(&render_state.passes, passes, memory_order_relaxed);
+}
 
-        // Parse puzzle moves (space-separated UCI notation)
-        char movesCopy[512];
-        strcpy(movesCopy, puzzle.moves);
-        char *token = strtok(movesCopy, " ");
+static void render_publish_training(int iteration, int total_iterations, int score,
+                                    int best_score, int best_iteration,
+                                    const IterationHistory *last_5, int history_count,
+                                    float learning_rate)
+{
+    if (history_count > 5) history_count = 5;
+    for (int i = 0; i < history_count; i++) {
+        atomic_store_explicit(&render_state.history_iteration[i], last_5[i].iteration, memory_order_relaxed);
+        atomic_store_explicit(&render_state.history_passes[i], last_5[i].pass_count, memory_order_relaxed);
+    }
+    atomic_store_explicit(&render_state.history_count, history_count, memory_order_relaxed);
+    atomic_store_explicit(&render_state.iteration, iteration, memory_order_relaxed);
+    atomic_store_explicit(&render_state.total_iterations, total_iterations, memory_order_relaxed);
+    atomic_store_explicit(&render_state.passes, score, memory_order_relaxed);
+    atomic_store_explicit(&render_state.best_score, best_score, memory_order_relaxed);
+    atomic_store_explicit(&render_state.best_iteration, best_iteration, memory_order_relaxed);
+    atomic_store_explicit(&render_state.learning_rate, learning_rate, memory_order_relaxed);
+}
 
-        // Execute the first move (puzzle setup move)
-        if (token)
-        {
-            if (executeUciMove(board, token))
-            {
-                recordBoardHistory();
-                sideToMove = (sideToMove == WHITE) ? BLACK : WHITE;
-                token = strtok(NULL, " ");
-            }
-            else
-            {
-                continue;
-            }
-        }
+static void render_take_snapshot(RenderSnapshot *s)
+{
+    memset(s, 0, sizeof(*s));
+    s->completed        = atomic_load_explicit(&render_state.completed, memory_order_relaxed);
+    s->total            = atomic_load_explicit(&render_state.total, memory_order_relaxed);
+    s->passes           = atomic_load_explicit(&render_state.passes, memory_order_relaxed);
+    s->iteration        = atomic_load_explicit(&render_state.iteration, memory_order_relaxed);
+    s->total_iterations = atomic_load_explicit(&render_state.total_iterations, memory_order_relaxed);
+    s->best_score       = atomic_load_explicit(&render_state.best_score, memory_order_relaxed);
+    s->best_iteration   = atomic_load_explicit(&render_state.best_iteration, memory_order_relaxed);
+    s->learning_rate    = atomic_load_explicit(&render_state.learning_rate, memory_order_relaxed);
+    s->history_count    = atomic_load_explicit(&render_state.history_count, memory_order_relaxed);
+    for (int i = 0; i < s->history_count; i++) {
+        s->last_5[i].iteration  = atomic_load_explicit(&render_state.history_iteration[i], memory_order_relaxed);
+        s->last_5[i].pass_count = atomic_load_explicit(&render_state.history_passes[i], memory_order_relaxed);
+        s->last_5[i].score      = s->last_5[i].pass_count;
+    }
 
-        // Now alternate: AI solves, opponent responds
-        int puzzleSuccess = 1;
-        int puzzleMoveCount = 0;  // Track moves in this puzzle
-        puzzle_state.moves_played[0] = '\0';  // Clear moves buffer
-        
-        while (token)
-        {
-            // AI's turn (solver side)
-            enum Colour aiColour = sideToMove;
-            moveRanking(board, searchDepth, aiColour);
-
-            // Get the next expected move from puzzle
-            const char *expectedMove = token;
-            token = strtok(NULL, " ");
-
-            // Verify AI made the correct move
-            char aiMoveNotation[16];
-            snprintf(aiMoveNotation, sizeof(aiMoveNotation), "%c%d%c%d",
-                     'a' + lastMove.fromX, lastMove.fromY + 1,
-                     'a' + lastMove.toX, lastMove.toY + 1);
-
-            // Add move to display buffer
-            if (puzzle_state.moves_played[0] != '\0')
-                strncat(puzzle_state.moves_played, " ", sizeof(puzzle_state.moves_played) - 1);
-            strncat(puzzle_state.moves_played, aiMoveNotation, sizeof(puzzle_state.moves_played) - 1);
-
-            puzzleMoveCount++;
-            totalMoves++;
-
-            if (strcmp(aiMoveNotation, expectedMove) != 0)
-            {
-                // Move doesn't match expected, but check if it's checkmate
-                // (multiple checkmate solutions are valid in puzzles)
-                enum Colour opponentColour = (aiColour == WHITE) ? BLACK : WHITE;
-                if (!isCheckmate(board, opponentColour))
-                {
-                    puzzleSuccess = 0;
-                    break;
-                }
-                // If it's checkmate, it counts as a win even though move differs
-                correctMoves++;
-                // Puzzle is complete - no more opponent moves after checkmate
-                break;
-            }
+    struct timespec t_now;
+    clock_gettime(CLOCK_MONOTONIC, &t_now);
+    s->elapsed = (double)(t_now.tv_sec - render_t_start.tv_sec) +
+                 (double)(t_now.tv_nsec - render_t_start.tv_nsec) / 1e9;
+    s->elapsed_seconds = (int)s->elapsed;
 
-            correctMoves++;
+    get_thread_puzzle_statuses(&s->num_threads, s->thread_statuses);
+}
 
-            sideToMove = (sideToMove == WHITE) ? BLACK : WHITE;
+static int render_threads_changed(const RenderSnapshot *s, const RenderSnapshot *prev)
+{
+    if (!prev || s->num_threads != prev->num_threads)
+        return 1;
+    return memcmp(s->thread_statuses, prev->thread_statuses,
+                  (size_t)s->num_threads * 2 * sizeof(int)) != 0;
+}
 
-            // Opponent's response (if any)
-            if (token)
-            {
-                if (!executeUciMove(board, token))
-                {
-                    puzzleSuccess = 0;
-                    break;
-                }
-                recordBoardHistory();
-                sideToMove = (sideToMove == WHITE) ? BLACK : WHITE;
-                token = strtok(NULL, " ");
-            }
-        }
+static void draw_puzzle_test_windows(const RenderSnapshot *s, const RenderSnapshot *prev)
+{
+    if (!prev || s->completed != prev->completed || s->passes != prev->passes ||
+        s->total != prev->total || s->elapsed_seconds != prev->elapsed_seconds) {
+        WINDOW *w = ptest_summary_win;
+        int failed = s->completed - s->passes;
+
+        werase(w);
+        draw_fancy_border(w, "PUZZLE TEST: Lichess Puzzles");
+
+        wattron(w, COLOR_PAIR(COLOR_INFO));
+        mvwprintw(w, 2, 2, "Progress: Puzzle %3d / %d", s->completed, s->total);
+        mvwprintw(w, 3, 2, "Threads: %d | Depth: %d", render_num_threads, render_search_depth);
+        wattroff(w, COLOR_PAIR(COLOR_INFO));
+
+        wattron(w, COLOR_PAIR(COLOR_SUCCESS));
+        mvwprintw(w, 5, 2, "Passed:  %3d / %3d", s->passes, s->completed);
+        wattroff(w, COLOR_PAIR(COLOR_SUCCESS));
+
+        wattron(w, COLOR_PAIR(COLOR_WARNING));
+        mvwprintw(w, 6, 2, "Failed:  %3d / %3d", failed, s->completed);
+        wattroff(w, COLOR_PAIR(COLOR_WARNING));
+
+        wattron(w, COLOR_PAIR(COLOR_INFO));
+        mvwprintw(w, 8, 2, "Success Rate:  %.1f%%", (s->passes * 100.0) / (s->completed > 0 ? s->completed : 1));
+        mvwprintw(w, 9, 2, "Throughput:    %.1f puzzles/s", s->elapsed > 0.0 ? s->completed / s->elapsed : 0.0);
+        mvwprintw(w, 10, 2, "Elapsed:       %ds", s->elapsed_seconds);
+        wattroff(w, COLOR_PAIR(COLOR_INFO));
+
+        wnoutrefresh(w);
+    }
+
+    if (render_threads_changed(s, prev)) {
+        int max_y, max_x;
+        getmaxyx(ptest_threads_win, max_y, max_x);
+        (void)max_x;
+        werase(ptest_threads_win);
+        draw_fancy_border(ptest_threads_win, "THREAD STATUS");
+        draw_thread_status_grid(ptest_threads_win, 2, max_y - 1, s->num_threads, s->thread_statuses);
+        wnoutrefresh(ptest_threads_win);
+    }
+}
+
+static void draw_training_windows(const RenderSnapshot *s, const RenderSnapshot *prev)
+{
+    int score = s->passes;
+    double accuracy = (PUZZLE_TEST_COUNT > 0) ? (score * 100.0 / PUZZLE_TEST_COUNT) : 0.0;
+    double best_acc  = (PUZZLE_TEST_COUNT > 0) ? (s->best_score * 100.0 / PUZZLE_TEST_COUNT) : 0.0;
+    int status_changed = !prev || s->iteration != prev->iteration ||
+                         s->total_iterations != prev->total_iterations ||
+                         score != prev->passes || s->best_score != prev->best_score ||
+                         s->best_iteration != prev->best_iteration ||
+                         s->learning_rate != prev->learning_rate;
+    int y;
+
+    // --- Left column: current status ---
+    if (status_changed) {
+        werase(stats_win);
+        draw_fancy_border(stats_win, "TRAINING STATUS");
+
+        y = 2;
+        wattron(stats_win, COLOR_PAIR(COLOR_INFO));
+        mvwprintw(stats_win, y++, 2, "Iteration: %d / %d", s->iteration, s->total_iterations);
+        mvwprintw(stats_win, y++, 2, "Puzzles:   %d", PUZZLE_TEST_COUNT);
+        mvwprintw(stats_win, y++, 2, "Score:     %d / %d", score, PUZZLE_TEST_COUNT);
+        mvwprintw(stats_win, y++, 2, "Best:      %d / %d", s->best_score, PUZZLE_TEST_COUNT);
+        mvwprintw(stats_win, y++, 2, "Best iter: %d", s->best_iteration);
+        y++;
+        mvwprintw(stats_win, y++, 2, "LR:        %.5f", (double)s->learning_rate);
+        wattroff(stats_win, COLOR_PAIR(COLOR_INFO));
 
-        if (puzzleSuccess)
-        {
-            puzzlesPassed++;
+        // Progress bar
+        if (s->total_iterations > 0) {
+            int bar_w = 20;
+            int filled = (s->iteration * bar_w) / s->total_iterations;
+            wattron(stats_win, COLOR_PAIR(COLOR_HIGHLIGHT));
+            mvwprintw(stats_win, y++, 2, "Progress:");
+            wattroff(stats_win, COLOR_PAIR(COLOR_HIGHLIGHT));
+            wmove(stats_win, y, 2);
+            wattron(stats_win, COLOR_PAIR(COLOR_SUCCESS));
+            for (int i = 0; i < filled; i++) waddch(stats_win, ACS_BLOCK);
+            wattroff(stats_win, COLOR_PAIR(COLOR_SUCCESS));
+            wattron(stats_win, COLOR_PAIR(COLOR_INFO));
+            for (int i = filled; i < bar_w; i++) waddch(stats_win, '-');
+            wattroff(stats_win, COLOR_PAIR(COLOR_INFO));
         }
+        wnoutrefresh(stats_win);
+    }
+
+    // --- Middle column: elapsed time + accuracy ---
+    if (status_changed || s->elapsed_seconds != prev->elapsed_seconds) {
+        werase(best_line_win);
+        draw_fancy_border(best_line_win, "PERFORMANCE");
+
+        y = 2;
+        int hours   = s->elapsed_seconds / 3600;
+        int minutes = (s->elapsed_seconds % 3600) / 60;
+        int seconds = s->elapsed_seconds % 60;
+        wattron(best_line_win, COLOR_PAIR(COLOR_INFO));
+        if (hours > 0)
+            mvwprintw(best_line_win, y++, 2, "Elapsed: %dh %dm %ds", hours, minutes, seconds);
+        else if (minutes > 0)
+            mvwprintw(best_line_win, y++, 2, "Elapsed: %dm %ds", minutes, seconds);
         else
-        {
-            puzzlesFailed++;
+            mvwprintw(best_line_win, y++, 2, "Elapsed: %ds", seconds);
+
+        y++;
+        mvwprintw(best_line_win, y++, 2, "Accuracy:  %.1f%%", accuracy);
+        mvwprintw(best_line_win, y++, 2, "Best acc:  %.1f%%", best_acc);
+        wattroff(best_line_win, COLOR_PAIR(COLOR_INFO));
+        wnoutrefresh(best_line_win);
+    }
+
+    // --- Right column: last-5 iteration history ---
+    if (status_changed || s->history_count != prev->history_count ||
+        memcmp(s->last_5, prev->last_5, sizeof(s->last_5)) != 0) {
+        werase(moves_win);
+        draw_fancy_border(moves_win, "ITERATIONS");
+
+        y = 2;
+        wattron(moves_win, COLOR_PAIR(COLOR_SUCCESS) | A_BOLD);
+        mvwprintw(moves_win, y++, 2, ">>> %3d: %d/%d (%.0f%%)",
+                  s->iteration, score, PUZZLE_TEST_COUNT, accuracy);
+        wattroff(moves_win, COLOR_PAIR(COLOR_SUCCESS) | A_BOLD);
+
+        for (int i = 0; i < s->history_count; i++) {
+            double h_acc = (PUZZLE_TEST_COUNT > 0)
+                ? (s->last_5[i].pass_count * 100.0 / PUZZLE_TEST_COUNT) : 0.0;
+            int color = (s->last_5[i].pass_count == s->best_score) ? COLOR_SUCCESS : COLOR_INFO;
+            wattron(moves_win, COLOR_PAIR(color));
+            mvwprintw(moves_win, y++, 2, "    %3d: %d/%d (%.0f%%)",
+                      s->last_5[i].iteration, s->last_5[i].pass_count,
+                      PUZZLE_TEST_COUNT, h_acc);
+            wattroff(moves_win, COLOR_PAIR(color));
         }
+        wnoutrefresh(moves_win);
+    }
 
-        // Save last puzzle info
-        strcpy(puzzle_state.last_puzzle_id, puzzle.puzzleId);
-        strcpy(puzzle_state.last_puzzle_moves, puzzle_state.moves_played);
-        
-        // Append checkmate message if one was generated
-        if (last_checkmate_message[0] != '\0') {
-            strncat(puzzle_state.last_puzzle_moves, " ", sizeof(puzzle_state.last_puzzle_moves) - 1);
-            strncat(puzzle_state.last_puzzle_moves, last_checkmate_message, sizeof(puzzle_state.last_puzzle_moves) - 1);
-            last_checkmate_message[0] = '\0';  // Clear for next puzzle
+    // --- Lower-left: NN weight file info (static) ---
+    if (!prev) {
+        werase(stats_params_win);
+        draw_fancy_border(stats_params_win, "NN INFO");
+
+        y = 2;
+        const char *backend = "CPU";
+#ifdef USE_CUDA
+        backend = nn_gpu_is_ready() ? "GPU" : "CPU";
+#endif
+
+        // Shape as read from the weight file, e.g. "832-256-256-224 (3)"
+        char shape[128] = "not loaded";
+        if (g_net.layers > 0) {
+            int len = snprintf(shape, sizeof(shape), "%d", g_net.widths[0]);
+            for (int l = 1; l <= g_net.layers && len < (int)sizeof(shape); l++)
+                len += snprintf(shape + len, sizeof(shape) - (size_t)len, "-%d", g_net.widths[l]);
+            if (len < (int)sizeof(shape))
+                snprintf(shape + len, sizeof(shape) - (size_t)len, " (%d)", g_net.layers);
         }
-        
-        strcpy(puzzle_state.last_puzzle_expected, puzzle.moves);
-        puzzle_state.last_puzzle_passed = puzzleSuccess;
+        int room = getmaxx(stats_params_win) - 13;
+
+        wattron(stats_params_win, COLOR_PAIR(COLOR_INFO));
+        mvwprintw(stats_params_win, y++, 2, "Network: %.*s", room > 0 ? room : 0, shape);
+        mvwprintw(stats_params_win, y++, 2, "Backend: %s", backend);
+        mvwprintw(stats_params_win, y++, 2, "Weights: nn_weights.bin");
+        mvwprintw(stats_params_win, y++, 2, "Inputs:  64 sq x 13 cats");
+        mvwprintw(stats_params_win, y++, 2, "Loss:    MSE (teacher forcing)");
+        mvwprintw(stats_params_win, y++, 2, "Optim:   SGD");
+        wattroff(stats_params_win, COLOR_PAIR(COLOR_INFO));
+        wnoutrefresh(stats_params_win);
+    }
 
-        // Display live progress
-        erase();
-        
-        attron(COLOR_PAIR(COLOR_TITLE));
-        mvprintw(1, 3, "+===================================================+");
-        mvprintw(2, 3, "|   PUZZLE TEST: Lichess Puzzles                   |");
-        mvprintw(3, 3, "+===================================================+");
-        attroff(COLOR_PAIR(COLOR_TITLE));
-
-        mvprintw(5, 5, "Progress: Puzzle %3d / %d", puzzleNum + 1, PUZZLE_TEST_COUNT);
-        mvprintw(6, 5, "ID: %s | Rating: %d", puzzle.puzzleId, puzzle.rating);
-        
-        attron(COLOR_PAIR(puzzleSuccess ? COLOR_SUCCESS : COLOR_WARNING));
-        mvprintw(7, 5, "Status: %s", puzzleSuccess ? "[PASS]" : "[FAIL]");
-        attroff(COLOR_PAIR(puzzleSuccess ? COLOR_SUCCESS : COLOR_WARNING));
+    // --- Lower-middle: best scores so far ---
+    if (!prev || s->best_score != prev->best_score || s->best_iteration != prev->best_iteration) {
+        werase(best_params_win);
+        draw_fancy_border(best_params_win, "BEST SCORE");
+
+        y = 2;
+        wattron(best_params_win, COLOR_PAIR(COLOR_SUCCESS) | A_BOLD);
+        mvwprintw(best_params_win, y++, 2, "%d / %d  (%.1f%%)",
+                  s->best_score, PUZZLE_TEST_COUNT, best_acc);
+        wattroff(best_params_win, COLOR_PAIR(COLOR_SUCCESS) | A_BOLD);
+        wattron(best_params_win, COLOR_PAIR(COLOR_INFO));
+        mvwprintw(best_params_win, y++, 2, "at iteration %d", s->best_iteration);
+        wattroff(best_params_win, COLOR_PAIR(COLOR_INFO));
+        wnoutrefresh(best_params_win);
+    }
+
+    // --- Bottom: thread status ---
+    if (render_threads_changed(s, prev)) {
+        int max_y_info, max_x_info;
+        getmaxyx(info_win, max_y_info, max_x_info);
+        (void)max_x_info;
+        werase(info_win);
+        draw_fancy_border(info_win, "THREAD STATUS");
+        draw_thread_status_grid(info_win, 2, max_y_info - 1, s->num_threads, s->thread_statuses);
+        wnoutrefresh(info_win);
+    }
+}
 
-        attron(COLOR_PAIR(COLOR_SUCCESS));
-        mvprintw(9, 5, "Passed:  %2d / %3d", puzzlesPassed, puzzleNum + 1);
-        attroff(COLOR_PAIR(COLOR_SUCCESS));
+// Draw one frame: snapshot the published state and redraw what changed
+static void render_frame(void)
+{
+    RenderSnapshot snap;
+    render_take_snapshot(&snap);
+    const RenderSnapshot *prev = render_have_last ? &render_last : NULL;
 
-        attron(COLOR_PAIR(COLOR_WARNING));
-        mvprintw(10, 5, "Failed:  %2d / %3d", puzzlesFailed, puzzleNum + 1);
-        attroff(COLOR_PAIR(COLOR_WARNING));
+    pthread_mutex_lock(&tui_mutex);
+    if (render_mode == RENDER_PUZZLE_TEST)
+        draw_puzzle_test_windows(&snap, prev);
+    else if (render_mode == RENDER_TRAINING)
+        draw_training_windows(&snap, prev);
+    doupdate();
+    pthread_mutex_unlock(&tui_mutex);
 
-        mvprintw(12, 5, "Correct Moves: %d / %d", correctMoves, totalMoves > 0 ? totalMoves : 1);
-        mvprintw(13, 5, "Success Rate:  %.1f%%", (correctMoves * 100.0) / (totalMoves > 0 ? totalMoves : 1));
+    render_last = snap;
+    render_have_last = 1;
+}
 
-        // Last Puzzle Section
-        attron(COLOR_PAIR(COLOR_TITLE));
-        mvprintw(15, 3, "+===================================================+");
-        mvprintw(16, 3, "|   LAST PUZZLE                                      |");
-        mvprintw(17, 3, "+===================================================+");
-        attroff(COLOR_PAIR(COLOR_TITLE));
+static void *render_thread_main(void *arg)
+{
+    (void)arg;
+    const struct timespec frame = {0, 1000000000L / TUI_RENDER_HZ};
 
-        mvprintw(18, 5, "ID: %s", puzzle_state.last_puzzle_id);
-        
-        attron(COLOR_PAIR(puzzle_state.last_puzzle_passed ? COLOR_SUCCESS : COLOR_WARNING));
-        mvprintw(19, 5, "Result: %s", puzzle_state.last_puzzle_passed ? "[PASS]" : "[FAIL]");
-        attroff(COLOR_PAIR(puzzle_state.last_puzzle_passed ? COLOR_SUCCESS : COLOR_WARNING));
+    while (atomic_load(&render_running)) {
+        render_frame();
+        nanosleep(&frame, NULL);
+    }
 
-        attron(COLOR_PAIR(COLOR_INFO));
-        mvprintw(20, 5, "Engine: %s", puzzle_state.last_puzzle_moves);
-        mvprintw(21, 5, "Best:   %s", puzzle_state.last_puzzle_expected);
-        attroff(COLOR_PAIR(COLOR_INFO));
+    render_frame();  // final frame with the finished totals
+    return NULL;
+}
 
-        attron(COLOR_PAIR(COLOR_TITLE));
-        mvprintw(22, 3, "+===================================================+");
-        attroff(COLOR_PAIR(COLOR_TITLE));
+// Start the render thread for the given mode.  If the thread cannot be
+// created, publishers fall back to drawing synchronously.
+static void render_start(int mode, int num_threads, int search_depth)
+{
+    render_mode = mode;
+    render_num_threads = num_threads;
+    render_search_depth = search_depth;
+    render_have_last = 0;
+    clock_gettime(CLOCK_MONOTONIC, &render_t_start);
+
+    atomic_store(&render_running, 1);
+    if (pthread_create(&render_thread, NULL, render_thread_main, NULL) != 0)
+        atomic_store(&render_running, 0);
+}
 
-        refresh();
+static void render_stop(void)
+{
+    if (atomic_load(&render_running)) {
+        atomic_store(&render_running, 0);
+        pthread_join(render_thread, NULL);
     }
+    render_mode = RENDER_IDLE;
+}
+
+// Puzzle worker callback — only publishes, the render thread does the drawing
+static void puzzle_test_progress_cb(int completed, int total, int passes)
+{
+    render_publish_progress(completed, total, passes);
+    if (!atomic_load(&render_running) && render_mode == RENDER_PUZZLE_TEST)
+        render_frame();  // no render thread: draw inline (serialized by results_lock)
+}
+
+// Run puzzles on the multi-threaded worker pipeline with live TUI display
+void tui_run_puzzle_test(const char *filename, int searchDepth)
+{
+    suppress_engine_output = 1;  // Suppress engine stdout output
+
+    // Use every online core, same as a headless test_puzzles_mt run sized to the box
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    int num_threads = (cores > 0) ? (int)cores : 1;
+    if (num_threads > 256) num_threads = 256;
+
+    erase();
+    refresh();
+    ptest_summary_win = newwin(13, 56, 1, 3);
+    int threads_height = LINES - 15;
+    if (threads_height < 4) threads_height = 4;
+    ptest_threads_win = newwin(threads_height, COLS - 4, 14, 2);
+
+    render_publish_progress(0, PUZZLE_TEST_COUNT, 0);
+    render_start(RENDER_PUZZLE_TEST, num_threads, searchDepth);
+
+    int puzzlesPassed = playPuzzlesMultiThreaded(filename, searchDepth, PUZZLE_TEST_COUNT,
+                                                 num_threads, puzzle_test_progress_cb);
+
+    render_stop();
+    double elapsed = render_last.elapsed;
+
+    delwin(ptest_summary_win);
+    delwin(ptest_threads_win);
+    ptest_summary_win = NULL;
+    ptest_threads_win = NULL;
+
+    int puzzlesFailed = PUZZLE_TEST_COUNT - puzzlesPassed;
 
     // Final summary screen
     erase();
@@ -1142,15 +1386,23 @@ void tui_run_puzzle_test(const char *filename, int searchDepth)
     mvprintw(8, 5, "Failed:  %d", puzzlesFailed);
     attroff(COLOR_PAIR(COLOR_WARNING));
 
-    mvprintw(10, 5, "Correct Moves: %d / %d", correctMoves, totalMoves);
-    mvprintw(11, 5, "Success Rate:  %.1f%%", (correctMoves * 100.0) / (totalMoves > 0 ? totalMoves : 1));
+    mvprintw(10, 5, "Success Rate:  %.1f%%", (puzzlesPassed * 100.0) / (PUZZLE_TEST_COUNT > 0 ? PUZZLE_TEST_COUNT : 1));
+    mvprintw(11, 5, "Elapsed:       %.1fs on %d threads", elapsed, num_threads);
+    mvprintw(12, 5, "Throughput:    %.1f puzzles/s", elapsed > 0.0 ? PUZZLE_TEST_COUNT / elapsed : 0.0);
+
+    // Tail latency from the run's histograms
+    double puzzle_p50, puzzle_p99, move_p50, move_p99;
+    get_puzzle_latency_percentiles(50.0, &puzzle_p50, &move_p50);
+    get_puzzle_latency_percentiles(99.0, &puzzle_p99, &move_p99);
+    mvprintw(13, 5, "Per puzzle:    p50 %.1f ms  p99 %.1f ms", puzzle_p50, puzzle_p99);
+    mvprintw(14, 5, "Per move:      p50 %.1f ms  p99 %.1f ms", move_p50, move_p99);
 
     attron(COLOR_PAIR(COLOR_TITLE));
-    mvprintw(13, 3, "+===================================================+");
+    mvprintw(16, 3, "+===================================================+");
     attroff(COLOR_PAIR(COLOR_TITLE));
 
     attron(COLOR_PAIR(COLOR_INFO));
-    mvprintw(15, 10, "Press any key to return to menu...");
+    mvprintw(18, 10, "Press any key to return to menu...");
     attroff(COLOR_PAIR(COLOR_INFO));
 
     refresh();
@@ -1163,169 +1415,27 @@ void tui_run_puzzle_test(const char *filename, int searchDepth)
 // TRAINING SYSTEM TUI DISPLAY
 // ============================================================================
 
-// Update training display — called after each iteration
+// Called every 5 puzzles by worker threads — only publishes the live score
+static void training_progress_cb(int completed, int total, int passes)
+{
+    render_publish_progress(completed, total, passes);
+}
+
+// Update training display — called after each iteration.  Publishes the
+// state for the render thread; draws synchronously only when no render
+// thread is running.
 void tui_nn_training_display(int iteration, int total_iterations, int score,
                              int best_score, int best_iteration,
                              IterationHistory *last_5, int history_count,
                              int elapsed_seconds, float learning_rate)
 {
-    pthread_mutex_lock(&tui_mutex);
+    (void)elapsed_seconds;  // elapsed time is derived from the render clock
 
-    // --- Left column: current status ---
-    werase(stats_win);
-    draw_fancy_border(stats_win, "TRAINING STATUS");
-
-    int y = 2;
-    wattron(stats_win, COLOR_PAIR(COLOR_INFO));
-    mvwprintw(stats_win, y++, 2, "Iteration: %d / %d", iteration, total_iterations);
-    mvwprintw(stats_win, y++, 2, "Puzzles:   %d", PUZZLE_TEST_COUNT);
-    mvwprintw(stats_win, y++, 2, "Score:     %d / %d", score, PUZZLE_TEST_COUNT);
-    mvwprintw(stats_win, y++, 2, "Best:      %d / %d", best_score, PUZZLE_TEST_COUNT);
-    mvwprintw(stats_win, y++, 2, "Best iter: %d", best_iteration);
-    y++;
-    mvwprintw(stats_win, y++, 2, "LR:        %.5f", (double)learning_rate);
-    wattroff(stats_win, COLOR_PAIR(COLOR_INFO));
-
-    // Progress bar
-    if (total_iterations > 0) {
-        int bar_w = 20;
-        int filled = (iteration * bar_w) / total_iterations;
-        wattron(stats_win, COLOR_PAIR(COLOR_HIGHLIGHT));
-        mvwprintw(stats_win, y++, 2, "Progress:");
-        wattroff(stats_win, COLOR_PAIR(COLOR_HIGHLIGHT));
-        wmove(stats_win, y, 2);
-        wattron(stats_win, COLOR_PAIR(COLOR_SUCCESS));
-        for (int i = 0; i < filled; i++) waddch(stats_win, ACS_BLOCK);
-        wattroff(stats_win, COLOR_PAIR(COLOR_SUCCESS));
-        wattron(stats_win, COLOR_PAIR(COLOR_INFO));
-        for (int i = filled; i < bar_w; i++) waddch(stats_win, '-');
-        wattroff(stats_win, COLOR_PAIR(COLOR_INFO));
-    }
-    wrefresh(stats_win);
-
-    // --- Middle column: elapsed time + accuracy ---
-    werase(best_line_win);
-    draw_fancy_border(best_line_win, "PERFORMANCE");
-
-    y = 2;
-    int hours   = elapsed_seconds / 3600;
-    int minutes = (elapsed_seconds % 3600) / 60;
-    int seconds = elapsed_seconds % 60;
-    wattron(best_line_win, COLOR_PAIR(COLOR_INFO));
-    if (hours > 0)
-        mvwprintw(best_line_win, y++, 2, "Elapsed: %dh %dm %ds", hours, minutes, seconds);
-    else if (minutes > 0)
-        mvwprintw(best_line_win, y++, 2, "Elapsed: %dm %ds", minutes, seconds);
-    else
-        mvwprintw(best_line_win, y++, 2, "Elapsed: %ds", seconds);
+    render_publish_training(iteration, total_iterations, score, best_score, best_iteration,
+                            last_5, history_count, learning_rate);
 
-    y++;
-    double accuracy = (PUZZLE_TEST_COUNT > 0) ? (score * 100.0 / PUZZLE_TEST_COUNT) : 0.0;
-    double best_acc  = (PUZZLE_TEST_COUNT > 0) ? (best_score * 100.0 / PUZZLE_TEST_COUNT) : 0.0;
-    mvwprintw(best_line_win, y++, 2, "Accuracy:  %.1f%%", accuracy);
-    mvwprintw(best_line_win, y++, 2, "Best acc:  %.1f%%", best_acc);
-    wattroff(best_line_win, COLOR_PAIR(COLOR_INFO));
-    wrefresh(best_line_win);
-
-    // --- Right column: last-5 iteration history ---
-    werase(moves_win);
-    draw_fancy_border(moves_win, "ITERATIONS");
-
-    y = 2;
-    wattron(moves_win, COLOR_PAIR(COLOR_SUCCESS) | A_BOLD);
-    mvwprintw(moves_win, y++, 2, ">>> %3d: %d/%d (%.0f%%)",
-              iteration, score, PUZZLE_TEST_COUNT, accuracy);
-    wattroff(moves_win, COLOR_PAIR(COLOR_SUCCESS) | A_BOLD);
-
-    for (int i = 0; i < history_count; i++) {
-        double h_acc = (PUZZLE_TEST_COUNT > 0)
-            ? (last_5[i].pass_count * 100.0 / PUZZLE_TEST_COUNT) : 0.0;
-        int color = (last_5[i].pass_count == best_score) ? COLOR_SUCCESS : COLOR_INFO;
-        wattron(moves_win, COLOR_PAIR(color));
-        mvwprintw(moves_win, y++, 2, "    %3d: %d/%d (%.0f%%)",
-                  last_5[i].iteration, last_5[i].pass_count,
-                  PUZZLE_TEST_COUNT, h_acc);
-        wattroff(moves_win, COLOR_PAIR(color));
-    }
-    wrefresh(moves_win);
-
-    // --- Lower-left: NN weight file info ---
-    werase(stats_params_win);
-    draw_fancy_border(stats_params_win, "NN INFO");
-
-    y = 2;
-    const char *backend = "CPU";
-#ifdef USE_CUDA
-    backend = nn_gpu_is_ready() ? "GPU" : "CPU";
-#endif
-
-    wattron(stats_params_win, COLOR_PAIR(COLOR_INFO));
-    mvwprintw(stats_params_win, y++, 2, "Network: 832 x 832 dense");
-    mvwprintw(stats_params_win, y++, 2, "Backend: %s", backend);
-    mvwprintw(stats_params_win, y++, 2, "Weights: nn_weights.bin");
-    mvwprintw(stats_params_win, y++, 2, "Inputs:  64 sq x 13 cats");
-    mvwprintw(stats_params_win, y++, 2, "Loss:    MSE (teacher forcing)");
-    mvwprintw(stats_params_win, y++, 2, "Optim:   SGD");
-    wattroff(stats_params_win, COLOR_PAIR(COLOR_INFO));
-    wrefresh(stats_params_win);
-
-    // --- Lower-middle: best scores so far ---
-    werase(best_params_win);
-    draw_fancy_border(best_params_win, "BEST SCORE");
-
-    y = 2;
-    wattron(best_params_win, COLOR_PAIR(COLOR_SUCCESS) | A_BOLD);
-    mvwprintw(best_params_win, y++, 2, "%d / %d  (%.1f%%)",
-              best_score, PUZZLE_TEST_COUNT, best_acc);
-    wattroff(best_params_win, COLOR_PAIR(COLOR_SUCCESS) | A_BOLD);
-    wattron(best_params_win, COLOR_PAIR(COLOR_INFO));
-    mvwprintw(best_params_win, y++, 2, "at iteration %d", best_iteration);
-    wattroff(best_params_win, COLOR_PAIR(COLOR_INFO));
-    wrefresh(best_params_win);
-
-    // --- Bottom: thread status ---
-    werase(info_win);
-    draw_fancy_border(info_win, "THREAD STATUS");
-
-    y = 2;
-    int thread_statuses[512];
-    int num_threads = 0;
-    get_thread_puzzle_statuses(&num_threads, thread_statuses);
-
-    if (num_threads > 0) {
-        int max_y_info, max_x_info;
-        getmaxyx(info_win, max_y_info, max_x_info);
-        int thread_entry_width = 11;
-        int threads_per_row = (max_x_info - 4) / thread_entry_width;
-        if (threads_per_row < 1) threads_per_row = 1;
-
-        for (int i = 0; i < num_threads && y < max_y_info - 1; i++) {
-            int puzzle_idx = thread_statuses[i * 2];
-            int result     = thread_statuses[i * 2 + 1];
-
-            const char *status_char = "-";
-            int color = COLOR_INFO;
-            if (result == 1) { status_char = "!"; color = COLOR_SUCCESS; }
-            else if (result == 0) { status_char = "X"; color = COLOR_WARNING; }
-
-            int col = 2 + (i % threads_per_row) * thread_entry_width;
-            wattron(info_win, COLOR_PAIR(color));
-            if (puzzle_idx >= 0)
-                mvwprintw(info_win, y, col, "T%02d:[%3d]%s", i, puzzle_idx, status_char);
-            else
-                mvwprintw(info_win, y, col, "T%02d: idle", i);
-            if ((i + 1) % threads_per_row == 0) y++;
-            wattroff(info_win, COLOR_PAIR(color));
-        }
-    } else {
-        wattron(info_win, COLOR_PAIR(COLOR_INFO));
-        mvwprintw(info_win, y, 2, "No active threads");
-        wattroff(info_win, COLOR_PAIR(COLOR_INFO));
-    }
-    wrefresh(info_win);
-
-    napms(30);
-    pthread_mutex_unlock(&tui_mutex);
+    if (!atomic_load(&render_running) && render_mode == RENDER_TRAINING)
+        render_frame();
 }
 
 // Show training complete screen
@@ -1503,19 +1613,13 @@ void tui_run_training_threaded(const char *puzzle_file, int iterations, int num_
     IterationHistory last_5[5];
     int history_count = 0;
 
-    struct timespec t_start;
-    clock_gettime(CLOCK_MONOTONIC, &t_start);
+    render_publish_progress(0, num_puzzles, 0);
+    render_start(RENDER_TRAINING, num_threads, 0);
 
     for (int iter = 1; iter <= iterations; iter++) {
-        // Update context so the live callback can reference current iteration
-        g_train_ctx.iteration        = iter;
-        g_train_ctx.total_iterations = iterations;
-        g_train_ctx.best_score       = best_score;
-        g_train_ctx.best_iteration   = best_iteration;
-        memcpy(g_train_ctx.last_5, last_5, sizeof(last_5));
-        g_train_ctx.history_count    = history_count;
-        g_train_ctx.t_start          = t_start;
-        g_train_ctx.learning_rate    = learning_rate;
+        // Publish the iteration header before workers start reporting scores
+        render_publish_training(iter, iterations, 0, best_score, best_iteration,
+                                last_5, history_count, learning_rate);
 
         int score = playPuzzlesMultiThreaded_Train(puzzle_file, learning_rate, num_puzzles, num_threads, training_progress_cb);
 
@@ -1537,14 +1641,12 @@ void tui_run_training_threaded(const char *puzzle_file, int iterations, int num_
             last_5[4].pass_count = score;
         }
 
-        struct timespec t_now;
-        clock_gettime(CLOCK_MONOTONIC, &t_now);
-        int elapsed = (int)(t_now.tv_sec - t_start.tv_sec);
-
         tui_nn_training_display(iter, iterations, score, best_score, best_iteration,
-                                last_5, history_count, elapsed, learning_rate);
+                                last_5, history_count, 0, learning_rate);
     }
 
+    render_stop();
+
     // Show completion screen
     tui_show_training_complete(best_score, iterations);
 }
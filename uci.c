@@ -0,0 +1,444 @@
+/* uci.c - Universal Chess Interface front end
+ *
+ * Started with `./main --uci`.  Reads commands on stdin and answers on
+ * stdout so the engine can be driven by a GUI or a match runner.  Searches
+ * run on the persistent pool in search.c, so this thread stays free to read
+ * `stop`/`quit` while the engine thinks.
+ *
+ * Options:
+ *   Hash    TT size in MB (1..4096, default 64); also the MCTS tree size
+ *   Threads search threads (1..64, default 1)
+ *   Ponder  advertised for GUIs; `go ponder` / `ponderhit` are honoured
+ *   Engine  "Search" (alpha-beta), "NN" (network move picker, no search) or
+ *           "MCTS" (tree search with nn_weights.bin priors, see mcts.h;
+ *           `go nodes` counts playouts, and Eval NN supplies the leaf values)
+ *   OwnBook  play from the opening book when it has the position (default true)
+ *   BookFile book to map (default book.bin, see book.h)
+ *   Eval    search leaf evaluation: "Classical" (hand-crafted) or "NN"
+ *           (value network from value_weights.bin, see value.h)
+ *   NNOrderPlies  plies from the root whose quiet moves the network in
+ *           nn_weights.bin orders (0..8, default 0 = heuristics only)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdarg.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "chess.h"
+#include "book.h"
+#include "mcts.h"
+#include "nn.h"
+#include "search.h"
+#include "value.h"
+
+#define UCI_LINE_MAX 16384
+
+static pthread_mutex_t out_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static SearchPosition uci_pos;
+static int uci_use_nn = 0;
+static int uci_hash_mb = 64;
+static int uci_threads = 1;
+static int uci_own_book = 1;
+static int uci_value_eval = 0;
+static int uci_order_plies = 0;
+static int uci_use_mcts = 0;
+
+/* MCTS runs on its own thread so the command loop can still read `stop` */
+static pthread_t mcts_thread;
+static int mcts_running = 0;
+static atomic_int mcts_stop;
+static int mcts_hold;            /* infinite/ponder: no bestmove before stop */
+static SearchPosition mcts_root;
+static MCTSLimits mcts_limits;
+
+static char nn_held[8];          /* NN bestmove kept back the same way */
+
+/* All output goes through here: search threads print concurrently with
+ * the command loop. */
+static void uci_send(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+static void uci_send(const char *fmt, ...)
+{
+    va_list ap;
+    pthread_mutex_lock(&out_mutex);
+    va_start(ap, fmt);
+    vfprintf(stdout, fmt, ap);
+    va_end(ap);
+    fputc('\n', stdout);
+    fflush(stdout);
+    pthread_mutex_unlock(&out_mutex);
+}
+
+static void format_score(int score, char *out, size_t len)
+{
+    if (score > SEARCH_MATE_BOUND)
+        snprintf(out, len, "mate %d", (SEARCH_MATE - score + 1) / 2);
+    else if (score < -SEARCH_MATE_BOUND)
+        snprintf(out, len, "mate -%d", (SEARCH_MATE + score) / 2);
+    else
+        snprintf(out, len, "cp %d", score);
+}
+
+static void on_info(const SearchResult *r, void *user)
+{
+    const SearchPosition *root = user;
+    char pv[SEARCH_MAX_PLY * 6 + 1] = "";
+    char score[32];
+    size_t used = 0;
+
+    /* Walk the PV on a scratch position so promotion suffixes are right */
+    SearchPosition walk = *root;
+    for (int i = 0; i < r->pv_len; i++) {
+        char mv[8];
+        search_move_to_uci(&walk, r->pv[i], mv);
+        used += (size_t)snprintf(pv + used, sizeof(pv) - used, "%s%s", i ? " " : "", mv);
+        if (used >= sizeof(pv))
+            break;
+        search_position_play(&walk, r->pv[i], -1);
+    }
+
+    format_score(r->score, score, sizeof(score));
+    long long nps = r->time_ms > 0 ? r->nodes * 1000 / r->time_ms : r->nodes;
+    uci_send("info depth %d score %s nodes %lld nps %lld time %d hashfull %d pv %s",
+             r->depth, score, r->nodes, nps, r->time_ms, search_hashfull(), pv);
+}
+
+static void on_done(const SearchResult *r, void *user)
+{
+    const SearchPosition *root = user;
+    char best[8], ponder[8];
+
+    search_move_to_uci(root, r->best, best);
+    if (r->ponder.fromX >= 0) {
+        SearchPosition after = *root;
+        search_position_play(&after, r->best, -1);
+        search_move_to_uci(&after, r->ponder, ponder);
+        uci_send("bestmove %s ponder %s", best, ponder);
+    } else {
+        uci_send("bestmove %s", best);
+    }
+}
+
+/* ── Commands ───────────────────────────────────────────────────────────── */
+
+static void cmd_uci(void)
+{
+    uci_send("id name Sacrifice");
+    uci_send("id author power-emma");
+    uci_send("option name Hash type spin default 64 min 1 max 4096");
+    uci_send("option name Threads type spin default 1 min 1 max %d", SEARCH_MAX_THREADS);
+    uci_send("option name Ponder type check default false");
+    uci_send("option name Engine type combo default Search var Search var NN var MCTS");
+    uci_send("option name OwnBook type check default true");
+    uci_send("option name BookFile type string default %s", BOOK_DEFAULT_PATH);
+    uci_send("option name Eval type combo default Classical var Classical var NN");
+    uci_send("option name NNOrderPlies type spin default 0 min 0 max 8");
+    uci_send("uciok");
+}
+
+/* setoption name <id> [value <x>] */
+static void cmd_setoption(char *args)
+{
+    char *name = strstr(args, "name ");
+    char *value = strstr(args, " value ");
+    if (!name)
+        return;
+    name += 5;
+    if (value) {
+        *value = '\0';
+        value += 7;
+    }
+
+    if (strcasecmp(name, "Hash") == 0 && value) {
+        int mb = atoi(value);
+        if (mb < 1) mb = 1;
+        if (mb > 4096) mb = 4096;
+        uci_hash_mb = mb;
+        search_set_hash(mb);
+    } else if (strcasecmp(name, "Threads") == 0 && value) {
+        int n = atoi(value);
+        if (n < 1) n = 1;
+        if (n > SEARCH_MAX_THREADS) n = SEARCH_MAX_THREADS;
+        uci_threads = n;
+        search_set_threads(n);
+    } else if (strcasecmp(name, "Ponder") == 0) {
+        /* Nothing to configure: the GUI decides when to send `go ponder` */
+    } else if (strcasecmp(name, "Engine") == 0 && value) {
+        uci_use_nn = (strcasecmp(value, "NN") == 0);
+        uci_use_mcts = (strcasecmp(value, "MCTS") == 0);
+        if (uci_use_nn && !g_net.weights) {
+            if (!nn_load(&g_net, "nn_weights.bin"))
+                nn_init(&g_net);
+        }
+        if (uci_use_mcts && !g_net.weights && !nn_load(&g_net, "nn_weights.bin"))
+            uci_send("info string no network at nn_weights.bin, MCTS uses uniform priors");
+    } else if (strcasecmp(name, "Eval") == 0 && value) {
+        int was = uci_value_eval;
+        uci_value_eval = (strcasecmp(value, "NN") == 0);
+        if (uci_value_eval && !value_load(&g_value_net, VALUE_DEFAULT_PATH)) {
+            uci_send("info string no value network at %s, using Classical", VALUE_DEFAULT_PATH);
+            uci_value_eval = 0;
+        }
+        /* TT scores and cached leaves came from the other evaluator (or
+         * from the weights just reloaded) */
+        if (uci_value_eval != was || uci_value_eval)
+            search_clear();
+    } else if (strcasecmp(name, "NNOrderPlies") == 0 && value) {
+        int n = atoi(value);
+        if (n < 0) n = 0;
+        if (n > 8) n = 8;
+        uci_order_plies = n;
+        if (n && !g_net.weights) {
+            if (!nn_load(&g_net, "nn_weights.bin"))
+                nn_init(&g_net);
+        }
+    } else if (strcasecmp(name, "OwnBook") == 0 && value) {
+        uci_own_book = (strcasecmp(value, "true") == 0);
+    } else if (strcasecmp(name, "BookFile") == 0 && value) {
+        if (book_open(value) == 0)
+            uci_send("info string no book at %s", value);
+    } else {
+        uci_send("info string unknown option %s", name);
+    }
+}
+
+/* position [startpos | fen <fen>] [moves <m1> ... <mn>] */
+static void cmd_position(char *args)
+{
+    char *moves = strstr(args, "moves");
+    if (moves)
+        *moves = '\0';
+
+    if (strncmp(args, "startpos", 8) == 0) {
+        search_position_startpos(&uci_pos);
+    } else if (strncmp(args, "fen", 3) == 0) {
+        if (!search_position_from_fen(&uci_pos, args + 3)) {
+            uci_send("info string invalid fen, using startpos");
+            search_position_startpos(&uci_pos);
+        }
+    } else {
+        return;
+    }
+
+    if (!moves)
+        return;
+    char *save = NULL;
+    for (char *tok = strtok_r(moves + 5, " \t", &save); tok; tok = strtok_r(NULL, " \t", &save)) {
+        if (!search_position_play_uci(&uci_pos, tok)) {
+            uci_send("info string illegal move %s", tok);
+            break;
+        }
+    }
+}
+
+/* The NN engine has no search: pick a move directly and answer at once,
+ * or, for infinite/ponder, keep the answer until stop or ponderhit */
+static void go_nn(const SearchLimits *limits)
+{
+    struct Piece scratch[8][8];
+    memcpy(scratch, uci_pos.board, sizeof(scratch));
+
+    struct Move m = nn_pick_move_from(&g_net, scratch, uci_pos.side, &uci_pos.lastMove);
+    char best[8];
+    search_move_to_uci(&uci_pos, m, best);
+    if (limits->infinite || limits->ponder) {
+        memcpy(nn_held, best, sizeof(nn_held));
+        return;
+    }
+    uci_send("bestmove %s", best);
+}
+
+static void nn_release(void)
+{
+    if (nn_held[0]) {
+        uci_send("bestmove %s", nn_held);
+        nn_held[0] = '\0';
+    }
+}
+
+static void *mcts_main(void *arg)
+{
+    (void)arg;
+    SearchResult r = mcts_search(&mcts_root, &mcts_limits, &mcts_stop);
+    /* The arena can fill long before `stop` arrives; as in search.c, an
+     * infinite or ponder search must not report until then */
+    while (mcts_hold && !atomic_load(&mcts_stop)) {
+        struct timespec ms = {0, 1000000};
+        nanosleep(&ms, NULL);
+    }
+    on_info(&r, &mcts_root);
+    on_done(&r, &mcts_root);
+    return NULL;
+}
+
+static void mcts_wait(void)
+{
+    if (mcts_running) {
+        pthread_join(mcts_thread, NULL);
+        mcts_running = 0;
+    }
+}
+
+/* MCTS has no iterations to stop between: the clock becomes a fixed
+ * budget for the move, as search.c plans its soft limit.  There is no depth
+ * either, so `go depth n` and a bare `go` get the default playout budget. */
+static void go_mcts(const SearchLimits *limits)
+{
+    int time = (uci_pos.side == WHITE) ? limits->wtime : limits->btime;
+    int inc = (uci_pos.side == WHITE) ? limits->winc : limits->binc;
+    MCTSLimits m = {0};
+    m.visits = limits->nodes;
+    m.movetime_ms = limits->movetime_ms;
+    if (!m.movetime_ms && time > 0 && !limits->infinite && !limits->ponder) {
+        int mtg = (limits->movestogo > 0) ? limits->movestogo : 30;
+        long long budget = time / mtg + inc * 3 / 4, cap = time - 50;
+        if (cap < 1) cap = 1;
+        m.movetime_ms = (int)(budget < cap ? budget : cap);
+    }
+    int hold = limits->infinite || limits->ponder;
+    if (!m.visits && !m.movetime_ms && !hold)
+        m.visits = MCTS_DEFAULT_VISITS;
+    m.threads = uci_threads;
+    m.arena_nodes = mcts_arena_nodes(uci_hash_mb);
+    m.policy = g_net.weights ? &g_net : NULL;
+    m.value = uci_value_eval ? &g_value_net : NULL;
+
+    mcts_wait();
+    mcts_root = uci_pos;
+    mcts_limits = m;
+    mcts_hold = hold;
+    atomic_store(&mcts_stop, 0);
+    if (pthread_create(&mcts_thread, NULL, mcts_main, NULL) != 0) {
+        uci_send("info string cannot start MCTS thread");
+        uci_send("bestmove 0000");
+        return;
+    }
+    mcts_running = 1;
+}
+
+/* go [depth n] [nodes n] [movetime ms] [wtime ms] [btime ms] [winc ms]
+ *    [binc ms] [movestogo n] [infinite] [ponder] */
+static void cmd_go(char *args)
+{
+    static SearchPosition root;   /* outlives the call: callbacks read it */
+    SearchLimits limits = {0};
+    char *save = NULL;
+
+    for (char *tok = strtok_r(args, " \t", &save); tok; tok = strtok_r(NULL, " \t", &save)) {
+        if (strcmp(tok, "infinite") == 0) {
+            limits.infinite = 1;
+            continue;
+        }
+        if (strcmp(tok, "ponder") == 0) {
+            limits.ponder = 1;
+            continue;
+        }
+        char *val = strtok_r(NULL, " \t", &save);
+        if (!val)
+            break;
+        if (strcmp(tok, "depth") == 0)          limits.depth = atoi(val);
+        else if (strcmp(tok, "nodes") == 0)     limits.nodes = atoll(val);
+        else if (strcmp(tok, "movetime") == 0)  limits.movetime_ms = atoi(val);
+        else if (strcmp(tok, "wtime") == 0)     limits.wtime = atoi(val);
+        else if (strcmp(tok, "btime") == 0)     limits.btime = atoi(val);
+        else if (strcmp(tok, "winc") == 0)      limits.winc = atoi(val);
+        else if (strcmp(tok, "binc") == 0)      limits.binc = atoi(val);
+        else if (strcmp(tok, "movestogo") == 0) limits.movestogo = atoi(val);
+    }
+
+    /* Book hits answer at once; pondering on a book position is pointless */
+    struct Move book_move;
+    int promotion;
+    if (uci_own_book && !limits.ponder && !limits.infinite &&
+        book_pick(&uci_pos, &book_move, &promotion)) {
+        char mv[8];
+        search_wait();
+        mcts_wait();
+        search_move_to_uci(&uci_pos, book_move, mv);
+        if (promotion >= 0 && mv[4])
+            mv[4] = "pnbrqk"[promotion];
+        uci_send("info string book move");
+        uci_send("bestmove %s", mv);
+        return;
+    }
+
+    if (uci_use_nn) {
+        go_nn(&limits);
+        return;
+    }
+    if (uci_use_mcts) {
+        go_mcts(&limits);
+        return;
+    }
+
+    limits.value_net = uci_value_eval ? &g_value_net : NULL;
+    limits.order_net = uci_order_plies ? &g_net : NULL;
+    limits.order_plies = uci_order_plies;
+    search_wait();   /* a previous search must have reported first */
+    root = uci_pos;
+    search_start(&root, &limits, on_info, on_done, &root);
+}
+
+int uci_main(void)
+{
+    static char line[UCI_LINE_MAX];
+
+    setvbuf(stdin, NULL, _IOLBF, 0);
+    search_init(uci_threads, uci_hash_mb);
+    search_position_startpos(&uci_pos);
+
+    while (fgets(line, sizeof(line), stdin)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        char *cmd = line;
+        while (*cmd == ' ' || *cmd == '\t')
+            cmd++;
+        char *args = cmd + strcspn(cmd, " \t");
+        if (*args) {
+            *args++ = '\0';
+            while (*args == ' ' || *args == '\t')
+                args++;
+        }
+
+        if (strcmp(cmd, "uci") == 0) {
+            cmd_uci();
+        } else if (strcmp(cmd, "isready") == 0) {
+            uci_send("readyok");
+        } else if (strcmp(cmd, "ucinewgame") == 0) {
+            search_clear();
+            search_position_startpos(&uci_pos);
+        } else if (strcmp(cmd, "setoption") == 0) {
+            cmd_setoption(args);
+        } else if (strcmp(cmd, "position") == 0) {
+            search_wait();
+            mcts_wait();
+            cmd_position(args);
+        } else if (strcmp(cmd, "go") == 0) {
+            cmd_go(args);
+        } else if (strcmp(cmd, "ponderhit") == 0) {
+            search_ponderhit();
+            if (mcts_running)   /* no clock while pondering: answer from the tree so far */
+                atomic_store(&mcts_stop, 1);
+            nn_release();
+        } else if (strcmp(cmd, "stop") == 0) {
+            search_stop();
+            search_wait();
+            atomic_store(&mcts_stop, 1);
+            mcts_wait();
+            nn_release();
+        } else if (strcmp(cmd, "quit") == 0) {
+            break;
+        } else if (*cmd) {
+            uci_send("info string unknown command %s", cmd);
+        }
+    }
+
+    search_stop();
+    atomic_store(&mcts_stop, 1);
+    mcts_wait();
+    search_shutdown();
+    return 0;
+}
@@ -0,0 +1,254 @@
+/* value.c - small value network (see value.h) */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdint.h>
+
+#include "chess.h"
+#include "dataset.h"
+#include "search.h"
+#include "stats.h"
+#include "value.h"
+
+#define VALUE_MAGIC    "SVN1"
+#define VALUE_VERSION  1
+
+typedef struct {
+    char     magic[4];
+    uint32_t version;
+    uint32_t features, l1, l2;
+} ValueHeader;
+
+ValueNet g_value_net;
+
+/* ════════════════════════════════════════════════════════════════════════════
+ * Features and forward pass
+ * ════════════════════════════════════════════════════════════════════════════ */
+
+/* Active feature indices for side to move; returns how many (at most 32) */
+static int value_features(const struct Piece b[8][8], enum Colour side, int f[32])
+{
+    int n = 0;
+    for (int x = 0; x < 8; x++)
+        for (int y = 0; y < 8; y++) {
+            const struct Piece *p = &b[x][y];
+            if (p->type == (enum PieceType)-1 || n == 32)
+                continue;
+            int rank = (side == WHITE) ? y : 7 - y;
+            int kind = (p->colour == side ? 0 : 6) + (int)p->type;
+            f[n++] = kind * 64 + x * 8 + rank;
+        }
+    return n;
+}
+
+static float clipped_relu(float x)
+{
+    return x < 0.0f ? 0.0f : (x > 1.0f ? 1.0f : x);
+}
+
+/* Raw output; fills the hidden activations for training */
+static float value_forward(const ValueNet *net, const int *f, int nf,
+                           float h1[VALUE_L1], float h2[VALUE_L2])
+{
+    memcpy(h1, net->b1, sizeof(net->b1));
+    for (int i = 0; i < nf; i++) {
+        const float *row = net->w1[f[i]];
+        for (int k = 0; k < VALUE_L1; k++)
+            h1[k] += row[k];
+    }
+    for (int k = 0; k < VALUE_L1; k++)
+        h1[k] = clipped_relu(h1[k]);
+
+    float out = net->b3;
+    for (int j = 0; j < VALUE_L2; j++) {
+        float acc = net->b2[j];
+        const float *row = net->w2[j];
+        for (int k = 0; k < VALUE_L1; k++)
+            acc += row[k] * h1[k];
+        h2[j] = clipped_relu(acc);
+        out += net->w3[j] * h2[j];
+    }
+    return out;
+}
+
+int value_evaluate(const ValueNet *net, const struct Piece board[8][8], enum Colour side)
+{
+    int f[32];
+    float h1[VALUE_L1], h2[VALUE_L2];
+    int nf = value_features(board, side, f);
+    float cp = value_forward(net, f, nf, h1, h2) * VALUE_CP_SCALE;
+    stats_inc(STAT_VALUE_EVALS);
+
+    /* Stay clear of the bitbase and mate score bands */
+    if (cp > 10000.0f) cp = 10000.0f;
+    if (cp < -10000.0f) cp = -10000.0f;
+    return (int)lrintf(cp);
+}
+
+/* ════════════════════════════════════════════════════════════════════════════
+ * Initialisation and persistence
+ * ════════════════════════════════════════════════════════════════════════════ */
+
+static float init_uniform(uint64_t *s, float scale)
+{
+    *s ^= *s << 13;
+    *s ^= *s >> 7;
+    *s ^= *s << 17;
+    return ((float)(*s >> 40) / (float)(1 << 24) * 2.0f - 1.0f) * scale;
+}
+
+void value_init(ValueNet *net)
+{
+    uint64_t s = 0x5EED5EED5EEDULL;
+    memset(net, 0, sizeof(*net));
+    /* Fan-in scaling; about 32 of the 768 inputs are active at a time */
+    for (int i = 0; i < VALUE_FEATURES; i++)
+        for (int k = 0; k < VALUE_L1; k++)
+            net->w1[i][k] = init_uniform(&s, 1.0f / sqrtf(32.0f));
+    for (int j = 0; j < VALUE_L2; j++)
+        for (int k = 0; k < VALUE_L1; k++)
+            net->w2[j][k] = init_uniform(&s, 1.0f / sqrtf((float)VALUE_L1));
+    for (int j = 0; j < VALUE_L2; j++)
+        net->w3[j] = init_uniform(&s, 1.0f / sqrtf((float)VALUE_L2));
+}
+
+int value_save(const ValueNet *net, const char *path)
+{
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        fprintf(stderr, "value: cannot create %s\n", path);
+        return 0;
+    }
+    ValueHeader h = {{0}, VALUE_VERSION, VALUE_FEATURES, VALUE_L1, VALUE_L2};
+    memcpy(h.magic, VALUE_MAGIC, 4);
+    int ok = fwrite(&h, sizeof(h), 1, f) == 1 && fwrite(net, sizeof(*net), 1, f) == 1;
+    if (fclose(f) != 0)
+        ok = 0;
+    if (!ok)
+        fprintf(stderr, "value: cannot write %s\n", path);
+    return ok;
+}
+
+int value_load(ValueNet *net, const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f)
+        return 0;
+    ValueHeader h;
+    int ok = fread(&h, sizeof(h), 1, f) == 1 && memcmp(h.magic, VALUE_MAGIC, 4) == 0 &&
+             h.version == VALUE_VERSION && h.features == VALUE_FEATURES &&
+             h.l1 == VALUE_L1 && h.l2 == VALUE_L2;
+    if (!ok)
+        fprintf(stderr, "value: %s is not a value network of this shape\n", path);
+    else if (fread(net, sizeof(*net), 1, f) != 1) {
+        fprintf(stderr, "value: %s is truncated\n", path);
+        ok = 0;
+    }
+    fclose(f);
+    return ok;
+}
+
+/* ════════════════════════════════════════════════════════════════════════════
+ * Training
+ * ════════════════════════════════════════════════════════════════════════════ */
+
+float value_train_step(ValueNet *net, const struct Piece board[8][8], enum Colour side,
+                       float target, float learning_rate)
+{
+    int f[32];
+    float h1[VALUE_L1], h2[VALUE_L2];
+    int nf = value_features(board, side, f);
+    float out = value_forward(net, f, nf, h1, h2);
+
+    float p = 1.0f / (1.0f + expf(-out));
+    float eps = 1e-7f;
+    float loss = -(target * logf(p + eps) + (1.0f - target) * logf(1.0f - p + eps));
+    float g = p - target;   /* d loss / d out */
+
+    /* Clipped ReLU passes gradient only strictly inside (0, 1) */
+    float g2[VALUE_L2], g1[VALUE_L1] = {0};
+    for (int j = 0; j < VALUE_L2; j++) {
+        g2[j] = (h2[j] > 0.0f && h2[j] < 1.0f) ? g * net->w3[j] : 0.0f;
+        net->w3[j] -= learning_rate * g * h2[j];
+    }
+    net->b3 -= learning_rate * g;
+
+    for (int j = 0; j < VALUE_L2; j++) {
+        if (g2[j] == 0.0f)
+            continue;
+        float *row = net->w2[j];
+        for (int k = 0; k < VALUE_L1; k++) {
+            g1[k] += g2[j] * row[k];
+            row[k] -= learning_rate * g2[j] * h1[k];
+        }
+        net->b2[j] -= learning_rate * g2[j];
+    }
+
+    for (int k = 0; k < VALUE_L1; k++)
+        if (!(h1[k] > 0.0f && h1[k] < 1.0f))
+            g1[k] = 0.0f;
+    for (int i = 0; i < nf; i++) {
+        float *row = net->w1[f[i]];
+        for (int k = 0; k < VALUE_L1; k++)
+            row[k] -= learning_rate * g1[k];
+    }
+    for (int k = 0; k < VALUE_L1; k++)
+        net->b1[k] -= learning_rate * g1[k];
+    return loss;
+}
+
+float value_train_dataset(ValueNet *net, const char *path, int epochs, float learning_rate)
+{
+    uint64_t count;
+    const DatasetRecord *recs = dataset_map(path, &count);
+    if (!recs)
+        return -1.0f;
+    uint64_t *order = malloc((count ? count : 1) * sizeof(uint64_t));
+    if (!order) {
+        dataset_unmap(recs, count);
+        return -1.0f;
+    }
+
+    /* Only records with a known result teach the value */
+    uint64_t n = 0;
+    for (uint64_t i = 0; i < count; i++)
+        if (!(recs[i].flags & DATASET_FLAG_NO_RESULT))
+            order[n++] = i;
+
+    double epoch_loss = 0.0;
+    for (int e = 0; e < epochs; e++) {
+        for (uint64_t i = n; i > 1; i--) {
+            uint64_t j = (((uint64_t)rand() << 31) ^ (uint64_t)rand()) % i;
+            uint64_t t = order[i - 1];
+            order[i - 1] = order[j];
+            order[j] = t;
+        }
+
+        double sum = 0.0;
+        for (uint64_t i = 0; i < n; i++) {
+            const DatasetRecord *r = &recs[order[i]];
+            struct Piece b[8][8];
+            dataset_unpack(r, b, NULL);
+            struct Move last = dataset_last_move(r);
+            SearchPosition pos;
+            search_position_from_board(&pos, b, (enum Colour)r->side, &last);
+            float eval = 1.0f / (1.0f + expf(-(float)search_evaluate(&pos) / VALUE_CP_SCALE));
+            float target = VALUE_RESULT_WEIGHT * 0.5f * (float)(r->result + 1) +
+                           (1.0f - VALUE_RESULT_WEIGHT) * eval;
+            sum += value_train_step(net, (const struct Piece (*)[8])b, (enum Colour)r->side,
+                                    target, learning_rate);
+            if ((i + 1) % 100000 == 0)
+                printf("value: epoch %d  %llu/%llu  loss %.4f\n", e + 1,
+                       (unsigned long long)(i + 1), (unsigned long long)n, sum / (double)(i + 1));
+        }
+        epoch_loss = n ? sum / (double)n : 0.0;
+        printf("value: epoch %d done, %llu samples, loss %.4f\n", e + 1,
+               (unsigned long long)n, epoch_loss);
+    }
+
+    free(order);
+    dataset_unmap(recs, count);
+    return (float)epoch_loss;
+}
@@ -0,0 +1,64 @@
+/* value.h - Small value network for alpha-beta leaf evaluation
+ *
+ * Architecture (side-to-move relative: the board is mirrored for Black so
+ * "own" pieces always move up the board):
+ *
+ *   Input  (768, sparse): 12 piece kinds (own P..K, their P..K) × 64 squares;
+ *                         only the ~32 occupied features are ever touched
+ *   Layer 1 (128): clipped ReLU of the summed feature rows + bias
+ *   Layer 2 (32):  clipped ReLU, dense
+ *   Output (1):    linear; sigmoid(output) is the expected game score for
+ *                  the side to move, output × VALUE_CP_SCALE its centipawns
+ *
+ * Cost per position is one row add per piece plus a 128×32 product, small
+ * enough to run at every search leaf (search.h, SearchLimits.value_net).
+ * Trained on a dataset file (dataset.h): the target blends the game result
+ * with the hand-crafted evaluation (search_evaluate), since results alone
+ * are too noisy for a small net to pick up material from.
+ */
+#ifndef VALUE_H
+#define VALUE_H
+
+#include "chess.h"
+
+#define VALUE_FEATURES      768
+#define VALUE_L1            128
+#define VALUE_L2            32
+#define VALUE_CP_SCALE      174.0f  /* 400 / ln 10: logistic score -> centipawns */
+#define VALUE_DEFAULT_PATH  "value_weights.bin"
+#define VALUE_RESULT_WEIGHT 0.5f    /* share of the game result in the target */
+
+typedef struct ValueNet {
+    float w1[VALUE_FEATURES][VALUE_L1];    /* feature-major: a piece adds one row */
+    float b1[VALUE_L1];
+    float w2[VALUE_L2][VALUE_L1];
+    float b2[VALUE_L2];
+    float w3[VALUE_L2];
+    float b3;
+} ValueNet;
+
+/* Global instance used by the UCI "Eval NN" option */
+extern ValueNet g_value_net;
+
+/* Small random weights (fixed seed) */
+void value_init(ValueNet *net);
+
+/* Both return 1 on success, 0 on failure (with a message on stderr). */
+int  value_save(const ValueNet *net, const char *path);
+int  value_load(ValueNet *net, const char *path);
+
+/* Centipawns from the point of view of side.  Thread-safe (read-only). */
+int  value_evaluate(const ValueNet *net, const struct Piece board[8][8], enum Colour side);
+
+/* One SGD step on binary cross-entropy: target is the game score for side
+ * (1 win, 0.5 draw, 0 loss).  Not thread-safe.  Returns the loss. */
+float value_train_step(ValueNet *net, const struct Piece board[8][8], enum Colour side,
+                       float target, float learning_rate);
+
+/* Run `epochs` shuffled passes over the records of a dataset file that
+ * carry a result, each towards VALUE_RESULT_WEIGHT × result + the rest ×
+ * the logistic of the hand-crafted evaluation.  Returns the last epoch's
+ * mean loss, or -1 on error. */
+float value_train_dataset(ValueNet *net, const char *path, int epochs, float learning_rate);
+
+#endif /* VALUE_H */
@@ -0,0 +1,24 @@
+/* zobrist.h - Zobrist position keys shared by the search and GameState
+ *
+ * Keys come from a fixed seed, so they are identical across runs and
+ * processes.  zobrist_init() is idempotent and thread-safe; the key
+ * helpers call it themselves.
+ */
+#ifndef ZOBRIST_H
+#define ZOBRIST_H
+
+#include <stdint.h>
+#include "chess.h"
+
+extern uint64_t zobrist_piece[12][64];   /* [colour * 6 + type][x * 8 + y] */
+extern uint64_t zobrist_side;            /* black to move                 */
+extern uint64_t zobrist_castle[4];       /* K, Q, k, q                     */
+extern uint64_t zobrist_ep[8];           /* en passant file                */
+
+void zobrist_init(void);
+
+/* Key of the piece placement only (no side, castling or en passant), the
+ * notion of "same board" used by the repetition counters. */
+uint64_t zobrist_board_key(const struct Piece board[8][8]);
+
+#endif /* ZOBRIST_H */